@@ -1,6 +1,7 @@
 #ifndef IOD_JSON_HH_
 # define IOD_JSON_HH_
 
+#include <algorithm>
 #include <vector>
 #include <fstream>
 #include <cassert>
@@ -30,17 +31,18 @@ namespace iod {
         Nullable()
         {}
 
-        operator bool() {
+        operator bool() const {
             return !isNull;
         }
 
-        inline bool empty() {
+        inline bool empty() const {
             return isNull;
         }
 
         value_type& operator*() { return obj; }
         value_type* operator->() { return &obj; }
         const value_type& operator*() const { return obj; }
+        const value_type* operator->() const { return &obj; }
         value_type obj{};
         bool isNull{true};
     };
@@ -132,40 +134,72 @@ namespace iod {
 
         static const int LBS = 500;
 
+        // An external buffer the encoder writes into, avoids building
+        // an intermediate std::string
+        struct encode_sink {
+            // @return a pointer to at least n writable bytes, cap is set to the bytes available
+            virtual char *reserve(size_t n, size_t &cap) = 0;
+            // the first n bytes at the pointer returned by reserve were written
+            virtual void commit(size_t n) = 0;
+        };
+
         struct stringstream {
 
             stringstream(int hint_size = 10)
-                    : pos_(0) { str_.reserve(hint_size); }
+                    : pos_(0),
+                      cap_(LBS),
+                      buf_(local_),
+                      sink_(nullptr) { str_.reserve(hint_size); }
+
+            stringstream(encode_sink &sink, size_t hint_size = LBS)
+                    : pos_(0),
+                      sink_(&sink) { buf_ = sink.reserve(std::max<size_t>(hint_size, LBS), cap_); }
+
+            stringstream(const stringstream &) = delete;
+            stringstream &operator=(const stringstream &) = delete;
 
             inline void append(const char t) {
-                if (pos_ == LBS)
-                    flush();
+                if (pos_ == cap_)
+                    flush(1);
                 buf_[pos_] = t;
                 pos_++;
             }
 
             inline void append(const stringview s) {
-                const char *begin = s.data();
-                const char *end = s.data() + s.size();
+                size_t n = s.size();
+                if (pos_ + n > cap_) {
+                    flush(n);
+                    if (n > cap_) {
+                        // only when writing into str_
+                        str_.append(s.data(), n);
+                        return;
+                    }
+                }
 
-                while (int(end - begin) > (LBS - pos_)) {
-                    flush();
-                    int to_write = std::min(int(end - begin), LBS);
+                memcpy(buf_ + pos_, s.data(), n);
+                pos_ += n;
+            }
 
-                    memcpy(buf_, begin, to_write);
-                    begin += to_write;
-                    pos_ += to_write;
+            inline void flush(size_t need = 0) {
+                if (sink_ != nullptr) {
+                    finish();
+                    if (need > cap_)
+                        buf_ = sink_->reserve(std::max<size_t>(need, LBS), cap_);
+                    return;
                 }
 
-                memcpy(buf_ + pos_, begin, end - begin);
-
-                pos_ += end - begin;
+                str_.append(buf_, pos_);
+                pos_ = 0;
             }
 
-            inline void flush() {
-                str_.resize(str_.size() + pos_);
-                memcpy(&(str_)[0] + str_.size() - pos_, buf_, pos_);
-                pos_ = 0;
+            // commits what was written into the sink
+            void finish() {
+                if (sink_ != nullptr && pos_ > 0) {
+                    sink_->commit(pos_);
+                    buf_ += pos_;
+                    cap_ -= pos_;
+                    pos_ = 0;
+                }
             }
 
             const std::string &str() {
@@ -180,8 +214,11 @@ namespace iod {
                 return std::move(str_);
             }
 
-            int pos_;
-            char buf_[LBS];
+            size_t pos_;
+            size_t cap_;
+            char *buf_;
+            encode_sink *sink_;
+            char local_[LBS];
             std::string str_;
         };
 
@@ -362,11 +399,11 @@ namespace iod {
             ss << '{';
             int i = 0;
             bool first = true;
-            foreach(o) | [&](auto m) {
+            foreach(o) | [&](const auto& m) {
                 if (!m.attributes().has(_json_skip)) {
                     /* ignore empty entry */
-                    auto val = m.value();
-                    if (m.attributes().has(_ignore) && json_ignore<decltype(val)>(val)) return;
+                    const auto& val = m.value();
+                    if (m.attributes().has(_ignore) && json_ignore<std::decay_t<decltype(val)>>(val)) return;
 
                     if (!first) { ss << ','; }
                     first = false;
@@ -599,7 +636,8 @@ namespace iod {
                     if (str[end] == '"') break;
 
                     end++;
-                    switch (str[end]) {
+                    char esc = str[end];
+                    switch (esc) {
                         case '\'':
                             append_char('\'');
                             break;
@@ -658,6 +696,8 @@ namespace iod {
                             break;
                     }
 
+                    // \u sequences are consumed by the decoder
+                    if (esc != 'u') end++;
                     start = end;
                 }
                 flush();
@@ -771,11 +811,11 @@ namespace iod {
             inline json_parser &fill(unsigned int &val) { return fill_int<unsigned int, 10>(val); }
 
             inline json_parser &fill(bool &t) {
-                if ((str.size()>(pos+4)) && (strncmp(&str[pos], "true", 4) ==0)) {
+                if ((str.size()>=(pos+4)) && (strncmp(&str[pos], "true", 4) ==0)) {
                     pos += 4;
                     t = true;
                 }
-                else if ((str.size()>(pos+5)) && (strncmp(&str[pos], "false", 5) ==0)) {
+                else if ((str.size()>=(pos+5)) && (strncmp(&str[pos], "false", 5) ==0)) {
                     pos += 5;
                     t =  false;
                 }
@@ -784,6 +824,7 @@ namespace iod {
                     auto err = "cannot deserialize '" + str.substr(pos, max).to_std_string() + "' into boolean type";
                     throw std::runtime_error(err);
                 }
+                return *this;
             }
 
             template<typename T>
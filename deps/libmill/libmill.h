@@ -718,6 +718,8 @@ MILL_EXPORT ssize_t mill_sslsend_(
 MILL_EXPORT void mill_sslflush_(
     struct mill_sslsock_ *s,
     int64_t deadline);
+MILL_EXPORT void mill_sslshutdown_(
+    struct mill_sslsock_ *s, int how);
 MILL_EXPORT void mill_sslclose_(
     struct mill_sslsock_ *s);
 
@@ -732,6 +734,7 @@ typedef struct mill_sslsock_ *mill_sslsock;
 #define mill_sslrecvuntil mill_sslrecvuntil_
 #define mill_sslsend mill_sslsend_
 #define mill_sslflush mill_sslflush_
+#define mill_sslshutdown mill_sslshutdown_
 #define mill_sslclose mill_sslclose_
 #else
 typedef struct mill_sslsock_ *sslsock;
@@ -744,6 +747,7 @@ typedef struct mill_sslsock_ *sslsock;
 #define sslrecvuntil mill_sslrecvuntil_
 #define sslsend mill_sslsend_
 #define sslflush mill_sslflush_
+#define sslshutdown mill_sslshutdown_
 #define sslclose mill_sslclose_
 #endif
 
@@ -156,6 +156,13 @@ static int ssl_wait(struct mill_sslconn *c, int64_t deadline) {
     return -1;  /* should not happen ? */
 }
 
+void mill_sslshutdown_(struct mill_sslsock_ *s, int how) {
+    if(s->type != MILL_SSLCONN)
+        mill_panic("trying to shutdown an unconnected socket");
+    struct mill_sslconn *c = (struct mill_sslconn*)s;
+    tcpshutdown(c->s, how);
+}
+
 void mill_sslclose_(struct mill_sslsock_ *s) {
     switch(s->type) {
     case MILL_SSLLISTENER:;
@@ -2,26 +2,64 @@
 // Created by dc on 09/11/18.
 //
 
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
 #include "buffer.h"
 #include "base64.h"
 
 namespace suil {
 
-    namespace utils {
+    namespace utils::base64 {
 
-        String base64::encode(const uint8_t *data, size_t sz) {
-            OBuffer ob{};
-            encode(ob, data, sz);
-            return String(ob);
+        struct alphabet_t {
+            char    table[65];
+            uint8_t lookup[256];
+            char    c62;
+            char    c63;
+            bool    pad;
+        };
+
+        constexpr alphabet_t alphabet(char c62, char c63, bool pad) {
+            alphabet_t a{};
+            for (int i = 0; i < 26; i++) {
+                a.table[i]    = (char) ('A' + i);
+                a.table[26+i] = (char) ('a' + i);
+            }
+            for (int i = 0; i < 10; i++)
+                a.table[52+i] = (char) ('0' + i);
+            a.table[62] = c62;
+            a.table[63] = c63;
+            /* 64 marks characters which are not in the alphabet */
+            for (int i = 0; i < 256; i++)
+                a.lookup[i] = 64;
+            for (int i = 0; i < 64; i++)
+                a.lookup[(uint8_t) a.table[i]] = (uint8_t) i;
+            a.c62 = c62;
+            a.c63 = c63;
+            a.pad = pad;
+            return a;
         }
 
-        void base64::encode(OBuffer& ob, const uint8_t *data, size_t sz) {
-            static char b64table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
-            ob.reserve(2+((sz+2)/3*4));
+        /* RFC 4648 base64 and the URL and filename safe base64url (not padded) */
+        constexpr alphabet_t STANDARD = alphabet('+', '/', true);
+        constexpr alphabet_t URL      = alphabet('-', '_', false);
+
+        /*
+         * The kernels encode (decode) as many whole blocks of the input as they can and
+         * return the number of bytes consumed, the scalar code takes care of the rest.
+         * Decoding kernels stop at the first block with a character that is not in the
+         * alphabet, leaving it to the scalar code to report.
+         */
+        typedef size_t (*encode_t)(char *out, const uint8_t *in, size_t len, const alphabet_t& a);
+        typedef size_t (*decode_t)(uint8_t *out, const uint8_t *in, size_t len, const alphabet_t& a);
 
-            char *out = ob.data();
+        size_t encode_scalar(char *out, const uint8_t *data, size_t sz, const alphabet_t& a) {
+            const char *b64table = a.table;
             char *it = out;
-            while (sz >= 3) {
+            size_t n = sz - (sz % 3);
+            for (size_t i = 0; i < n; i += 3) {
                 // |X|X|X|X|X|X|-|-|
                 *it++ = b64table[((*data & 0xFC) >> 2)];
                 // |-|-|-|-|-|-|X|X|
@@ -34,110 +72,348 @@ namespace suil {
                 *it++ = b64table[h | ((*data & 0xC0) >> 6)];
                 // |-|-|X|X|X|X|X|X|
                 *it++ = b64table[(*data++ & 0x3F)];
-                sz -= 3;
             }
+            return n;
+        }
+
+        size_t decode_scalar(uint8_t *out, const uint8_t *in, size_t len, const alphabet_t& a) {
+            const uint8_t *lookup = a.lookup;
+            size_t n = len & ~size_t(3);
+            for (size_t i = 0; i < n; i += 4) {
+                uint8_t c0 = lookup[in[i]], c1 = lookup[in[i+1]],
+                        c2 = lookup[in[i+2]], c3 = lookup[in[i+3]];
+                if ((c0 | c1 | c2 | c3) & 0x40) {
+                    // invalid base64 character
+                    throw Exception::invalidArguments("utils::base64::decode - invalid base64 encoded string passed");
+                }
+                *out++ = (uint8_t) (c0 << 2 | c1 >> 4);
+                *out++ = (uint8_t) (c1 << 4 | c2 >> 2);
+                *out++ = (uint8_t) (c2 << 6 | c3);
+            }
+            return n;
+        }
+
+#if defined(__x86_64__) || defined(__i386__)
+        /*
+         * Vectorized encoding and decoding (W. Mula and D. Lemire, "Faster Base64
+         * Encoding and Decoding Using AVX2 Instructions"), the SSSE3 kernels
+         * encode 12 bytes (decode 16 characters) per iteration and the AVX2
+         * kernels twice as much.
+         */
+        __attribute__((target("ssse3")))
+        size_t encode_ssse3(char *out, const uint8_t *in, size_t len, const alphabet_t& a) {
+            const __m128i shuffle = _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1);
+            /* offsets added to the 6-bit values, see translation below */
+            const __m128i offsets = _mm_setr_epi8('a'-26, '0'-52, '0'-52, '0'-52, '0'-52, '0'-52, '0'-52,
+                    '0'-52, '0'-52, '0'-52, '0'-52, (char) (a.c62-62), (char) (a.c63-63), 'A', 0, 0);
+            size_t i{0};
+            for (; len - i >= 16; i += 12, out += 16) {
+                /* each 32-bit lane gets the 3 bytes it encodes */
+                __m128i v = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) &in[i]), shuffle);
+                /* split the 24 bits of each lane into four 6-bit values */
+                __m128i t0 = _mm_mulhi_epu16(_mm_and_si128(v, _mm_set1_epi32(0x0fc0fc00)),
+                                             _mm_set1_epi32(0x04000040));
+                __m128i t1 = _mm_mullo_epi16(_mm_and_si128(v, _mm_set1_epi32(0x003f03f0)),
+                                             _mm_set1_epi32(0x01000010));
+                __m128i idx = _mm_or_si128(t0, t1);
+                /* 0..25 -> 13, 26..51 -> 0, 52..61 -> 1..10, 62 -> 11, 63 -> 12 */
+                __m128i r = _mm_subs_epu8(idx, _mm_set1_epi8(51));
+                r = _mm_or_si128(r, _mm_and_si128(_mm_cmpgt_epi8(_mm_set1_epi8(26), idx), _mm_set1_epi8(13)));
+                r = _mm_add_epi8(_mm_shuffle_epi8(offsets, r), idx);
+                _mm_storeu_si128((__m128i *) out, r);
+            }
+            return i;
+        }
+
+        __attribute__((target("ssse3")))
+        size_t decode_ssse3(uint8_t *out, const uint8_t *in, size_t len, const alphabet_t& a) {
+            const __m128i pack = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+            size_t i{0};
+            for (; len - i >= 16; i += 16, out += 12) {
+                __m128i c = _mm_loadu_si128((const __m128i *) &in[i]);
+                /* characters above 127 are negative and fall out of all ranges */
+                __m128i upper = _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('A'-1)),
+                                              _mm_cmpgt_epi8(_mm_set1_epi8('Z'+1), c));
+                __m128i lower = _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('a'-1)),
+                                              _mm_cmpgt_epi8(_mm_set1_epi8('z'+1), c));
+                __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('0'-1)),
+                                              _mm_cmpgt_epi8(_mm_set1_epi8('9'+1), c));
+                __m128i c62 = _mm_cmpeq_epi8(c, _mm_set1_epi8(a.c62));
+                __m128i c63 = _mm_cmpeq_epi8(c, _mm_set1_epi8(a.c63));
+                __m128i valid = _mm_or_si128(_mm_or_si128(upper, lower), _mm_or_si128(digit, _mm_or_si128(c62, c63)));
+                if (_mm_movemask_epi8(valid) != 0xFFFF)
+                    break;
+
+                __m128i shift = _mm_or_si128(
+                        _mm_or_si128(_mm_and_si128(upper, _mm_set1_epi8(-65)), _mm_and_si128(lower, _mm_set1_epi8(-71))),
+                        _mm_or_si128(_mm_and_si128(digit, _mm_set1_epi8(4)),
+                                     _mm_or_si128(_mm_and_si128(c62, _mm_set1_epi8((char) (62-a.c62))),
+                                                  _mm_and_si128(c63, _mm_set1_epi8((char) (63-a.c63))))));
+                __m128i v = _mm_add_epi8(c, shift);
+                /* merge the four 6-bit values of each lane into 3 bytes */
+                v = _mm_maddubs_epi16(v, _mm_set1_epi32(0x01400140));
+                v = _mm_madd_epi16(v, _mm_set1_epi32(0x00011000));
+                /* 16 bytes are stored, only the first 12 are valid */
+                _mm_storeu_si128((__m128i *) out, _mm_shuffle_epi8(v, pack));
+            }
+            return i;
+        }
+
+        __attribute__((target("avx2")))
+        size_t encode_avx2(char *out, const uint8_t *in, size_t len, const alphabet_t& a) {
+            const __m256i shuffle = _mm256_broadcastsi128_si256(
+                    _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+            const __m256i offsets = _mm256_broadcastsi128_si256(
+                    _mm_setr_epi8('a'-26, '0'-52, '0'-52, '0'-52, '0'-52, '0'-52, '0'-52,
+                    '0'-52, '0'-52, '0'-52, '0'-52, (char) (a.c62-62), (char) (a.c63-63), 'A', 0, 0));
+            size_t i{0};
+            for (; len - i >= 28; i += 24, out += 32) {
+                /* 12 bytes per 128-bit lane */
+                __m256i v = _mm256_inserti128_si256(
+                        _mm256_castsi128_si256(_mm_loadu_si128((const __m128i *) &in[i])),
+                        _mm_loadu_si128((const __m128i *) &in[i+12]), 1);
+                v = _mm256_shuffle_epi8(v, shuffle);
+                __m256i t0 = _mm256_mulhi_epu16(_mm256_and_si256(v, _mm256_set1_epi32(0x0fc0fc00)),
+                                                _mm256_set1_epi32(0x04000040));
+                __m256i t1 = _mm256_mullo_epi16(_mm256_and_si256(v, _mm256_set1_epi32(0x003f03f0)),
+                                                _mm256_set1_epi32(0x01000010));
+                __m256i idx = _mm256_or_si256(t0, t1);
+                __m256i r = _mm256_subs_epu8(idx, _mm256_set1_epi8(51));
+                r = _mm256_or_si256(r, _mm256_and_si256(_mm256_cmpgt_epi8(_mm256_set1_epi8(26), idx),
+                                                        _mm256_set1_epi8(13)));
+                r = _mm256_add_epi8(_mm256_shuffle_epi8(offsets, r), idx);
+                _mm256_storeu_si256((__m256i *) out, r);
+            }
+            return i;
+        }
+
+        __attribute__((target("avx2")))
+        size_t decode_avx2(uint8_t *out, const uint8_t *in, size_t len, const alphabet_t& a) {
+            const __m256i pack = _mm256_broadcastsi128_si256(
+                    _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+            /* moves the 12 bytes of the upper lane next to those of the lower lane */
+            const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, -1, -1);
+            size_t i{0};
+            for (; len - i >= 32; i += 32, out += 24) {
+                __m256i c = _mm256_loadu_si256((const __m256i *) &in[i]);
+                __m256i upper = _mm256_and_si256(_mm256_cmpgt_epi8(c, _mm256_set1_epi8('A'-1)),
+                                                 _mm256_cmpgt_epi8(_mm256_set1_epi8('Z'+1), c));
+                __m256i lower = _mm256_and_si256(_mm256_cmpgt_epi8(c, _mm256_set1_epi8('a'-1)),
+                                                 _mm256_cmpgt_epi8(_mm256_set1_epi8('z'+1), c));
+                __m256i digit = _mm256_and_si256(_mm256_cmpgt_epi8(c, _mm256_set1_epi8('0'-1)),
+                                                 _mm256_cmpgt_epi8(_mm256_set1_epi8('9'+1), c));
+                __m256i c62 = _mm256_cmpeq_epi8(c, _mm256_set1_epi8(a.c62));
+                __m256i c63 = _mm256_cmpeq_epi8(c, _mm256_set1_epi8(a.c63));
+                __m256i valid = _mm256_or_si256(_mm256_or_si256(upper, lower),
+                                                _mm256_or_si256(digit, _mm256_or_si256(c62, c63)));
+                if (_mm256_movemask_epi8(valid) != -1)
+                    break;
+
+                __m256i shift = _mm256_or_si256(
+                        _mm256_or_si256(_mm256_and_si256(upper, _mm256_set1_epi8(-65)),
+                                        _mm256_and_si256(lower, _mm256_set1_epi8(-71))),
+                        _mm256_or_si256(_mm256_and_si256(digit, _mm256_set1_epi8(4)),
+                                        _mm256_or_si256(_mm256_and_si256(c62, _mm256_set1_epi8((char) (62-a.c62))),
+                                                        _mm256_and_si256(c63, _mm256_set1_epi8((char) (63-a.c63))))));
+                __m256i v = _mm256_add_epi8(c, shift);
+                v = _mm256_maddubs_epi16(v, _mm256_set1_epi32(0x01400140));
+                v = _mm256_madd_epi16(v, _mm256_set1_epi32(0x00011000));
+                v = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(v, pack), lanes);
+                /* 32 bytes are stored, only the first 24 are valid */
+                _mm256_storeu_si256((__m256i *) out, v);
+            }
+            return i;
+        }
+#endif
+
+        size_t encode_none(char *, const uint8_t *, size_t, const alphabet_t&) {
+            return 0;
+        }
+
+        size_t decode_none(uint8_t *, const uint8_t *, size_t, const alphabet_t&) {
+            return 0;
+        }
+
+        struct kernel_t {
+            const char *name;
+            encode_t    encode;
+            decode_t    decode;
+            bool        supported;
+        };
+
+#if defined(__x86_64__) || defined(__i386__)
+        /* the kernels are selected during static initialization */
+        bool has_avx2() {
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2") != 0;
+        }
+
+        bool has_ssse3() {
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("ssse3") != 0;
+        }
+#endif
+
+        const kernel_t KERNELS[] = {
+#if defined(__x86_64__) || defined(__i386__)
+            {"avx2",   encode_avx2,  decode_avx2,  has_avx2()},
+            {"ssse3",  encode_ssse3, decode_ssse3, has_ssse3()},
+#endif
+            {"scalar", encode_none,  decode_none,  true}
+        };
+
+        const kernel_t* select_kernel() {
+            for (auto& k: KERNELS) {
+                if (k.supported)
+                    return &k;
+            }
+            return &KERNELS[sizeof(KERNELS)/sizeof(KERNELS[0]) - 1];
+        }
+
+        /* the kernel used by the codec, picked once for the CPU */
+        const kernel_t* KERNEL = select_kernel();
+
+        size_t encode(char *out, const uint8_t *data, size_t sz, const alphabet_t& a) {
+            size_t i = KERNEL->encode(out, data, sz, a);
+            i += encode_scalar(&out[i/3*4], &data[i], sz-i, a);
+            char *it = &out[i/3*4];
+            data += i;
+            sz -= i;
 
             if (sz == 1) {
                 // pad with ==
                 // |X|X|X|X|X|X|-|-|
-                *it++ = b64table[((*data & 0xFC) >> 2)];
+                *it++ = a.table[((*data & 0xFC) >> 2)];
                 // |-|-|-|-|-|-|X|X|
                 uint8_t h = (uint8_t) (*data++ & 0x03) << 4;
-                *it++ = b64table[h];
-                *it++ = '=';
-                *it++ = '=';
+                *it++ = a.table[h];
+                if (a.pad) {
+                    *it++ = '=';
+                    *it++ = '=';
+                }
             } else if (sz == 2) {
                 // pad with =
                 // |X|X|X|X|X|X|-|-|
-                *it++ = b64table[((*data & 0xFC) >> 2)];
+                *it++ = a.table[((*data & 0xFC) >> 2)];
                 // |-|-|-|-|-|-|X|X|
                 uint8_t h = (uint8_t) (*data++ & 0x03) << 4;
                 // |-|-|-|-|-|-|X|X|_|X|X|X|X|-|-|-|-|
-                *it++ = b64table[h | ((*data & 0xF0) >> 4)];
+                *it++ = a.table[h | ((*data & 0xF0) >> 4)];
                 // |-|-|-|-|X|X|X|X|
                 h = (uint8_t) (*data++ & 0x0F) << 2;
-                *it++ = b64table[h];
-                *it++ = '=';
+                *it++ = a.table[h];
+                if (a.pad)
+                    *it++ = '=';
             }
 
             *it = '\0';
-            // own the memory
-            ob.bseek(it-out);
+            return it-out;
+        }
+
+        /* the decoding kernels store up to 8 bytes past the decoded data */
+        constexpr size_t DECODE_SLACK{8};
+
+        size_t decode(uint8_t *out, const uint8_t *in, size_t size, const alphabet_t& a) {
+            /* padding is optional with either alphabet */
+            if (size && in[size-1] == '=')
+                size--;
+            if (size && in[size-1] == '=')
+                size--;
+            if ((size % 4) == 1) {
+                // a single character cannot encode a byte
+                throw Exception::invalidArguments("utils::base64::decode - invalid base64 encoded string passed");
+            }
+
+            size_t i = KERNEL->decode(out, in, size, a);
+            i += decode_scalar(&out[i/4*3], &in[i], size-i, a);
+            uint8_t *it = &out[i/4*3];
+            size_t rem = size-i;
+            if (rem > 1) {
+                uint8_t c0 = a.lookup[in[i]], c1 = a.lookup[in[i+1]],
+                        c2 = (rem > 2)? a.lookup[in[i+2]] : 0;
+                if ((c0 | c1 | c2) & 0x40) {
+                    // invalid base64 character
+                    throw Exception::invalidArguments("utils::base64::decode - invalid base64 encoded string passed");
+                }
+                *it++ = (uint8_t) (c0 << 2 | c1 >> 4);
+                if (rem > 2)
+                    *it++ = (uint8_t) (c1 << 4 | c2 >> 2);
+            }
+            return it-out;
+        }
+
+        void encode(OBuffer& ob, const uint8_t *data, size_t sz, const alphabet_t& a) {
+            ob.reserve(2+((sz+2)/3*4));
+            // encoded in place, after the current contents
+            ob.seek(encode(&ob.data()[ob.size()], data, sz, a));
+        }
+
+        void decode(OBuffer& ob, const uint8_t *in, size_t size, const alphabet_t& a) {
+            ob.reserve(((size+3)/4*3) + DECODE_SLACK + 1);
+            // decoded in place, after the current contents
+            auto out = (uint8_t *) &ob.data()[ob.size()];
+            size_t n = decode(out, in, size, a);
+            out[n] = '\0';
+            ob.seek(n);
+        }
+    }
+
+    namespace utils {
+
+        String base64::encode(const uint8_t *data, size_t sz) {
+            OBuffer ob{(uint32_t) (2+((sz+2)/3*4))};
+            encode(ob, data, sz);
+            return String(ob);
+        }
+
+        void base64::encode(OBuffer& ob, const uint8_t *data, size_t sz) {
+            encode(ob, data, sz, STANDARD);
+        }
+
+        size_t base64::encode(char *out, const uint8_t *data, size_t sz) {
+            return encode(out, data, sz, STANDARD);
         }
 
         String base64::decode(const uint8_t *in, size_t size) {
-            OBuffer b((uint32_t) (size/4)*3);
+            OBuffer b((uint32_t) ((size+3)/4*3 + DECODE_SLACK + 1));
             decode(b, in, size);
             return String{b};
         }
 
         void base64::decode(OBuffer& ob, const uint8_t *in, size_t size) {
-            ob.reserve((uint32_t) (size/4)*3);
-            static const unsigned char ASCII_LOOKUP[256] =
-            {
-                /* ASCII table */
-                64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64,
-                64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64,
-                64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 62, 64, 64, 64, 63,
-                52, 53, 54, 55, 56, 57, 58, 59, 60, 61, 64, 64, 64, 64, 64, 64,
-                64,  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14,
-                15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 64, 64, 64, 64, 64,
-                64, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40,
-                41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51, 64, 64, 64, 64, 64,
-                64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64,
-                64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64,
-                64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64,
-                64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64,
-                64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64,
-                64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64,
-                64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64,
-                64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64, 64
-            };
-            size_t sz = size, pos{0};
-            const uint8_t *it = in;
-            char *data = ob.data();
-
-            while (sz > 4) {
-                if (ASCII_LOOKUP[it[0]] == 64 ||
-                    ASCII_LOOKUP[it[1]] == 64 ||
-                    ASCII_LOOKUP[it[2]] == 64 ||
-                    ASCII_LOOKUP[it[3]] == 64)
-                {
-                    // invalid base64 character
-                    throw Exception::invalidArguments("utils::base64::decode - invalid base64 encoded string passed");
-                }
+            decode(ob, in, size, STANDARD);
+        }
 
-                data[pos++] = ((uint8_t)(ASCII_LOOKUP[it[0]] << 2 | ASCII_LOOKUP[it[1]] >> 4));
-                data[pos++] = ((uint8_t)(ASCII_LOOKUP[it[1]] << 4 | ASCII_LOOKUP[it[2]] >> 2));
-                data[pos++] = ((uint8_t)(ASCII_LOOKUP[it[2]] << 6 | ASCII_LOOKUP[it[3]]));
-                sz -= 4;
-                it += 4;
-            }
-            int i = 0;
-            while ((it[i] != '=') && (ASCII_LOOKUP[it[i]] != 64) && (i++ < 4));
-            if ((sz-i) && (it[i] != '=')) {
-                // invalid base64 character
-                throw Exception::invalidArguments("utils::base64::decode - invalid base64 encoded string passed");
-            }
-            sz -= 4-i;
+        String base64url::encode(const uint8_t *data, size_t sz) {
+            OBuffer ob{(uint32_t) (2+((sz+2)/3*4))};
+            encode(ob, data, sz);
+            return String(ob);
+        }
 
-            if (sz > 1) {
-                data[pos++] = ((uint8_t)(ASCII_LOOKUP[it[0]] << 2 | ASCII_LOOKUP[it[1]] >> 4));
-            }
-            if (sz > 2) {
-                data[pos++] = ((uint8_t)(ASCII_LOOKUP[it[1]] << 4 | ASCII_LOOKUP[it[2]] >> 2));
-            }
-            if (sz > 3) {
-                data[pos++] = ((uint8_t)(ASCII_LOOKUP[it[2]] << 6 | ASCII_LOOKUP[it[3]]));
-            }
+        void base64url::encode(OBuffer& ob, const uint8_t *data, size_t sz) {
+            base64::encode(ob, data, sz, base64::URL);
+        }
+
+        size_t base64url::encode(char *out, const uint8_t *data, size_t sz) {
+            return base64::encode(out, data, sz, base64::URL);
+        }
+
+        String base64url::decode(const uint8_t *in, size_t size) {
+            OBuffer b((uint32_t) ((size+3)/4*3 + base64::DECODE_SLACK + 1));
+            decode(b, in, size);
+            return String{b};
+        }
 
-            ob.seek(pos);
+        void base64url::decode(OBuffer& ob, const uint8_t *in, size_t size) {
+            base64::decode(ob, in, size, base64::URL);
         }
     }
 }
 
 #ifdef unit_test
 #include <catch/catch.hpp>
+#include <chrono>
+#include <random>
 
 using namespace suil;
 
@@ -199,5 +475,111 @@ TEST_CASE("base64 encoding", "[common][utils][base64]")
     }
 }
 
+TEST_CASE("base64url encoding", "[common][utils][base64]")
+{
+    SECTION("url safe alphabet without padding") {
+        const uint8_t raw[] = {0xfb, 0xff, 0xbf, 0x01};
+        String b64 = utils::base64::encode(raw, sizeof(raw));
+        CHECK(b64.compare("+/+/AQ==") == 0);
+        String url = utils::base64url::encode(raw, sizeof(raw));
+        CHECK(url.compare("-_-_AQ") == 0);
+        REQUIRE(String((const char *) raw, sizeof(raw), false) == utils::base64url::decode(url));
+        // padding is optional
+        REQUIRE(String((const char *) raw, sizeof(raw), false) == utils::base64url::decode("-_-_AQ=="));
+        REQUIRE(String((const char *) raw, sizeof(raw), false) == utils::base64::decode("+/+/AQ"));
+        // alphabets are not mixed
+        CHECK_THROWS(utils::base64::decode(url));
+        CHECK_THROWS(utils::base64url::decode(b64));
+        CHECK_THROWS(utils::base64::decode("QUJDR"));
+    }
+
+    SECTION("encoding and decoding append to buffers") {
+        OBuffer ob{8};
+        ob << "Basic ";
+        utils::base64::encode(ob, (const uint8_t *) "Hello World!", 12);
+        CHECK(strview(ob.data(), ob.size()) == "Basic SGVsbG8gV29ybGQh");
+        OBuffer raw{8};
+        raw << "> ";
+        utils::base64::decode(raw, (const uint8_t *) &ob.data()[6], ob.size()-6);
+        CHECK(strview(raw.data(), raw.size()) == "> Hello World!");
+    }
+
+    SECTION("vectorized kernels match the scalar code") {
+        std::mt19937 gen(0xb64);
+        std::uniform_int_distribution<int> dist(0, 255);
+        std::vector<uint8_t> data(1000);
+        for (auto& b: data)
+            b = (uint8_t) dist(gen);
+
+        auto saved = utils::base64::KERNEL;
+        for (auto& k: utils::base64::KERNELS) {
+            if (!k.supported)
+                continue;
+            for (size_t len: {0, 1, 2, 3, 11, 12, 15, 16, 17, 27, 28, 29, 31, 32, 33, 64, 100, 999, 1000}) {
+                for (bool url: {false, true}) {
+                    utils::base64::KERNEL = &utils::base64::KERNELS[sizeof(utils::base64::KERNELS)/sizeof(utils::base64::KERNELS[0])-1];
+                    String expected = url? utils::base64url::encode(data.data(), len) :
+                                           utils::base64::encode(data.data(), len);
+                    utils::base64::KERNEL = &k;
+                    String encoded = url? utils::base64url::encode(data.data(), len) :
+                                          utils::base64::encode(data.data(), len);
+                    CHECK(encoded == expected);
+                    String decoded = url? utils::base64url::decode(encoded) : utils::base64::decode(encoded);
+                    CHECK(decoded == String((const char *) data.data(), len, false));
+                }
+            }
+
+            // invalid characters within a vectorized block are reported
+            String encoded = utils::base64::encode(data.data(), 600);
+            for (size_t pos: {0, 5, 17, 31, 32, 400, 799}) {
+                std::string bad(encoded.data(), encoded.size());
+                bad[pos] = (pos % 2)? '*' : (char) 0xC3;
+                CHECK_THROWS(utils::base64::decode((const uint8_t *) bad.data(), bad.size()));
+            }
+        }
+        utils::base64::KERNEL = saved;
+    }
+}
+
+TEST_CASE("base64 benchmark", "[.][benchmark][base64]")
+{
+    using Clock = std::chrono::steady_clock;
+    std::mt19937 gen(0xb64);
+    std::uniform_int_distribution<int> dist(0, 255);
+    std::vector<uint8_t> data(1024*1024);
+    for (auto& b: data)
+        b = (uint8_t) dist(gen);
+    const int rounds = 50;
 
-#endif
\ No newline at end of file
+    auto mbps = [&](auto d, size_t size) {
+        auto us = std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+        return (size * rounds) / (double) (us? us : 1);
+    };
+
+    auto saved = utils::base64::KERNEL;
+    OBuffer enc{(uint32_t) data.size()*2}, dec{(uint32_t) data.size()*2};
+    for (auto& k: utils::base64::KERNELS) {
+        if (!k.supported)
+            continue;
+        utils::base64::KERNEL = &k;
+        auto start = Clock::now();
+        for (int i = 0; i < rounds; i++) {
+            enc.reset(0, true);
+            utils::base64::encode(enc, data.data(), data.size());
+        }
+        auto encodeTime = Clock::now() - start;
+
+        start = Clock::now();
+        for (int i = 0; i < rounds; i++) {
+            dec.reset(0, true);
+            utils::base64::decode(dec, (const uint8_t *) enc.data(), enc.size());
+        }
+        auto decodeTime = Clock::now() - start;
+        REQUIRE(dec.size() == data.size());
+
+        WARN(k.name << ": encode " << mbps(encodeTime, data.size()) << " MB/s, decode "
+             << mbps(decodeTime, enc.size()) << " MB/s");
+    }
+    utils::base64::KERNEL = saved;
+}
+#endif
@@ -11,8 +11,21 @@ namespace suil {
 
     namespace utils::base64 {
 
+        /**
+         * encodes the given data, appending the encoded string to the buffer. The
+         * data is encoded with SSSE3/AVX2 when the CPU supports it
+         */
         void encode(OBuffer& ob, const uint8_t *, size_t);
 
+        /**
+         * encodes the given data into a caller provided buffer
+         * @param out the output buffer, must fit at least ((len+2)/3*4)+1 bytes
+         * @param data the data to encode
+         * @param len the size of the data to encode
+         * @return the size of the encoded string, excluding the terminating '\0'
+         */
+        size_t encode(char *out, const uint8_t *data, size_t len);
+
         String encode(const uint8_t *, size_t);
 
         static String encode(const String &str) {
@@ -23,6 +36,10 @@ namespace suil {
             return encode((const uint8_t *) str.data(), str.size());
         }
 
+        /**
+         * decodes the given base64 string, appending the decoded data to the buffer
+         * @throws Exception if the string is not a valid base64 string
+         */
         void decode(OBuffer& ob, const uint8_t *in, size_t len);
 
         String decode(const uint8_t *in, size_t len);
@@ -39,5 +56,38 @@ namespace suil {
             return std::move(decode((const uint8_t *) zc.data(), zc.size()));
         }
     }
+
+    /**
+     * The URL and filename safe variant of base64 (RFC 4648 section 5), encoded
+     * strings are not padded and padding is optional when decoding
+     */
+    namespace utils::base64url {
+
+        void encode(OBuffer& ob, const uint8_t *, size_t);
+
+        String encode(const uint8_t *, size_t);
+
+        size_t encode(char *out, const uint8_t *data, size_t len);
+
+        static String encode(const String &str) {
+            return encode((const uint8_t *) str.data(), str.size());
+        }
+
+        static String encode(const std::string &str) {
+            return encode((const uint8_t *) str.data(), str.size());
+        }
+
+        void decode(OBuffer& ob, const uint8_t *in, size_t len);
+
+        String decode(const uint8_t *in, size_t len);
+
+        static String decode(const char *in) {
+            return decode((const uint8_t *) in, strlen(in));
+        }
+
+        static String decode(const String &zc) {
+            return decode((const uint8_t *) zc.data(), zc.size());
+        }
+    }
 }
 #endif //SUIL_BASE64_H
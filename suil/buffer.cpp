@@ -561,6 +561,13 @@ TEST_CASE("OBuffer tests", "[common][obuffer]")
             ss = ob.hex(str, true);
             REQUIRE(ss == 10);
             REQUIRE(__Check(ob, 10, "48656C6C6F", ss));
+            // numbers are appended in hex
+            ss = ob.hex(0xBEEF);
+            REQUIRE(ss == 4);
+            REQUIRE(__Check(ob, 20, "beef", ss));
+            ss = ob.hex((int64_t) -2, true);
+            REQUIRE(ss == 16);
+            REQUIRE(__Check(ob, 24, "fffffffffffffffe", ss));
         }
 
         WHEN("Using other buffer operators") {
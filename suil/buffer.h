@@ -8,6 +8,7 @@
 #include <type_traits>
 
 #include <suil/wire.h>
+#include <suil/numfmt.h>
 
 namespace suil {
 
@@ -246,15 +247,13 @@ namespace suil {
          * @return the number of bytes copied into the buffer on success and
          * -1 on failure
          */
-        template<typename T, typename = typename std::enable_if<std::is_arithmetic<T>::value>::type>
+        template<typename T, typename = typename std::enable_if<std::is_integral<T>::value>::type>
         ssize_t hex(T  v, bool filled = false) {
-            size_t tmp = this->size();
-            char fmt[10];
-            if (filled)
-                sprintf(fmt, "%%0%dx",(int)sizeof(T)*2);
-            else
-                sprintf(fmt, "%%x");
-            return appendnf(8, fmt, v);
+            reserve(numfmt::MAX_INTEGER);
+            auto u = (uint64_t) (typename std::make_unsigned<T>::type) v;
+            auto n = numfmt::xtoa(u, (char *) &m_data[m_offset], filled? (int) sizeof(T)*2 : 0);
+            m_offset += (uint32_t) n;
+            return (ssize_t) n;
         }
 
         /**
@@ -522,107 +521,116 @@ namespace suil {
          * @return
          */
         inline OBuffer&  operator<<(const bool u) {
-            if (u) appendf("true"); else append("false");
+            if (u) append("true"); else append("false");
             return *this;
         }
 
         /**
-         * add unsigned char  - printf-style appends the given value into the buffer
+         * add unsigned char  - appends the given value formatted in base 10 into the buffer
          * @param u the value to append
          * @return
          */
         inline OBuffer&  operator<<(unsigned char u) {
-            appendf("%hhu", u);
+            reserve(numfmt::MAX_INTEGER);
+            m_offset += (uint32_t) numfmt::utoa(u, (char *) &m_data[m_offset]);
             return *this;
         }
 
         /**
-         * add unsigned short  - printf-style appends the given value into the buffer
+         * add unsigned short  - appends the given value formatted in base 10 into the buffer
          * @param u the value to append
          * @return
          */
         inline OBuffer&  operator<<(unsigned short u) {
-            appendf("%hu", u);
+            reserve(numfmt::MAX_INTEGER);
+            m_offset += (uint32_t) numfmt::utoa(u, (char *) &m_data[m_offset]);
             return *this;
         }
 
         /**
-         * add unsigned int  - printf-style appends the given value into the buffer
+         * add unsigned int  - appends the given value formatted in base 10 into the buffer
          * @param u the value to append
          * @return
          */
         inline OBuffer&  operator<<(unsigned int u) {
-            appendf("%u", u);
+            reserve(numfmt::MAX_INTEGER);
+            m_offset += (uint32_t) numfmt::utoa(u, (char *) &m_data[m_offset]);
             return *this;
         }
 
         /**
-         * add unsigned long  - printf-style appends the given value into the buffer
+         * add unsigned long  - appends the given value formatted in base 10 into the buffer
          * @param ul the value to append
          * @return
          */
         inline OBuffer&  operator<<(unsigned long ul) {
-            appendf("%lu", ul);
+            reserve(numfmt::MAX_INTEGER);
+            m_offset += (uint32_t) numfmt::utoa(ul, (char *) &m_data[m_offset]);
             return *this;
         }
 
         /**
-         * add unsigned long long  - printf-style appends the given value into the buffer
+         * add unsigned long long  - appends the given value formatted in base 10 into the buffer
          * @param ull the value to append
          * @return
          */
         inline OBuffer&  operator<<(unsigned long long ull) {
-            appendf("%llu", ull);
+            reserve(numfmt::MAX_INTEGER);
+            m_offset += (uint32_t) numfmt::utoa(ull, (char *) &m_data[m_offset]);
             return *this;
         }
 
         /**
-         * add char  - printf-style appends the given value into the buffer
+         * add char  - appends the given character into the buffer
          * @param i the value to append
          * @return
          */
         inline OBuffer&  operator<<(char i) {
-            appendf("%c", i);
+            append(&i, 1);
             return *this;
         }
 
         /**
-         * add short  - printf-style appends the given value into the buffer
+         * add short  - appends the given value formatted in base 10 into the buffer
          * @param i the value to append
          * @return
          */
         inline OBuffer&  operator<<(short i) {
-            appendf("%hd", i);
+            reserve(numfmt::MAX_INTEGER);
+            m_offset += (uint32_t) numfmt::itoa(i, (char *) &m_data[m_offset]);
             return *this;
         }
 
         /**
-         * add int  - printf-style appends the given value into the buffer
+         * add int  - appends the given value formatted in base 10 into the buffer
          * @param i the value to append
          * @return
          */
         inline OBuffer&  operator<<(int i) {
-            appendf("%d", i);
+            reserve(numfmt::MAX_INTEGER);
+            m_offset += (uint32_t) numfmt::itoa(i, (char *) &m_data[m_offset]);
             return *this;
         }
 
         /**
-         * add long  - printf-style appends the given value into the buffer
+         * add long  - appends the given value formatted in base 10 into the buffer
          * @param l the value to append
          * @return
          */
         inline OBuffer&  operator<<(long l) {
-            appendf("%ld", l);
+            reserve(numfmt::MAX_INTEGER);
+            m_offset += (uint32_t) numfmt::itoa(l, (char *) &m_data[m_offset]);
             return *this;
         }
 
         /**
-         * add long long  - printf-style appends the given value into the buffer
+         * add long long  - appends the given value formatted in base 10 into the buffer
          * @param ll the value to append
          * @return
          */
         inline OBuffer&  operator<<(long long ll) {
-            appendf("%lld", ll);
+            reserve(numfmt::MAX_INTEGER);
+            m_offset += (uint32_t) numfmt::itoa(ll, (char *) &m_data[m_offset]);
             return *this;
         }
 
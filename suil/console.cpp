@@ -7,11 +7,14 @@
 namespace suil {
 
     void console::cprintv(uint8_t color, int bold, const char *fmt, va_list args) {
+        /* the color codes and the message are not interleaved with other threads' output */
+        flockfile(stdout);
         if (color > 0 && color <= console::CYAN)
             printf("\033[%s3%dm", (bold? "1;" : ""), color);
         (void) vprintf(fmt, args);
         if (color > 0 && color <= console::CYAN)
             printf("\033[0m");
+        funlockfile(stdout);
     }
 
     void console::cprintf(uint8_t color, int bold, const char *fmt, ...) {
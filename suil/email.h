@@ -6,6 +6,7 @@
 #define SUIL_SMTP_HPP
 
 #include <suil/sock.h>
+#include <suil/resolver.h>
 #include <suil/base64.h>
 
 namespace suil {
@@ -312,7 +313,7 @@ namespace suil {
             int64_t timeout = params.get(sym(timeout), 1500);
             String domain = params.get(sym(domain),  "localhost");
 
-            ipaddr addr = ipremote(server.data(), port, 0, utils::after(timeout));
+            ipaddr addr = ipresolve(server.data(), port, 0, timeout);
             if (errno != 0) {
                 ierror("server address '%s:%d' could not be resolved: %",
                             server.data(), port, errno_s);
@@ -321,6 +322,7 @@ namespace suil {
 
             // open Connection to server using underlying protocol (either raw TCP or SSL)
             if (!proto.connect(addr, timeout)) {
+                Resolver::get().failed(server.data(), addr);
                 ierror("connecting to server '%s:%d' failed: %s",
                           server.data(), port, errno_s);
                 return false;
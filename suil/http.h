@@ -535,6 +535,9 @@ namespace suil {
             String name_{nullptr};
             void    *data_{nullptr};
             size_t  len_{0};
+            /* the body offload file holding the data, if any */
+            int     fd_{-1};
+            off_t   offset_{0};
         };
 
         typedef decltype(iod::D(
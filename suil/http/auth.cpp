@@ -4,6 +4,8 @@
 #include <openssl/rand.h>
 #include <openssl/evp.h>
 #include <openssl/sha.h>
+#include <openssl/hmac.h>
+#include <openssl/crypto.h>
 
 #include <suil/http/auth.h>
 #include <suil/base64.h>
@@ -12,89 +14,151 @@ namespace suil {
     namespace http {
 
         bool Jwt::decode(Jwt& jwt,String &&jwtstr, String& secret) {
-            /* header.payload.signature */
-            char *tok_sig = strrchr(jwtstr.data(), '.');
-            if (tok_sig == nullptr) {
-                /* invalid json token */
-                throw Error::unauthorized(
-                        "invalid token");
-            }
-            *tok_sig++ = '\0';
-            String data(jwtstr.data());
-
-            /* get signature hash  */
-            String signature =
-                    utils::SHA_HMAC256(secret, data, true);
-            strace("token signature orig:%s, generated %s",
-                   tok_sig, signature.data());
+            return Jwt::decode(jwt, strview(jwtstr.data(), jwtstr.size()), secret);
+        }
 
-            if (strcmp(tok_sig, signature.data()) != 0) {
+        bool Jwt::decode(Jwt& jwt, const strview& token, const String& secret) {
+            if (!Jwt::verify(token, secret)) {
                 /* token invalid */
                 return false;
             }
 
-            auto parts = data.split(".");
-            if (parts.size() != 2) {
-                /* invalid token */
+            /* header.payload, the signature was validated by verify */
+            strview data = token.substr(0, token.rfind('.'));
+            auto dot = data.find('.');
+            if (dot == strview::npos || data.find('.', dot+1) != strview::npos) {
                 /* invalid json token */
                 throw Error::unauthorized(
                         "invalid token");
             }
 
-            String header(utils::base64::decode(parts[0]));
-            strace("header: %s", header.data());
-            iod::json_decode(jwt.header, header);
-            String payload(utils::base64::decode(parts[1]));
-            strace("header: %s", payload.data());
-            iod::json_decode(jwt.payload, payload);
+            OBuffer raw{(uint32_t) data.size()};
+            utils::base64::decode(raw, (const uint8_t *) data.data(), dot);
+            strace("header: %.*s", (int) raw.size(), raw.data());
+            iod::json_decode(jwt.header, raw);
+            raw.reset(0, true);
+            utils::base64::decode(raw, (const uint8_t *) &data[dot+1], data.size()-dot-1);
+            strace("payload: %.*s", (int) raw.size(), raw.data());
+            iod::json_decode(jwt.payload, raw);
             return true;
         }
 
         bool Jwt::verify(String&& jwtstr, String &secret) {
+            return Jwt::verify(strview(jwtstr.data(), jwtstr.size()), secret);
+        }
+
+        bool Jwt::verify(const strview& token, const String& secret) {
             /* header.payload.signature */
-            char *tok_sig = strrchr(jwtstr.data(), '.');
-            if (tok_sig == nullptr) {
+            auto sig = token.rfind('.');
+            if (sig == strview::npos) {
                 /* invalid json token */
                 throw Error::unauthorized(
                         "invalid token");
             }
-            *tok_sig++ = '\0';
-            String data(jwtstr.data());
 
-            /* get signature hash  */
-            String signature =
-                    utils::SHA_HMAC256(secret, data);
-            strace("token signature orig:%s, generated %s",
-                   tok_sig, signature.data());
+            /* the signature is computed over a view of the token, without copying it */
+            uint8_t  hmac[EVP_MAX_MD_SIZE];
+            uint32_t len{0};
+            HMAC(EVP_sha256(), secret.data(), (int) secret.size(),
+                 (const uint8_t *) token.data(), sig, hmac, &len);
 
-            return strcmp(tok_sig, signature.data()) == 0;
+            char signature[((EVP_MAX_MD_SIZE+2)/3*4)+1];
+            size_t size = utils::base64::encode(signature, hmac, len);
+            strview given = token.substr(sig+1);
+            strace("token signature orig:%.*s, generated %s",
+                   (int) given.size(), given.data(), signature);
+
+            return (given.size() == size) &&
+                   (CRYPTO_memcmp(given.data(), signature, size) == 0);
         }
 
         String Jwt::encode(String& secret) {
             /* encode jwt */
-            /* 1. base64(hdr) & base64(payload)*/
-            std::string raw_hdr(iod::json_encode(header));
-            String hdr(std::move(utils::base64::encode(raw_hdr)));
-            std::string raw_data(iod::json_encode(payload));
-            String data(std::move(utils::base64::encode(raw_data)));
-
-            /* 2. base64(hdr).base64(payload) */
-            OBuffer tmp(hdr.size() + data.size() + 4);
-            tmp << hdr << "." << data;
-
-            /* 3. HMAC_Sha256 (base64(hdr).base64(payload))*/
-            String signature =
-                    utils::SHA_HMAC256(secret,
-                                       (const uint8_t *) tmp.data(),
-                                       tmp.size(), true);
-
-            /* 4. header.payload.signature */
-            tmp << "." << signature;
+            /* 1. base64(hdr).base64(payload), encoded straight into the token's buffer */
+            OBuffer raw(256), tmp(512);
+            json::encode(header, raw);
+            utils::base64::encode(tmp, (const uint8_t *) raw.data(), raw.size());
+            tmp << ".";
+            raw.reset(256, true);
+            json::encode(payload, raw);
+            utils::base64::encode(tmp, (const uint8_t *) raw.data(), raw.size());
+
+            /* 2. HMAC_Sha256 (base64(hdr).base64(payload))*/
+            uint8_t  hmac[EVP_MAX_MD_SIZE];
+            uint32_t len{0};
+            HMAC(EVP_sha256(), secret.data(), (int) secret.size(),
+                 (const uint8_t *) tmp.data(), tmp.size(), hmac, &len);
+
+            /* 3. header.payload.signature */
+            tmp << ".";
+            utils::base64::encode(tmp, hmac, len);
             strace("encoded jwt: %s", tmp.data());
 
             return std::move(String(tmp));
         }
 
+        JwtCache::jwt_ptr_t JwtCache::find(const strview& token, int64_t now) {
+            String tmp(token.data(), token.size(), false);
+            auto it = mMap.find(tmp);
+            if (it == mMap.end())
+                return nullptr;
+
+            auto entry = it->second;
+            if (entry->second->exp() < now) {
+                /* token expired */
+                mMap.erase(it);
+                mLru.erase(entry);
+                return nullptr;
+            }
+
+            /* move to the front of the LRU list */
+            mLru.splice(mLru.begin(), mLru, entry);
+            return entry->second;
+        }
+
+        void JwtCache::add(const strview& token, jwt_ptr_t jwt) {
+            if (mCapacity == 0) {
+                /* caching disabled */
+                return;
+            }
+
+            evict(token);
+            if (mLru.size() >= mCapacity) {
+                /* evict the least recently used token */
+                mMap.erase(mLru.back().first);
+                mLru.pop_back();
+            }
+
+            // the map is keyed by a view of the entry's token
+            mLru.emplace_front(String(token.data(), token.size(), false).dup(), std::move(jwt));
+            mMap.emplace(mLru.front().first.peek(), mLru.begin());
+        }
+
+        bool JwtCache::evict(const strview& token) {
+            String tmp(token.data(), token.size(), false);
+            auto it = mMap.find(tmp);
+            if (it == mMap.end())
+                return false;
+
+            auto entry = it->second;
+            mMap.erase(it);
+            mLru.erase(entry);
+            return true;
+        }
+
+        void JwtCache::resize(size_t capacity) {
+            mCapacity = capacity;
+            while (mLru.size() > mCapacity) {
+                mMap.erase(mLru.back().first);
+                mLru.pop_back();
+            }
+        }
+
+        void JwtCache::clear() {
+            mMap.clear();
+            mLru.clear();
+        }
+
         String rand_8byte_salt::operator()(const String &) {
             /* simple generate random bytes */
             uint8_t key[8];
@@ -150,23 +214,22 @@ namespace suil {
                     authrequest(resp);
                 }
 
-                String token(ctx.actualToken.dup());
-
-                bool valid{false};
+                JwtCache::jwt_ptr_t jwt{nullptr};
                 try {
-                    valid = Jwt::decode(ctx.jwt, std::move(token), key);
+                    jwt = verify(ctx.actualToken);
                 }
                 catch(...) {
                     /* error decoding token */
                     authrequest(resp, "Invalid authorization token.");
                 }
 
-                if (!valid || (ctx.jwt.exp() < time(nullptr))) {
+                if (jwt == nullptr) {
                     /* token unauthorized */
                     authrequest(resp);
                 }
+                ctx.verified = std::move(jwt);
 
-                if (!req.route().AUTHORIZE.check(ctx.jwt.roles())) {
+                if (!req.route().AUTHORIZE.check(ctx.jwtRef().roles())) {
                     /* token does not have permission to access resource */
                     authrequest(resp, "Access to resource denied.");
                 }
@@ -175,6 +238,25 @@ namespace suil {
             }
         }
 
+        JwtCache::jwt_ptr_t JwtAuthorization::verify(const String& token) {
+            strview view(token.data(), token.size());
+            auto now = time(nullptr);
+            auto jwt = cache.find(view, now);
+            if (jwt != nullptr) {
+                /* verified before and not expired */
+                return jwt;
+            }
+
+            auto tmp = std::make_shared<Jwt>();
+            if (!Jwt::decode(*tmp, view, key) || (tmp->exp() < now)) {
+                /* token invalid or expired */
+                return nullptr;
+            }
+
+            cache.add(view, tmp);
+            return tmp;
+        }
+
         void JwtAuthorization::after(Request&, http::Response& resp, Context& ctx) {
             /* if authorized token should have been set */
             if (ctx.sendTok) {
@@ -212,4 +294,161 @@ namespace suil {
             }
         }
     }
-}
\ No newline at end of file
+}
+#ifdef unit_test
+#include <catch/catch.hpp>
+#include <chrono>
+
+using namespace suil;
+using namespace suil::http;
+
+static String signedToken(String& secret, const char *aud, int64_t exp) {
+    Jwt jwt;
+    jwt.aud(aud);
+    jwt.exp(exp);
+    jwt.roles("admin", "user");
+    return jwt.encode(secret);
+}
+
+TEST_CASE("suil::http::Jwt", "[http][auth][jwt]")
+{
+    String secret{"some secret"};
+    int64_t exp = time(nullptr) + 60;
+
+    SECTION("Verifying tokens without copies") {
+        String tok = signedToken(secret, "carter", exp);
+        strview view(tok.data(), tok.size());
+        REQUIRE(Jwt::verify(view, secret));
+        // the token is not modified
+        CHECK(view.size() == strlen(tok.data()));
+
+        Jwt jwt;
+        REQUIRE(Jwt::decode(jwt, view, secret));
+        CHECK(jwt.aud() == "carter");
+        CHECK(jwt.exp() == exp);
+        CHECK(jwt.roles().type() == JSON_ARRAY);
+
+        // legacy API still works
+        Jwt other;
+        REQUIRE(Jwt::decode(other, tok.dup(), secret));
+        CHECK(other.aud() == "carter");
+
+        String wrong{"wrong secret"};
+        CHECK_FALSE(Jwt::verify(view, wrong));
+        std::string tampered(tok.data(), tok.size());
+        tampered[tampered.size()/2] ^= 0x01;
+        CHECK_FALSE(Jwt::verify(strview(tampered), secret));
+        CHECK_THROWS(Jwt::verify(strview("no-signature"), secret));
+    }
+
+    SECTION("Caching verified tokens") {
+        JwtCache cache(2);
+        int64_t now = time(nullptr);
+        String t1 = signedToken(secret, "a", exp), t2 = signedToken(secret, "b", exp),
+               t3 = signedToken(secret, "c", exp), t4 = signedToken(secret, "d", now - 1);
+        auto decoded = [&](const String& t) {
+            auto jwt = std::make_shared<Jwt>();
+            REQUIRE(Jwt::decode(*jwt, strview(t.data(), t.size()), secret));
+            return jwt;
+        };
+        auto view = [](const String& t) { return strview(t.data(), t.size()); };
+
+        cache.add(view(t1), decoded(t1));
+        cache.add(view(t2), decoded(t2));
+        REQUIRE(cache.size() == 2);
+        auto jwt = cache.find(view(t1), now);
+        REQUIRE(jwt != nullptr);
+        CHECK(jwt->aud() == "a");
+
+        // t2 is the least recently used
+        cache.add(view(t3), decoded(t3));
+        CHECK(cache.size() == 2);
+        CHECK(cache.find(view(t2), now) == nullptr);
+        CHECK(cache.find(view(t1), now) != nullptr);
+        CHECK(cache.find(view(t3), now) != nullptr);
+
+        // a prefix of a cached token is not a hit
+        CHECK(cache.find(strview(t1.data(), t1.size()-1), now) == nullptr);
+
+        // expired tokens are evicted on lookup
+        cache.add(view(t4), decoded(t4));
+        CHECK(cache.find(view(t4), now) == nullptr);
+        CHECK(cache.size() == 1);
+
+        // revocation hooks
+        cache.add(view(t1), decoded(t1));
+        CHECK(cache.evict(view(t1)));
+        CHECK_FALSE(cache.evict(view(t1)));
+        cache.add(view(t1), decoded(t1));
+        CHECK(cache.evict([](const Jwt& j) { return j.aud() == "c"; }) == 1);
+        CHECK(cache.find(view(t3), now) == nullptr);
+        // entries still referenced outlive the eviction
+        CHECK(jwt->aud() == "a");
+
+        cache.resize(0);
+        CHECK(cache.size() == 0);
+        cache.add(view(t1), decoded(t1));
+        CHECK(cache.size() == 0);
+    }
+}
+
+TEST_CASE("suil::http::JwtAuthorization", "[http][auth][jwt]")
+{
+    JwtAuthorization auth;
+    auth.setup(opt(key, String{"some secret"}));
+    String secret{"some secret"};
+    JwtAuthorization::Context ctx;
+    ctx.jwtAuth = &auth;
+
+    SECTION("tokens are authorized until they expire") {
+        int64_t now = time(nullptr);
+        CHECK(ctx.authorize(signedToken(secret, "a", now + 60)));
+        // expiring now is expired, also once the token is verified and cached
+        String tok = signedToken(secret, "b", now);
+        CHECK_FALSE(ctx.authorize(tok));
+        CHECK_FALSE(ctx.authorize(tok));
+        CHECK_FALSE(ctx.authorize(signedToken(secret, "c", now - 1)));
+    }
+}
+
+TEST_CASE("suil::http::Jwt benchmark", "[.][benchmark][jwt]")
+{
+    using Clock = std::chrono::steady_clock;
+    String secret{"some secret"};
+    String tok = signedToken(secret, "carter", time(nullptr) + 60);
+    strview view(tok.data(), tok.size());
+    const int rounds = 100000;
+
+    int valid{0};
+    auto start = Clock::now();
+    for (int i = 0; i < rounds; i++) {
+        Jwt jwt;
+        valid += Jwt::decode(jwt, tok.dup(), secret);
+    }
+    auto decodeTime = Clock::now() - start;
+
+    start = Clock::now();
+    for (int i = 0; i < rounds; i++) {
+        valid += Jwt::verify(view, secret);
+    }
+    auto verifyTime = Clock::now() - start;
+
+    JwtCache cache;
+    auto jwt = std::make_shared<Jwt>();
+    REQUIRE(Jwt::decode(*jwt, view, secret));
+    cache.add(view, jwt);
+    int64_t now = time(nullptr);
+    start = Clock::now();
+    for (int i = 0; i < rounds; i++) {
+        valid += (cache.find(view, now) != nullptr);
+    }
+    auto cacheTime = Clock::now() - start;
+    REQUIRE(valid == 3*rounds);
+
+    auto ns = [&](auto d) {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(d).count()/rounds;
+    };
+    WARN("decode: " << ns(decodeTime) << " ns, verify (views): " << ns(verifyTime)
+         << " ns, cached: " << ns(cacheTime) << " ns");
+}
+#endif
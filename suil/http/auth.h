@@ -81,7 +81,7 @@ namespace suil {
                     rs.push(std::forward<R>(r), std::forward<Roles>(roles)...);
             }
 
-            inline json::Object roles() {
+            inline json::Object roles() const {
                 return Ego.payload.claims["roles"];
             }
 
@@ -167,7 +167,17 @@ namespace suil {
             }
 
             static bool decode(Jwt& jwt, String&& zcstr, String& secret);
+            /**
+             * verifies the signature of the given token and decodes it, the token
+             * is not modified nor copied
+             * @param jwt the token to decode into
+             * @param token the encoded token
+             * @param secret the key the token was signed with
+             * @return true if the signature is valid, false otherwise
+             */
+            static bool decode(Jwt& jwt, const strview& token, const String& secret);
             static bool verify(String&& zcstr, String& secret);
+            static bool verify(const strview& token, const String& secret);
             String encode(String& secret);
 
         private:
@@ -213,6 +223,83 @@ namespace suil {
             const String& appsalt;
         };
 
+        /**
+         * A bounded cache of verified tokens. A cached token is not decoded and its
+         * signature is not verified again until it expires. Entries are looked up
+         * by the token's hash and compared against the whole token, least recently
+         * used entries are evicted first
+         */
+        struct JwtCache {
+            typedef std::shared_ptr<const Jwt>     jwt_ptr_t;
+            typedef std::pair<String, jwt_ptr_t>   jwt_entry_t;
+            typedef std::list<jwt_entry_t>         jwt_lru_t;
+            typedef Map<jwt_lru_t::iterator>       jwt_map_t;
+
+            JwtCache(size_t capacity = 1024)
+                : mCapacity(capacity)
+            {}
+
+            /**
+             * @param token the encoded token to lookup
+             * @param now the current time, expired tokens are evicted
+             * @return the decoded token if cached, nullptr otherwise
+             */
+            jwt_ptr_t find(const strview& token, int64_t now);
+
+            /**
+             * adds a verified token to the cache
+             * @param token the encoded token, it is copied
+             * @param jwt the decoded token
+             */
+            void add(const strview& token, jwt_ptr_t jwt);
+
+            /**
+             * @param token the encoded token to evict
+             * @return true if the token was cached
+             */
+            bool evict(const strview& token);
+
+            /**
+             * evicts all tokens matching the given predicate
+             * @param pred a function invoked as pred(const Jwt&)
+             * @return the number of evicted tokens
+             */
+            template <typename P>
+            size_t evict(P pred) {
+                size_t n{0};
+                for (auto it = mLru.begin(); it != mLru.end();) {
+                    if (pred(*it->second)) {
+                        mMap.erase(it->first);
+                        it = mLru.erase(it);
+                        n++;
+                    }
+                    else it++;
+                }
+                return n;
+            }
+
+            /**
+             * changes the maximum number of cached tokens
+             * @param capacity the new capacity, 0 disables caching
+             */
+            void resize(size_t capacity);
+
+            void clear();
+
+            inline size_t size() const {
+                return mLru.size();
+            }
+
+            inline size_t capacity() const {
+                return mCapacity;
+            }
+
+        private:
+            jwt_lru_t mLru;
+            jwt_map_t mMap;
+            size_t    mCapacity;
+        };
+
         struct JwtUse {
             typedef enum { HEADER, COOKIE} From;
             JwtUse()
@@ -237,6 +324,7 @@ namespace suil {
 
                 inline void authorize(Jwt&& jwt) {
                     this->jwt = std::move(jwt);
+                    Ego.verified.reset();
                     Ego.jwt.iat(time(nullptr));
                     Ego.jwt.exp(time(nullptr) + jwtAuth->expiry);
                     sendTok = 1;
@@ -246,24 +334,41 @@ namespace suil {
                 }
 
                 inline bool authorize(const String& token) {
-                    /* decode and use given token in authorization */
-                    Jwt tok;
-                    if (Jwt::decode(tok, token.dup(), jwtAuth->key)) {
-                        /* decoded, authorize only if not expired */
-                        if (tok.exp() > time(NULL)) {
-                            /* token valid, authorize with token */
-                            this->jwt = std::move(tok);
-                            sendTok = 1;
-                            encode  = 1;
-                            requestAuth = 0;
-                            Ego.actualToken = token.dup();
-                            return true;
-                        }
+                    /* verify (or find the verified) token and use it in authorization,
+                     * only if it expires later than now */
+                    auto tok = jwtAuth->verify(token);
+                    if (tok && tok->exp() > time(nullptr)) {
+                        /* token valid, authorize with token */
+                        Ego.verified = std::move(tok);
+                        sendTok = 1;
+                        encode  = 1;
+                        requestAuth = 0;
+                        Ego.actualToken = token.dup();
+                        return true;
                     }
                     /*  token not valid */
                     return false;
                 }
 
+                /**
+                 * evicts the token of the current request from the cache of
+                 * verified tokens, e.g when the token has been revoked
+                 */
+                inline void revoke() {
+                    if (!Ego.actualToken.empty())
+                        jwtAuth->revoke(Ego.actualToken);
+                }
+
+                /**
+                 * evicts all the cached tokens matching the given predicate
+                 * @param pred a function invoked as pred(const Jwt&)
+                 * @return the number of evicted tokens
+                 */
+                template <typename P>
+                inline size_t revoke(P pred) {
+                    return jwtAuth->revoke(pred);
+                }
+
                 inline Status authenticate(Status status, const char *msg = NULL) {
                     sendTok = 0;
                     encode   = 0;
@@ -292,11 +397,13 @@ namespace suil {
                 }
 
                 const Jwt& jwtRef() const {
-                    return jwt;
+                    return verified? *verified : jwt;
                 }
 
-            private:
+            private suil_ut:
                 Jwt    jwt;
+                /* the verified token, shared with the cache */
+                JwtCache::jwt_ptr_t verified{nullptr};
                 friend struct JwtAuthorization;
                 union {
                     struct {
@@ -318,6 +425,34 @@ namespace suil {
 
             void after(Request&, http::Response& resp, Context& ctx);
 
+            /**
+             * verifies the given token, tokens that have been verified before are
+             * served from the cache until they expire
+             * @param token the encoded token
+             * @return the decoded token if valid and not expired, nullptr otherwise
+             */
+            JwtCache::jwt_ptr_t verify(const String& token);
+
+            /**
+             * evicts the given token from the cache of verified tokens. Each worker
+             * has its own cache, the token is only evicted from the calling worker's
+             * @param token the token to evict
+             * @return true if the token was cached
+             */
+            inline bool revoke(const String& token) {
+                return cache.evict(strview(token.data(), token.size()));
+            }
+
+            /**
+             * evicts all the cached tokens matching the given predicate
+             * @param pred a function invoked as pred(const Jwt&)
+             * @return the number of evicted tokens
+             */
+            template <typename P>
+            inline size_t revoke(P pred) {
+                return cache.evict(pred);
+            }
+
             template <typename __Opts>
             void configure(__Opts& opts) {
                 /* configure expiry time */
@@ -327,8 +462,13 @@ namespace suil {
                 if (tmp) {
                     key = std::move(tmp.dup());
                     trace("jwt key changed to %s", key());
+                    /* tokens verified with the previous key */
+                    cache.clear();
                 }
 
+                /* configure the number of verified tokens to cache */
+                cache.resize(opts.get(sym(jwt_cache), cache.capacity()));
+
                 /* configure authenticate header string */
                 tmp = opts.get(sym(realm), String());
                 if (tmp) {
@@ -389,6 +529,7 @@ namespace suil {
             // cookie attributes
             String    domain{""};
             String    path{"/"};
+            JwtCache  cache;
         };
 
         namespace auth {
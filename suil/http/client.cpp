@@ -93,21 +93,27 @@ namespace suil {
                 }
             }
 
-            void Response::receive(SocketAdaptor &sock, int64_t timeout) {
+            void Response::receiveHeaders(SocketAdaptor &sock, int64_t timeout) {
                 OBuffer tmp(1023);
+                bool first{true};
                 do {
                     size_t nrd = tmp.capacity();
                     if (!sock.read(&tmp[0], nrd, timeout)) {
-                        /* failed to receive headers*/
+                        /* failed to receive headers, sockets are closed when the peer resets */
+                        closed = first && nrd == 0 && !sock.isopen();
                         throw Exception::create("receiving Request failed: ", errno_s);
                     }
+                    first = false;
 
                     if (!feed(tmp.data(), nrd)) {
                         throw Exception::create("parsing headers failed: ",
                               http_errno_name((enum http_errno) http_errno));
                     }
                 } while (!headers_complete);
+            }
 
+            void Response::receive(SocketAdaptor &sock, int64_t timeout) {
+                receiveHeaders(sock, timeout);
                 if (body_read || content_length == 0) {
                     strace("%s - Response has no body to read: %lu", sock.id(), content_length);
                     return;
@@ -116,7 +122,7 @@ namespace suil {
                 /* received and parse body */
                 size_t len  = 0, left = content_length == ULLONG_MAX? 8000 : (content_length+20);
                 // read body in chunks
-                tmp.reserve(left);
+                OBuffer tmp(left);
 
                 do {
                     tmp.reset(len, true);
@@ -136,6 +142,20 @@ namespace suil {
                 } while (!body_complete);
             }
 
+            void Response::pull(SocketAdaptor &sock, OBuffer& tmp, int64_t timeout) {
+                /* reads whatever is available, the parser decodes chunks into the reader */
+                tmp.reset(8192, true);
+                size_t len = tmp.capacity();
+                if (!sock.read(&tmp[0], len, timeout)) {
+                    throw Exception::create("receive failed: ", errno_s);
+                }
+
+                if (!feed(tmp.data(), len)) {
+                    throw Exception::create("parsing  body failed: ",
+                                            http_errno_name((enum http_errno )http_errno));
+                }
+            }
+
             int Response::handle_body_part(const char *at, size_t length) {
                 if (reader == nullptr) {
                     return parser::handle_body_part(at, length);
@@ -153,7 +173,7 @@ namespace suil {
                 if (reader != nullptr) {
                     reader(nullptr, content_length);
                 }
-                else {
+                else if (!streaming) {
                     body.reserve(content_length + 2);
                 }
                 return 0;
@@ -191,6 +211,7 @@ namespace suil {
                     reader(nullptr, 0);
                 }
                 body_read = true;
+                keep_alive = http_should_keep_alive(this) != 0;
                 return parser::msg_complete();
             }
 
@@ -214,6 +235,8 @@ namespace suil {
                     form = std::move(o.form);
                     body   = std::move(o.body);
                     bodyFd = std::move(o.bodyFd);
+                    writer = std::move(o.writer);
+                    writerLen = o.writerLen;
                     o.sock_ptr = nullptr;
                     o.method = Method::Unknown;
                     o.cleanup();
@@ -230,7 +253,9 @@ namespace suil {
                   resource(std::move(o.resource)),
                   form(std::move(o.form)),
                   body(std::move(o.body)),
-                  bodyFd(std::move(o.bodyFd))
+                  bodyFd(std::move(o.bodyFd)),
+                  writer(std::move(o.writer)),
+                  writerLen(o.writerLen)
             {
                 o.sock_ptr = nullptr;
                 o.method = Method::Unknown;
@@ -272,6 +297,16 @@ namespace suil {
                 return body;
             }
 
+            void Request::streambody(size_t len, BodyWriter w) {
+                if (!body.empty() || bodyFd.valid()) {
+                    iwarn("request body already set, overriding with body writer");
+                    body.clear();
+                    bodyFd.close();
+                }
+                writer = std::move(w);
+                writerLen = len;
+            }
+
             void Request::encodeargs(OBuffer &dst) const {
                 if (!arguments.empty()) {
                     dst << "?";
@@ -296,7 +331,11 @@ namespace suil {
 
             size_t Request::buildbody() {
                 size_t content_length{0};
-                if (utils::matchany(method, Method::Put, Method::Post)) {
+                if (writer != nullptr) {
+                    /* body is streamed by the writer, whatever the method */
+                    content_length = writerLen;
+                }
+                else if (utils::matchany(method, Method::Put, Method::Post)) {
                     if (form) {
                         /*encode form if available */
                         content_length = form.encode(body);
@@ -332,7 +371,12 @@ namespace suil {
                     return;
                 }
 
-                if (Ego.bodyFd.valid()) {
+                if (writer != nullptr) {
+                    if (!writer(sock, timeout)) {
+                        throw Exception::create("streaming Request body failed: ", errno_s);
+                    }
+                }
+                else if (Ego.bodyFd.valid()) {
                     // send body as a file
                     /* send file */
                     int fd = Ego.bodyFd.raw();
@@ -391,9 +435,22 @@ namespace suil {
                 sock.flush();
             }
 
-            Response Session::perform(handle_t& h, Method m, const char *resource, request_builder_t& builder, ResponseWriter& rd) {
+            static bool idempotent(Method m) {
+                return m == Method::Get || m == Method::Head || m == Method::Put ||
+                       m == Method::Delete || m == Method::Options || m == Method::Trace;
+            }
+
+            void Session::resubmit(Request& req, int64_t timeout) {
+                trace("%s:%d - pooled connection failed, reconnecting", host(), port);
+                if (!connect(req.sock, timeout)) {
+                    throw Exception::create("Connecting to '", host(), ":",
+                                            port, "' failed: ", errno_s);
+                }
+                req.submit(timeout);
+            }
+
+            bool Session::submit(handle_t& h, Method m, const char *resource, request_builder_t& builder, int64_t timeout) {
                 Request& req = h.req;
-                Response resp;
                 req.reset(m, resource, false);
 
                 for(auto& hdr: headers) {
@@ -406,20 +463,158 @@ namespace suil {
                     throw Exception::create("building Request '", resource, "' failed");
                 }
 
+                bool pooled{false};
                 if (!req.sock.isopen()) {
-                    /* open a new socket for the Request */
-                    if (!req.sock.connect(addr, timeout)) {
+                    /* use a warm connection from the pool or open a new socket for the Request */
+                    pooled = borrow(req.sock);
+                    if (!pooled && !connect(req.sock, timeout)) {
                         throw Exception::create("Connecting to '", host(), ":",
                                                  port, "' failed: ", errno_s);
                     }
                 }
 
-                req.submit(timeout);
+                try {
+                    req.submit(timeout);
+                }
+                catch (...) {
+                    req.sock.close();
+                    if (!pooled || req.form) {
+                        throw;
+                    }
+
+                    /* pooled connection was closed by the server, retry on a new connection */
+                    resubmit(req, timeout);
+                    return false;
+                }
+
+                /* forms are streamed from their files and cannot be sent again */
+                return pooled && !req.form && idempotent(m);
+            }
+
+            Response Session::perform(handle_t& h, Method m, const char *resource, request_builder_t& builder,
+                                      ResponseWriter& rd, int64_t timeout)
+            {
+                Request& req = h.req;
+                Response resp;
+                bool retry = submit(h, m, resource, builder, timeout);
+
                 resp.reader = rd;
-                resp.receive(req.sock, timeout);
+                while (true) {
+                    try {
+                        resp.receive(req.sock, timeout);
+                        break;
+                    }
+                    catch (...) {
+                        /* connection state unknown, cannot be reused */
+                        req.sock.close();
+                        if (!retry || !resp.closed || req.aborted) {
+                            throw;
+                        }
+                    }
+
+                    /* server closed the pooled connection without responding, nothing
+                     * was received so the request can be sent again on a new connection */
+                    retry = false;
+                    resp.closed = false;
+                    resubmit(req, timeout);
+                }
+
+                if (resp.keep_alive) {
+                    release(req.sock);
+                }
+                else {
+                    req.sock.close();
+                }
                 return std::move(resp);
             }
 
+            static void movesock(SocketAdaptor& to, SocketAdaptor& from, bool https) {
+                if (https)
+                    dynamic_cast<SslSock&>(to) = std::move(dynamic_cast<SslSock&>(from));
+                else
+                    dynamic_cast<TcpSock&>(to) = std::move(dynamic_cast<TcpSock&>(from));
+            }
+
+            static bool isalive(SocketAdaptor& sock) {
+                /* an idle connection must have nothing to read, anything read
+                 * means that the server closed it or sent unexpected data */
+                char c;
+                size_t len{1};
+                if (sock.receive(&c, len, 0))
+                    return false;
+                return errno == ETIMEDOUT && sock.isopen();
+            }
+
+            bool Session::connect(SocketAdaptor& sock, int64_t timeout) {
+                /* the host might have multiple addresses, failover to the next
+                 * one if the current one cannot be reached */
+                auto& resolver = Resolver::get();
+                for (int i = 0; i < 3; i++) {
+                    ipaddr tmp = resolver.resolve(host.data(), port, 0, timeout);
+                    if (errno != 0) {
+                        if (i == 0)
+                            return false;
+                        break;
+                    }
+                    addr = tmp;
+                    if (sock.connect(addr, timeout))
+                        return true;
+
+                    int err = errno;
+                    resolver.failed(host.data(), addr);
+                    trace("%s:%d - connecting to %s failed: %s", host(), port, ipstr(addr), strerror(err));
+                    errno = err;
+                }
+                return false;
+            }
+
+            bool Session::borrow(SocketAdaptor& sock) {
+                auto& p = *pool;
+                p.prune(p.maxPerHost);
+                while (!p.idle.empty()) {
+                    /* most recently used connections first */
+                    auto e = p.idle.back();
+                    p.idle.pop_back();
+                    if (isalive(*e.sock)) {
+                        movesock(sock, *e.sock, ishttps());
+                        delete e.sock;
+                        trace("%s:%d - using pooled connection", host(), port);
+                        return true;
+                    }
+                    delete e.sock;
+                }
+                return false;
+            }
+
+            void Session::release(SocketAdaptor& sock) {
+                auto& p = *pool;
+                p.prune(p.maxPerHost);
+                if (p.idle.size() >= p.maxPerHost) {
+                    /* pool is full, connection stays with the handle */
+                    return;
+                }
+
+                SocketAdaptor *idle = ishttps()?
+                        (SocketAdaptor *) new SslSock : (SocketAdaptor *) new TcpSock;
+                movesock(*idle, sock, ishttps());
+                p.idle.push_back({idle, mnow()});
+            }
+
+            void Session::pool_t::prune(size_t keep) {
+                auto now = mnow();
+                while (!idle.empty() &&
+                      ((idle.size() > keep) || ((now - idle.front().since) >= idleTimeout)))
+                {
+                    /* the oldest connections are at the front */
+                    delete idle.front().sock;
+                    idle.pop_front();
+                }
+            }
+
+            Session::pool_t::~pool_t() {
+                prune(0);
+            }
+
 
             void Session::connect(handle_t &h, CaseMap<String> /* @TODO implement headers */) {
                 Response resp = std::move(perform(h, Method::Connect, "/"));
@@ -438,7 +633,518 @@ namespace suil {
                 return std::move(resp);
             }
 
+            Stream Session::stream(handle_t& h, Method m, const char *resource, request_builder_t builder, int64_t timeout) {
+                if (timeout < 0)
+                    timeout = Ego.timeout;
+
+                Stream st(Ego, h.req.sock, timeout);
+                bool retry = submit(h, m, resource, builder, timeout);
+                st.resp.streaming = true;
+                while (true) {
+                    try {
+                        st.resp.receiveHeaders(h.req.sock, timeout);
+                        break;
+                    }
+                    catch (...) {
+                        h.req.sock.close();
+                        if (!retry || !st.resp.closed || h.req.aborted) {
+                            throw;
+                        }
+                    }
+
+                    /* see Session::perform */
+                    retry = false;
+                    st.resp.closed = false;
+                    resubmit(h.req, timeout);
+                }
+
+                if (st.resp.content_length == 0 && !st.resp.body_read) {
+                    /* the response doesn't have a body, e.g HEAD request or 204 */
+                    st.resp.body_read = true;
+                    st.resp.keep_alive = http_should_keep_alive(&st.resp) != 0;
+                }
+                return std::move(st);
+            }
+
+            bool Stream::read(const Handler& f) {
+                if (sock == nullptr)
+                    return false;
+
+                /* the body that was received with the headers is delivered first */
+                if (!resp.body.empty()) {
+                    bool ok = f(resp.body.data(), resp.body.size());
+                    resp.body.reset(0, true);
+                    if (!ok) {
+                        sock->close();
+                        sock = nullptr;
+                        return false;
+                    }
+                }
+
+                if (!resp.body_read) {
+                    bool aborted{false};
+                    resp.reader = [&](const char *at, size_t len) -> size_t {
+                        if (at == nullptr) {
+                            /* start and end of the body */
+                            return len;
+                        }
+                        if (!f(at, len)) {
+                            aborted = true;
+                            return 0;
+                        }
+                        return len;
+                    };
+
+                    try {
+                        resp.pull(*sock, tmp, timeout);
+                        resp.reader = nullptr;
+                    }
+                    catch (...) {
+                        resp.reader = nullptr;
+                        sock->close();
+                        sock = nullptr;
+                        if (aborted) {
+                            trace("Stream: transfer aborted by handler");
+                            return false;
+                        }
+                        throw;
+                    }
+                }
+
+                if (resp.body_read) {
+                    /* body consumed, the connection can be reused */
+                    close();
+                    return false;
+                }
+                return true;
+            }
+
+            size_t Stream::pipe(const Handler& f) {
+                size_t total{0};
+                auto counter = [&](const char *at, size_t len) {
+                    total += len;
+                    return f(at, len);
+                };
+                while (read(counter));
+                return total;
+            }
+
+            void Stream::close() {
+                if (sock == nullptr)
+                    return;
+
+                if (resp.body_read && resp.keep_alive)
+                    sess.release(*sock);
+                else
+                    sock->close();
+                sock = nullptr;
+            }
+
+            size_t FanOut::add(Method m, const char *resource, request_builder_t builder, int64_t timeout) {
+                if (ch != nullptr) {
+                    /* coroutines reference the calls */
+                    throw Exception::create("FanOut: requests cannot be added once started");
+                }
+
+                calls.push_back(call_t{m, String{resource}.dup(), std::move(builder), timeout});
+                return calls.size()-1;
+            }
+
+            void FanOut::start() {
+                if (ch != nullptr || calls.empty())
+                    return;
+
+                /* buffered, completed requests never wait for the reader */
+                ch = chmake(size_t, calls.size());
+                for (size_t id = 0; id < calls.size(); id++) {
+                    go(run(Ego, id));
+                }
+            }
+
+            coroutine void FanOut::run(FanOut& fo, size_t id) {
+                auto& call = fo.calls[id];
+                call.result.id = id;
+
+                int64_t timeout = call.timeout < 0? fo.sess.timeout : call.timeout;
+                if (fo.ddline >= 0) {
+                    /* requests never outlive the shared deadline */
+                    timeout = std::min(timeout, fo.ddline - mnow());
+                }
+
+                if (fo.cancelled) {
+                    call.result.error = String{"request cancelled"}.dup();
+                }
+                else if (timeout <= 0) {
+                    call.result.error = String{"deadline exceeded"}.dup();
+                }
+                else {
+                    auto h = fo.sess.handle();
+                    /* cancelling shuts the connection of the handle down */
+                    call.h = &h;
+                    try {
+                        ResponseWriter rd{nullptr};
+                        call.result.resp = std::move(
+                                fo.sess.perform(h, call.method, call.resource(), call.builder, rd, timeout));
+                    }
+                    catch (...) {
+                        call.result.error = String{Exception::fromCurrent().what()}.dup();
+                    }
+                    call.h = nullptr;
+                }
+
+                /* fo must not be touched after this point, it might be gone */
+                chs(fo.ch, size_t, id);
+            }
+
+            bool FanOut::next(Result& res) {
+                start();
+                if (cancelled || received == calls.size())
+                    return false;
+
+                size_t id{0};
+                if (ddline < 0) {
+                    id = chr(ch, size_t);
+                }
+                else {
+                    bool expired{false};
+                    choose {
+                        chin(ch, size_t, tmp):
+                            id = tmp;
+                        deadline(ddline):
+                            expired = true;
+                        chend
+                    }
+                    if (expired) {
+                        trace("FanOut: deadline elapsed with %zu requests pending", pending());
+                        return false;
+                    }
+                }
+
+                received++;
+                res = std::move(calls[id].result);
+                return true;
+            }
+
+            std::vector<FanOut::Result> FanOut::all() {
+                std::vector<Result> results(calls.size());
+                std::vector<bool> completed(calls.size(), false);
+
+                Result res;
+                while (next(res)) {
+                    size_t id = res.id;
+                    completed[id] = true;
+                    results[id] = std::move(res);
+                }
+
+                for (size_t id = 0; id < calls.size(); id++) {
+                    if (completed[id])
+                        continue;
+                    results[id].id    = id;
+                    results[id].error = String{cancelled? "request cancelled" : "deadline exceeded"}.dup();
+                }
+                return std::move(results);
+            }
+
+            void FanOut::cancel() {
+                cancelled = true;
+                for (auto& call: calls) {
+                    if (call.h != nullptr)
+                        call.h->req.abort();
+                }
+            }
+
+            FanOut::~FanOut() {
+                cancel();
+                if (ch == nullptr)
+                    return;
+
+                /* in-flight requests reference this fan-out and the session */
+                while (received < calls.size()) {
+                    chr(ch, size_t);
+                    received++;
+                }
+                chclose(ch);
+                ch = nullptr;
+            }
+
 #undef CRLF
         }
     }
-}
\ No newline at end of file
+}
+#ifdef unit_test
+#include <catch/catch.hpp>
+
+using namespace suil;
+using namespace suil::http;
+
+struct TestServer {
+    tcpsock ls{tcplisten(iplocal("127.0.0.1", 0, 0), 10)};
+    int     accepted{0};
+    bool    stop{false};
+
+    ~TestServer() {
+        stop = true;
+        msleep(mnow() + 50);
+    }
+};
+
+static coroutine void keepAliveServer(TestServer *srv, bool close) {
+    while (!srv->stop) {
+        tcpsock as = tcpaccept(srv->ls, mnow() + 10);
+        if (as == nullptr) continue;
+        srv->accepted++;
+        go([](tcpsock as, bool close) -> void {
+            char buf[1024];
+            OBuffer req(1024);
+            while (true) {
+                size_t nrd = tcprecvuntil(as, buf, sizeof(buf), "\n", 1, mnow() + 1000);
+                if (nrd == 0 || errno != 0) break;
+                req.append(buf, nrd);
+                if (strstr((char *) req, "\r\n\r\n") == nullptr) continue;
+                /* GET /<ms> delays the response by the given milliseconds */
+                int delay = atoi(strchr((char *) req, '/') + 1);
+                if (delay > 0) msleep(mnow() + delay);
+                bool chunked = strncmp((char *) req, "GET /chunked", 12) == 0;
+                req.reset(1024, true);
+                const char *resp = chunked?
+                        "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n"
+                        "5\r\nhello\r\n6\r\n world\r\n0\r\n\r\n" :
+                        close?
+                        "HTTP/1.1 200 OK\r\nContent-Length: 2\r\nConnection: close\r\n\r\nok" :
+                        "HTTP/1.1 200 OK\r\nContent-Length: 2\r\n\r\nok";
+                tcpsend(as, resp, strlen(resp), -1);
+                tcpflush(as, -1);
+                if (close) break;
+            }
+            tcpclose(as);
+        }(as, close));
+    }
+}
+
+static coroutine void staleServer(TestServer *srv) {
+    /* answers the first request of each connection and closes the connection
+     * upon receiving the next one, like a server expiring an idle connection */
+    while (!srv->stop) {
+        tcpsock as = tcpaccept(srv->ls, mnow() + 10);
+        if (as == nullptr) continue;
+        srv->accepted++;
+        go([](tcpsock as) -> void {
+            char buf[1024];
+            OBuffer req(1024);
+            int nreqs{0};
+            while (true) {
+                size_t nrd = tcprecvuntil(as, buf, sizeof(buf), "\n", 1, mnow() + 1000);
+                if (nrd == 0 || errno != 0) break;
+                req.append(buf, nrd);
+                if (strstr((char *) req, "\r\n\r\n") == nullptr) continue;
+                req.reset(1024, true);
+                if (nreqs++) break;
+                const char *resp = "HTTP/1.1 200 OK\r\nContent-Length: 2\r\n\r\nok";
+                tcpsend(as, resp, strlen(resp), -1);
+                tcpflush(as, -1);
+            }
+            tcpclose(as);
+        }(as));
+    }
+}
+
+TEST_CASE("suil::http::client::Session", "[http][client]")
+{
+    SECTION("connections are reused across requests") {
+        TestServer srv;
+        REQUIRE(srv.ls != nullptr);
+        go(keepAliveServer(&srv, false));
+
+        auto sess = client::load("127.0.0.1", tcpport(srv.ls));
+        for (int i = 0; i < 5; i++) {
+            auto resp = client::get(sess, "/");
+            REQUIRE(resp.status() == Status::OK);
+            CHECK(strview(resp().data(), resp().size()) == "ok");
+        }
+        CHECK(srv.accepted == 1);
+        CHECK(sess.pooled() == 1);
+
+        // handles borrowing from the pool concurrently
+        auto h1 = sess.handle(), h2 = sess.handle();
+        REQUIRE(client::get(h1, "/").status() == Status::OK);
+        CHECK(sess.pooled() == 1);
+        sess.pooling(0);
+        CHECK(sess.pooled() == 0);
+        REQUIRE(client::get(h2, "/").status() == Status::OK);
+        CHECK(srv.accepted == 2);
+    }
+
+    SECTION("closed connections are not pooled") {
+        TestServer srv;
+        REQUIRE(srv.ls != nullptr);
+        go(keepAliveServer(&srv, true));
+
+        auto sess = client::load("127.0.0.1", tcpport(srv.ls));
+        for (int i = 0; i < 3; i++) {
+            auto resp = client::get(sess, "/");
+            REQUIRE(resp.status() == Status::OK);
+        }
+        CHECK(srv.accepted == 3);
+        CHECK(sess.pooled() == 0);
+    }
+
+    SECTION("idempotent requests are retried when pooled connections were closed") {
+        TestServer srv;
+        REQUIRE(srv.ls != nullptr);
+        go(staleServer(&srv));
+
+        auto sess = client::load("127.0.0.1", tcpport(srv.ls));
+        REQUIRE(client::get(sess, "/").status() == Status::OK);
+        CHECK(sess.pooled() == 1);
+        auto resp = client::get(sess, "/");
+        REQUIRE(resp.status() == Status::OK);
+        CHECK(strview(resp().data(), resp().size()) == "ok");
+        CHECK(srv.accepted == 2);
+
+        /* the server might have processed the request, not sent again */
+        REQUIRE(sess.pooled() == 1);
+        CHECK_THROWS(client::post(sess, "/"));
+        CHECK(srv.accepted == 2);
+
+        /* streams are retried too */
+        REQUIRE(client::get(sess, "/").status() == Status::OK);
+        REQUIRE(sess.pooled() == 1);
+        auto h = sess.handle();
+        auto st = client::stream(Method::Get, h, "/");
+        CHECK(st.status() == Status::OK);
+        CHECK(srv.accepted == 4);
+    }
+}
+
+TEST_CASE("suil::http::client::Stream", "[http][client]")
+{
+    TestServer srv;
+    REQUIRE(srv.ls != nullptr);
+    go(keepAliveServer(&srv, false));
+    auto sess = client::load("127.0.0.1", tcpport(srv.ls));
+
+    SECTION("chunked bodies are decoded as they are read") {
+        auto h = sess.handle();
+        {
+            auto st = client::stream(Method::Get, h, "/chunked");
+            REQUIRE(st.status() == Status::OK);
+            OBuffer body;
+            size_t n = st.pipe([&](const char *data, size_t len) {
+                body.append(data, len);
+                return true;
+            });
+            CHECK(n == 11);
+            CHECK(strview(body.data(), body.size()) == "hello world");
+            CHECK(st.eof());
+        }
+        /* fully read, the connection is reusable */
+        CHECK(sess.pooled() == 1);
+        auto resp = client::get(sess, "/");
+        CHECK(resp.status() == Status::OK);
+        CHECK(srv.accepted == 1);
+    }
+
+    SECTION("aborted streams close the connection") {
+        auto h = sess.handle();
+        {
+            auto st = client::stream(Method::Get, h, "/chunked");
+            REQUIRE(st.status() == Status::OK);
+            CHECK_FALSE(st.read([](const char *, size_t) { return false; }));
+        }
+        CHECK(sess.pooled() == 0);
+    }
+}
+
+TEST_CASE("suil::http::client::FanOut", "[http][client]")
+{
+    TestServer srv;
+    REQUIRE(srv.ls != nullptr);
+    go(keepAliveServer(&srv, false));
+    auto sess = client::load("127.0.0.1", tcpport(srv.ls));
+
+    SECTION("requests run concurrently") {
+        int64_t started = mnow();
+        {
+            client::FanOut fo(sess, 2000);
+            for (int i = 0; i < 5; i++)
+                fo.add(Method::Get, "/200");
+            auto results = fo.all();
+            REQUIRE(results.size() == 5);
+            for (size_t i = 0; i < results.size(); i++) {
+                CHECK(results[i].id == i);
+                CHECK(results[i].ok());
+                CHECK(results[i].resp.status() == Status::OK);
+            }
+        }
+        CHECK((mnow() - started) < 800);
+        CHECK(srv.accepted == 5);
+        CHECK(sess.pooled() == 5);
+    }
+
+    SECTION("responses are returned as they complete") {
+        client::FanOut fo(sess, 2000);
+        fo.add(Method::Get, "/300");
+        fo.add(Method::Get, "/100");
+        fo.add(Method::Get, "/0");
+
+        std::vector<size_t> order;
+        client::FanOut::Result res;
+        while (fo.next(res)) {
+            CHECK(res.ok());
+            order.push_back(res.id);
+        }
+        CHECK((order == std::vector<size_t>{2, 1, 0}));
+        CHECK(fo.pending() == 0);
+    }
+
+    SECTION("stragglers are bounded by the deadlines") {
+        int64_t started = mnow();
+        {
+            client::FanOut fo(sess, 400);
+            fo.add(Method::Get, "/0");
+            fo.add(Method::Get, "/1000");
+            fo.add(Method::Get, "/300", nullptr, 100);
+            auto results = fo.all();
+            CHECK(results[0].ok());
+            CHECK_FALSE(results[1].ok());
+            CHECK_FALSE(results[2].ok());
+        }
+        CHECK((mnow() - started) < 800);
+    }
+
+    SECTION("cancelled fan-outs stop returning responses") {
+        client::FanOut fo(sess, 2000);
+        fo.add(Method::Get, "/0");
+        fo.add(Method::Get, "/300");
+        client::FanOut::Result res;
+        REQUIRE(fo.next(res));
+        CHECK(res.id == 0);
+        fo.cancel();
+        CHECK_FALSE(fo.next(res));
+        CHECK(fo.pending() == 1);
+    }
+
+    SECTION("in-flight requests are shut down when cancelled") {
+        int64_t started = mnow();
+        {
+            client::FanOut fo(sess, -1);
+            fo.add(Method::Get, "/1000");
+            fo.add(Method::Get, "/1000");
+            fo.start();
+            msleep(mnow() + 100);
+            fo.cancel();
+            CHECK(fo.pending() == 2);
+        }
+        {
+            /* destroying the fan-out cancels it */
+            client::FanOut fo(sess, -1);
+            fo.add(Method::Get, "/1000");
+            fo.start();
+            msleep(mnow() + 100);
+        }
+        CHECK((mnow() - started) < 600);
+        CHECK(srv.accepted == 3);
+        CHECK(sess.pooled() == 0);
+    }
+}
+#endif
@@ -10,8 +10,10 @@
 #include <fcntl.h>
 
 #include <suil/file.h>
+#include <suil/resolver.h>
 #include <suil/http.h>
 #include <suil/http/parser.h>
+#include <suil/msgpack.h>
 
 #ifndef SUIL_HTTP_USER_AGENT
 #define SUIL_HTTP_USER_AGENT SUIL_SOFTWARE_NAME "/" SUIL_VERSION_STRING
@@ -237,6 +239,13 @@ namespace suil {
                     return strview();
                 }
 
+                /**
+                 * @return all the headers of the response
+                 */
+                inline const CaseMap<String>& hdrs() const {
+                    return headers;
+                }
+
                 inline const OBuffer& operator()() const {
                     return body;
                 }
@@ -251,9 +260,24 @@ namespace suil {
                     return String{Ego.body};
                 }
 
+                /**
+                 * decodes the body, from MessagePack if the response's content type
+                 * is application/msgpack and from JSON otherwise
+                 */
+                template <typename T>
+                void decode(T& out) const {
+                    auto type = contenttype();
+                    size_t len = strlen(suil::msgpack::CONTENT_TYPE);
+                    if (type.size() >= len && strncasecmp(type.data(), suil::msgpack::CONTENT_TYPE, len) == 0)
+                        suil::msgpack::decode(Ego.body, out);
+                    else
+                        json::decode(Ego.body, out);
+                }
+
             private:
 
                 friend struct Session;
+                friend struct Stream;
 
                 int handle_body_part(const char *at, size_t length) override;
 
@@ -263,7 +287,15 @@ namespace suil {
 
                 void receive(SocketAdaptor& sock, int64_t timeout);
 
+                void receiveHeaders(SocketAdaptor& sock, int64_t timeout);
+
+                void pull(SocketAdaptor& sock, OBuffer& tmp, int64_t timeout);
+
                 bool body_read{false};
+                bool keep_alive{false};
+                bool streaming{false};
+                /* the connection was closed before any byte of the response was received */
+                bool closed{false};
                 ResponseWriter reader{nullptr};
             };
 
@@ -308,13 +340,36 @@ namespace suil {
 
                 template <typename J>
                 inline Request& operator<<(J jobj) {
-                    body << iod::json_encode(jobj);
+                    json::encode(jobj, body);
                     hdrs("Content-Type", "application/json");
                     return *this;
                 }
 
+                /**
+                 * encodes the given value into the body as MessagePack, the server
+                 * is told that MessagePack responses are accepted
+                 */
+                template <typename T>
+                inline Request& msgpack(const T& obj) {
+                    suil::msgpack::encode(obj, body);
+                    hdrs("Content-Type", suil::msgpack::CONTENT_TYPE,
+                         "Accept", suil::msgpack::CONTENT_TYPE);
+                    return *this;
+                }
+
                 OBuffer& buffer(const char* content_type = "text/plain");
 
+                using BodyWriter = std::function<bool(SocketAdaptor&, int64_t)>;
+
+                /**
+                 * sets a function that sends the body of the request once the headers
+                 * have been sent, allows sending large bodies without buffering them
+                 * @param len the size of the body that will be sent by \a w
+                 * @param w the function invoked with the socket and timeout to send
+                 * the body. It might be invoked more than once if the request is retried
+                 */
+                void streambody(size_t len, BodyWriter w);
+
                 inline void keepalive(bool on) {
                     if (on)
                         hdrs("Connection", "Keep-Alive");
@@ -337,8 +392,16 @@ namespace suil {
 
             private:
                 friend struct Session;
+                friend struct FanOut;
+
+                /* shuts the connection down, failing the request in progress without retrying it */
+                void abort() {
+                    aborted = true;
+                    sock.shutdown();
+                }
 
                 void reset(Method m, const char* res, bool clear = true) {
+                    aborted = false;
                     if (clear || m != method || resource != res) {
                         cleanup();
                         resource = String(res).dup();
@@ -352,6 +415,8 @@ namespace suil {
                     body.clear();
                     headers.clear();
                     bodyFd.close();
+                    writer = nullptr;
+                    writerLen = 0;
                 }
 
                 void encodeargs(OBuffer& dst) const;
@@ -376,10 +441,15 @@ namespace suil {
                 Form                   form{};
                 OBuffer               body{1024};
                 File                  bodyFd{nullptr};
+                BodyWriter            writer{nullptr};
+                size_t                writerLen{0};
+                bool                  aborted{false};
             };
 
             using request_builder_t = std::function<bool(Request&)>;
 
+            struct Stream;
+
             struct Session : LOGGER(HTTP_CLIENT) {
                 struct handle_t {
                     handle_t(Session& sess, SocketAdaptor* sock)
@@ -403,6 +473,7 @@ namespace suil {
                     Session& sess;
                 private:
                     friend struct Session;
+                    friend struct FanOut;
                     Request  req;
                 };
 
@@ -414,6 +485,10 @@ namespace suil {
                     header(String(name).dup(), String(value).dup());
                 }
 
+                inline void removeheader(const char *name) {
+                    headers.erase(String{name});
+                }
+
                 inline void language(const char *lang) {
                     header("Accept-Language", lang);
                 }
@@ -429,6 +504,27 @@ namespace suil {
                         header("Connection", "Close");
                 }
 
+                /**
+                 * configures the pool of keep-alive connections of the session. Once a
+                 * response has been received, its connection is returned to the pool
+                 * and used by the next request made on the session from any coroutine
+                 * @param maxPerHost the maximum number of idle connections kept for the
+                 * host, 0 disables pooling
+                 * @param idleTimeout the time in milliseconds an idle connection is kept
+                 */
+                inline void pooling(size_t maxPerHost, int64_t idleTimeout = 30000) {
+                    pool->maxPerHost  = maxPerHost;
+                    pool->idleTimeout = idleTimeout;
+                    pool->prune(maxPerHost);
+                }
+
+                /**
+                 * @return the number of idle connections in the session's pool
+                 */
+                inline size_t pooled() const {
+                    return pool->idle.size();
+                }
+
                 inline Session::handle_t handle() {
                     SocketAdaptor *sock = nullptr;
                     if (ishttps()) {
@@ -451,6 +547,18 @@ namespace suil {
 
                 Response head(handle_t& h, const char* resource, CaseMap<String> hdr = {});
 
+                /**
+                 * sends a request and receives the headers of the response, leaving
+                 * the body on the connection to be pulled with the returned stream
+                 * @param h the handle to send the request on, must outlive the stream
+                 * @param m the request method
+                 * @param resource the requested resource
+                 * @param builder used to build the request
+                 * @param timeout the I/O timeout in milliseconds (-1 uses the session timeout)
+                 */
+                Stream stream(handle_t& h, Method m, const char *resource,
+                              request_builder_t builder = nullptr, int64_t timeout = -1);
+
                 Session()
                     : Session(String("http").dup(), String("127.0.0.1").dup())
                 {}
@@ -459,6 +567,8 @@ namespace suil {
                 template <typename... __O>
                 friend Session  load(const char *, int port, const char *, __O...);
                 friend Response perform(Method, handle_t& h, const char *, request_builder_t,ResponseWriter);
+                friend struct FanOut;
+                friend struct Stream;
 
                 Session(String&& proto, String&& host, int port = 80)
                     : port(port),
@@ -470,7 +580,7 @@ namespace suil {
                 void configure(const char* path, __O&... opts) {
                     /* configure Session */
                     // FIXME: String sess(utils::fs::readall(path, true));
-                    addr = ipremote(host.data(), port, 0, utils::after(timeout));
+                    addr = ipresolve(host.data(), port, 0, timeout);
                     if (errno != 0) {
                         throw Exception::create("getting address '", host(),
                                                  ":", port, "' failed:", errno_s);
@@ -485,7 +595,35 @@ namespace suil {
                     return protocol == "https";
                 }
 
-                Response perform(handle_t& h, Method m, const char *url, request_builder_t& builder, ResponseWriter& rd);
+                struct pool_t {
+                    struct idle_t {
+                        SocketAdaptor *sock;
+                        int64_t        since;
+                    };
+
+                    /* closes expired connections, keeping at most \param keep */
+                    void prune(size_t keep);
+
+                    ~pool_t();
+
+                    std::deque<idle_t> idle{};
+                    size_t             maxPerHost{8};
+                    int64_t            idleTimeout{30000};
+                };
+
+                bool borrow(SocketAdaptor& sock);
+                void release(SocketAdaptor& sock);
+                bool connect(SocketAdaptor& sock, int64_t timeout);
+                /* returns true if the request can be sent again on a new connection should
+                 * the pooled connection it was sent on turn out to be closed */
+                bool submit(handle_t& h, Method m, const char *url, request_builder_t& builder, int64_t timeout);
+                void resubmit(Request& req, int64_t timeout);
+
+                Response perform(handle_t& h, Method m, const char *url, request_builder_t& builder,
+                                 ResponseWriter& rd, int64_t timeout);
+                inline Response perform(handle_t& h, Method m, const char *url, request_builder_t& builder, ResponseWriter& rd) {
+                    return std::move(perform(h, m, url, builder, rd, Ego.timeout));
+                }
                 inline Response perform(handle_t& h, Method m, const char *url = "") {
                     request_builder_t rb{nullptr};
                     ResponseWriter rw{nullptr};
@@ -498,6 +636,7 @@ namespace suil {
                 int64_t   timeout{20000};
                 ipaddr    addr{};
                 String  protocol{"http"};
+                std::shared_ptr<pool_t> pool{std::make_shared<pool_t>()};
             };
 
             inline client::Response perform(Method m, Session::handle_t& h, const char *u, request_builder_t b,
@@ -509,6 +648,222 @@ namespace suil {
                 return std::move(resp);
             }
 
+            /**
+             * A response whose body is pulled from the connection by the caller, one
+             * chunk at a time. Chunked transfer encoding is decoded on the fly, so
+             * the handler only sees the body's data.
+             *
+             * @code
+             * auto h = sess.handle();
+             * auto st = sess.stream(h, Method::Get, "/large");
+             * if (st.status() == Status::OK) {
+             *     st.pipe([&](const char *data, size_t len) {
+             *         return out.write(data, len, timeout) == len;
+             *     });
+             * }
+             * @endcode
+             */
+            struct Stream : LOGGER(HTTP_CLIENT) {
+                using Handler = std::function<bool(const char*, size_t)>;
+
+                Stream(Stream&& o) noexcept
+                    : sess(o.sess),
+                      sock(o.sock),
+                      resp(std::move(o.resp)),
+                      tmp(std::move(o.tmp)),
+                      timeout(o.timeout)
+                {
+                    o.sock = nullptr;
+                }
+
+                Stream(const Stream&) = delete;
+                Stream& operator=(const Stream&) = delete;
+                Stream& operator=(Stream&&) = delete;
+
+                inline Status status() const {
+                    return resp.status();
+                }
+
+                inline strview hdr(const char *name) const {
+                    return resp.hdr(name);
+                }
+
+                /**
+                 * @return the response being streamed, its body is always empty
+                 */
+                inline const Response& response() const {
+                    return resp;
+                }
+
+                /**
+                 * reads the next portion of the body, invoking \a f for every chunk
+                 * decoded. The connection is not read again until \a f returns, a slow
+                 * consumer therefore slows down the sender.
+                 * @param f the handler invoked with the chunks of the body, returning
+                 * false aborts the transfer and closes the connection
+                 * @return true if there is more of the body to read, false once the body
+                 * has been read or the transfer was aborted
+                 */
+                bool read(const Handler& f);
+
+                /**
+                 * reads the remainder of the body into \a f
+                 * @return the number of bytes passed to \a f
+                 */
+                size_t pipe(const Handler& f);
+
+                /**
+                 * @return true if the whole body has been read
+                 */
+                inline bool eof() const {
+                    return resp.body_read;
+                }
+
+                /**
+                 * closes the stream, a connection whose body hasn't been read to the
+                 * end is closed instead of being returned to the pool
+                 */
+                void close();
+
+                ~Stream() {
+                    close();
+                }
+
+            private:
+                friend struct Session;
+                Stream(Session& sess, SocketAdaptor& sock, int64_t timeout)
+                    : sess(sess),
+                      sock(&sock),
+                      timeout(timeout)
+                {}
+
+                Session&           sess;
+                SocketAdaptor     *sock{nullptr};
+                Response           resp{};
+                OBuffer            tmp{};
+                int64_t            timeout{-1};
+            };
+
+            /**
+             * @see Session::stream
+             */
+            inline Stream stream(Method m, Session::handle_t& h, const char *resource,
+                                 request_builder_t builder = nullptr, int64_t timeout = -1)
+            {
+                return h.sess.stream(h, m, resource, std::move(builder), timeout);
+            }
+
+            /**
+             * Runs multiple requests on a session concurrently, each request on its own
+             * coroutine and (pooled) connection. All the requests share a deadline and
+             * the responses can be consumed as they complete.
+             *
+             * @code
+             * client::FanOut fo(sess, 2000);
+             * fo.add(Method::Get, "/users/1");
+             * fo.add(Method::Get, "/orders/1", nullptr, 500);
+             * client::FanOut::Result res;
+             * while (fo.next(res)) {
+             *     if (res.ok()) ...
+             * }
+             * @endcode
+             */
+            struct FanOut : LOGGER(HTTP_CLIENT) {
+                struct Result {
+                    /* the id returned by \a add */
+                    size_t   id{0};
+                    Response resp{};
+                    /* the reason the request failed, empty on success */
+                    String   error{};
+
+                    inline bool ok() const {
+                        return error.empty();
+                    }
+                };
+
+                /**
+                 * @param sess the session to run the requests on, must outlive the fan-out
+                 * @param timeout the time in milliseconds within which all requests must complete
+                 */
+                FanOut(Session& sess, int64_t timeout)
+                    : sess(sess),
+                      ddline(timeout < 0? -1 : mnow() + timeout)
+                {}
+
+                FanOut(const FanOut&) = delete;
+                FanOut(FanOut&&) = delete;
+                FanOut& operator=(const FanOut&) = delete;
+                FanOut& operator=(FanOut&&) = delete;
+
+                /**
+                 * adds a request to the fan-out, requests are started on the first
+                 * call to \a next or \a all
+                 * @param m the request method
+                 * @param resource the requested resource
+                 * @param builder used to build the request
+                 * @param timeout the time in milliseconds allowed for this request, it is
+                 * always bounded by the shared deadline (-1 uses the session timeout)
+                 * @return the id of the request, which is the index of its response in \a all
+                 */
+                size_t add(Method m, const char *resource, request_builder_t builder = nullptr, int64_t timeout = -1);
+
+                /**
+                 * waits for the next request to complete
+                 * @param res receives the result of the completed request
+                 * @return false if there are no more requests to wait for, the shared deadline
+                 * elapsed or the fan-out was cancelled
+                 */
+                bool next(Result& res);
+
+                /**
+                 * waits for all the requests to complete
+                 * @return the results of the requests ordered by id, requests that did not
+                 * complete before the deadline are reported as failed
+                 */
+                std::vector<Result> all();
+
+                /**
+                 * cancels the remaining requests. Requests which have not been sent yet
+                 * are dropped, the connections of in-flight requests are shut down and
+                 * their results discarded. Requests still connecting fail on their timeout
+                 */
+                void cancel();
+
+                /**
+                 * @return the number of requests that haven't completed yet
+                 */
+                inline size_t pending() const {
+                    return calls.size() - received;
+                }
+
+                /**
+                 * cancels the remaining requests (see \a cancel) and waits for the in-flight
+                 * requests to finish with the session
+                 */
+                ~FanOut();
+
+            private suil_ut:
+                struct call_t {
+                    Method            method;
+                    String            resource;
+                    request_builder_t builder;
+                    int64_t           timeout;
+                    Result            result{};
+                    /* the handle of the request while it is in flight */
+                    Session::handle_t *h{nullptr};
+                };
+
+                void start();
+                static coroutine void run(FanOut& fo, size_t id);
+
+                Session&            sess;
+                int64_t             ddline{-1};
+                std::vector<call_t> calls{};
+                chan                ch{nullptr};
+                size_t              received{0};
+                bool                cancelled{false};
+            };
+
 #undef CRLF
 
             struct FileOffload: File {
@@ -381,7 +381,8 @@ namespace suil {
                     close_ = true;
                 }
 
-                if (res.status > Status::BAD_REQUEST && !res.body) {
+                bool chunked = res.isstreamed() && !res.headers.count("Content-Length");
+                if (res.status > Status::BAD_REQUEST && !res.body && !res.isstreamed()) {
                     res.body.append((status+9));
                 }
                 // flush cookies.
@@ -389,7 +390,7 @@ namespace suil {
 
                 for (auto h : res.headers) {
                     hbuf.append(h.first.data(), h.first.size());
-                    hbuf.append(" : ", sizeofcstr(" : "));
+                    hbuf.append(": ", sizeofcstr(": "));
                     hbuf.append(h.second.data(), h.second.size());
                     hbuf.append("\r\n", 2);
                 }
@@ -407,10 +408,13 @@ namespace suil {
                     hbuf.append("\r\n", 2);
                 }
 
-                if (!res.headers.count("Content-Length")) {
+                if (chunked) {
+                    hbuf.append("Transfer-Encoding: chunked\r\n",
+                                sizeofcstr("Transfer-Encoding: chunked\r\n"));
+                }
+                else if (!res.headers.count("Content-Length")) {
                     hbuf.append("Content-Length: ", sizeofcstr("Content-Length: "));
-                    auto tmp = std::to_string(res.length());
-                    hbuf.append(tmp.data(), tmp.size());
+                    hbuf << (uint64_t) res.length();
                     hbuf.append("\r\n", 2);
                 }
 
@@ -431,10 +435,47 @@ namespace suil {
                     close_ = true;
                     res.clear();
                 }
+                else if (res.isstreamed() && !stream_response(res, chunked)) {
+                    iwarn("(%p:%s) - streaming response failed: %s",
+                          this, sock.isopen(), errno_s);
+                    /* the client cannot tell where the response ends */
+                    close_ = true;
+                }
 
                 obuf.clear();
             }
 
+            bool stream_response(Response& res, bool chunked) {
+                bool ok{true};
+                BodyWriter writer = [&](const char *data, size_t len) -> bool {
+                    if (!ok || len == 0)
+                        return ok;
+
+                    if (chunked) {
+                        char head[24];
+                        size_t n = numfmt::xtoa(len, head);
+                        head[n++] = '\r';
+                        head[n++] = '\n';
+                        ok = sock.send(head, n, config.connection_timeout) == n;
+                    }
+                    ok = ok && sock.send(data, len, config.connection_timeout) == len;
+                    if (chunked) {
+                        ok = ok && sock.send("\r\n", 2, config.connection_timeout) == 2;
+                    }
+                    stats.tx_bytes += len;
+                    return ok;
+                };
+
+                if (!res.streamer(writer) || !ok) {
+                    return false;
+                }
+
+                if (chunked && sock.send("0\r\n\r\n", 5, config.connection_timeout) != 5) {
+                    return false;
+                }
+                return sock.flush(config.connection_timeout);
+            }
+
 
             bool write_response(sendbuf_t& buf) {
                 size_t rc{0};
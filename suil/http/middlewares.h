@@ -127,6 +127,10 @@ namespace suil::http::mw {
                 /* revoke token for given user */
                 auto& conn = redisContext->conn(0);
                 conn.hdel(self->hashName.peek(), user.peek());
+                /* the token should not be served from the cache of verified tokens */
+                jwtContext->revoke([&user](const http::Jwt& jwt) {
+                    return jwt.aud() == user;
+                });
                 jwtContext->logout();
             }
 
@@ -152,6 +156,7 @@ namespace suil::http::mw {
                 auto& conn = redisContext.conn(0);
                 if (!conn.hexists(hashName.peek(), aud.peek())) {
                     /* token does not exist */
+                    jwtContext.revoke();
                     jwtContext.authenticate("Attempt to access protected resource with invalid token");
                     resp.end();
                     return;
@@ -160,6 +165,7 @@ namespace suil::http::mw {
                 auto cachedToken = conn.template hget<String>(hashName.peek(), aud.peek());
                 if (cachedToken != jwtContext.token()) {
                     /* Token bad or token has been revoked */
+                    jwtContext.revoke();
                     jwtContext.authenticate("Attempt to access protected resource with invalid token");
                     resp.end();
                     return;
@@ -0,0 +1,488 @@
+//
+// HTTP reverse proxy
+//
+
+#include <algorithm>
+
+#include <suil/http/proxy.h>
+
+namespace suil {
+    namespace http {
+
+        namespace {
+
+            /* a request in flight, shared with the streamer of the response's body */
+            struct forward_t {
+                forward_t(client::Session& sess, uint32_t& active)
+                    : h(sess.handle()),
+                      active(active)
+                {
+                    active++;
+                }
+
+                ~forward_t() {
+                    /* the stream references the handle's socket */
+                    st = std::nullopt;
+                    active--;
+                }
+
+                client::Session::handle_t     h;
+                std::optional<client::Stream> st{std::nullopt};
+                uint32_t&                     active;
+            };
+
+            inline bool idempotent(Method m) {
+                return m != Method::Post && m != Method::Connect;
+            }
+        }
+
+        void Proxy::upstream(const char *host, int port) {
+            auto sess = client::load(host, port);
+            /* the client's headers are forwarded */
+            sess.removeheader("User-Agent");
+            sess.removeheader("Accept-Language");
+            servers.emplace_back(std::move(sess), utils::catstr(host, ":", port));
+            idebug("added upstream %s:%d", host, port);
+        }
+
+        bool Proxy::hopbyhop(const String& name) {
+            static const char *HOP_BY_HOP[] = {
+                "Connection", "Keep-Alive", "Proxy-Authenticate", "Proxy-Authorization",
+                "Proxy-Connection", "TE", "Trailer", "Transfer-Encoding", "Upgrade"
+            };
+
+            for (auto hdr: HOP_BY_HOP) {
+                if (name.compare(hdr, true) == 0)
+                    return true;
+            }
+            return false;
+        }
+
+        Proxy::upstream_t* Proxy::select(const std::vector<upstream_t*>& tried) {
+            auto now = mnow();
+            upstream_t *found{nullptr}, *down{nullptr};
+            size_t index{0};
+            for (size_t i = 0; i < servers.size(); i++) {
+                size_t idx = (next + i) % servers.size();
+                auto& up = servers[idx];
+                if (std::find(tried.begin(), tried.end(), &up) != tried.end())
+                    continue;
+
+                if (up.downUntil > now) {
+                    /* used if all the upstreams are down, the first to recover is probed */
+                    if (down == nullptr || up.downUntil < down->downUntil)
+                        down = &up;
+                    continue;
+                }
+
+                if (found == nullptr || (leastConnections && up.active < found->active)) {
+                    found = &up;
+                    index = idx;
+                }
+                if (!leastConnections)
+                    break;
+            }
+
+            if (found == nullptr)
+                return down;
+            next = index + 1;
+            return found;
+        }
+
+        void Proxy::failed(upstream_t& up) {
+            if (++up.failures >= maxFailures) {
+                iwarn("upstream %s failed %u times, skipping it for %ld ms",
+                      up.name(), up.failures, failTimeout);
+                up.downUntil = mnow() + failTimeout;
+                up.failures = 0;
+            }
+        }
+
+        void Proxy::operator()(const Request& req, Response& res) {
+            if (req.method > (unsigned) Method::Trace) {
+                res.end(Status::NOT_IMPLEMENTED);
+                return;
+            }
+
+            auto m = (Method) req.method;
+            auto target = req.target();
+            String resource = String{target.data(), target.size(), false}.dup();
+            String forwardedFor{req.ip()};
+            auto it = req.headers.find("X-Forwarded-For");
+            if (it != req.headers.end()) {
+                forwardedFor = utils::catstr(it->second, ", ", req.ip());
+            }
+
+            /* set once the upstream starts receiving the body */
+            bool sent{false};
+            client::request_builder_t builder = [&](client::Request& r) -> bool {
+                for (auto& hdr: req.headers) {
+                    if (hopbyhop(hdr.first) ||
+                        hdr.first.compare("Host", true) == 0 ||
+                        hdr.first.compare("X-Forwarded-For", true) == 0)
+                        continue;
+                    r.hdr(hdr.first.peek(), hdr.second.peek());
+                }
+                r.hdr(String{"X-Forwarded-For"}, forwardedFor.peek());
+                r.hdr(String{"X-Forwarded-Host"}, req.header("Host").empty()?
+                      String{} : String{req.header("Host").data(), req.header("Host").size(), false});
+                r.hdr(String{"X-Forwarded-Proto"}, String{proto.data(), proto.size(), false});
+
+                if (req.body_length()) {
+                    /* the body is sent from where the server received it, memory or disk */
+                    r.streambody(req.body_length(), [&](SocketAdaptor& sock, int64_t timeout) {
+                        sent = true;
+                        return req.forward_body(sock, timeout);
+                    });
+                }
+                return true;
+            };
+
+            std::vector<upstream_t*> tried;
+            Status status{Status::BAD_GATEWAY};
+            while (upstream_t *up = select(tried)) {
+                tried.push_back(up);
+                try {
+                    auto fw = std::make_shared<forward_t>(up->sess, up->active);
+                    fw->st.emplace(up->sess.stream(fw->h, m, resource(), builder, timeout));
+                    up->failures = 0;
+
+                    auto& resp = fw->st->response();
+                    for (auto& hdr: resp.hdrs()) {
+                        if (hopbyhop(hdr.first))
+                            continue;
+                        res.header(hdr.first.dup(), hdr.second.dup());
+                    }
+
+                    if (!fw->st->eof() || !resp().empty()) {
+                        /* relay the body as it's received, the upstream is released once done */
+                        res.stream([fw](const BodyWriter& w) {
+                            bool ok{true};
+                            try {
+                                fw->st->pipe([&](const char *data, size_t len) {
+                                    return ok = w(data, len);
+                                });
+                            }
+                            catch (...) {
+                                sdebug("relaying upstream response failed: %s",
+                                       Exception::fromCurrent().what());
+                                return false;
+                            }
+                            return ok && fw->st->eof();
+                        });
+                    }
+                    res.end(fw->st->status());
+                    return;
+                }
+                catch (...) {
+                    status = errno == ETIMEDOUT? Status::GATEWAY_TIMEOUT : Status::BAD_GATEWAY;
+                    iwarn("forwarding '%s' to %s failed: %s", resource(),
+                          up->name(), Exception::fromCurrent().what());
+                    failed(*up);
+                    if (!idempotent(m) && (sent || !req.body_length())) {
+                        /* the upstream might have processed the request */
+                        break;
+                    }
+                    sent = false;
+                }
+            }
+
+            res.end(status);
+        }
+
+        void Proxy::before(Request& req, Response& res, Context&) {
+            if (prefix.empty() || strncmp(req.url, prefix.data(), prefix.size()) != 0)
+                return;
+            Ego(req, res);
+        }
+    }
+}
+
+#ifdef unit_test
+#include <catch/catch.hpp>
+#include <suil/http/endpoint.h>
+
+using namespace suil;
+using namespace suil::http;
+
+static int freeport() {
+    tcpsock ls = tcplisten(iplocal("127.0.0.1", 0, 0), 1);
+    int port = tcpport(ls);
+    tcpclose(ls);
+    return port;
+}
+
+struct TestUpstream {
+    tcpsock     ls{tcplisten(iplocal("127.0.0.1", 0, 0), 10)};
+    bool        stop{false};
+    int         requests{0};
+    /* the head and body of the last request received */
+    std::string head{};
+    std::string body{};
+
+    TestUpstream() {
+        go(serve(this));
+    }
+
+    ~TestUpstream() {
+        stop = true;
+        msleep(mnow() + 50);
+    }
+
+private:
+    static coroutine void serve(TestUpstream *up) {
+        while (!up->stop) {
+            tcpsock as = tcpaccept(up->ls, mnow() + 10);
+            if (as == nullptr) continue;
+            go(session(up, as));
+        }
+        tcpclose(up->ls);
+    }
+
+    /* GET /chunked responds with a chunked body, /close closes the connection
+     * without responding and any other request is echoed (the body or the path) */
+    static coroutine void session(TestUpstream *up, tcpsock as) {
+        char buf[1024];
+        while (!up->stop) {
+            std::string head;
+            while (head.find("\r\n\r\n") == std::string::npos) {
+                size_t nrd = tcprecvuntil(as, buf, sizeof(buf), "\n", 1, mnow() + 100);
+                if (errno == ETIMEDOUT && head.empty() && !up->stop) continue;
+                if (nrd == 0 || errno != 0) {
+                    tcpclose(as);
+                    return;
+                }
+                head.append(buf, nrd);
+            }
+
+            std::string body;
+            const char *cl = strcasestr(head.c_str(), "Content-Length:");
+            if (cl != nullptr) {
+                body.resize(strtoul(cl + 15, nullptr, 10));
+                if (!body.empty())
+                    tcprecv(as, &body[0], body.size(), mnow() + 1000);
+            }
+            up->requests++;
+            up->head = head;
+            up->body = body;
+
+            std::string path = head.substr(head.find(' ') + 1);
+            path = path.substr(0, path.find(' '));
+            if (path == "/close")
+                break;
+
+            std::string resp;
+            if (path == "/chunked") {
+                resp = "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\nX-Upstream: yes\r\n\r\n"
+                       "5\r\nhello\r\n6\r\n world\r\n0\r\n\r\n";
+            }
+            else {
+                const std::string& echo = body.empty()? path : body;
+                resp = "HTTP/1.1 200 OK\r\nContent-Length: " + std::to_string(echo.size()) +
+                       "\r\nX-Upstream: yes\r\n\r\n" + echo;
+            }
+            tcpsend(as, resp.data(), resp.size(), -1);
+            tcpflush(as, -1);
+        }
+        tcpclose(as);
+    }
+};
+
+/* an endpoint forwarding every request with the given proxy */
+struct ProxyEndpoint : Endpoint<> {
+    ProxyEndpoint(Proxy& proxy)
+        : Endpoint<>("/")
+    {
+        this->config.name = "127.0.0.1";
+        this->config.port = port = freeport();
+        /* bodies larger than 64 bytes are offloaded to disk */
+        this->config.disk_offload = true;
+        this->config.disk_offload_min = 64;
+        this->config.offload_path = "/tmp";
+        proxy.attach(*this, "/{path}");
+        go(run(this));
+    }
+
+    ~ProxyEndpoint() {
+        this->stop();
+        msleep(mnow() + 50);
+    }
+
+    int port{0};
+
+private:
+    static coroutine void run(ProxyEndpoint *ep) {
+        ep->start();
+    }
+};
+
+TEST_CASE("suil::http::Proxy", "[http][proxy]")
+{
+    Proxy proxy;
+    proxy.upstream("127.0.0.1", 8001);
+    proxy.upstream("127.0.0.1", 8002);
+    proxy.upstream("127.0.0.1", 8003);
+    REQUIRE(proxy.upstreams() == 3);
+    auto& servers = proxy.servers;
+
+    SECTION("hop-by-hop headers are detected") {
+        CHECK(Proxy::hopbyhop("Connection"));
+        CHECK(Proxy::hopbyhop("transfer-encoding"));
+        CHECK_FALSE(Proxy::hopbyhop("Content-Length"));
+        CHECK_FALSE(Proxy::hopbyhop("X-Forwarded-For"));
+    }
+
+    SECTION("upstreams are used in a round robin fashion") {
+        for (int i = 0; i < 6; i++) {
+            CHECK(proxy.select({}) == &servers[i % 3]);
+        }
+        // upstreams already tried are skipped
+        CHECK(proxy.select({&servers[0], &servers[1]}) == &servers[2]);
+        CHECK(proxy.select({&servers[0], &servers[1], &servers[2]}) == nullptr);
+    }
+
+    SECTION("least connections picks the least busy upstream") {
+        proxy.leastConnections = true;
+        servers[0].active = 2;
+        servers[1].active = 1;
+        servers[2].active = 3;
+        CHECK(proxy.select({}) == &servers[1]);
+        servers[1].active = 4;
+        CHECK(proxy.select({}) == &servers[0]);
+    }
+
+    SECTION("failing upstreams are skipped for a while") {
+        proxy.failTimeout = 100;
+        for (uint32_t i = 0; i < proxy.maxFailures; i++) {
+            proxy.failed(servers[0]);
+        }
+        for (int i = 0; i < 4; i++) {
+            CHECK(proxy.select({}) != &servers[0]);
+        }
+        // the first to recover is used when all the upstreams are down
+        for (uint32_t i = 0; i < proxy.maxFailures; i++) {
+            proxy.failed(servers[1]);
+            proxy.failed(servers[2]);
+        }
+        CHECK(proxy.select({}) == &servers[0]);
+        msleep(mnow() + 110);
+        CHECK(servers[0].downUntil <= mnow());
+        CHECK(proxy.select({&servers[1]}) == &servers[0]);
+    }
+}
+
+TEST_CASE("suil::http::Proxy forwarding", "[http][proxy]")
+{
+    TestUpstream up1, up2;
+    Proxy proxy;
+    proxy.timeout = 1000;
+
+    SECTION("requests are forwarded to the upstream") {
+        proxy.upstream("127.0.0.1", tcpport(up1.ls));
+        ProxyEndpoint ep(proxy);
+        {
+            auto sess = client::load("127.0.0.1", ep.port);
+            auto resp = client::get(sess, "/hello?name=suil", [](client::Request& r) {
+                r.hdrs("X-Test", "yes");
+                return true;
+            });
+            REQUIRE(resp.status() == Status::OK);
+            CHECK(resp.getbody() == "/hello?name=suil");
+            CHECK(resp.hdr("X-Upstream") == "yes");
+            CHECK(up1.head.find("GET /hello?name=suil HTTP/1.1\r\n") == 0);
+            CHECK(up1.head.find("X-Test: yes\r\n") != std::string::npos);
+            CHECK(up1.head.find("X-Forwarded-For: 127.0.0.1\r\n") != std::string::npos);
+            CHECK(up1.head.find("X-Forwarded-Proto: http\r\n") != std::string::npos);
+
+            /* upstream connections are reused */
+            REQUIRE(client::get(sess, "/again").status() == Status::OK);
+            CHECK(up1.requests == 2);
+            CHECK(proxy.servers[0].sess.pooled() == 1);
+        }
+    }
+
+    SECTION("chunked responses are relayed as they are received") {
+        proxy.upstream("127.0.0.1", tcpport(up1.ls));
+        ProxyEndpoint ep(proxy);
+        {
+            auto sess = client::load("127.0.0.1", ep.port);
+            auto resp = client::get(sess, "/chunked");
+            REQUIRE(resp.status() == Status::OK);
+            CHECK(resp.hdr("Transfer-Encoding") == "chunked");
+            CHECK(resp.hdr("X-Upstream") == "yes");
+            CHECK(resp.getbody() == "hello world");
+
+            /* the connection is still usable after a chunked response */
+            resp = client::get(sess, "/after");
+            REQUIRE(resp.status() == Status::OK);
+            CHECK(resp.getbody() == "/after");
+        }
+    }
+
+    SECTION("bodies are forwarded from memory or from the offload file") {
+        proxy.upstream("127.0.0.1", tcpport(up1.ls));
+        ProxyEndpoint ep(proxy);
+        {
+            auto sess = client::load("127.0.0.1", ep.port);
+            auto resp = client::post(sess, "/echo", [](client::Request& r) {
+                r.buffer() << "small body";
+                return true;
+            });
+            REQUIRE(resp.status() == Status::OK);
+            CHECK(up1.body == "small body");
+            CHECK(resp.getbody() == "small body");
+
+            std::string large(20000, '\0');
+            for (size_t i = 0; i < large.size(); i++)
+                large[i] = (char) ('a' + (i % 26));
+            resp = client::post(sess, "/echo", [&](client::Request& r) {
+                r.buffer().append(large.data(), large.size());
+                return true;
+            });
+            REQUIRE(resp.status() == Status::OK);
+            CHECK(up1.body == large);
+            CHECK(resp().size() == large.size());
+        }
+    }
+
+    SECTION("requests are retried on the next upstream unless the body was sent") {
+        proxy.upstream("127.0.0.1", freeport());
+        proxy.upstream("127.0.0.1", tcpport(up1.ls));
+        ProxyEndpoint ep(proxy);
+        {
+            auto sess = client::load("127.0.0.1", ep.port);
+            /* the first upstream is unreachable */
+            REQUIRE(client::get(sess, "/retried").status() == Status::OK);
+            CHECK(up1.requests == 1);
+            auto resp = client::post(sess, "/echo", [](client::Request& r) {
+                r.buffer() << "never sent";
+                return true;
+            });
+            REQUIRE(resp.status() == Status::OK);
+            CHECK(resp.getbody() == "never sent");
+            CHECK(up1.requests == 2);
+        }
+    }
+
+    SECTION("requests failing after reaching the upstream") {
+        proxy.upstream("127.0.0.1", tcpport(up1.ls));
+        proxy.upstream("127.0.0.1", tcpport(up2.ls));
+        ProxyEndpoint ep(proxy);
+        {
+            auto sess = client::load("127.0.0.1", ep.port);
+            /* the upstream might have processed the body */
+            auto resp = client::post(sess, "/close", [](client::Request& r) {
+                r.buffer() << "processed?";
+                return true;
+            });
+            CHECK(resp.status() == Status::BAD_GATEWAY);
+            CHECK(up1.requests + up2.requests == 1);
+
+            /* idempotent requests are retried on every upstream */
+            resp = client::get(sess, "/close");
+            CHECK(resp.status() == Status::BAD_GATEWAY);
+            CHECK(up1.requests + up2.requests == 3);
+        }
+    }
+}
+#endif
@@ -0,0 +1,140 @@
+//
+// HTTP reverse proxy
+//
+
+#ifndef SUIL_HTTP_PROXY_H
+#define SUIL_HTTP_PROXY_H
+
+#include <deque>
+#include <optional>
+
+#include <suil/http/routing.h>
+#include <suil/http/clientapi.h>
+
+namespace suil {
+    namespace http {
+
+        define_log_tag(HTTP_PROXY);
+
+        /**
+         * Forwards requests to a pool of upstream servers. Requests are sent on the
+         * keep-alive connections of a client::Session per upstream and the response
+         * body is relayed to the client as it is received from the upstream.
+         *
+         * Upstreams are picked in a round robin fashion (or the one with the least
+         * requests in flight), an upstream failing \a maxFailures consecutive times
+         * is skipped for \a failTimeout milliseconds.
+         *
+         * The proxy can be attached to an endpoint route
+         * @code
+         * http::Proxy proxy;
+         * proxy.upstream("10.0.0.1", 8080);
+         * proxy.upstream("10.0.0.2", 8080);
+         * proxy.attach(ep, "/api/{path}");
+         * @endcode
+         *
+         * or used as a middleware, forwarding the requests whose path starts with
+         * \a prefix before they reach the route's handler
+         * @code
+         * http::Endpoint<http::Proxy> ep("/");
+         * auto& proxy = ep.middleware<http::Proxy>();
+         * proxy.prefix = "/legacy/";
+         * proxy.upstream("legacy.local", 80);
+         * @endcode
+         */
+        struct Proxy : LOGGER(HTTP_PROXY) {
+            struct Context {
+            };
+
+            /**
+             * adds an upstream server requests can be forwarded to
+             * @param host the host name or address of the server (can be prefixed
+             * with the protocol, e.g https://host)
+             * @param port the port the server listens on
+             */
+            void upstream(const char *host, int port = 80);
+
+            /**
+             * @return the number of upstream servers
+             */
+            inline size_t upstreams() const {
+                return servers.size();
+            }
+
+            /**
+             * forwards the request to an upstream server, the upstream's response is
+             * sent back as is, minus the hop-by-hop headers. Responds with
+             * BAD_GATEWAY (or GATEWAY_TIMEOUT) if none of the upstreams could be reached
+             */
+            void operator()(const Request& req, Response& res);
+
+            /**
+             * registers the proxy as the handler of \a route on the given endpoint
+             * @param ep the endpoint to attach to
+             * @param route the route to forward, can end with a {path} parameter
+             */
+            template <typename E>
+            void attach(E& ep, std::string route) {
+                auto tag = magic::get_parameter_tag_runtime(route.c_str());
+                if (tag != 0 && tag != 5) {
+                    throw Exception::create("Proxy: route '", route, "' can only have a {path} parameter");
+                }
+
+                auto& rule = ep(std::move(route))
+                ("GET"_method, "HEAD"_method, "POST"_method, "PUT"_method,
+                 "DELETE"_method, "OPTIONS"_method, "TRACE"_method);
+                if (tag != 0) {
+                    /* the request target is forwarded as is, the parameter is ignored */
+                    rule([this](const Request& req, Response& res, std::string) {
+                        Ego(req, res);
+                    });
+                }
+                else {
+                    rule([this](const Request& req, Response& res) {
+                        Ego(req, res);
+                    });
+                }
+            }
+
+            void before(Request& req, Response& res, Context&);
+
+            void after(Request&, Response&, Context&) {}
+
+            /* the path prefix of the requests forwarded when used as a middleware */
+            std::string prefix{};
+            /* the value of the X-Forwarded-Proto header */
+            std::string proto{"http"};
+            /* forward to the upstream with the least requests in flight */
+            bool        leastConnections{false};
+            /* the number of consecutive failures after which an upstream is skipped */
+            uint32_t    maxFailures{3};
+            /* the time (ms) a failed upstream is skipped */
+            int64_t     failTimeout{10000};
+            /* the I/O timeout (ms) of requests to upstreams */
+            int64_t     timeout{30000};
+
+        private suil_ut:
+            struct upstream_t {
+                upstream_t(client::Session&& sess, String&& name)
+                    : sess(std::move(sess)),
+                      name(std::move(name))
+                {}
+
+                client::Session sess;
+                String          name;
+                uint32_t        active{0};
+                uint32_t        failures{0};
+                int64_t         downUntil{0};
+            };
+
+            upstream_t* select(const std::vector<upstream_t*>& tried);
+            void failed(upstream_t& up);
+            static bool hopbyhop(const String& name);
+
+            std::deque<upstream_t> servers{};
+            size_t                 next{0};
+        };
+    }
+}
+
+#endif //SUIL_HTTP_PROXY_H
@@ -5,6 +5,8 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <sys/param.h>
+#include <sys/mman.h>
+#include <sys/sendfile.h>
 
 #include <suil/http/request.h>
 
@@ -78,257 +80,227 @@ namespace suil {
 
             size_t len = std::min(sizeofcstr("multipart/form-data"), ctype.size());
             if (strncasecmp(ctype.data(), "multipart/form-data", len) == 0) {
-                trace("parsing url encoded form");
-                const char *boundary = strchr(ctype.data(), '=');
+                trace("parsing multipart form");
+                const char *boundary = strcasestr(ctype.data(), "boundary=");
                 if (boundary == nullptr) {
-                    idebug("multipart/form-data without boundary: %", ctype.data());
+                    idebug("multipart/form-data without boundary: %s", ctype.data());
+                    return false;
+                }
+                boundary += sizeofcstr("boundary=");
+                size_t blen = strcspn(boundary, "; \t");
+                if (*boundary == '"') {
+                    /* quoted boundary */
+                    const char *q = strchr(++boundary, '"');
+                    blen = q? q-boundary : 0;
+                }
+                if (blen == 0) {
+                    idebug("multipart/form-data with an invalid boundary: %s", ctype.data());
                     return false;
                 }
-                boundary++;
-                String tmp(boundary);
 
-                return parse_multipart_form(boundary);
+                return parse_multipart_form(String(boundary, blen, false));
             }
 
             return false;
         }
 
-#define eat_space(p) while (*(p) == ' ' && *(p) != '\r') (p)++
-
-       static inline bool _get_header(char *&p, char *e, char *&f, char *&v) {
-           f = p;
-           if ((p = strchr(p, ':')) == nullptr)
-               return false;
-           *p++ = '\0';
-           eat_space(p);
-           v = p;
-           while (*(++p) != '\r' && p != e);
-
-           return (*p == '\r' && *++p == '\n');
-        };
-
-#define goto_chr(p, e, c) ({bool __v = false;                       \
-        while ((p) != (e) && *(p) != (c) && *(p) != '\r') (p)++;    \
-        if (*(p) == (c)) __v = true; __v; })
-
-        static inline bool _get_disposition(char *&p, char *e, char *&name, char *&filename) {
-            name = filename = nullptr;
-            while (*p != '\0' && p != e) {
-                if (strncasecmp(p, "name=\"", 4) == 0) {
-                    /* eat name=" */
-                    p += 6;
-                    name = p;
-                    if (goto_chr(p, e, '"')) {
-                        *p++ = '\0';
-                    } else
-                        return false;
+        namespace {
+
+            /* Boyer-Moore-Horspool search of a multipart delimiter, boundaries are long
+             * enough for the skip table to jump over most of the part's data */
+            struct delimiter_t {
+                delimiter_t(const char *pat, size_t len)
+                    : pat((const uint8_t *) pat),
+                      len(len)
+                {
+                    for (auto& s: skip)
+                        s = len;
+                    for (size_t i = 0; i < len-1; i++)
+                        skip[this->pat[i]] = len-1-i;
                 }
-                else if (strncasecmp(p, "filename=\"", 10) == 0) {
-                    /* eat filename= */
-                    p += 10;
-                    filename = p;
-                    if (goto_chr(p, e, '"')) {
-                        *p++ = '\0';
-                    } else
-                        return false;
+
+                char *find(char *p, char *e) const {
+                    auto *s = (const uint8_t *) p, *end = (const uint8_t *) e;
+                    const uint8_t last = pat[len-1];
+                    while ((size_t)(end - s) >= len) {
+                        uint8_t c = s[len-1];
+                        if (c == last && memcmp(s, pat, len-1) == 0)
+                            return (char *) s;
+                        s += skip[c];
+                    }
+                    return nullptr;
                 }
-                else {
-                    /* unknown field */
+
+                const uint8_t *pat;
+                size_t         len;
+                size_t         skip[256];
+            };
+
+            inline char *skip_lws(char *p, char *e) {
+                while (p < e && (*p == ' ' || *p == '\t')) p++;
+                return p;
+            }
+
+            /* parses a Content-Disposition header value (form-data; name="f"; filename="f.txt"),
+             * the name and filename reference the header, they are not terminated */
+            bool parse_disposition(char *p, char *e, String& name, String& filename, bool& isfile) {
+                if ((e - p) < 9 || strncasecmp(p, "form-data", 9) != 0)
                     return false;
+
+                p = skip_lws(p+9, e);
+                while (p < e) {
+                    if (*p++ != ';')
+                        return false;
+                    p = skip_lws(p, e);
+                    char *eq = (char *) memchr(p, '=', e - p);
+                    if (eq == nullptr)
+                        return false;
+                    char *key = p, *val = eq+1, *vend;
+                    size_t klen = eq - p;
+
+                    if (val < e && *val == '"') {
+                        vend = (char *) memchr(++val, '"', e - val);
+                        if (vend == nullptr)
+                            return false;
+                        p = vend+1;
+                    }
+                    else {
+                        vend = val;
+                        while (vend < e && *vend != ';' && *vend != ' ' && *vend != '\t') vend++;
+                        p = vend;
+                    }
+                    p = skip_lws(p, e);
+
+                    if (klen == 4 && strncasecmp(key, "name", 4) == 0) {
+                        name = String(val, vend - val, false);
+                    }
+                    else if (klen == 8 && strncasecmp(key, "filename", 8) == 0) {
+                        filename = String(val, vend - val, false);
+                        isfile = true;
+                    }
                 }
+                return true;
+            }
+        }
 
-                if (*p == ';') p++;
-                eat_space(p);
+        char *Request::body_buffer() {
+            if (offload == nullptr)
+                return body.empty()? nullptr : body.data();
+
+            if (body_map == nullptr) {
+                if (offload_error || offload->length == 0)
+                    return nullptr;
+                /* buffered writes must reach the file before it's mapped */
+                offload->flush(config.connection_timeout);
+                void *addr = mmap(nullptr, offload->length, PROT_READ,
+                                  MAP_PRIVATE, offload->raw(), 0);
+                if (addr == MAP_FAILED) {
+                    idebug("%s - mapping body offload failed: %s", sock.id(), errno_s);
+                    return nullptr;
+                }
+                body_map = addr;
+                body_map_len = offload->length;
             }
 
-            return true;
+            return (char *) body_map;
         }
 
         bool Request::parse_multipart_form(const String& boundary) {
-            OBuffer rb((uint32_t) content_length+2);
-            if (read_body(rb.data(), content_length) <= 0) {
+            /* fields and files reference the body, it is never copied nor modified
+             * (it might still be forwarded) so the values are not terminated */
+            size_t len = body_length();
+            char *p = body_buffer(), *end = p + len;
+            if (p == nullptr) {
                 trace("error: reading body failed");
                 return false;
             }
 
-            enum {
-                state_begin, state_is_boundary,
-                state_boundary, state_save_data,
-                state_save_file, state_header,
-                state_content, state_data,
-                state_error, state_end
-            }  state = state_begin, next_state = state_begin;
-            rb.bseek(content_length);
-            char *p = rb.data(), *end = p + content_length;
-            char *name = nullptr, *filename = nullptr, *data = nullptr, *dend = nullptr;
-            bool cap{false};
-            trace("start parse multipart form %d", mnow());
-            while (cap || (p != end)) {
-                switch (next_state) {
-                    case state_begin:
-                        trace("multipart/form-data state_begin");
-                        /* fall through */
-                        state = state_error;
-                        next_state = state_is_boundary;
-                    case state_is_boundary:
-                        trace("multipart/form-data state_is_boundary");
-                        if (*p == '-' && *++p == '-') {
-                            state = state_is_boundary;
-                            next_state = state_boundary;
-                            ++p;
-                        } else {
-                            next_state = state;
-                        }
-                        break;
-
-                    case state_boundary:
-                        state = state_is_boundary;
-                        trace("multipart/form-data state_boundary");
-                        if (strncmp(p, boundary.data(), boundary.size()) != 0) {
-                            /* invalid boundary */
-                            trace("error: multipart/form-data invalid boundary");
-                            next_state = state_error;
-                        }
-                        else {
-                            p += boundary.size();
-                            bool el = (p[0] == '\r' && p[1] == '\n');
-                            bool eb = (p[0] == '-' && p[1] == '-');
-                            if (el || eb)
-                            {
-                                state = el? state_content : state_end;
-                                p += 2;
-                                if (filename != nullptr) {
-                                    next_state = state_save_file;
-                                    cap = true;
-                                } else if (name != nullptr) {
-                                    next_state = state_save_data;
-                                    cap = true;
-                                } else if (el) {
-                                    next_state = state_content;
-                                } else
-                                    next_state = state_end;
-                            }
-                            else {
-                                trace("error: multipart/form-data invalid state %d %d", el, eb);
-                                next_state = state_error;
-                            }
-                        }
-                        break;
+            /* delimiters are preceded by a CRLF, which belongs to the delimiter */
+            OBuffer tmp(boundary.size()+8);
+            tmp << "\r\n--" << boundary;
+            delimiter_t delim(tmp.data(), tmp.size());
+            if (len >= delim.len-2 && memcmp(p, tmp.data()+2, delim.len-2) == 0) {
+                /* no preamble */
+                p += delim.len-2;
+            }
+            else {
+                p = delim.find(p, end);
+                if (p == nullptr) {
+                    trace("error: multipart/form-data boundary not found");
+                    return false;
+                }
+                p += delim.len;
+            }
 
-                    case state_save_file: {
-                        trace("multipart/form-data state_save_file");
-                        *dend-- = '\0';
-                        UploadedFile f;
-                        String tmp(filename);
-                        String tmp_name(name);
-                        f.name_ = std::move(tmp);
-                        f.len_  = dend - data;
-                        f.data_ = data;
-                        files.emplace(std::move(tmp_name),
-                                      std::move(f));
-                        filename = data = dend = nullptr;
-                        next_state = state;
-                        cap = false;
+            trace("start parse multipart form %d", mnow());
+            while (true) {
+                if ((end - p) >= 2 && p[0] == '-' && p[1] == '-') {
+                    /* close delimiter */
+                    trace("multipart/form-data done %d fields, %d files %d",
+                          form.size(), files.size(), mnow());
+                    return true;
+                }
 
-                        break;
+                p = skip_lws(p, end);
+                if ((end - p) < 2 || p[0] != '\r' || p[1] != '\n') {
+                    trace("error: multipart/form-data invalid delimiter");
+                    return false;
+                }
+                p += 2;
+
+                String name{}, filename{};
+                bool isfile{false};
+                while (true) {
+                    char *eol = (char *) memmem(p, end - p, "\r\n", 2);
+                    if (eol == nullptr) {
+                        trace("error: multipart/form-data parsing header failed");
+                        return false;
                     }
-
-                    case state_save_data: {
-                        trace("multipart/form-data state_save_data");
-                        *--dend = '\0';
-                        String tmp(name);
-                        String tmp_data(data, dend - data, false);
-                        form.emplace(std::move(tmp), std::move(tmp_data));
-                        name = data = dend = nullptr;
-
-                        next_state = state;
-                        cap = false;
+                    if (eol == p) {
+                        /* end of part headers */
+                        p += 2;
                         break;
                     }
 
-                    case state_content:
-                        trace("multipart/form-data state_content");
-                        char *disp, *val;
-                        state = state_content;
-                        next_state = state_error;
-                        if (_get_header(p, end, disp, val) &&
-                            strcasecmp(disp, "Content-Disposition") == 0)
-                        {
-                            *(++p-2) = '\0';
-                            trace("multipart/form-data content disposition: %s", val);
-                            if (strncasecmp(val, "form-data", 9)) {
-                                /* unsupported disposition */
-                                trace("error: multipart/form-data not content disposition: %s",
-                                      val);
-                                continue;
-                            }
-                            /* eat form-data */
-                            val += 10;
-                            eat_space(val);
-                            if (_get_disposition(val, end, name, filename)) {
-                                /* successfully go disposition */
-                                trace("multipart/form-data name: %s, filename %s",
-                                name, filename);
-                                next_state = state_header;
-                            } else {
-                                trace("error: multipart/form-data invalid disposition: %s", val);
-                            }
-                        } else {
-                            trace("error: multipart/form-data missing disposition");
-                        }
-                        break;
-
-                    case state_header:
-                        state = state_header;
-                        trace("multipart/form-data state_header\n%s", p);
-                        char *field, *value;
-                        if (*p == '\r' && *++p == '\n') {
-                            data = ++p;
-                            next_state = state_data;
+                    char *colon = (char *) memchr(p, ':', eol - p);
+                    if (colon && (colon - p) == 19 && strncasecmp(p, "Content-Disposition", 19) == 0) {
+                        if (!parse_disposition(skip_lws(colon+1, eol), eol, name, filename, isfile)) {
+                            trace("error: multipart/form-data invalid disposition");
+                            return false;
                         }
-                        else if (_get_header(p, end, field, value)) {
-                            *(++p-2) = '\0';
-                            trace("multipart/form-data header field: %s, value: %s",
-                                  field, value);
-                        }
-                        else {
-                            trace("error: multipart/form-data parsing header failed");
-                            next_state = state_error;
-                        }
-                        break;
-
-                    case state_data:
-                        state = state_data;
-                        trace("multipart/form-data state_data");
-                        dend = p;
-                        ++p;
-                        next_state = state_is_boundary;
-                        break;
+                    }
+                    p = eol+2;
+                }
 
-                    case state_end:
-                        state = state_end;
-                        trace("multipart/form-data state machine done %d fields, %d files %d",
-                                form.size(), files.size(), mnow());
-                        if (!form.empty() || !files.empty()) {
-                            // cache the buffer for later references
-                            String tmp(rb);
-                            form_str = std::move(tmp);
-                        }
-                        return true;
+                if (!name) {
+                    trace("error: multipart/form-data missing disposition");
+                    return false;
+                }
 
-                    case state_error:
-                    default:
-                        trace("error: multipart/form-data error in state machine");
-                        return false;
+                char *d = delim.find(p, end);
+                if (d == nullptr) {
+                    trace("error: multipart/form-data missing boundary");
+                    return false;
+                }
+                if (isfile) {
+                    UploadedFile f;
+                    f.name_ = std::move(filename);
+                    f.data_ = p;
+                    f.len_  = d - p;
+                    if (offload != nullptr) {
+                        /* the file can be saved straight from the offload file */
+                        f.fd_     = offload->raw();
+                        f.offset_ = p - (char *) body_map;
+                    }
+                    files.emplace(std::move(name), std::move(f));
                 }
+                else {
+                    form.emplace(std::move(name), String(p, d - p, false));
+                }
+                p = d + delim.len;
             }
-
-            return false;
         }
 
-#undef eat_space
-#undef goto_chr
-
         bool Request::parse_url_encoded_form() {
             OBuffer rb((uint32_t) content_length+2);
             if (read_body(rb.data(), content_length) > 0) {
@@ -418,7 +390,7 @@ namespace suil {
                 content_length > config.disk_offload_min)
             {
                 OBuffer tmp(64);
-                tmp.appendf(tmp,"%s/http_body.XXXXXX", config.offload_path.c_str());
+                tmp.appendf("%s/http_body.XXXXXX", config.offload_path.c_str());
                 if (offload == nullptr) {
                     offload = new BodyOffload(tmp);
                     offload->length = content_length;
@@ -429,6 +401,18 @@ namespace suil {
                           sock.id(), offload->path(), errno_s);
                     return Status::INTERNAL_ERROR;
                 }
+
+                if (!body.empty()) {
+                    /* part of the body was received along with the headers, content_length
+                     * only accounts for the rest of the body */
+                    offload->length += body.size();
+                    size_t nwr = offload->write(body.data(), body.size(), config.connection_timeout);
+                    if (nwr != body.size()) {
+                        trace("%s - error offloading body: %s", sock.id(), errno_s);
+                        return Status::INTERNAL_ERROR;
+                    }
+                    body.clear();
+                }
             }
 
             return Status::OK;
@@ -455,7 +439,7 @@ namespace suil {
                 stats.rx_bytes += len;
 
                 // parse header line
-                if (!feed(stage, len)) {
+                if (!feed((const char *) &stage[0], len)) {
                     trace("%s - parsing failed: %s",
                           sock.id(), http_errno_name((enum http_errno )http_errno));
                     status = Status::BAD_REQUEST;
@@ -501,6 +485,38 @@ namespace suil {
             return parser::msg_complete();
         }
 
+        bool Request::accepts(const char *mime) const {
+            auto accept = header("Accept");
+            size_t len = strlen(mime), pos{0};
+            while (pos < accept.size()) {
+                auto end = accept.find(',', pos);
+                if (end == strview::npos)
+                    end = accept.size();
+                auto range = accept.substr(pos, end-pos);
+                pos = end+1;
+
+                while (!range.empty() && isspace(range.front()))
+                    range.remove_prefix(1);
+                auto params = range.find(';');
+                auto type = range.substr(0, params);
+                while (!type.empty() && isspace(type.back()))
+                    type.remove_suffix(1);
+                if (type.size() != len || strncasecmp(type.data(), mime, len) != 0)
+                    continue;
+
+                if (params == strview::npos)
+                    return true;
+                auto q = range.find("q=", params);
+                if (q == strview::npos)
+                    return true;
+                auto value = range.substr(q+2);
+                value = value.substr(0, value.find_first_of(" ;"));
+                /* a quality of 0 means not acceptable */
+                return value.find_first_of("123456789") != strview::npos;
+            }
+            return false;
+        }
+
         strview Request::get_body() {
             if (!has_body || body_read || body_error) {
                 return body;
@@ -552,6 +568,20 @@ namespace suil {
             return toread;
         }
 
+        bool Request::forward_body(SocketAdaptor& to, int64_t timeout) const {
+            if (offload != nullptr) {
+                if (offload_error)
+                    return false;
+                /* buffered writes must reach the file before it's sent */
+                offload->flush(timeout);
+                return to.sendfile(offload->raw(), 0, offload->length, timeout) == offload->length;
+            }
+
+            if (body.empty())
+                return true;
+            return to.send(body.data(), body.size(), timeout) == body.size();
+        }
+
         bool Request::body_seek(off_t off) {
             if (!body_read) {
                 if (!offload_error && offload) {
@@ -571,6 +601,8 @@ namespace suil {
             files.clear();
             cookies.clear();
             if (offload) {
+                if (offload->path)
+                    ::unlink(offload->path());
                 delete offload;
                 offload = nullptr;
             }
@@ -591,6 +623,13 @@ namespace suil {
                 files.clear();
                 formed = false;
             }
+
+            if (body_map != nullptr) {
+                /* unmapped once the form fields referencing it are gone */
+                munmap(body_map, body_map_len);
+                body_map = nullptr;
+                body_map_len = 0;
+            }
             params.clear();
         }
 
@@ -619,7 +658,7 @@ namespace suil {
             String tmp(key);
             const auto it = req.form.find(tmp);
             if (it != req.form.end()) {
-                return std::move(it->second.peek());
+                return it->second.dup();
             }
             throw Error::internal("form data not found in post form");
         }
@@ -637,7 +676,7 @@ namespace suil {
             String tmp(name);
             auto it = req.form.find(tmp);
             if (it != req.form.end()) {
-                out = std::move(String(it->second.data(), it->second.size(), false));
+                out = it->second.dup();
                 return true;
             }
 
@@ -651,15 +690,278 @@ namespace suil {
                 throw Exception::create("directory: '", dir, "' invalid.");
             }
 
-            String path = utils::catstr(real_dir, "/", basename((char *)name_.data()));
+            /* the name references the request's body, it is not terminated */
+            String name = name_.dup();
+            if (!name) {
+                throw Exception::create("file with an empty name not supported.");
+            }
+            String path = utils::catstr(real_dir, "/", basename((char *)name.data()));
             if (!path || utils::fs::isdir(path.data())) {
                 /* directory is not valid */
                 throw Exception::create("file with name: '", name_(), "' not supported.");
             }
 
-            /* async write data to disk */
             File writer(path.data(), O_WRONLY | O_CREAT, 0644);
+            if (fd_ >= 0) {
+                /* the data is still in the body offload file, copy it within the kernel */
+                off_t off = offset_;
+                size_t left = len_;
+                while (left > 0) {
+                    ssize_t nwr = ::sendfile(writer.raw(), fd_, &off, left);
+                    if (nwr < 0 && errno == EINTR)
+                        continue;
+                    if (nwr <= 0) {
+                        throw Exception::create("saving file '", name_(), "' failed: ", errno_s);
+                    }
+                    left -= nwr;
+                }
+                return;
+            }
+
+            /* async write data to disk */
             writer.write(data_, len_, timeout);
         }
     }
-}
\ No newline at end of file
+}
+#ifdef unit_test
+#include <catch/catch.hpp>
+#include <suil/http/response.h>
+
+using namespace suil;
+using namespace suil::http;
+
+namespace {
+    /* exposes the parser to feed requests without a connection */
+    struct TestRequest : http::Request {
+        using http::Request::Request;
+        using parser::feed;
+    };
+}
+
+static void feedForm(TestRequest& req, const std::string& body, const char *ctype) {
+    OBuffer head(256);
+    head << "POST /upload HTTP/1.1\r\nContent-Type: " << ctype
+         << "\r\nContent-Length: " << body.size() << "\r\n\r\n";
+    REQUIRE(req.feed(head.data(), head.size()));
+    REQUIRE(req.process_headers() == Status::OK);
+    REQUIRE(req.feed(body.data(), body.size()));
+}
+
+static void feedHeaders(TestRequest& req, const char *headers) {
+    OBuffer head(256);
+    head << "GET / HTTP/1.1\r\n" << headers << "\r\n";
+    REQUIRE(req.feed(head.data(), head.size()));
+    REQUIRE(req.process_headers() == Status::OK);
+}
+
+TEST_CASE("suil::http::Request multipart form", "[http][request]")
+{
+    /* the file's data contains a partial delimiter */
+    std::string fileData("GIF89a\r\n--Xy\0\r\n-binary", 23);
+    std::string body =
+        "preamble is ignored\r\n"
+        "--XyZ\r\n"
+        "Content-Disposition: form-data; name=\"name\"\r\n"
+        "\r\n"
+        "Carter\r\n"
+        "--XyZ\r\n"
+        "Content-Disposition: form-data; name=age\r\n"
+        "Content-Type: text/plain\r\n"
+        "\r\n"
+        "42\r\n"
+        "--XyZ  \r\n"
+        "Content-Disposition: form-data; name=\"avatar\"; filename=\"me.gif\"\r\n"
+        "Content-Type: image/gif\r\n"
+        "\r\n" + fileData + "\r\n"
+        "--XyZ--\r\n"
+        "epilogue is ignored";
+
+    TcpSock sock;
+    HttpConfig config;
+
+    SECTION("fields and files reference the body") {
+        TestRequest req(sock, config);
+        feedForm(req, body, "multipart/form-data; boundary=\"XyZ\"; charset=utf-8");
+        REQUIRE(req.parseForm());
+        REQUIRE(req.form.size() == 2);
+        CHECK(req.form["name"] == "Carter");
+        CHECK(req.form["age"] == "42");
+        REQUIRE(req.files.size() == 1);
+        auto& f = req.files["avatar"];
+        CHECK(f.name() == "me.gif");
+        REQUIRE(f.size() == fileData.size());
+        CHECK(memcmp(f.data(), fileData.data(), f.size()) == 0);
+        auto b = req.body_length();
+        CHECK(b == body.size());
+        CHECK((char *) f.data() > req.body_buffer());
+        CHECK((char *) f.data() < req.body_buffer() + b);
+    }
+
+    SECTION("the body is left intact") {
+        TestRequest req(sock, config);
+        feedForm(req, body, "multipart/form-data; boundary=XyZ");
+        REQUIRE(req.parseForm());
+        auto b = req.get_body();
+        CHECK(strview(b.data(), b.size()) == strview(body));
+
+        // values are not terminated, casts are bounded by their size
+        auto o = iod::D(prop(name, String), prop(age, int));
+        RequestForm form(req, {});
+        CHECK((form >> o).empty());
+        CHECK(o.name == "Carter");
+        CHECK(o.age == 42);
+        // name is followed by the other fields in the body
+        CHECK(strcmp(o.name(), "Carter") == 0);
+        CHECK(strcmp(form["name"].data(), "Carter") == 0);
+        CHECK(strcmp(form["age"](), "42") == 0);
+
+        const char *dir = "/tmp/suil-multipart-test";
+        utils::fs::mkdir(dir, true);
+        req.files["avatar"].save(dir);
+        String saved = utils::fs::readall("/tmp/suil-multipart-test/me.gif");
+        CHECK(strview(saved.data(), saved.size()) == strview(fileData));
+        utils::fs::remove(dir, true);
+    }
+
+    SECTION("offloaded bodies are parsed in place") {
+        config.disk_offload = true;
+        config.disk_offload_min = 16;
+        config.offload_path = "/tmp";
+        const char *dir = "/tmp/suil-multipart-test";
+        utils::fs::mkdir(dir, true);
+        {
+            TestRequest req(sock, config);
+            feedForm(req, body, "multipart/form-data; boundary=XyZ");
+            REQUIRE(req.offload != nullptr);
+            REQUIRE(req.parseForm());
+            CHECK(req.form["name"] == "Carter");
+            auto& f = req.files["avatar"];
+            REQUIRE(f.size() == fileData.size());
+            CHECK(memcmp(f.data(), fileData.data(), f.size()) == 0);
+
+            // saved straight from the offload file
+            f.save(dir);
+            String saved = utils::fs::readall("/tmp/suil-multipart-test/me.gif");
+            CHECK(strview(saved.data(), saved.size()) == strview(fileData));
+        }
+        utils::fs::remove(dir, true);
+    }
+
+    SECTION("malformed forms are rejected") {
+        TestRequest req(sock, config);
+        feedForm(req, "--XyZ\r\nContent-Disposition: form-data; name=\"x\"\r\n\r\nno end",
+                 "multipart/form-data; boundary=XyZ");
+        CHECK_FALSE(req.parseForm());
+    }
+}
+
+TEST_CASE("suil::http::Request accepts", "[http][request]")
+{
+    TcpSock sock;
+    HttpConfig config;
+
+    SECTION("types are matched in any position and case") {
+        TestRequest req(sock, config);
+        feedHeaders(req, "Accept: text/html, Application/MsgPack ,application/json\r\n");
+        CHECK(req.accepts("text/html"));
+        CHECK(req.accepts("application/msgpack"));
+        CHECK(req.accepts("APPLICATION/JSON"));
+        CHECK_FALSE(req.accepts("application/xml"));
+        // prefixes are not matches
+        CHECK_FALSE(req.accepts("text/htm"));
+        CHECK_FALSE(req.accepts("application/msgpack2"));
+    }
+
+    SECTION("parameters and qualities") {
+        TestRequest req(sock, config);
+        feedHeaders(req, "Accept: text/html;level=1, application/msgpack;q=0, "
+                         "application/json; q=0.5, text/plain;q=0.000, image/gif; q=0 ;x=1\r\n");
+        CHECK(req.accepts("text/html"));
+        CHECK(req.accepts("application/json"));
+        CHECK_FALSE(req.accepts("application/msgpack"));
+        CHECK_FALSE(req.accepts("text/plain"));
+        CHECK_FALSE(req.accepts("image/gif"));
+    }
+
+    SECTION("without an Accept header nothing is accepted") {
+        TestRequest req(sock, config);
+        feedHeaders(req, "Host: localhost\r\n");
+        CHECK_FALSE(req.accepts("application/json"));
+    }
+}
+
+TEST_CASE("suil::http::Request decode", "[http][request]")
+{
+    TcpSock sock;
+    HttpConfig config;
+    auto o = iod::D(prop(name, String), prop(age, int));
+    using Person = decltype(o);
+    o.name = "Carter";
+    o.age  = 42;
+
+    SECTION("MessagePack bodies are decoded by content type") {
+        TestRequest req(sock, config);
+        OBuffer ob{64};
+        msgpack::encode(o, ob);
+        feedForm(req, std::string(ob.data(), ob.size()), "Application/MsgPack; charset=binary");
+        auto p = req.decode<Person>();
+        CHECK(p.name == "Carter");
+        CHECK(p.age == 42);
+    }
+
+    SECTION("other bodies are decoded as JSON") {
+        TestRequest req(sock, config);
+        feedForm(req, R"({"name": "Carter", "age": 42})", "application/json");
+        auto p = req.decode<Person>();
+        CHECK(p.name == "Carter");
+        CHECK(p.age == 42);
+    }
+}
+TEST_CASE("suil::http::Response of a handler's value", "[http][request]")
+{
+    TcpSock sock;
+    HttpConfig config;
+    auto o = iod::D(prop(name, String), prop(age, int));
+    using Person = decltype(o);
+    o.name = "Carter";
+    o.age  = 42;
+
+    SECTION("values are encoded as MessagePack if the client accepts it") {
+        TestRequest req(sock, config);
+        feedHeaders(req, "Accept: application/json;q=0.5, application/msgpack\r\n");
+        auto resp = Response::of(req, o);
+        CHECK(resp.header("Content-Type") == msgpack::CONTENT_TYPE);
+        Person p;
+        msgpack::decode(resp(0), p);
+        CHECK(p.name == "Carter");
+        CHECK(p.age == 42);
+
+        resp = Response::of(req, std::vector<int>{1, 2});
+        CHECK(resp.header("Content-Type") == msgpack::CONTENT_TYPE);
+        std::vector<int> v;
+        msgpack::decode(resp(0), v);
+        CHECK((v == std::vector<int>{1, 2}));
+    }
+
+    SECTION("values are encoded as JSON otherwise") {
+        TestRequest req(sock, config);
+        feedHeaders(req, "Accept: application/msgpack;q=0, application/json\r\n");
+        auto resp = Response::of(req, o);
+        CHECK(resp.header("Content-Type") == "application/json");
+        auto& body = resp(0);
+        CHECK(strview(body.data(), body.size()) == R"({"name":"Carter","age":42})");
+    }
+
+    SECTION("other values keep their own representation") {
+        TestRequest req(sock, config);
+        feedHeaders(req, "Accept: application/msgpack\r\n");
+        auto resp = Response::of(req, std::string("Hello"));
+        CHECK(resp.header("Content-Type").empty());
+        CHECK(strview(resp(0).data(), resp(0).size()) == "Hello");
+        Response other;
+        other << "done";
+        resp = Response::of(req, std::move(other));
+        CHECK(strview(resp(0).data(), resp(0).size()) == "done");
+    }
+}
+#endif
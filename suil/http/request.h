@@ -6,6 +6,7 @@
 #define SUIL_HTTP_REQUEST_HPP
 
 #include <suil/http/parser.h>
+#include <suil/msgpack.h>
 #include <suil/sock.h>
 #include <suil/file.h>
 
@@ -22,6 +23,10 @@ namespace suil {
         using form_file_it_t = std::function<bool(const UploadedFile&)>;
 
         struct Request;
+        /**
+         * reads the fields of a request's form. Fields read by name are terminated
+         * copies, the iterators pass the fields as views of the request's body
+         */
         struct RequestForm {
             RequestForm(const Request& req, std::vector<String>&& required = {});
             void operator|(form_data_it_t f);
@@ -34,9 +39,19 @@ namespace suil {
             String operator>>(T& o);
         private:
 
+            /* multipart values reference the request's body, they are not terminated
+             * so values are cast from (or handed out as) terminated copies */
             template <typename T>
             inline static void cast(const String& s, T& v) {
-                utils::cast(s, v);
+                static_assert(!std::is_same<T, const char*>::value,
+                        "form values are not terminated, read them into a String instead");
+                if constexpr (std::is_same<T, String>::value) {
+                    v = s.dup();
+                }
+                else {
+                    std::string tmp(s.data(), s.size());
+                    utils::cast(String(tmp.data(), tmp.size(), false), v);
+                }
             }
 
             template <typename T>
@@ -75,6 +90,29 @@ namespace suil {
 
             ssize_t read_body(void *buf, size_t len);
 
+            /**
+             * sends the body of the request to the given socket, bodies offloaded
+             * to disk are sent from the file without being loaded into memory
+             * @param to the socket to send the body to
+             * @param timeout the send timeout
+             * @return true if the whole body was sent
+             */
+            bool forward_body(SocketAdaptor& to, int64_t timeout) const;
+
+            /**
+             * @return the size of the body of the request
+             */
+            inline size_t body_length() const {
+                return offload? offload->length : body.size();
+            }
+
+            /**
+             * @return the request target as received, i.e the path and query string
+             */
+            inline strview target() const {
+                return strview(raw_url.data(), raw_url.size());
+            }
+
             bool body_seek(off_t off = 0);
 
             strview get_body();
@@ -102,6 +140,13 @@ namespace suil {
                 return header(tmp);
             }
 
+            /**
+             * @param mime the media type to look for, e.g application/msgpack
+             * @return true if the type is listed (with a non-zero quality) in the
+             * request's Accept header
+             */
+            bool accepts(const char *mime) const;
+
             inline void header(String&& h, const std::string v) {
                 // we dup the value here
                 String vv = String(v.data(), v.size(), false);
@@ -156,7 +201,31 @@ namespace suil {
                 return std::move(tmp);
             }
 
-        private:
+            /**
+             * decodes the body of the request, from MessagePack if it's content type
+             * is application/msgpack and from JSON otherwise
+             */
+            template <typename T>
+            T decode() const {
+                T tmp;
+                auto type = header("Content-Type");
+                size_t len = strlen(msgpack::CONTENT_TYPE);
+                if (type.size() >= len && strncasecmp(type.data(), msgpack::CONTENT_TYPE, len) == 0)
+                    msgpack::decode(Ego.body, tmp);
+                else
+                    iod::json_decode(tmp, Ego.body);
+                return std::move(tmp);
+            }
+
+            /**
+             * @return a lazy view of the JSON body, the members are decoded
+             * as they are accessed. The view references the request's body
+             */
+            json::View toJsonView() {
+                return json::View(Ego.get_body());
+            }
+
+        private suil_ut:
             template <typename H, typename... Mws>
             friend struct Connection;
             friend struct SystemAttrs;
@@ -169,6 +238,7 @@ namespace suil {
             bool parseForm();
             bool parse_url_encoded_form();
             bool parse_multipart_form(const String& boundary);
+            char *body_buffer();
 
             inline bool any_method() const {
                 return false;
@@ -211,6 +281,9 @@ namespace suil {
 
             uint32_t                body_offset{0};
             BodyOffload            *offload{nullptr};
+            /* the offloaded body mapped for parsing multipart forms */
+            void                   *body_map{nullptr};
+            size_t                  body_map_len{0};
             OBuffer                stage{0};
 
             SocketAdaptor&       sock;
@@ -254,7 +327,7 @@ namespace suil {
             return ob.empty()? nullptr : String(ob);
         }
 
-        template <typename T, typename  std::enable_if<std::is_base_of<iod::MetaType, T>::value>::type* = nullptr>
+        template <typename T, typename  std::enable_if<std::is_base_of<iod::MetaType, T>::value>::type*>
         String RequestForm::operator>>(T& o) {
             OBuffer ob{127};
             iod::foreach2(T::Meta) |
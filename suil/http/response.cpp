@@ -3,6 +3,7 @@
 //
 
 #include <suil/http/response.h>
+#include <suil/http/request.h>
 
 namespace suil {
     namespace http {
@@ -12,7 +13,8 @@ namespace suil {
               cookies(std::move(other.cookies)),
               body(std::move(other.body)),
               status(other.status),
-              completed(other.completed)
+              completed(other.completed),
+              streamer(std::move(other.streamer))
         {
         }
 
@@ -22,15 +24,21 @@ namespace suil {
             headers = std::move(other.headers);
             cookies = std::move(other.cookies);
             completed = other.completed;
+            streamer = std::move(other.streamer);
             return *this;
         }
 
+        bool Response::binary(const Request& req) {
+            return req.accepts(msgpack::CONTENT_TYPE);
+        }
+
         void Response::clear() {
             completed = false;
             headers.clear();
             body.clear();
             cookies.clear();
             chunks.clear();
+            streamer = nullptr;
             status = Status::OK;
         }
 
@@ -107,4 +115,41 @@ namespace suil {
         }
 
     }
-}
\ No newline at end of file
+}
+#ifdef unit_test
+#include <catch/catch.hpp>
+
+using namespace suil;
+using namespace suil::http;
+
+TEST_CASE("suil::http::Response encode", "[http][response]")
+{
+    auto o = iod::D(prop(name, String), prop(age, int));
+    using Person = decltype(o);
+    o.name = "Carter";
+    o.age  = 42;
+
+    SECTION("values are encoded as JSON by default") {
+        Response resp;
+        resp.encode(o);
+        auto& body = resp(0);
+        CHECK(resp.header("Content-Type") == "application/json");
+        Person p;
+        json::decode(body, p);
+        CHECK(p.name == "Carter");
+        CHECK(p.age == 42);
+    }
+
+    SECTION("binary values are encoded as MessagePack") {
+        Response resp;
+        resp.encode(o, true);
+        auto& body = resp(0);
+        CHECK(resp.header("Content-Type") == msgpack::CONTENT_TYPE);
+        REQUIRE(msgpack::detect(body.data(), body.size()));
+        Person p;
+        msgpack::decode(body, p);
+        CHECK(p.name == "Carter");
+        CHECK(p.age == 42);
+    }
+}
+#endif
@@ -9,15 +9,37 @@
 
 #include <suil/http.h>
 #include <suil/logging.h>
+#include <suil/msgpack.h>
 
 namespace suil {
     namespace http {
 
         struct WebSockApi;
         struct Request;
+
+        namespace detail {
+            /* the values a response encodes (see Response::encode), other values
+             * have their own constructor */
+            template <typename T>
+            struct encoded {
+                static const bool value = std::is_base_of<iod::MetaType, T>::value ||
+                                          iod::is_sio<T>::value ||
+                                          std::is_same<T, json::Object>::value;
+            };
+
+            template <typename T>
+            struct encoded<std::vector<T>> : std::true_type {};
+
+            template <typename T>
+            struct encoded<iod::Nullable<T>> : std::true_type {};
+        }
         struct Response;
 
         using ProtocolHandler = std::function<bool(Request&, Response&)>;
+        /* writes a portion of a streamed body, returns false if sending fails */
+        using BodyWriter = std::function<bool(const char*, size_t)>;
+        /* produces a streamed body using the given writer, returns false on failure */
+        using BodyStreamer = std::function<bool(const BodyWriter&)>;
 
         define_log_tag(HTTP_RESP);
         struct Response : LOGGER(HTTP_RESP) {
@@ -106,8 +128,7 @@ namespace suil {
                 : body(0),
                   status(Status::OK)
             {
-                setContentType("application/json");
-                body << json::encode(data).c_str();
+                encode(data);
             }
 
             Response(Response&&);
@@ -122,6 +143,42 @@ namespace suil {
                 header("Content-Type", type);
             }
 
+            /**
+             * encodes the given value into the body
+             * @param data the value to encode
+             * @param binary true to encode the value as MessagePack, e.g if the client
+             * accepts it (see Request::accepts), otherwise it's encoded as JSON
+             */
+            template<typename _T>
+            void encode(const _T& data, bool binary = false) {
+                if (binary) {
+                    setContentType(msgpack::CONTENT_TYPE);
+                    msgpack::encode(data, body);
+                }
+                else {
+                    setContentType("application/json");
+                    json::encode(data, body);
+                }
+            }
+
+            /**
+             * builds the response to a handler's return value, encoded values are
+             * encoded as MessagePack if the request accepts it and JSON otherwise
+             * @param req the request being handled
+             * @param data the value returned by the handler
+             */
+            template<typename _T>
+            static Response of(const Request& req, _T&& data) {
+                if constexpr (detail::encoded<std::decay_t<_T>>::value) {
+                    Response res;
+                    res.encode(data, binary(req));
+                    return res;
+                }
+                else {
+                    return Response(std::forward<_T>(data));
+                }
+            }
+
             Response& operator()(http::Status status) {
                 // set the response status
                 if (Ego.status == Status::OK)
@@ -192,12 +249,12 @@ namespace suil {
 
             strview header(const char *field) const {
                 String tmp(field);
-                return header(field);
+                return header(tmp);
             }
 
             strview header(std::string& field) const {
                 String tmp(field.data(), field.size(), false);
-                return header(field);
+                return header(tmp);
             }
 
             void cookie(Cookie& ck) {
@@ -223,6 +280,20 @@ namespace suil {
 
             void end(ProtocolHandler p);
 
+            /**
+             * sets the function which will produce the body of the response once
+             * the headers have been sent, the body is never buffered. Without a
+             * Content-Length header, the body is sent using chunked transfer encoding
+             * @param s the body streamer, returning false closes the connection
+             */
+            inline void stream(BodyStreamer s) {
+                streamer = std::move(s);
+            }
+
+            inline bool isstreamed() const {
+                return streamer != nullptr;
+            }
+
             inline void redirect(Status status, const char *location) {
                 header("Location", location);
                 end(status);
@@ -237,6 +308,9 @@ namespace suil {
 
             void flush_cookies();
 
+            /* true if the request accepts MessagePack encoded responses */
+            static bool binary(const Request& req);
+
             struct Chunk {
                 union {
                     int     fd;
@@ -288,6 +362,7 @@ namespace suil {
             Status                status;
             bool                    completed{false};
             ProtocolHandler         proto{nullptr};
+            BodyStreamer            streamer{nullptr};
         };
 
         inline Response mkresp(http::Status status, String msg) {
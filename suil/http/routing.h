@@ -117,8 +117,8 @@ namespace suil {
                             !std::is_same<typename std::tuple_element<0, std::tuple<Args..., void>>::type, const Request &>::value, int>::type = 0) {
                         handler_ = (
                                 [f = std::move(f)]
-                                        (const Request &, Response &res, Args... args) {
-                                    res = Response(f(args...));
+                                        (const Request &req, Response &res, Args... args) {
+                                    res = Response::of(req, f(args...));
                                     res.end();
                                 });
                     }
@@ -130,7 +130,7 @@ namespace suil {
                         }
 
                         void operator()(const Request &req, Response &res, Args... args) {
-                            res = Response(f(req, args...));
+                            res = Response::of(req, f(req, args...));
                             res.end();
                         }
 
@@ -323,8 +323,8 @@ namespace suil {
                 static_assert(!std::is_same<void, decltype(f(std::declval<Args>()...))>::value,
                               "Handler function cannot have void return type; valid return types: string, int, resposne, json object");
 
-                handler_ = [f = std::move(f)](const Request &, Response &res, Args ... args) {
-                    res = Response(f(args...));
+                handler_ = [f = std::move(f)](const Request &req, Response &res, Args ... args) {
+                    res = Response::of(req, f(args...));
                     res.end();
                 };
             }
@@ -358,7 +358,7 @@ namespace suil {
                               "Handler function cannot have void return type; valid return types: string, Status, resposne, IOD objects");
 
                 handler_ = [f = std::move(f)](const Request &req, Response &res, Args ... args) {
-                    res = Response(f(req, args...));
+                    res = Response::of(req, f(req, args...));
                     res.end();
                 };
             }
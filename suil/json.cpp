@@ -24,10 +24,15 @@
 #include "json.h"
 
 #include <assert.h>
+#include <math.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unordered_map>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
 
 #define out_of_memory() do {                    \
 		fprintf(stderr, "Out of memory.\n");    \
@@ -332,9 +337,27 @@ static void append_node(JsonNode *parent, JsonNode *child);
 static void prepend_node(JsonNode *parent, JsonNode *child);
 static void append_member(JsonNode *object, char *key, JsonNode *value);
 
+/*
+ * Objects with more than JSON_INDEX_THRESHOLD members get a hash index of their
+ * members the first time a lookup goes past that many members, the index is
+ * updated when members are appended and dropped on any other change.
+ */
+#define JSON_INDEX_THRESHOLD 16
+
+struct JsonIndex {
+	uint32_t   mask;
+	uint32_t   count;
+	JsonNode **slots;
+};
+
+static uint32_t key_hash(const char *key, size_t len);
+static JsonIndex *index_build(JsonNode *object);
+static bool index_insert(JsonIndex *index, JsonNode *member);
+static JsonNode *index_find(const JsonIndex *index, const char *key, size_t len);
+static void index_drop(JsonNode *object);
+
 /* Assertion-friendly validity checks */
 static bool tag_is_valid(unsigned int tag);
-static bool number_is_valid(const char *num);
 
 static void json_delete(JsonNode *node);
 
@@ -360,6 +383,7 @@ static void json_delete(JsonNode *node)
 {
 	if (node != nullptr) {
 		json_remove_from_parent(node);
+		index_drop(node);
 
 		switch (node->tag) {
 			case JSON_STRING:
@@ -413,32 +437,108 @@ JsonNode *json_find_element(JsonNode *array, int index)
 	return nullptr;
 }
 
-JsonNode *json_find_member(JsonNode *object, const char *name)
+static JsonNode *find_member(JsonNode *object, const char *key, size_t keyLen)
 {
 	JsonNode *member;
+	uint32_t n = 0;
 
 	if (object == nullptr || object->tag != JSON_OBJECT)
 		return nullptr;
 
-	json_foreach(member, object)
-		if (strcmp(member->key, name) == 0)
+	if (object->children.index != nullptr)
+		return index_find(object->children.index, key, keyLen);
+
+	json_foreach(member, object) {
+		if (++n > JSON_INDEX_THRESHOLD)
+			return index_find(index_build(object), key, keyLen);
+		if (strncmp(member->key, key, keyLen) == 0 && member->key[keyLen] == '\0')
 			return member;
+	}
 
 	return nullptr;
 }
 
+JsonNode *json_find_member(JsonNode *object, const char *name)
+{
+	return find_member(object, name, strlen(name));
+}
+
 JsonNode *json_find_member(JsonNode *object, const char *key, size_t keyLen)
+{
+	return find_member(object, key, keyLen);
+}
+
+static uint32_t key_hash(const char *key, size_t len)
+{
+	/* FNV-1a */
+	uint32_t h = 2166136261u;
+	for (size_t i = 0; i < len; i++) {
+		h ^= (uint8_t) key[i];
+		h *= 16777619u;
+	}
+	return h;
+}
+
+static JsonIndex *index_build(JsonNode *object)
 {
 	JsonNode *member;
+	uint32_t count = 0, cap = 32;
 
-	if (object == nullptr || object->tag != JSON_OBJECT)
-		return nullptr;
+	json_foreach(member, object)
+		count++;
+	while (cap < count * 2)
+		cap <<= 1;
+
+	/* twice as many slots as members, allocated along with the index */
+	JsonIndex *index = (JsonIndex*) calloc(1, sizeof(JsonIndex) + cap * sizeof(JsonNode*));
+	if (index == nullptr)
+		out_of_memory();
+	index->mask = cap - 1;
+	index->slots = (JsonNode**) (index + 1);
 
 	json_foreach(member, object)
-		if (strncmp(member->key, key, keyLen) == 0)
-			return member;
+		index_insert(index, member);
 
-	return nullptr;
+	object->children.index = index;
+	return index;
+}
+
+static bool index_insert(JsonIndex *index, JsonNode *member)
+{
+	if ((index->count + 1) * 2 > index->mask + 1)
+		return false;
+
+	size_t len = strlen(member->key);
+	for (uint32_t i = key_hash(member->key, len) & index->mask;; i = (i + 1) & index->mask) {
+		JsonNode *slot = index->slots[i];
+		if (slot == nullptr) {
+			index->slots[i] = member;
+			index->count++;
+			return true;
+		}
+		/* the first of duplicate members is found */
+		if (strcmp(slot->key, member->key) == 0)
+			return true;
+	}
+}
+
+static JsonNode *index_find(const JsonIndex *index, const char *key, size_t len)
+{
+	for (uint32_t i = key_hash(key, len) & index->mask;; i = (i + 1) & index->mask) {
+		JsonNode *slot = index->slots[i];
+		if (slot == nullptr)
+			return nullptr;
+		if (strncmp(slot->key, key, len) == 0 && slot->key[len] == '\0')
+			return slot;
+	}
+}
+
+static void index_drop(JsonNode *object)
+{
+	if (object->tag == JSON_OBJECT && object->children.index != nullptr) {
+		free(object->children.index);
+		object->children.index = nullptr;
+	}
 }
 
 JsonNode *json_first_child(const JsonNode *node)
@@ -518,6 +618,7 @@ static void append_node(JsonNode *parent, JsonNode *child)
 
 static void prepend_node(JsonNode *parent, JsonNode *child)
 {
+	index_drop(parent);
 	child->parent = parent;
 	child->prev = nullptr;
 	child->next = parent->children.head;
@@ -533,6 +634,8 @@ static void append_member(JsonNode *object, char *key, JsonNode *value)
 {
 	value->key = key;
 	append_node(object, value);
+	if (object->children.index != nullptr && !index_insert(object->children.index, value))
+		index_drop(object);
 }
 
 void json_append_element(JsonNode *array, JsonNode *element)
@@ -573,6 +676,7 @@ void json_remove_from_parent(JsonNode *node)
 	JsonNode *parent = node->parent;
 
 	if (parent != nullptr) {
+		index_drop(parent);
 		if (node->prev != nullptr)
 			node->prev->next = node->next;
 		else
@@ -1178,16 +1282,14 @@ void emit_string(iod::encode_stream& out, const char *str)
 static void emit_number(iod::encode_stream& out, double num)
 {
 	/*
-	 * This isn't exactly how JavaScript renders numbers,
-	 * but it should produce valid JSON for reasonable numbers
-	 * preserve precision well enough, and avoid some oddities
-	 * like 0.3 -> 0.299999999999999988898 .
+	 * Rendered like JavaScript renders numbers, with the shortest
+	 * digits that parse back to the same number (0.3 -> 0.3).
+	 * NaN and Infinity are not valid JSON.
 	 */
-	char buf[64];
-	sprintf(buf, "%.16g", num);
-	
-	if (number_is_valid(buf))
-		out << num;
+	char buf[suil::numfmt::MAX_DOUBLE];
+
+	if (std::isfinite(num))
+		out << iod::stringview(buf, suil::numfmt::dtoa(num, buf));
 	else
 		out << "null";
 }
@@ -1197,11 +1299,6 @@ static bool tag_is_valid(unsigned int tag)
 	return (/* tag >= JSON_NULL && */ tag <= JSON_OBJECT);
 }
 
-static bool number_is_valid(const char *num)
-{
-	return (parse_number(&num, nullptr) && *num == '\0');
-}
-
 static bool expect_literal(const char **sp, const char *str)
 {
 	const char *s = *sp;
@@ -1336,6 +1433,1101 @@ bool json_check(const JsonNode *node, char errmsg[256])
 
 namespace suil::json {
 
+    /*
+     * A decoded JSON document. The values are laid out in document order on a tape
+     * of tagged 64-bit words (the tag is the high byte) and the strings are copied
+     * into a single arena, so decoding takes a couple of allocations whatever the
+     * size of the document.
+     *
+     *  'n' 't' 'f'  null, true and false
+     *  'd'          a number, the double is stored in the next word
+     *  '"'          a string or a member's key, the payload is the offset of the NUL
+     *               terminated string in the arena, preceded by its 32-bit length
+     *  '[' '{'      the payload is the index following the matching ']' '}' (bits 0-31)
+     *               and the number of elements or members (bits 32-55), nested values
+     *               are skipped in O(1)
+     *  ']' '}'      the payload is the index of the matching '[' '{'
+     *
+     * Members are a key followed by the value. The tape is built from the index of
+     * structural characters computed by a vectorized first pass over the input.
+     * The document is converted to a JsonNode tree the first time it's modified.
+     */
+    struct Tape {
+        static constexpr uint64_t PAYLOAD{0x00FFFFFFFFFFFFFFull};
+        static constexpr uint32_t MAX_COUNT{0xFFFFFF};
+        static constexpr size_t   MAX_DEPTH{1024};
+
+        Tape() = default;
+
+        Tape(const Tape&) = delete;
+        Tape& operator=(const Tape&) = delete;
+
+        ~Tape() {
+            if (root != nullptr)
+                json_delete(root);
+            ::free(words);
+            ::free(strings);
+        }
+
+        inline uint8_t tag(uint32_t i) const {
+            return (uint8_t) (words[i] >> 56);
+        }
+
+        inline uint64_t payload(uint32_t i) const {
+            return words[i] & PAYLOAD;
+        }
+
+        inline uint32_t count(uint32_t i) const {
+            return (uint32_t) ((words[i] >> 32) & MAX_COUNT);
+        }
+
+        inline uint32_t next(uint32_t i) const {
+            switch (tag(i)) {
+                case '[':
+                case '{':
+                    return (uint32_t) payload(i);
+                case 'd':
+                    return i+2;
+                default:
+                    return i+1;
+            }
+        }
+
+        inline const char *str(uint32_t i) const {
+            return strings + payload(i);
+        }
+
+        inline uint32_t size(uint32_t i) const {
+            uint32_t l;
+            memcpy(&l, str(i)-sizeof(uint32_t), sizeof(l));
+            return l;
+        }
+
+        inline double number(uint32_t i) const {
+            double d;
+            memcpy(&d, &words[i+1], sizeof(d));
+            return d;
+        }
+
+        JsonTag type(uint32_t i) const;
+
+        /* the index of the element/member's value, 0 (the root) if not found */
+        uint32_t element(uint32_t i, int index) const;
+        uint32_t member(uint32_t i, const char *key, size_t keyLen) const;
+
+        bool parse(const char *s, const char *e, const char *&end);
+
+        JsonNode *build(uint32_t i, bool map);
+
+        void thaw();
+
+        void emit(iod::encode_stream& out, uint32_t i) const;
+
+        uint64_t *words{nullptr};
+        uint32_t  len{0};
+        uint32_t  cap{0};
+        char     *strings{nullptr};
+        size_t    slen{0};
+        size_t    scap{0};
+        /* the document as a tree once modified, nodes[i] is the value at i */
+        JsonNode *root{nullptr};
+        std::vector<JsonNode*> nodes{};
+        /* hash indices of the members of large objects, indices[i] is the object at i */
+        mutable std::unordered_map<uint32_t, std::vector<uint32_t>> indices{};
+
+    private:
+        inline void push(uint8_t t, uint64_t data = 0) {
+            if (len == cap)
+                grow(len+1);
+            words[len++] = ((uint64_t) t << 56) | data;
+        }
+
+        void grow(size_t need);
+        void reserve(size_t need);
+        bool copy_string(const char *p, const char *q);
+        bool parse_number(const char *&p, const char *e);
+    };
+
+    namespace {
+
+        const double POW10[] = {
+            1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+            1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+        };
+
+        /*
+         * Stage 1 of the decoder, the input is classified 64 bytes at a time into
+         * bitmasks (with SSE4.2 or AVX2 when the CPU supports them) from which the
+         * index of the structural characters is computed: {}[]:, outside strings,
+         * unescaped quotes and the first character of scalars. UTF-8 is validated
+         * in the same pass. Stage 2 (Tape::parse) walks the index.
+         */
+        enum : uint8_t {
+            C_QUOTE  = 0x01,
+            C_BSLASH = 0x02,
+            C_OP     = 0x04,
+            C_WS     = 0x08,
+            C_CTRL   = 0x10
+        };
+
+        struct classes_t {
+            classes_t() {
+                for (int c = 0; c < 0x20; c++)
+                    table[c] = C_CTRL;
+                table[(uint8_t) '"']  = C_QUOTE;
+                table[(uint8_t) '\\'] = C_BSLASH;
+                for (auto c: {'{', '}', '[', ']', ':', ','})
+                    table[(uint8_t) c] = C_OP;
+                for (auto c: {' ', '\t', '\n', '\r'})
+                    table[(uint8_t) c] |= C_WS;
+            }
+            uint8_t table[256]{0};
+        };
+        const classes_t CLASSES{};
+
+        struct block_t {
+            uint64_t quote;
+            uint64_t bslash;
+            uint64_t op;
+            uint64_t ws;
+            uint64_t ctrl;
+        };
+
+        /* UTF-8 validation state carried from one block to the next */
+        struct utf8_t {
+            /* SIMD, the last bytes of the previous block */
+            uint8_t prev[32]{0};
+            bool    incomplete{false};
+            /* scalar, the continuation bytes expected and the range of the next one */
+            uint8_t need{0};
+            uint8_t lo{0x80};
+            uint8_t hi{0xBF};
+        };
+
+        inline bool utf8_step(utf8_t& u, uint8_t c) {
+            if (u.need == 0) {
+                if (c < 0x80)
+                    return true;
+                if (c >= 0xC2 && c <= 0xDF)
+                    u.need = 1, u.lo = 0x80, u.hi = 0xBF;
+                else if (c == 0xE0)
+                    u.need = 2, u.lo = 0xA0, u.hi = 0xBF;
+                else if (c == 0xED)
+                    /* no surrogates */
+                    u.need = 2, u.lo = 0x80, u.hi = 0x9F;
+                else if (c >= 0xE1 && c <= 0xEF)
+                    u.need = 2, u.lo = 0x80, u.hi = 0xBF;
+                else if (c == 0xF0)
+                    u.need = 3, u.lo = 0x90, u.hi = 0xBF;
+                else if (c >= 0xF1 && c <= 0xF3)
+                    u.need = 3, u.lo = 0x80, u.hi = 0xBF;
+                else if (c == 0xF4)
+                    u.need = 3, u.lo = 0x80, u.hi = 0x8F;
+                else
+                    return false;
+                return true;
+            }
+
+            if (c < u.lo || c > u.hi) {
+                u.need = 0;
+                return false;
+            }
+            u.need--;
+            u.lo = 0x80;
+            u.hi = 0xBF;
+            return true;
+        }
+
+        bool utf8_valid(const char *s, const char *e) {
+            utf8_t u;
+            for (; s < e; s++) {
+                if (!utf8_step(u, (uint8_t) *s))
+                    return false;
+            }
+            return u.need == 0;
+        }
+
+        /* classifies the given blocks, returns the first block with invalid UTF-8 (or nblocks) */
+        using classify_t = size_t (*)(const uint8_t *in, size_t nblocks, block_t *out, utf8_t& u);
+
+        size_t classify_scalar(const uint8_t *in, size_t nblocks, block_t *out, utf8_t& u) {
+            size_t bad{nblocks};
+            for (size_t b = 0; b < nblocks; b++, in += 64) {
+                block_t blk{0, 0, 0, 0, 0};
+                bool ok{true};
+                for (int i = 0; i < 64; i++) {
+                    uint8_t c = in[i], k = CLASSES.table[c];
+                    if (k != 0) {
+                        uint64_t bit = 1ull << i;
+                        if (k & C_QUOTE)  blk.quote  |= bit;
+                        if (k & C_BSLASH) blk.bslash |= bit;
+                        if (k & C_OP)     blk.op     |= bit;
+                        if (k & C_WS)     blk.ws     |= bit;
+                        if (k & C_CTRL)   blk.ctrl   |= bit;
+                    }
+                    if (c >= 0x80 || u.need)
+                        ok = utf8_step(u, c) && ok;
+                }
+                if (!ok && bad == nblocks)
+                    bad = b;
+                out[b] = blk;
+            }
+            return bad;
+        }
+
+#if defined(__x86_64__) || defined(__i386__)
+        /*
+         * UTF-8 validation with lookup tables (Keiser & Lemire), the error of a byte is
+         * found from the high nibble of the previous byte, its low nibble and the high
+         * nibble of the byte itself.
+         */
+        enum : uint8_t {
+            U_TOO_SHORT  = 1 << 0,
+            U_TOO_LONG   = 1 << 1,
+            U_OVERLONG_3 = 1 << 2,
+            U_TOO_LARGE  = 1 << 3,
+            U_SURROGATE  = 1 << 4,
+            U_OVERLONG_2 = 1 << 5,
+            U_TOO_LARGE_1000 = 1 << 6,
+            U_OVERLONG_4 = 1 << 6,
+            U_TWO_CONTS  = 1 << 7,
+            U_CARRY      = U_TOO_SHORT | U_TOO_LONG | U_TWO_CONTS
+        };
+
+        alignas(16) const uint8_t UTF8_BYTE_1_HIGH[16] = {
+            U_TOO_LONG, U_TOO_LONG, U_TOO_LONG, U_TOO_LONG,
+            U_TOO_LONG, U_TOO_LONG, U_TOO_LONG, U_TOO_LONG,
+            U_TWO_CONTS, U_TWO_CONTS, U_TWO_CONTS, U_TWO_CONTS,
+            U_TOO_SHORT | U_OVERLONG_2,
+            U_TOO_SHORT,
+            U_TOO_SHORT | U_OVERLONG_3 | U_SURROGATE,
+            U_TOO_SHORT | U_TOO_LARGE | U_TOO_LARGE_1000 | U_OVERLONG_4
+        };
+
+        alignas(16) const uint8_t UTF8_BYTE_1_LOW[16] = {
+            U_CARRY | U_OVERLONG_3 | U_OVERLONG_2 | U_OVERLONG_4,
+            U_CARRY | U_OVERLONG_2,
+            U_CARRY,
+            U_CARRY,
+            U_CARRY | U_TOO_LARGE,
+            U_CARRY | U_TOO_LARGE | U_TOO_LARGE_1000,
+            U_CARRY | U_TOO_LARGE | U_TOO_LARGE_1000,
+            U_CARRY | U_TOO_LARGE | U_TOO_LARGE_1000,
+            U_CARRY | U_TOO_LARGE | U_TOO_LARGE_1000,
+            U_CARRY | U_TOO_LARGE | U_TOO_LARGE_1000,
+            U_CARRY | U_TOO_LARGE | U_TOO_LARGE_1000,
+            U_CARRY | U_TOO_LARGE | U_TOO_LARGE_1000,
+            U_CARRY | U_TOO_LARGE | U_TOO_LARGE_1000,
+            U_CARRY | U_TOO_LARGE | U_TOO_LARGE_1000 | U_SURROGATE,
+            U_CARRY | U_TOO_LARGE | U_TOO_LARGE_1000,
+            U_CARRY | U_TOO_LARGE | U_TOO_LARGE_1000
+        };
+
+        alignas(16) const uint8_t UTF8_BYTE_2_HIGH[16] = {
+            U_TOO_SHORT, U_TOO_SHORT, U_TOO_SHORT, U_TOO_SHORT,
+            U_TOO_SHORT, U_TOO_SHORT, U_TOO_SHORT, U_TOO_SHORT,
+            U_TOO_LONG | U_OVERLONG_2 | U_TWO_CONTS | U_OVERLONG_3 | U_TOO_LARGE_1000 | U_OVERLONG_4,
+            U_TOO_LONG | U_OVERLONG_2 | U_TWO_CONTS | U_OVERLONG_3 | U_TOO_LARGE,
+            U_TOO_LONG | U_OVERLONG_2 | U_TWO_CONTS | U_SURROGATE  | U_TOO_LARGE,
+            U_TOO_LONG | U_OVERLONG_2 | U_TWO_CONTS | U_SURROGATE  | U_TOO_LARGE,
+            U_TOO_SHORT, U_TOO_SHORT, U_TOO_SHORT, U_TOO_SHORT
+        };
+
+        /* the last 3 bytes of a block can't start a sequence that doesn't fit */
+        alignas(32) const uint8_t UTF8_MAX[32] = {
+            0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+            0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xEF, 0xDF, 0xBF
+        };
+
+        __attribute__((target("sse4.2")))
+        inline __m128i utf8_check_sse42(__m128i v, __m128i prev) {
+            const __m128i nibble = _mm_set1_epi8(0x0F);
+            __m128i prev1 = _mm_alignr_epi8(v, prev, 15);
+            __m128i prev2 = _mm_alignr_epi8(v, prev, 14);
+            __m128i prev3 = _mm_alignr_epi8(v, prev, 13);
+            __m128i b1h = _mm_shuffle_epi8(_mm_load_si128((const __m128i *) UTF8_BYTE_1_HIGH),
+                                           _mm_and_si128(_mm_srli_epi16(prev1, 4), nibble));
+            __m128i b1l = _mm_shuffle_epi8(_mm_load_si128((const __m128i *) UTF8_BYTE_1_LOW),
+                                           _mm_and_si128(prev1, nibble));
+            __m128i b2h = _mm_shuffle_epi8(_mm_load_si128((const __m128i *) UTF8_BYTE_2_HIGH),
+                                           _mm_and_si128(_mm_srli_epi16(v, 4), nibble));
+            __m128i special = _mm_and_si128(_mm_and_si128(b1h, b1l), b2h);
+            /* continuation bytes expected after 3 and 4 byte sequences leads */
+            __m128i must23 = _mm_or_si128(_mm_subs_epu8(prev2, _mm_set1_epi8(0xE0-0x80)),
+                                          _mm_subs_epu8(prev3, _mm_set1_epi8(0xF0-0x80)));
+            return _mm_xor_si128(_mm_and_si128(must23, _mm_set1_epi8((char) 0x80)), special);
+        }
+
+        __attribute__((target("sse4.2")))
+        size_t classify_sse42(const uint8_t *in, size_t nblocks, block_t *out, utf8_t& u) {
+            const __m128i quote = _mm_set1_epi8('"'), bslash = _mm_set1_epi8('\\');
+            const __m128i lbrace = _mm_set1_epi8('{'), rbrace = _mm_set1_epi8('}');
+            const __m128i lbracket = _mm_set1_epi8('['), rbracket = _mm_set1_epi8(']');
+            const __m128i colon = _mm_set1_epi8(':'), comma = _mm_set1_epi8(',');
+            const __m128i space = _mm_set1_epi8(' '), tab = _mm_set1_epi8('\t');
+            const __m128i nl = _mm_set1_epi8('\n'), cr = _mm_set1_epi8('\r');
+            const __m128i high3 = _mm_set1_epi8((char) 0xE0), zero = _mm_setzero_si128();
+            const __m128i max = _mm_loadu_si128((const __m128i *) (UTF8_MAX + 16));
+            __m128i prev = _mm_loadu_si128((const __m128i *) (u.prev + 16));
+            size_t bad{nblocks};
+
+            for (size_t b = 0; b < nblocks; b++, in += 64) {
+                block_t blk{0, 0, 0, 0, 0};
+                __m128i err = zero;
+                for (int k = 0; k < 4; k++) {
+                    __m128i v = _mm_loadu_si128((const __m128i *) (in + 16*k));
+                    __m128i op = _mm_or_si128(
+                        _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, lbrace), _mm_cmpeq_epi8(v, rbrace)),
+                                     _mm_or_si128(_mm_cmpeq_epi8(v, lbracket), _mm_cmpeq_epi8(v, rbracket))),
+                        _mm_or_si128(_mm_cmpeq_epi8(v, colon), _mm_cmpeq_epi8(v, comma)));
+                    __m128i ws = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, space), _mm_cmpeq_epi8(v, tab)),
+                                              _mm_or_si128(_mm_cmpeq_epi8(v, nl), _mm_cmpeq_epi8(v, cr)));
+                    int shift = 16*k;
+                    blk.quote  |= (uint64_t) (uint16_t) _mm_movemask_epi8(_mm_cmpeq_epi8(v, quote)) << shift;
+                    blk.bslash |= (uint64_t) (uint16_t) _mm_movemask_epi8(_mm_cmpeq_epi8(v, bslash)) << shift;
+                    blk.op     |= (uint64_t) (uint16_t) _mm_movemask_epi8(op) << shift;
+                    blk.ws     |= (uint64_t) (uint16_t) _mm_movemask_epi8(ws) << shift;
+                    blk.ctrl   |= (uint64_t) (uint16_t) _mm_movemask_epi8(
+                                      _mm_cmpeq_epi8(_mm_and_si128(v, high3), zero)) << shift;
+
+                    if (_mm_movemask_epi8(v) == 0)
+                        /* ASCII, the previous bytes must not be an incomplete sequence */
+                        err = _mm_or_si128(err, _mm_subs_epu8(prev, max));
+                    else
+                        err = _mm_or_si128(err, utf8_check_sse42(v, prev));
+                    prev = v;
+                }
+                if (!_mm_testz_si128(err, err) && bad == nblocks)
+                    bad = b;
+                out[b] = blk;
+            }
+
+            _mm_storeu_si128((__m128i *) (u.prev + 16), prev);
+            __m128i inc = _mm_subs_epu8(prev, max);
+            u.incomplete = !_mm_testz_si128(inc, inc);
+            return bad;
+        }
+
+        __attribute__((target("avx2")))
+        inline __m256i utf8_check_avx2(__m256i v, __m256i prev) {
+            const __m256i nibble = _mm256_set1_epi8(0x0F);
+            __m256i shifted = _mm256_permute2x128_si256(prev, v, 0x21);
+            __m256i prev1 = _mm256_alignr_epi8(v, shifted, 15);
+            __m256i prev2 = _mm256_alignr_epi8(v, shifted, 14);
+            __m256i prev3 = _mm256_alignr_epi8(v, shifted, 13);
+            __m256i b1h = _mm256_shuffle_epi8(
+                _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i *) UTF8_BYTE_1_HIGH)),
+                _mm256_and_si256(_mm256_srli_epi16(prev1, 4), nibble));
+            __m256i b1l = _mm256_shuffle_epi8(
+                _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i *) UTF8_BYTE_1_LOW)),
+                _mm256_and_si256(prev1, nibble));
+            __m256i b2h = _mm256_shuffle_epi8(
+                _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i *) UTF8_BYTE_2_HIGH)),
+                _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble));
+            __m256i special = _mm256_and_si256(_mm256_and_si256(b1h, b1l), b2h);
+            __m256i must23 = _mm256_or_si256(_mm256_subs_epu8(prev2, _mm256_set1_epi8(0xE0-0x80)),
+                                             _mm256_subs_epu8(prev3, _mm256_set1_epi8(0xF0-0x80)));
+            return _mm256_xor_si256(_mm256_and_si256(must23, _mm256_set1_epi8((char) 0x80)), special);
+        }
+
+        __attribute__((target("avx2")))
+        size_t classify_avx2(const uint8_t *in, size_t nblocks, block_t *out, utf8_t& u) {
+            const __m256i quote = _mm256_set1_epi8('"'), bslash = _mm256_set1_epi8('\\');
+            const __m256i lbrace = _mm256_set1_epi8('{'), rbrace = _mm256_set1_epi8('}');
+            const __m256i lbracket = _mm256_set1_epi8('['), rbracket = _mm256_set1_epi8(']');
+            const __m256i colon = _mm256_set1_epi8(':'), comma = _mm256_set1_epi8(',');
+            const __m256i space = _mm256_set1_epi8(' '), tab = _mm256_set1_epi8('\t');
+            const __m256i nl = _mm256_set1_epi8('\n'), cr = _mm256_set1_epi8('\r');
+            const __m256i high3 = _mm256_set1_epi8((char) 0xE0), zero = _mm256_setzero_si256();
+            const __m256i max = _mm256_load_si256((const __m256i *) UTF8_MAX);
+            __m256i prev = _mm256_loadu_si256((const __m256i *) u.prev);
+            size_t bad{nblocks};
+
+            for (size_t b = 0; b < nblocks; b++, in += 64) {
+                block_t blk{0, 0, 0, 0, 0};
+                __m256i err = zero;
+                for (int k = 0; k < 2; k++) {
+                    __m256i v = _mm256_loadu_si256((const __m256i *) (in + 32*k));
+                    __m256i op = _mm256_or_si256(
+                        _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, lbrace), _mm256_cmpeq_epi8(v, rbrace)),
+                                        _mm256_or_si256(_mm256_cmpeq_epi8(v, lbracket), _mm256_cmpeq_epi8(v, rbracket))),
+                        _mm256_or_si256(_mm256_cmpeq_epi8(v, colon), _mm256_cmpeq_epi8(v, comma)));
+                    __m256i ws = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, space), _mm256_cmpeq_epi8(v, tab)),
+                                                 _mm256_or_si256(_mm256_cmpeq_epi8(v, nl), _mm256_cmpeq_epi8(v, cr)));
+                    int shift = 32*k;
+                    blk.quote  |= (uint64_t) (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, quote)) << shift;
+                    blk.bslash |= (uint64_t) (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, bslash)) << shift;
+                    blk.op     |= (uint64_t) (uint32_t) _mm256_movemask_epi8(op) << shift;
+                    blk.ws     |= (uint64_t) (uint32_t) _mm256_movemask_epi8(ws) << shift;
+                    blk.ctrl   |= (uint64_t) (uint32_t) _mm256_movemask_epi8(
+                                      _mm256_cmpeq_epi8(_mm256_and_si256(v, high3), zero)) << shift;
+
+                    if (_mm256_movemask_epi8(v) == 0)
+                        /* ASCII, the previous bytes must not be an incomplete sequence */
+                        err = _mm256_or_si256(err, _mm256_subs_epu8(prev, max));
+                    else
+                        err = _mm256_or_si256(err, utf8_check_avx2(v, prev));
+                    prev = v;
+                }
+                if (!_mm256_testz_si256(err, err) && bad == nblocks)
+                    bad = b;
+                out[b] = blk;
+            }
+
+            _mm256_storeu_si256((__m256i *) u.prev, prev);
+            __m256i inc = _mm256_subs_epu8(prev, max);
+            u.incomplete = !_mm256_testz_si256(inc, inc);
+            return bad;
+        }
+#endif
+
+        struct classifier_t {
+            const char *name;
+            classify_t  classify;
+            bool        supported;
+        };
+
+#if defined(__x86_64__) || defined(__i386__)
+        /* the classifiers are selected during static initialization */
+        bool has_avx2() {
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2") != 0;
+        }
+
+        bool has_sse42() {
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("sse4.2") != 0;
+        }
+#endif
+
+        const classifier_t CLASSIFIERS[] = {
+#if defined(__x86_64__) || defined(__i386__)
+            {"avx2",   classify_avx2,   has_avx2()},
+            {"sse4.2", classify_sse42,  has_sse42()},
+#endif
+            {"scalar", classify_scalar, true}
+        };
+
+        classify_t select_classifier() {
+            for (auto& c: CLASSIFIERS) {
+                if (c.supported)
+                    return c.classify;
+            }
+            return classify_scalar;
+        }
+
+        /* the classifier used by the decoder, picked once for the CPU */
+        classify_t CLASSIFY = select_classifier();
+
+        inline uint64_t prefix_xor(uint64_t x) {
+            x ^= x << 1;
+            x ^= x << 2;
+            x ^= x << 4;
+            x ^= x << 8;
+            x ^= x << 16;
+            x ^= x << 32;
+            return x;
+        }
+
+        /* the structural index, built a chunk at a time as the decoder consumes it */
+        struct scanner_t {
+            static constexpr size_t CHUNK{64};
+
+            scanner_t(const uint8_t *in, uint32_t len, uint32_t *idx, block_t *blocks, classify_t classify)
+                : in(in),
+                  len(len),
+                  idx(idx),
+                  blocks(blocks),
+                  classify(classify)
+            {}
+
+            inline uint32_t next() {
+                if (i == n && !fill())
+                    return len;
+                return idx[i++];
+            }
+
+            bool fill();
+
+            void index(const block_t& blk, uint32_t base);
+
+            const uint8_t *in;
+            uint32_t    len;
+            uint32_t   *idx;
+            block_t    *blocks;
+            classify_t  classify;
+            uint32_t    scanned{0};
+            size_t      n{0};
+            size_t      i{0};
+            utf8_t      utf8{};
+            /* carried from one block to the next */
+            uint64_t    escapedNext{0};
+            uint64_t    inString{0};
+            uint64_t    inScalar{0};
+            /* stage 1 reads ahead, errors only count if they are within the decoded value */
+            size_t      utf8Error{SIZE_MAX};
+            size_t      ctrlError{SIZE_MAX};
+        };
+
+        bool scanner_t::fill() {
+            n = i = 0;
+            while (n == 0 && scanned < len) {
+                size_t avail = len - scanned, nblocks = std::min(CHUNK, avail / 64), bytes = nblocks * 64;
+                const uint8_t *src = in + scanned;
+                uint8_t pad[64];
+                if (nblocks == 0) {
+                    /* the last block is padded with spaces */
+                    memset(pad, ' ', sizeof(pad));
+                    memcpy(pad, src, avail);
+                    src = pad;
+                    nblocks = 1;
+                    bytes = avail;
+                }
+
+                size_t bad = classify(src, nblocks, blocks, utf8);
+                if (bad != nblocks && utf8Error == SIZE_MAX)
+                    utf8Error = scanned + bad * 64;
+                for (size_t b = 0; b < nblocks; b++)
+                    index(blocks[b], scanned + (uint32_t) (b * 64));
+                scanned += (uint32_t) bytes;
+
+                if (scanned == len && utf8Error == SIZE_MAX && (utf8.incomplete || utf8.need))
+                    utf8Error = len - std::min(len, 3u);
+            }
+            return n != 0;
+        }
+
+        void scanner_t::index(const block_t& blk, uint32_t base) {
+            /* characters following an odd number of backslashes are escaped */
+            uint64_t escaped;
+            if (blk.bslash == 0) {
+                escaped = escapedNext;
+                escapedNext = 0;
+            }
+            else {
+                const uint64_t ODD_BITS{0xAAAAAAAAAAAAAAAAull};
+                uint64_t potential = blk.bslash & ~escapedNext;
+                uint64_t codes = ((potential << 1) | ODD_BITS) - potential;
+                uint64_t terminal = codes ^ ODD_BITS;
+                escaped = terminal ^ (blk.bslash | escapedNext);
+                escapedNext = (terminal & blk.bslash) >> 63;
+            }
+
+            uint64_t quote = blk.quote & ~escaped;
+            /* from the opening quote up to the closing quote */
+            uint64_t str = prefix_xor(quote) ^ inString;
+            inString = (uint64_t) ((int64_t) str >> 63);
+
+            uint64_t ctrl = blk.ctrl & str;
+            if (ctrl != 0 && ctrlError == SIZE_MAX)
+                ctrlError = base + __builtin_ctzll(ctrl);
+
+            uint64_t scalar = ~(blk.op | blk.ws | quote | str);
+            uint64_t structurals = (blk.op & ~str) | quote | (scalar & ~((scalar << 1) | inScalar));
+            inScalar = scalar >> 63;
+
+            while (structurals != 0) {
+                idx[n++] = base + __builtin_ctzll(structurals);
+                structurals &= structurals - 1;
+            }
+        }
+
+        thread_local uint32_t SCAN_INDEX[scanner_t::CHUNK * 64];
+        thread_local block_t  SCAN_BLOCKS[scanner_t::CHUNK];
+
+        JsonNode *json_clone(const JsonNode *node) {
+            JsonNode *ret{nullptr}, *child{nullptr};
+            switch (node->tag) {
+                case JSON_NULL:
+                    return json_mknull();
+                case JSON_BOOL:
+                    return json_mkbool(node->bool_);
+                case JSON_STRING:
+                    return json_mkstring(node->string_);
+                case JSON_NUMBER:
+                    return json_mknumber(node->number_);
+                case JSON_ARRAY:
+                    ret = json_mkarray();
+                    json_foreach(child, node)
+                        json_append_element(ret, json_clone(child));
+                    return ret;
+                default:
+                    ret = json_mkobject();
+                    json_foreach(child, node)
+                        json_append_member(ret, child->key, json_clone(child));
+                    return ret;
+            }
+        }
+    }
+
+    void Tape::grow(size_t need) {
+        size_t ncap = cap? cap : 64;
+        while (ncap < need)
+            ncap *= 2;
+        if (ncap > UINT32_MAX)
+            throw Exception::create("json::Object::decode document too large");
+        words = (uint64_t *) realloc(words, ncap * sizeof(uint64_t));
+        if (words == nullptr)
+            out_of_memory();
+        cap = (uint32_t) ncap;
+    }
+
+    void Tape::reserve(size_t need) {
+        if (need <= scap)
+            return;
+        size_t ncap = scap? scap : 64;
+        while (ncap < need)
+            ncap *= 2;
+        strings = (char *) realloc(strings, ncap);
+        if (strings == nullptr)
+            out_of_memory();
+        scap = ncap;
+    }
+
+    JsonTag Tape::type(uint32_t i) const {
+        switch (tag(i)) {
+            case 'n':
+                return JSON_NULL;
+            case 't':
+            case 'f':
+                return JSON_BOOL;
+            case '"':
+                return JSON_STRING;
+            case 'd':
+                return JSON_NUMBER;
+            case '[':
+                return JSON_ARRAY;
+            default:
+                return JSON_OBJECT;
+        }
+    }
+
+    uint32_t Tape::element(uint32_t i, int index) const {
+        if (index < 0 || (count(i) != MAX_COUNT && (uint32_t) index >= count(i)))
+            return 0;
+        for (uint32_t k = i+1; tag(k) != ']'; k = next(k)) {
+            if (index-- == 0)
+                return k;
+        }
+        return 0;
+    }
+
+    uint32_t Tape::member(uint32_t i, const char *key, size_t keyLen) const {
+        if (count(i) <= JSON_INDEX_THRESHOLD) {
+            for (uint32_t k = i+1; tag(k) != '}'; k = next(k+1)) {
+                if (size(k) == keyLen && memcmp(str(k), key, keyLen) == 0)
+                    return k+1;
+            }
+            return 0;
+        }
+
+        auto it = indices.find(i);
+        if (it == indices.end()) {
+            /* the slots hold the index of the keys, twice as many slots as members */
+            uint32_t cap{32};
+            while (cap < count(i) * 2)
+                cap <<= 1;
+            std::vector<uint32_t> slots(cap, 0);
+            for (uint32_t k = i+1; tag(k) != '}'; k = next(k+1)) {
+                for (uint32_t h = key_hash(str(k), size(k)) & (cap-1);; h = (h+1) & (cap-1)) {
+                    if (slots[h] == 0) {
+                        slots[h] = k;
+                        break;
+                    }
+                    /* the first of duplicate members is found */
+                    if (size(slots[h]) == size(k) && memcmp(str(slots[h]), str(k), size(k)) == 0)
+                        break;
+                }
+            }
+            it = indices.emplace(i, std::move(slots)).first;
+        }
+
+        auto& slots = it->second;
+        auto mask = (uint32_t) slots.size() - 1;
+        for (uint32_t h = key_hash(key, keyLen) & mask;; h = (h+1) & mask) {
+            auto k = slots[h];
+            if (k == 0)
+                return 0;
+            if (size(k) == keyLen && memcmp(str(k), key, keyLen) == 0)
+                return k+1;
+        }
+    }
+
+    bool Tape::parse(const char *s, const char *e, const char *&end) {
+        struct level_t {
+            uint32_t idx;
+            uint32_t count;
+        };
+
+        if ((size_t) (e - s) >= UINT32_MAX)
+            throw Exception::create("json::Object::decode document too large");
+        auto size = (uint32_t) (e - s);
+        scanner_t sc((const uint8_t *) s, size, SCAN_INDEX, SCAN_BLOCKS, CLASSIFY);
+        std::vector<level_t> levels;
+        /* the end of the last value */
+        const char *vend{s};
+        uint32_t pos;
+
+        /* most documents fit without growing the tape or the arena */
+        grow(size/8 + 16);
+        reserve(size + size/2 + 64);
+
+        pos = sc.next();
+    value:
+        if (pos >= size)
+            goto failed;
+        switch (s[pos]) {
+            case '{':
+            case '[':
+                if (levels.size() == MAX_DEPTH)
+                    goto failed;
+                levels.push_back({len, 0});
+                push((uint8_t) s[pos]);
+                pos = sc.next();
+                if (pos >= size)
+                    goto failed;
+                if (tag(levels.back().idx) == '{') {
+                    if (s[pos] == '}')
+                        goto close;
+                    goto key;
+                }
+                if (s[pos] == ']')
+                    goto close;
+                goto value;
+            case '"': {
+                /* the next structural is the closing quote */
+                uint32_t q = sc.next();
+                if (q >= size || !copy_string(s+pos+1, s+q))
+                    goto failed;
+                vend = s+q+1;
+                break;
+            }
+            case 't':
+                if ((e - s - pos) < 4 || memcmp(s+pos, "true", 4) != 0)
+                    goto failed;
+                push('t');
+                vend = s+pos+4;
+                break;
+            case 'f':
+                if ((e - s - pos) < 5 || memcmp(s+pos, "false", 5) != 0)
+                    goto failed;
+                push('f');
+                vend = s+pos+5;
+                break;
+            case 'n':
+                if ((e - s - pos) < 4 || memcmp(s+pos, "null", 4) != 0)
+                    goto failed;
+                push('n');
+                vend = s+pos+4;
+                break;
+            default:
+                vend = s+pos;
+                if (!parse_number(vend, e))
+                    goto failed;
+                break;
+        }
+
+    more:
+        if (levels.empty())
+            goto done;
+        levels.back().count++;
+        pos = sc.next();
+        /* scalars must be followed by a structural character */
+        for (; vend < s+std::min(pos, size); vend++) {
+            if (!is_space(*vend)) {
+                pos = (uint32_t) (vend - s);
+                goto failed;
+            }
+        }
+        if (pos >= size)
+            goto failed;
+        if (s[pos] == ',') {
+            pos = sc.next();
+            if (tag(levels.back().idx) == '{')
+                goto key;
+            goto value;
+        }
+        if (s[pos] != (tag(levels.back().idx) == '{'? '}' : ']'))
+            goto failed;
+
+    close:
+        {
+            auto lvl = levels.back();
+            levels.pop_back();
+            uint8_t t = tag(lvl.idx);
+            push(t == '{'? '}' : ']', lvl.idx);
+            words[lvl.idx] = ((uint64_t) t << 56) |
+                             ((uint64_t) std::min(lvl.count, MAX_COUNT) << 32) | len;
+            vend = s+pos+1;
+        }
+        goto more;
+
+    key:
+        if (pos >= size || s[pos] != '"')
+            goto failed;
+        {
+            uint32_t q = sc.next();
+            if (q >= size || !copy_string(s+pos+1, s+q))
+                goto failed;
+        }
+        pos = sc.next();
+        if (pos >= size || s[pos] != ':')
+            goto failed;
+        pos = sc.next();
+        goto value;
+
+    done:
+        while (vend < e && is_space(*vend))
+            vend++;
+        end = vend;
+        if (sc.ctrlError < (size_t) (vend - s)) {
+            /* Control characters are not allowed in string literals. */
+            end = s + sc.ctrlError;
+            return false;
+        }
+        if (sc.utf8Error < (size_t) (vend - s) && !utf8_valid(s, vend)) {
+            end = s + sc.utf8Error;
+            return false;
+        }
+        return true;
+
+    failed:
+        end = s + std::min(pos, size);
+        return false;
+    }
+
+    bool Tape::copy_string(const char *p, const char *q) {
+        /* UTF-8 and control characters are checked by stage 1, a string is never longer than its encoding */
+        reserve(slen + sizeof(uint32_t) + (q - p) + 1);
+        char *start = strings + slen + sizeof(uint32_t), *b = start;
+
+        while (true) {
+            auto bs = (const char *) memchr(p, '\\', q - p);
+            auto stop = bs? bs : q;
+            memcpy(b, p, stop - p);
+            b += stop - p;
+            if (bs == nullptr)
+                break;
+
+            /* an escape never ends on the closing quote */
+            p = bs+1;
+            switch (*p++) {
+                case '"':  *b++ = '"';  break;
+                case '\\': *b++ = '\\'; break;
+                case '/':  *b++ = '/';  break;
+                case 'b':  *b++ = '\b'; break;
+                case 'f':  *b++ = '\f'; break;
+                case 'n':  *b++ = '\n'; break;
+                case 'r':  *b++ = '\r'; break;
+                case 't':  *b++ = '\t'; break;
+                case 'u': {
+                    uint16_t uc, lc;
+                    uchar_t unicode;
+                    if ((q - p) < 4 || !parse_hex16(&p, &uc))
+                        return false;
+                    if (uc >= 0xD800 && uc <= 0xDFFF) {
+                        /* UTF-16 surrogate pair */
+                        if ((q - p) < 6 || *p++ != '\\' || *p++ != 'u' || !parse_hex16(&p, &lc))
+                            return false;
+                        if (!from_surrogate_pair(uc, lc, &unicode))
+                            return false;
+                    }
+                    else if (uc == 0) {
+                        /* Disallow "\u0000". */
+                        return false;
+                    }
+                    else {
+                        unicode = uc;
+                    }
+                    b += utf8_write_char(unicode, b);
+                    break;
+                }
+                default:
+                    return false;
+            }
+        }
+
+        auto l = (uint32_t) (b - start);
+        memcpy(start - sizeof(uint32_t), &l, sizeof(l));
+        *b++ = '\0';
+        push('"', start - strings);
+        slen = b - strings;
+        return true;
+    }
+
+    bool Tape::parse_number(const char *&p, const char *e) {
+        /* same grammar as parse_number */
+        const char *s = p;
+        uint64_t m{0};
+        int digits{0}, exp10{0};
+        bool neg{false};
+
+        if (p < e && *p == '-') {
+            neg = true;
+            p++;
+        }
+
+        if (p == e)
+            return false;
+        if (*p == '0') {
+            p++;
+        }
+        else {
+            if (!is_digit(*p))
+                return false;
+            do {
+                if (digits < 19) {
+                    m = m*10 + (*p - '0');
+                    digits++;
+                }
+                else {
+                    exp10++;
+                }
+                p++;
+            } while (p < e && is_digit(*p));
+        }
+
+        if (p < e && *p == '.') {
+            p++;
+            if (p == e || !is_digit(*p))
+                return false;
+            do {
+                if (digits < 19) {
+                    m = m*10 + (*p - '0');
+                    digits++;
+                    exp10--;
+                }
+                p++;
+            } while (p < e && is_digit(*p));
+        }
+
+        if (p < e && (*p == 'E' || *p == 'e')) {
+            p++;
+            bool eneg{false};
+            if (p < e && (*p == '+' || *p == '-'))
+                eneg = *p++ == '-';
+            if (p == e || !is_digit(*p))
+                return false;
+            int x{0};
+            do {
+                if (x < 100000)
+                    x = x*10 + (*p - '0');
+                p++;
+            } while (p < e && is_digit(*p));
+            exp10 += eneg? -x : x;
+        }
+
+        double d;
+        if (digits <= 15 && exp10 >= -22 && exp10 <= 22) {
+            /* the mantissa and the power of 10 are exact, the result is correctly rounded */
+            d = (double) m;
+            d = exp10 < 0? d / POW10[-exp10] : d * POW10[exp10];
+            if (neg)
+                d = -d;
+        }
+        else {
+            char buf[64];
+            size_t n = p - s;
+            if (n < sizeof(buf)) {
+                memcpy(buf, s, n);
+                buf[n] = '\0';
+                d = strtod(buf, nullptr);
+            }
+            else {
+                std::string tmp(s, n);
+                d = strtod(tmp.c_str(), nullptr);
+            }
+        }
+
+        push('d');
+        if (len == cap)
+            grow(len+1);
+        memcpy(&words[len++], &d, sizeof(d));
+        return true;
+    }
+
+    JsonNode *Tape::build(uint32_t i, bool map) {
+        JsonNode *node;
+        switch (tag(i)) {
+            case 'n':
+                node = json_mknull();
+                break;
+            case 't':
+                node = json_mkbool(true);
+                break;
+            case 'f':
+                node = json_mkbool(false);
+                break;
+            case 'd':
+                node = json_mknumber(number(i));
+                break;
+            case '"':
+                node = json_mknstring(str(i), size(i));
+                break;
+            case '[':
+                node = json_mkarray();
+                for (uint32_t k = i+1; tag(k) != ']'; k = next(k))
+                    json_append_element(node, build(k, map));
+                break;
+            default:
+                node = json_mkobject();
+                for (uint32_t k = i+1; tag(k) != '}'; k = next(k+1))
+                    json_append_member(node, str(k), build(k+1, map));
+                break;
+        }
+
+        if (map)
+            nodes[i] = node;
+        return node;
+    }
+
+    void Tape::thaw() {
+        if (root != nullptr)
+            return;
+        nodes.assign(len, nullptr);
+        root = build(0, true);
+    }
+
+    void Tape::emit(iod::encode_stream& out, uint32_t i) const {
+        switch (tag(i)) {
+            case 'n':
+                out << "null";
+                break;
+            case 't':
+                out << "true";
+                break;
+            case 'f':
+                out << "false";
+                break;
+            case 'd':
+                emit_number(out, number(i));
+                break;
+            case '"':
+                emit_string(out, str(i));
+                break;
+            case '[':
+                out << '[';
+                for (uint32_t k = i+1; tag(k) != ']'; k = next(k)) {
+                    if (k != i+1)
+                        out << ',';
+                    emit(out, k);
+                }
+                out << ']';
+                break;
+            default:
+                out << '{';
+                for (uint32_t k = i+1; tag(k) != '}'; k = next(k+1)) {
+                    if (k != i+1)
+                        out << ',';
+                    emit_string(out, str(k));
+                    out << ':';
+                    emit(out, k+1);
+                }
+                out << '}';
+                break;
+        }
+    }
+
     Object::Object()
         : mNode(mknode(JsonTag::JSON_NULL))
     {}
@@ -1368,226 +2560,739 @@ namespace suil::json {
         : mNode(json_mkobject())
     {}
 
+    Tape* Object::tape() const {
+        return (mTape != nullptr && mTape->root == nullptr)? mTape : nullptr;
+    }
+
+    JsonNode* Object::node() const {
+        if (mTape != nullptr)
+            return mTape->root? mTape->nodes[mIdx] : nullptr;
+        return mNode;
+    }
+
+    JsonNode* Object::modify() {
+        if (mTape != nullptr)
+            mTape->thaw();
+        return node();
+    }
+
+    JsonNode* Object::detach() {
+        if (mTape != nullptr) {
+            /* decoded values are copied */
+            return mTape->root? json_clone(mTape->nodes[mIdx]) : mTape->build(mIdx, false);
+        }
+        if (mNode != nullptr && mNode->parent != nullptr) {
+            /* values of another document are copied */
+            return json_clone(mNode);
+        }
+        /* the node is now owned by its new parent */
+        ref = true;
+        return mNode;
+    }
+
     void Object::push(suil::json::Object &&o) {
-        if (mNode == nullptr || mNode->tag != JsonTag::JSON_ARRAY)
+        auto node = modify();
+        if (node == nullptr || node->tag != JsonTag::JSON_ARRAY)
             throw Exception::create("json::Object::push - object is not a JSON array");
-        json_append_element(mNode, o.mNode);
-        o.ref = true;
+        json_append_element(node, o.detach());
     }
 
     void Object::set(const char *key, suil::json::Object &&o) {
-        if (mNode == nullptr || mNode->tag != JsonTag::JSON_OBJECT)
+        auto node = modify();
+        if (node == nullptr || node->tag != JsonTag::JSON_OBJECT)
             throw Exception::create("json::Object::set - object is not a JSON object");
-        json_append_member(mNode, key, o.mNode);
-        o.ref = true;
+        json_append_member(node, key, o.detach());
     }
 
     Object Object::operator[](int index) const {
-        if (mNode == nullptr || mNode->tag != JsonTag::JSON_ARRAY)
+        if (auto t = tape()) {
+            if (t->tag(mIdx) != '[')
+                throw Exception::create("json::Object::[index] - object is not a JSON array");
+            auto i = t->element(mIdx, index);
+            return i? Object(t, i) : Object((JsonNode *) nullptr);
+        }
+
+        auto node = Ego.node();
+        if (node == nullptr || node->tag != JsonTag::JSON_ARRAY)
             throw Exception::create("json::Object::[index] - object is not a JSON array");
-        Object obj(json_find_element(mNode, index));
+        Object obj(json_find_element(node, index));
         return obj;
     }
 
     Object Object::operator[](const char *key) const {
-        if (mNode == nullptr || mNode->tag != JsonTag::JSON_OBJECT)
+        if (auto t = tape()) {
+            if (t->tag(mIdx) != '{')
+                throw Exception::create("json::Object::[index] - object is not a JSON object");
+            auto i = t->member(mIdx, key, strlen(key));
+            return i? Object(t, i) : Object((JsonNode *) nullptr);
+        }
+
+        auto node = Ego.node();
+        if (node == nullptr || node->tag != JsonTag::JSON_OBJECT)
             throw Exception::create("json::Object::[index] - object is not a JSON object");
-        Object obj(json_find_member(mNode, key));
+        Object obj(json_find_member(node, key));
         return obj;
     }
 
     Object Object::operator[](const suil::String &&key) const {
-		if (mNode == nullptr || mNode->tag != JsonTag::JSON_OBJECT)
-			throw Exception::create("json::Object::[index] - object is not a JSON object");
-		Object obj(json_find_member(mNode, key.data(), key.size()));
-		return obj;
+        if (auto t = tape()) {
+            if (t->tag(mIdx) != '{')
+                throw Exception::create("json::Object::[index] - object is not a JSON object");
+            auto i = t->member(mIdx, key.data(), key.size());
+            return i? Object(t, i) : Object((JsonNode *) nullptr);
+        }
+
+        auto node = Ego.node();
+        if (node == nullptr || node->tag != JsonTag::JSON_OBJECT)
+            throw Exception::create("json::Object::[index] - object is not a JSON object");
+        Object obj(json_find_member(node, key.data(), key.size()));
+        return obj;
     }
 
     Object::operator bool()   const {
-        if (mNode == nullptr || mNode->tag != JsonTag::JSON_BOOL)
+        if (auto t = tape())
+            return t->tag(mIdx) == 't';
+
+        auto node = Ego.node();
+        if (node == nullptr || node->tag != JsonTag::JSON_BOOL)
             return false;
-        return mNode->bool_;
+        return node->bool_;
     }
 
     Object::operator double()   const {
-        if (mNode == nullptr || mNode->tag != JsonTag::JSON_NUMBER)
+        if (auto t = tape()) {
+            if (t->tag(mIdx) != 'd')
+                throw Exception::create("json::Object - object is not a number");
+            return t->number(mIdx);
+        }
+
+        auto node = Ego.node();
+        if (node == nullptr || node->tag != JsonTag::JSON_NUMBER)
             throw Exception::create("json::Object - object is not a number");
-        return mNode->number_;
+        return node->number_;
     }
 
     Object::operator const char*()   const {
-        if (mNode == nullptr || mNode->tag != JsonTag::JSON_STRING)
+        if (auto t = tape()) {
+            if (t->tag(mIdx) != '"')
+                throw Exception::create("json::Object - object is not a string");
+            return t->str(mIdx);
+        }
+
+        auto node = Ego.node();
+        if (node == nullptr || node->tag != JsonTag::JSON_STRING)
             throw Exception::create("json::Object - object is not a string");
-        return mNode->string_;
+        return node->string_;
     }
 
     bool Object::empty() const {
-        if (mNode == nullptr || mNode->tag == JsonTag::JSON_NULL) return true;
-        if (mNode->tag == JsonTag::JSON_STRING)
-            return mNode->string_? strlen(mNode->string_) == 0 : true;
-        if (mNode->tag == JsonTag::JSON_BOOL)
-			return !mNode->bool_;
-        if (mNode->tag == JsonTag::JSON_OBJECT || mNode->tag == JsonTag::JSON_ARRAY)
-            return mNode->children.head == nullptr;
+        if (auto t = tape()) {
+            switch (t->tag(mIdx)) {
+                case '"':
+                    return t->size(mIdx) == 0;
+                case '[':
+                case '{':
+                    return t->next(mIdx) == mIdx+2;
+                case 't':
+                case 'd':
+                    return false;
+                default:
+                    return true;
+            }
+        }
+
+        auto node = Ego.node();
+        if (node == nullptr || node->tag == JsonTag::JSON_NULL) return true;
+        if (node->tag == JsonTag::JSON_STRING)
+            return node->string_? strlen(node->string_) == 0 : true;
+        if (node->tag == JsonTag::JSON_BOOL)
+			return !node->bool_;
+        if (node->tag == JsonTag::JSON_OBJECT || node->tag == JsonTag::JSON_ARRAY)
+            return node->children.head == nullptr;
 
         return false;
     }
 
     bool Object::isNull() const {
-        return mNode == nullptr || mNode->tag == JsonTag::JSON_NULL;
+        return Ego.type() == JsonTag::JSON_NULL || (mTape == nullptr && mNode == nullptr);
     }
 
     bool Object::isBool() const {
-        return mNode != nullptr && mNode->tag == JsonTag::JSON_BOOL;
+        return (mNode != nullptr || mTape != nullptr) && Ego.type() == JsonTag::JSON_BOOL;
     }
 
     bool Object::isNumber() const {
-        return mNode != nullptr && mNode->tag == JsonTag::JSON_NUMBER;
+        return Ego.type() == JsonTag::JSON_NUMBER;
     }
 
     bool Object::isString() const {
-        return mNode != nullptr && mNode->tag == JsonTag::JSON_STRING;
+        return Ego.type() == JsonTag::JSON_STRING;
     }
 
     bool Object::isArray() const {
-        return mNode != nullptr && mNode->tag == JsonTag::JSON_ARRAY;
+        return Ego.type() == JsonTag::JSON_ARRAY;
     }
 
     bool Object::isObject() const {
-        return mNode != nullptr && mNode->tag == JsonTag::JSON_OBJECT;
+        return Ego.type() == JsonTag::JSON_OBJECT;
     }
 
-    JsonTag Object::type() const { return mNode? mNode->tag : JsonTag::JSON_BOOL; }
+    JsonTag Object::type() const {
+        if (auto t = tape())
+            return t->type(mIdx);
+        auto node = Ego.node();
+        return node? node->tag : JsonTag::JSON_BOOL;
+    }
 
     Object Object::push(const suil::json::Array_t &) {
-        if (mNode == nullptr || mNode->tag != JsonTag::JSON_ARRAY)
+        auto node = modify();
+        if (node == nullptr || node->tag != JsonTag::JSON_ARRAY)
             /* valid node */
             throw Exception::create("json::Object::push - object is not a JSON array");
         /* create array node and append it */
         Object o(json::Arr);
-        json_append_element(mNode, o.mNode);
+        json_append_element(node, o.mNode);
         o.ref = true;
         return o;
     }
 
     Object Object::push(const suil::json::Object_t&) {
-        if (mNode == nullptr || mNode->tag != JsonTag::JSON_ARRAY)
+        auto node = modify();
+        if (node == nullptr || node->tag != JsonTag::JSON_ARRAY)
             /* valid node */
             throw Exception::create("json::Object::push - object is not a JSON array");
 
         /* create array node and append it */
         Object o(json::Obj);
-        json_append_element(mNode, o.mNode);
+        json_append_element(node, o.mNode);
         o.ref = true;
         return o;
     }
 
     Object Object::set(const char *key, const suil::json::Object_t &) {
-        if (mNode == nullptr || mNode->tag != JsonTag::JSON_OBJECT)
+        auto node = modify();
+        if (node == nullptr || node->tag != JsonTag::JSON_OBJECT)
             /* valid node */
             throw Exception::create("json::Object::set - object is not a JSON object");
         /* create array node and append it */
         Object o(json::Obj);
-        json_append_member(mNode, key, o.mNode);
+        json_append_member(node, key, o.mNode);
         o.ref = true;
         return o;
     }
 
     Object Object::set(const char *key, const suil::json::Array_t &) {
-        if (mNode == nullptr || mNode->tag != JsonTag::JSON_OBJECT)
+        auto node = modify();
+        if (node == nullptr || node->tag != JsonTag::JSON_OBJECT)
             /* valid node */
             throw Exception::create("json::Object::set - object is not a JSON object");
         /* create array node and append it */
         Object o(json::Arr);
-        json_append_member(mNode, key, o.mNode);
+        json_append_member(node, key, o.mNode);
         o.ref = true;
         return o;
     }
 
     void Object::encode(iod::encode_stream &ss) const {
         /* encode json object */
-        emit_value(ss, mNode);
+        if (auto t = tape())
+            t->emit(ss, mIdx);
+        else
+            emit_value(ss, Ego.node());
     }
 
     Object Object::decode(const char *str, size_t& sz) {
-        JsonNode *ret;
-        const char *s = str;
-        skip_space(&s);
-        if (!parse_value(&s, &ret)) {
+        /* the tape is owned by the returned object */
+        auto tape = new Tape;
+        const char *end{str};
+        if (!tape->parse(str, str+sz, end)) {
             /* parsing json string failed */
-            throw Exception::create("json::Object::decode invalid json string at ", (s-str));
+            delete tape;
+            throw Exception::create("json::Object::decode invalid json string at ", (end-str));
         }
 
-        skip_space(&s);
-        sz = s-str;
-        return Object(ret, false);
+        sz = end-str;
+        return Object(tape, 0, false);
     }
 
     void Object::operator|(suil::json::Object::ArrayEnumerator f) const {
-        if (mNode == nullptr || mNode->tag != JsonTag::JSON_ARRAY)
+        if (auto t = tape()) {
+            if (t->tag(mIdx) != '[')
+                throw Exception::create("json::Object::enumerate - object is not a JSON array");
+            for (uint32_t k = mIdx+1; t->tag(k) != ']'; k = t->next(k)) {
+                if (f(Object(t, k)))
+                    break;
+            }
+            return;
+        }
+
+        auto node = Ego.node();
+        if (node == nullptr || node->tag != JsonTag::JSON_ARRAY)
             /* valid node */
             throw Exception::create("json::Object::enumerate - object is not a JSON array");
-        JsonNode *node{nullptr};
-        json_foreach(node, mNode) {
-            if (f(Object(node, true)))
+        JsonNode *child{nullptr};
+        json_foreach(child, node) {
+            if (f(Object(child, true)))
                 break;
         }
     }
 
     void Object::operator|(suil::json::Object::ObjectEnumerator f) const {
-        if (mNode == nullptr || mNode->tag != JsonTag::JSON_OBJECT)
+        if (auto t = tape()) {
+            if (t->tag(mIdx) != '{')
+                throw Exception::create("json::Object::enumerate - object is not a JSON object");
+            for (uint32_t k = mIdx+1; t->tag(k) != '}'; k = t->next(k+1)) {
+                if (f(t->str(k), Object(t, k+1)))
+                    break;
+            }
+            return;
+        }
+
+        auto node = Ego.node();
+        if (node == nullptr || node->tag != JsonTag::JSON_OBJECT)
             /* valid node */
             throw Exception::create("json::Object::enumerate - object is not a JSON object");
 
-        JsonNode *node{nullptr};
-        json_foreach(node, mNode) {
-            if (f(node->key, Object(node, true)))
+        JsonNode *child{nullptr};
+        json_foreach(child, node) {
+            if (f(child->key, Object(child, true)))
                 break;
         }
     }
 
     Object::iterator Object::iterator::operator++() {
-    	if (mNode)
+        if (mTape) {
+            mIdx = mTape->next(mMembers? mIdx+1 : mIdx);
+            if (mTape->tag(mIdx) == (mMembers? '}' : ']')) {
+                /* reached the end */
+                mTape = nullptr;
+                mIdx = 0;
+            }
+        }
+        else if (mNode)
     		mNode = mNode->next;
     	return Ego;
     }
 
     const std::pair<const char*,Object> Object::iterator::operator*() const {
+        if (mTape) {
+            if (mMembers)
+                return std::make_pair(mTape->str(mIdx), Object(mTape, mIdx+1));
+            return std::make_pair(nullptr, Object(mTape, mIdx));
+        }
     	return std::make_pair(mNode? mNode->key:nullptr, Object(mNode));
     }
 
     Object::iterator Object::begin() {
-    	if (Ego.isArray() || Ego.isObject())
-    		return iterator(mNode->children.head);
-    	return end();
+        return ((const Object&) Ego).begin();
     }
 
     Object::const_iterator Object::begin() const {
+        if (auto t = tape()) {
+            auto tag = t->tag(mIdx);
+            if ((tag == '[' || tag == '{') && t->next(mIdx) != mIdx+2)
+                return const_iterator(t, mIdx+1, tag == '{');
+            return end();
+        }
+
 		if (Ego.isArray() || Ego.isObject())
-			return const_iterator(mNode->children.head);
+			return const_iterator(Ego.node()->children.head);
 		return end();
     }
 
     Object& Object::operator=(suil::json::Object &&o) noexcept {
 		if (this != &o) {
-			if (mNode && !ref)
-				json_delete(mNode);
+		    if (!ref) {
+		        if (mTape)
+		            delete mTape;
+		        else if (mNode)
+		            json_delete(mNode);
+		    }
 			mNode = o.mNode;
+			mTape = o.mTape;
+			mIdx  = o.mIdx;
 			ref = o.ref;
 			o.mNode = nullptr;
+			o.mTape = nullptr;
 		}
 		return Ego;
 	}
 
     Object::~Object() {
-        if (mNode && !ref)
-            json_delete(mNode);
+        if (!ref) {
+            if (mTape)
+                delete mTape;
+            else if (mNode)
+                json_delete(mNode);
+        }
         mNode = nullptr;
+        mTape = nullptr;
+    }
+
+    void Stream::feed(const char *data, size_t len) {
+        if (mEnd)
+            throw Exception::create("json::Stream - cannot feed a finished stream");
+        compact();
+        mBuffer.append(data, len);
+    }
+
+    void Stream::compact() {
+        if (mPos == 0)
+            return;
+        /* only the value being framed is kept */
+        size_t rem = mBuffer.size()-mPos;
+        memmove(mBuffer.data(), mBuffer.data()+mPos, rem);
+        mBuffer.bseek(rem);
+        mBase += mPos;
+        mScan -= mPos;
+        if (mStart != NONE)
+            mStart -= mPos;
+        mPos = 0;
+    }
+
+    void Stream::unexpected(size_t i) const {
+        throw Exception::create("json::Stream - unexpected '", mBuffer.data()[i],
+                                "' at offset ", mBase+i);
+    }
+
+    bool Stream::frame(const char *&p, size_t& len) {
+        const char *data = mBuffer.data();
+        size_t size = mBuffer.size(), i = mScan, end{0};
+
+        while (i < size) {
+            char c = data[i];
+            if (mStart == NONE) {
+                if (is_space(c)) {
+                    i++;
+                    continue;
+                }
+
+                if (mFraming == Array) {
+                    /* the elements of the array are framed, not the array */
+                    switch (mState) {
+                        case Open:
+                            if (c != '[')
+                                unexpected(i);
+                            mState = First;
+                            i++;
+                            continue;
+                        case First:
+                        case Next:
+                            if (c == ']') {
+                                mState = Closed;
+                                i++;
+                                continue;
+                            }
+                            if (mState == Next) {
+                                if (c != ',')
+                                    unexpected(i);
+                                mState = Element;
+                                i++;
+                                continue;
+                            }
+                            break;
+                        case Closed:
+                            unexpected(i);
+                        default:
+                            break;
+                    }
+                }
+
+                if (c == ',' || c == ']' || c == '}' || c == ':')
+                    unexpected(i);
+                mStart = i++;
+                mDepth = 0;
+                mScalar = false;
+                if (c == '"')
+                    mString = true;
+                else if (c == '{' || c == '[')
+                    mDepth = 1;
+                else
+                    mScalar = true;
+                continue;
+            }
+
+            if (mString) {
+                if (mEscape) {
+                    mEscape = false;
+                    i++;
+                    continue;
+                }
+                while (i < size && data[i] != '"' && data[i] != '\\')
+                    i++;
+                if (i == size)
+                    break;
+                if (data[i++] == '\\') {
+                    mEscape = true;
+                    continue;
+                }
+                mString = false;
+                if (mDepth == 0) {
+                    end = i;
+                    break;
+                }
+                continue;
+            }
+
+            if (mScalar) {
+                /* numbers and literals end at the next delimiter */
+                while (i < size && !is_space(data[i]) && !strchr(",]}[{\":", data[i]))
+                    i++;
+                if (i == size)
+                    break;
+                end = i;
+                break;
+            }
+
+            i++;
+            if (c == '"')
+                mString = true;
+            else if (c == '{' || c == '[')
+                mDepth++;
+            else if ((c == '}' || c == ']') && --mDepth == 0) {
+                end = i;
+                break;
+            }
+        }
+
+        if (end == 0 && mEnd && i == size && mStart != NONE) {
+            if (!mScalar)
+                throw Exception::create("json::Stream - truncated value at offset ", mBase+mStart);
+            end = size;
+        }
+
+        if (end == 0) {
+            mScan = i;
+            if (mLimit && mStart != NONE && (size-mStart) > mLimit)
+                throw Exception::create("json::Stream - value at offset ", mBase+mStart,
+                                        " exceeds the limit of ", mLimit, " bytes");
+            if (mEnd && mFraming == Array && mState != Open && mState != Closed)
+                throw Exception::create("json::Stream - unterminated array");
+            return false;
+        }
+
+        len = end-mStart;
+        if (mLimit && len > mLimit)
+            throw Exception::create("json::Stream - value at offset ", mBase+mStart,
+                                    " exceeds the limit of ", mLimit, " bytes");
+        p = data+mStart;
+        mPos = mScan = end;
+        mStart = NONE;
+        mState = Next;
+        return true;
+    }
+
+    namespace {
+
+        inline const char *skip_ws(const char *p, const char *e) {
+            while (p < e && is_space(*p))
+                p++;
+            return p;
+        }
+
+        inline const char *skip_str(const char *p, const char *e) {
+            for (p++; p < e; p++) {
+                if (*p == '\\')
+                    p++;
+                else if (*p == '"')
+                    return p+1;
+            }
+            return nullptr;
+        }
+    }
+
+    View::View(const char *data, size_t size) {
+        const char *e = data+size;
+        data = skip_ws(data, e);
+        while (e > data && is_space(e[-1]))
+            e--;
+        mRaw = String{data, (size_t)(e-data), false};
+    }
+
+    const char *View::skip(const char *p, const char *e) {
+        if (p >= e)
+            return nullptr;
+
+        if (*p == '"')
+            return skip_str(p, e);
+
+        if (*p == '{' || *p == '[') {
+            /* nested values are balanced, they are validated when decoded */
+            int depth{0};
+            while (p < e) {
+                switch (*p) {
+                    case '"':
+                        p = skip_str(p, e);
+                        if (p == nullptr)
+                            return nullptr;
+                        continue;
+                    case '{':
+                    case '[':
+                        depth++;
+                        break;
+                    case '}':
+                    case ']':
+                        if (--depth == 0)
+                            return p+1;
+                        break;
+                    default:
+                        break;
+                }
+                p++;
+            }
+            return nullptr;
+        }
+
+        /* numbers and literals end at the next delimiter */
+        const char *s = p;
+        while (p < e && !is_space(*p) && *p != ',' && *p != ']' && *p != '}' && *p != ':')
+            p++;
+        return p == s? nullptr : p;
+    }
+
+    bool View::scan() const {
+        if (mScanned)
+            return false;
+        if (!isObject() && !isArray()) {
+            mScanned = true;
+            return false;
+        }
+
+        const char *s = mRaw.data(), *e = s+mRaw.size();
+        const char *p = skip_ws(s + (mCursor? mCursor : 1), e);
+        auto invalid = [&]() {
+            return Exception::create("json::View - invalid JSON at offset ", (p-s));
+        };
+
+        bool obj = *s == '{';
+        if (p == e)
+            throw invalid();
+        if (*p == (obj? '}' : ']')) {
+            mScanned = true;
+            return false;
+        }
+        if (!mEntries.empty()) {
+            if (*p != ',')
+                throw invalid();
+            p = skip_ws(p+1, e);
+        }
+
+        entry_t en{};
+        if (obj) {
+            const char *q = (p < e && *p == '"')? skip_str(p, e) : nullptr;
+            if (q == nullptr)
+                throw invalid();
+            en.key  = (uint32_t) (p+1-s);
+            en.klen = (uint32_t) (q-p-2);
+            p = skip_ws(q, e);
+            if (p == e || *p != ':')
+                throw invalid();
+            p = skip_ws(p+1, e);
+        }
+
+        const char *q = skip(p, e);
+        if (q == nullptr)
+            throw invalid();
+        en.val  = (uint32_t) (p-s);
+        en.vlen = (uint32_t) (q-p);
+        mEntries.push_back(en);
+        mCursor = (uint32_t) (q-s);
+        return true;
+    }
+
+    View View::operator[](const char *key) const {
+        if (!isObject())
+            return View{};
+
+        size_t len = strlen(key);
+        const char *s = mRaw.data();
+        auto matches = [&](const entry_t& en) {
+            return en.klen == len && memcmp(s+en.key, key, len) == 0;
+        };
+
+        for (auto& en: mEntries) {
+            if (matches(en))
+                return View(s+en.val, en.vlen);
+        }
+        while (scan()) {
+            if (matches(mEntries.back()))
+                return View(s+mEntries.back().val, mEntries.back().vlen);
+        }
+        return View{};
+    }
+
+    View View::operator[](int index) const {
+        if (!isArray() || index < 0)
+            return View{};
+        while (mEntries.size() <= (size_t) index) {
+            if (!scan())
+                return View{};
+        }
+        auto& en = mEntries[index];
+        return View(mRaw.data()+en.val, en.vlen);
+    }
+
+    size_t View::count() const {
+        while (scan());
+        return mEntries.size();
+    }
+
+    View View::dup() const {
+        View v;
+        v.mRaw = mRaw.dup();
+        /* the entries are offsets into the value */
+        v.mEntries = mEntries;
+        v.mCursor  = mCursor;
+        v.mScanned = mScanned;
+        return v;
+    }
+
+    JsonTag View::type() const {
+        if (empty())
+            return JSON_NULL;
+        switch (mRaw.data()[0]) {
+            case '{':
+                return JSON_OBJECT;
+            case '[':
+                return JSON_ARRAY;
+            case '"':
+                return JSON_STRING;
+            case 't':
+            case 'f':
+                return JSON_BOOL;
+            case 'n':
+                return JSON_NULL;
+            default:
+                return JSON_NUMBER;
+        }
+    }
+
+    void View::operator|(ArrayEnumerator f) const {
+        if (!isArray())
+            throw Exception::create("json::View::enumerate - value is not a JSON array");
+        const char *s = mRaw.data();
+        for (size_t i = 0; i < mEntries.size() || scan(); i++) {
+            if (f(View(s+mEntries[i].val, mEntries[i].vlen)))
+                break;
+        }
+    }
+
+    void View::operator|(ObjectEnumerator f) const {
+        if (!isObject())
+            throw Exception::create("json::View::enumerate - value is not a JSON object");
+        const char *s = mRaw.data();
+        for (size_t i = 0; i < mEntries.size() || scan(); i++) {
+            auto& en = mEntries[i];
+            if (f(strview(s+en.key, en.klen), View(s+en.val, en.vlen)))
+                break;
+        }
     }
 }
 
 #ifdef unit_test
 #include <catch/catch.hpp>
+#include <chrono>
+#include <random>
 #include "tests/test_symbols.h"
 
 using namespace suil;
@@ -2155,49 +3860,49 @@ TEST_CASE("suil::json::Object", "[json][Object]")
 			auto obj = json::Object::decode(str.data(), size); // decode json object
 			REQUIRE(size == str.size());
             auto tmp = obj["one"];
-            REQUIRE_FALSE(tmp.mNode == nullptr);
+            REQUIRE_FALSE(tmp.mTape == nullptr);
             REQUIRE(tmp.ref);
             REQUIRE(1 == (int) tmp);
             tmp = obj["bool"];
-            REQUIRE_FALSE(tmp.mNode == nullptr);
+            REQUIRE_FALSE(tmp.mTape == nullptr);
             REQUIRE(tmp.ref);
             REQUIRE((bool) tmp);
             tmp = obj["str"];
-            REQUIRE_FALSE(tmp.mNode == nullptr);
+            REQUIRE_FALSE(tmp.mTape == nullptr);
             REQUIRE(tmp.ref);
-            REQUIRE(strcmp(tmp.mNode->string_, "Cali") == 0);
+            REQUIRE(strcmp((const char *) tmp, "Cali") == 0);
             auto obj1 = obj["obj"];
-            REQUIRE_FALSE(obj1.mNode == nullptr);
+            REQUIRE_FALSE(obj1.mTape == nullptr);
             REQUIRE(obj1.ref);
-            REQUIRE(obj1.mNode->tag == JsonTag::JSON_OBJECT);
+            REQUIRE(obj1.type() == JsonTag::JSON_OBJECT);
 
             tmp = obj1["two"];
-            REQUIRE_FALSE(tmp.mNode == nullptr);
+            REQUIRE_FALSE(tmp.mTape == nullptr);
             REQUIRE(tmp.ref);
             REQUIRE(2 == (int) tmp);
             tmp = obj1["bool"];
-            REQUIRE_FALSE(tmp.mNode == nullptr);
+            REQUIRE_FALSE(tmp.mTape == nullptr);
             REQUIRE(tmp.ref);
             REQUIRE_FALSE((bool) tmp);
             tmp = obj1["str"];
-            REQUIRE_FALSE(tmp.mNode == nullptr);
+            REQUIRE_FALSE(tmp.mTape == nullptr);
             REQUIRE(tmp.ref);
-            REQUIRE(strcmp(tmp.mNode->string_, "Cali") == 0);
+            REQUIRE(strcmp((const char *) tmp, "Cali") == 0);
 
             auto arr = obj["arr"];
-            REQUIRE_FALSE(arr.mNode == nullptr);
+            REQUIRE_FALSE(arr.mTape == nullptr);
             tmp = arr[0];
-            REQUIRE_FALSE(tmp.mNode == nullptr);
+            REQUIRE_FALSE(tmp.mTape == nullptr);
             REQUIRE(tmp.ref);
             REQUIRE(1 == (int) tmp);
             tmp = arr[1];
-            REQUIRE_FALSE(tmp.mNode == nullptr);
+            REQUIRE_FALSE(tmp.mTape == nullptr);
             REQUIRE(tmp.ref);
             REQUIRE((bool) tmp);
             tmp = arr[2];
-            REQUIRE_FALSE(tmp.mNode == nullptr);
+            REQUIRE_FALSE(tmp.mTape == nullptr);
             REQUIRE(tmp.ref);
-            REQUIRE(strcmp(tmp.mNode->string_, "Cali") == 0);
+            REQUIRE(strcmp((const char *) tmp, "Cali") == 0);
 
             /* !!!NOTE!!! this is really important */
             size = str2.size()-9;
@@ -2364,5 +4069,921 @@ TEST_CASE("suil::json::Object", "[json][Object]")
     }
 }
 
+TEST_CASE("suil::json::Tape", "[json][Tape]")
+{
+    auto decode = [](const char *str) {
+        size_t size{strlen(str)};
+        auto obj = json::Object::decode(str, size);
+        REQUIRE(size == strlen(str));
+        return obj;
+    };
+
+    SECTION("decoded documents are laid on a tape") {
+        auto obj = decode(R"( {"a":[1,[2,3],{"b":null}],"s":"Cali","t":true,"f":false} )");
+        REQUIRE(obj.mTape != nullptr);
+        REQUIRE_FALSE(obj.ref);
+        auto& t = *obj.mTape;
+        CHECK(t.tag(0) == '{');
+        CHECK(t.count(0) == 4);
+        CHECK(t.next(0) == t.len);
+        CHECK(t.tag(t.len-1) == '}');
+        CHECK(t.payload(t.len-1) == 0);
+
+        // nested values are skipped without visiting them
+        auto a = obj["a"];
+        CHECK(a.mIdx == 2);
+        CHECK(t.count(a.mIdx) == 3);
+        CHECK(t.tag(t.next(a.mIdx)) == '"');
+        CHECK(strcmp(t.str(t.next(a.mIdx)), "s") == 0);
+        CHECK(t.size(t.next(a.mIdx)) == 1);
+        CHECK((int) a[1][1] == 3);
+        CHECK(a[2]["b"].isNull());
+        CHECK_FALSE(a[2]["b"].mTape == nullptr);
+        CHECK(a[3].mTape == nullptr);
+        CHECK(a[-1].mTape == nullptr);
+        CHECK(obj["x"].mTape == nullptr);
+        CHECK(obj["x"].isNull());
+        CHECK(obj[String{"s"}].isString());
+        CHECK((String) obj["s"] == "Cali");
+        CHECK((bool) obj["t"]);
+        CHECK(obj["f"].isBool());
+        CHECK_FALSE((bool) obj["f"]);
+        CHECK_THROWS(obj[0]);
+        CHECK_THROWS(a["b"]);
+        CHECK_THROWS((double) obj["s"]);
+        CHECK_THROWS((const char *) obj["t"]);
+
+        CHECK_FALSE(obj.empty());
+        CHECK(decode("{}").empty());
+        CHECK(decode("[ ]").empty());
+        CHECK(decode(R"("")").empty());
+        CHECK(decode("null").empty());
+        CHECK(decode("false").empty());
+        CHECK_FALSE(decode("0").empty());
+    }
+
+    SECTION("strings are unescaped into the arena") {
+        auto obj = decode(R"(["tab\tquote\"slash\/", "é😀", "cafÃ", "日本"])");
+        CHECK(strcmp((const char *) obj[0], "tab\tquote\"slash/") == 0);
+        CHECK(strcmp((const char *) obj[1], "\xC3\xA9\xF0\x9F\x98\x80") == 0);
+        CHECK(obj.mTape->size(obj[1].mIdx) == 6);
+        CHECK(strcmp((const char *) obj[3], "日本") == 0);
+
+        size_t size;
+        for (auto bad: {R"("\u0000")", R"("\x")", R"("\ud83d")", "\"\x01\"", "\"\xC3\"", R"("open)"}) {
+            size = strlen(bad);
+            CHECK_THROWS(json::Object::decode(bad, size));
+        }
+    }
+
+    SECTION("numbers are decoded exactly") {
+        auto obj = decode("[0,-0,12,-45.5,3.14159,1e3,2.5E-3,1234567890123456789,0.1,1.7976931348623157e308,5e-324]");
+        CHECK((double) obj[0] == 0.0);
+        CHECK((double) obj[1] == 0.0);
+        CHECK((int) obj[2] == 12);
+        CHECK((double) obj[3] == -45.5);
+        CHECK((double) obj[4] == 3.14159);
+        CHECK((double) obj[5] == 1000.0);
+        CHECK((double) obj[6] == 0.0025);
+        CHECK((double) obj[7] == strtod("1234567890123456789", nullptr));
+        CHECK((double) obj[8] == 0.1);
+        CHECK((double) obj[9] == 1.7976931348623157e308);
+        CHECK((double) obj[10] == 5e-324);
+
+        size_t size;
+        for (auto bad: {"01", "-", "1.", ".5", "1e", "+1", "1.e5"}) {
+            size = strlen(bad);
+            bool failed{false};
+            try {
+                json::Object::decode(bad, size);
+                failed = size != strlen(bad);
+            }
+            catch (...) {
+                failed = true;
+            }
+            CHECK(failed);
+        }
+    }
+
+    SECTION("invalid documents are rejected") {
+        size_t size;
+        for (auto bad: {"", "  ", "[1,]", "{\"a\":1,}", "[1 2]", "{\"a\" 1}", "{1:2}",
+                        "[", "{\"a\":", "tru", "nul", "[true", "]"}) {
+            size = strlen(bad);
+            CHECK_THROWS(json::Object::decode(bad, size));
+        }
+
+        std::string deep(json::Tape::MAX_DEPTH+1, '[');
+        deep.append(json::Tape::MAX_DEPTH+1, ']');
+        size = deep.size();
+        CHECK_THROWS(json::Object::decode(deep.data(), size));
+        size = deep.size() - 2;
+        CHECK_NOTHROW(json::Object::decode(&deep[1], size));
+    }
+
+    SECTION("decoding is bounded by the given size") {
+        const char *str = R"({"a":123}{"b":4})";
+        size_t size{9};
+        auto obj = json::Object::decode(str, size);
+        CHECK(size == 9);
+        CHECK((int) obj["a"] == 123);
+        size = 7;
+        CHECK_THROWS(json::Object::decode(str, size));
+        // numbers and literals ending on the boundary
+        size = 2;
+        CHECK((int) json::Object::decode("12345", size) == 12);
+        size = 4;
+        CHECK((bool) json::Object::decode("truer", size));
+    }
+
+    SECTION("decoded documents are enumerable and encodable") {
+        const char *str = R"({"one":1,"arr":[true,"Cali",{"x":[]}],"obj":{"two":2.5,"n":null},"e":{}})";
+        auto obj = decode(str);
+        CHECK(json::encode(obj) == str);
+        CHECK(json::encode(obj["arr"]) == R"([true,"Cali",{"x":[]}])");
+
+        std::vector<std::string> keys;
+        for (const auto [key, val]: obj) {
+            keys.emplace_back(key);
+            CHECK_FALSE(val.isNull());
+        }
+        CHECK((keys == std::vector<std::string>{"one", "arr", "obj", "e"}));
+
+        int count{0};
+        for (const auto [key, val]: obj["arr"]) {
+            CHECK(key == nullptr);
+            count++;
+        }
+        CHECK(count == 3);
+        for (const auto [key, val]: obj["e"])
+            count++;
+        CHECK(count == 3);
+
+        count = 0;
+        obj["obj"] | [&](const char *key, json::Object val) {
+            CHECK(utils::strmatchany(key, "two", "n"));
+            return ++count == 2;
+        };
+        CHECK(count == 2);
+        obj["arr"] | [&](json::Object val) {
+            count++;
+            return false;
+        };
+        CHECK(count == 5);
+
+        auto v = (std::vector<int>) decode("[1,2,3]");
+        CHECK((v == std::vector<int>{1, 2, 3}));
+    }
+
+    SECTION("members of large objects are found through an index") {
+        OBuffer ob;
+        ob << "{";
+        for (int i = 0; i < 100; i++)
+            ob << (i? ",": "") << "\"k" << i << "\":" << i;
+        ob << ",\"k7\":700}";
+        std::string doc(ob.data(), ob.size());
+        auto obj = decode(doc.c_str());
+
+        CHECK(obj.mTape->indices.empty());
+        CHECK((int) obj["k99"] == 99);
+        CHECK(obj.mTape->indices.size() == 1);
+        for (int i = 0; i < 100; i++) {
+            CHECK((int) obj[suil::String{"k" + std::to_string(i)}] == i);
+        }
+        // duplicates resolve to the first member, keys are matched exactly
+        CHECK((int) obj["k7"] == 7);
+        CHECK(obj["k"].empty());
+        CHECK(obj["k100"].empty());
+        CHECK((int) obj[suil::String{"k1"}] == 1);
+
+        // the tree is indexed on the first lookup past the threshold
+        obj.set("k100", 100);
+        auto node = obj.node();
+        CHECK(node->children.index == nullptr);
+        CHECK((int) obj["k3"] == 3);
+        CHECK(node->children.index == nullptr);
+        CHECK((int) obj["k50"] == 50);
+        REQUIRE(node->children.index != nullptr);
+        CHECK((int) obj["k7"] == 7);
+        CHECK((int) obj["k100"] == 100);
+        CHECK(obj["k10"].mNode->key == std::string("k10"));
+        CHECK(obj[suil::String{"k10"}].mNode->key == std::string("k10"));
+
+        // appended members are added to the index
+        obj.set("added", true);
+        CHECK(node->children.index != nullptr);
+        CHECK((bool) obj["added"]);
+
+        // removing members drops the index
+        json_delete(json_find_member(node, "k50"));
+        CHECK(node->children.index == nullptr);
+        CHECK(obj["k50"].empty());
+        CHECK((int) obj["k51"] == 51);
+        CHECK(node->children.index != nullptr);
+    }
+
+    SECTION("keys are matched exactly") {
+        auto obj = decode(R"({"abc":1,"ab":2,"names":[3]})");
+        for (int thawed = 0; thawed < 2; thawed++) {
+            // thawed objects are looked up in the tree
+            REQUIRE((obj.mTape->root != nullptr) == (thawed == 1));
+            CHECK((int) obj["ab"] == 2);
+            CHECK((int) obj[suil::String{"ab"}] == 2);
+            CHECK((int) obj[suil::String{"abc"}] == 1);
+            CHECK(obj["a"].empty());
+            CHECK(obj[suil::String{"a"}].empty());
+            CHECK(obj[suil::String{"name"}].empty());
+            CHECK(obj[suil::String{"abcd"}].empty());
+            obj.set("other", true);
+        }
+    }
+
+    SECTION("decoded documents are converted to a tree when modified") {
+        auto obj = decode(R"({"one":1,"arr":[true],"obj":{"two":2}})");
+        auto arr = obj["arr"];
+        auto inner = obj["obj"];
+        REQUIRE(obj.mTape->root == nullptr);
+
+        // modifying a nested value converts the whole document
+        arr.push("Cali");
+        REQUIRE(obj.mTape->root != nullptr);
+        CHECK(arr.node() == obj.mTape->nodes[arr.mIdx]);
+        inner.set("three", 3);
+        obj.set("copy", decode(R"([1,{"a":"b"}])"));
+        CHECK(json::encode(obj) ==
+              R"({"one":1,"arr":[true,"Cali"],"obj":{"two":2,"three":3},"copy":[1,{"a":"b"}]})");
+
+        // values of a modified document are read from the tree
+        CHECK((int) obj["obj"]["three"] == 3);
+        CHECK(obj["arr"][1].mNode != nullptr);
+
+        // decoded values are copied when added to another document
+        json::Object other(json::Obj, "arr", obj["arr"], "copy", obj["copy"][1]);
+        CHECK(json::encode(other) == R"({"arr":[true,"Cali"],"copy":{"a":"b"}})");
+        auto doc = decode(R"({"k":[1,2]})");
+        other.set("doc", doc["k"]);
+        CHECK_THROWS(other.push(1));
+    }
+}
+
+TEST_CASE("suil::json structural index", "[json][Tape]")
+{
+    using namespace suil::json;
+
+    // the index computed one character at a time
+    auto reference = [](const std::string& in, size_t& ctrl) {
+        std::vector<uint32_t> idx;
+        bool inString{false}, escape{false}, scalar{false};
+        ctrl = SIZE_MAX;
+        for (uint32_t i = 0; i < in.size(); i++) {
+            auto c = (uint8_t) in[i];
+            bool escaped{escape};
+            escape = (c == '\\') && !escaped;
+            bool quote = (c == '"') && !escaped;
+            if (inString) {
+                if (quote) {
+                    inString = false;
+                    idx.push_back(i);
+                }
+                else if (c < 0x20 && ctrl == SIZE_MAX)
+                    ctrl = i;
+                scalar = false;
+            }
+            else if (quote) {
+                inString = true;
+                idx.push_back(i);
+                scalar = false;
+            }
+            else if (strchr("{}[]:,", c) && c != 0) {
+                idx.push_back(i);
+                scalar = false;
+            }
+            else if (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+                scalar = false;
+            }
+            else {
+                if (!scalar)
+                    idx.push_back(i);
+                scalar = true;
+            }
+        }
+        return idx;
+    };
+
+    auto scan = [](const classifier_t& c, const std::string& in, size_t& ctrl, size_t& utf8) {
+        std::vector<uint32_t> idx(scanner_t::CHUNK*64), out;
+        std::vector<block_t> blocks(scanner_t::CHUNK);
+        scanner_t sc((const uint8_t *) in.data(), (uint32_t) in.size(), idx.data(), blocks.data(), c.classify);
+        for (uint32_t pos = sc.next(); pos < in.size(); pos = sc.next())
+            out.push_back(pos);
+        ctrl = sc.ctrlError;
+        utf8 = sc.utf8Error;
+        return out;
+    };
+
+    auto decodes = [](const std::string& str) {
+        size_t size{str.size()};
+        try {
+            json::Object::decode(str.data(), size);
+            return true;
+        }
+        catch (...) {
+            return false;
+        }
+    };
+
+    SECTION("all the classifiers compute the same index") {
+        const char alphabet[] = "\"\"\\\\{}[]:,  \t\nab1.-";
+        const char *utf8[] = {"\xC3\xA9", "\xE2\x82\xAC", "\xF0\x9F\x98\x80", "\xC3", "\xED\xA0\x80", "\xFF", "\x01"};
+        std::mt19937 rng(42);
+        for (size_t len: {0, 1, 15, 63, 64, 65, 127, 200, 4095, 4096, 4097, 9000}) {
+            for (int round = 0; round < 8; round++) {
+                std::string in;
+                while (in.size() < len) {
+                    auto r = rng() % 64;
+                    if (r < 2)
+                        in += utf8[rng() % 7];
+                    else
+                        in += alphabet[rng() % (sizeof(alphabet)-1)];
+                }
+                in.resize(len);
+
+                size_t ctrl;
+                auto expected = reference(in, ctrl);
+                bool valid = utf8_valid(in.data(), in.data()+in.size());
+                for (auto& c: CLASSIFIERS) {
+                    if (!c.supported)
+                        continue;
+                    size_t scanCtrl, scanUtf8;
+                    CHECK(scan(c, in, scanCtrl, scanUtf8) == expected);
+                    CHECK(scanCtrl == ctrl);
+                    CHECK((scanUtf8 == SIZE_MAX) == valid);
+                }
+            }
+        }
+    }
+
+    SECTION("UTF-8 is validated across block boundaries") {
+        auto saved = CLASSIFY;
+        for (auto& c: CLASSIFIERS) {
+            if (!c.supported)
+                continue;
+            CLASSIFY = c.classify;
+            for (size_t off: {0, 13, 14, 15, 29, 30, 31, 61, 62, 63, 64}) {
+                std::string pad(off, 'x');
+                for (auto good: {"\xC3\xA9", "\xE2\x82\xAC", "\xF0\x9F\x98\x80", "\xEF\xBF\xBD", "\xF4\x8F\xBF\xBF"})
+                    CHECK(decodes("\"" + pad + good + "\""));
+                for (auto bad: {"\x80", "\xC0\xAF", "\xC3", "\xE0\x80\xAF", "\xED\xA0\x80", "\xE2\x82",
+                                "\xF4\x90\x80\x80", "\xF0\x9F\x98", "\xF8\x88\x80\x80\x80", "\xFF"})
+                    CHECK_FALSE(decodes("\"" + pad + bad + "\""));
+            }
+        }
+        CLASSIFY = saved;
+    }
+
+    SECTION("strings spanning multiple chunks are decoded") {
+        std::string value, encoded;
+        for (int i = 0; i < 10000; i++) {
+            char c = (char) ('a' + i % 26);
+            value += c;
+            encoded += c;
+            if (i % 61 == 0) {
+                // escapes crossing the block boundaries
+                value += "\"\\";
+                encoded += "\\\"\\\\";
+            }
+        }
+
+        auto saved = CLASSIFY;
+        for (auto& c: CLASSIFIERS) {
+            if (!c.supported)
+                continue;
+            CLASSIFY = c.classify;
+            std::string str = "{\"k\": [\"" + encoded + "\", 1]}";
+            size_t size{str.size()};
+            auto obj = json::Object::decode(str.data(), size);
+            CHECK(size == str.size());
+            CHECK(value == (const char *) obj["k"][0]);
+            CHECK((int) obj["k"][1] == 1);
+        }
+        CLASSIFY = saved;
+    }
+
+    SECTION("errors after the decoded value are ignored") {
+        // the input is scanned ahead of the value being decoded
+        size_t size;
+        for (auto str: {"{\"a\":1}\"\x01\"", "{\"a\":1}\xFF", "{\"a\":1}\xE2\x82"}) {
+            size = strlen(str);
+            auto obj = json::Object::decode(str, size);
+            CHECK(size == 7);
+            CHECK((int) obj["a"] == 1);
+        }
+    }
+}
+
+TEST_CASE("suil::json::encode into a buffer", "[json][encode]")
+{
+    typedef decltype(iod::D(
+            tprop(a,           std::string),
+            tprop(b,           std::vector<int>),
+            tprop(c,           iod::Nullable<std::vector<String>>)
+    )) IodType;
+
+    IodType value{};
+    value.a = "Hello";
+    for (int i = 0; i < 10; i++)
+        value.b.push_back(i);
+
+    SECTION("values are appended to the buffer") {
+        OBuffer ob(16);
+        ob << "data=";
+        json::encode(value, ob);
+        CHECK(strview(ob) == "data=" + json::encode(value));
+        CHECK(json::encode(value) == R"({"a":"Hello","b":[0,1,2,3,4,5,6,7,8,9],"c":null})");
+
+        ob.reset(0, true);
+        ob << value;
+        CHECK(strview(ob) == json::encode(value));
+
+        // numbers are encoded with the shortest digits
+        CHECK(json::encode(std::vector<double>{0.1, 1e21, -2.5, 3}) == "[0.1,1e+21,-2.5,3]");
+        CHECK(json::encode(std::vector<float>{1.1f, NAN}) == "[1.1,null]");
+        CHECK(json::encode(std::vector<int64_t>{INT64_MIN, 0}) == "[-9223372036854775808,0]");
+        CHECK(json::encode(json::Object(json::Arr, 0.3, 1e-7, 12.0)) == "[0.3,1e-7,12]");
+
+        json::Object obj(json::Obj, "a", 1, "b", "two");
+        ob.reset(0, true);
+        json::encode(obj, ob);
+        CHECK(strview(ob) == json::encode(obj));
+    }
+
+    SECTION("the buffer is reserved from the estimated size") {
+        std::vector<String> strs;
+        for (int i = 0; i < 2000; i++)
+            strs.emplace_back(utils::catstr("string number ", i));
+        value.c = std::vector<String>(strs);
+
+        auto sz = json::estimate(value);
+        auto expected = json::encode(value);
+        CHECK(sz >= expected.size());
+        CHECK(sz < 2 * expected.size());
+
+        OBuffer ob(0);
+        json::encode(value, ob);
+        CHECK(ob.size() == expected.size());
+        CHECK(strview(ob) == expected);
+
+        // encoding beyond the estimate grows the buffer
+        OBuffer small(0);
+        json::encode(std::vector<json::Object>(100, json::Object(json::Arr, strs[0], strs[1999])), small);
+        CHECK(small.size() == json::encode(std::vector<json::Object>(100, json::Object(json::Arr, strs[0], strs[1999]))).size());
+    }
+}
+
+TEST_CASE("suil::json::Stream", "[json][Stream]")
+{
+    typedef decltype(iod::D(
+            tprop(a,           int),
+            tprop(b,           std::string)
+    )) Record;
+
+    // feeds the input in chunks of the given size, decoding values as they are available
+    auto decodeAll = [](json::Stream& js, const std::string& in, size_t chunk) {
+        std::vector<std::string> out;
+        json::Object obj;
+        for (size_t i = 0; i < in.size(); i += chunk) {
+            js.feed(&in[i], std::min(chunk, in.size()-i));
+            while (js.next(obj))
+                out.push_back(json::encode(obj));
+        }
+        js.finish();
+        while (js.next(obj))
+            out.push_back(json::encode(obj));
+        return out;
+    };
+
+    SECTION("newline delimited values are decoded from chunks of any size") {
+        std::string in{"{\"a\":1,\"b\":\"x\\\"}\"}\n[1,[2,{}]]\n\"s\\\\\"\n12.5\ntrue\n  null 7"};
+        std::vector<std::string> expected{R"({"a":1,"b":"x\"}"})", "[1,[2,{}]]", R"("s\\")",
+                                          "12.5", "true", "null", "7"};
+        for (size_t chunk: {1, 2, 3, 7, 64}) {
+            json::Stream js;
+            CHECK(decodeAll(js, in, chunk) == expected);
+        }
+
+        json::Stream js;
+        std::string lines;
+        for (int i = 0; i < 100; i++)
+            lines += utils::catstr("{\"a\":", i, ",\"b\":\"record ", i, "\"}\n").peek();
+        Record rec;
+        int count{0};
+        for (size_t i = 0; i < lines.size(); i += 13) {
+            js.feed(&lines[i], std::min<size_t>(13, lines.size()-i));
+            while (js.next(rec)) {
+                CHECK(rec.a == count);
+                CHECK(rec.b == "record " + std::to_string(count));
+                count++;
+            }
+            // only the value being decoded is buffered
+            CHECK(js.buffered() < 40);
+        }
+        CHECK(count == 100);
+    }
+
+    SECTION("the elements of a top level array are decoded one at a time") {
+        std::string in{" [ {\"a\":1}, \"two\" ,3,[4] ,null]  "};
+        std::vector<std::string> expected{R"({"a":1})", R"("two")", "3", "[4]", "null"};
+        for (size_t chunk: {1, 4, 100}) {
+            json::Stream js(json::Stream::Array);
+            CHECK(decodeAll(js, in, chunk) == expected);
+        }
+
+        json::Stream empty(json::Stream::Array);
+        CHECK(decodeAll(empty, "[ ]", 1).empty());
+        json::Stream none(json::Stream::Array);
+        CHECK(decodeAll(none, "", 1).empty());
+    }
+
+    SECTION("invalid streams are rejected") {
+        auto fails = [&](const char *in, json::Stream::Framing framing) {
+            json::Stream js(framing);
+            try {
+                decodeAll(js, in, 3);
+                return false;
+            }
+            catch (...) {
+                return true;
+            }
+        };
+        CHECK(fails("{\"a\":1", json::Stream::Values));
+        CHECK(fails("\"abc", json::Stream::Values));
+        CHECK(fails("{} }", json::Stream::Values));
+        CHECK(fails("{\"a\":tru}", json::Stream::Values));
+        CHECK(fails("{}", json::Stream::Array));
+        CHECK(fails("[1,2", json::Stream::Array));
+        CHECK(fails("[1,]", json::Stream::Array));
+        CHECK(fails("[1 2]", json::Stream::Array));
+        CHECK(fails("[1] 2", json::Stream::Array));
+
+        json::Stream js(json::Stream::Values, 16);
+        json::Object obj;
+        js.feed("{\"a\":1} ", 8);
+        CHECK(js.next(obj));
+        js.feed("{\"b\":\"0123456789", 16);
+        CHECK_FALSE(js.next(obj));
+        js.feed("ab", 2);
+        CHECK_THROWS(js.next(obj));
+    }
+
+    SECTION("values are read from a source") {
+        // a source returning a few bytes per read
+        struct Source {
+            bool read(void *buf, size_t& len, int64_t) {
+                len = std::min({len, (size_t) 5, data.size()-pos});
+                memcpy(buf, &data[pos], len);
+                pos += len;
+                return true;
+            }
+            std::string data;
+            size_t      pos{0};
+        } src{"[{\"a\":1,\"b\":\"one\"},{\"a\":2,\"b\":\"two\"},{\"a\":3,\"b\":\"three\"}]"};
+
+        json::Stream js(json::Stream::Array);
+        Record rec;
+        std::vector<std::string> names;
+        while (js.read(src, rec))
+            names.push_back(rec.b);
+        CHECK((names == std::vector<std::string>{"one", "two", "three"}));
+        CHECK_FALSE(js.fill(src));
+    }
+}
+
+TEST_CASE("suil::json::View", "[json][View]")
+{
+    typedef decltype(iod::D(
+            tprop(a,           int),
+            tprop(b,           std::string)
+    )) Inner;
+
+    std::string doc{R"( {"a": 10, "b" : "Hello \"World\"", "c": [1, {"x": "]}"}, [], true],
+                         "d": {"a": 2, "b": "two"}, "e": null, "f": -1.5e2, "g": false } )"};
+
+    SECTION("members are located and decoded on access") {
+        json::View v(doc.data(), doc.size());
+        CHECK(v.isObject());
+        CHECK(v.mEntries.empty());
+
+        CHECK(v["a"].as<int>() == 10);
+        // only the members up to the one accessed are located
+        CHECK(v.mEntries.size() == 1);
+        CHECK(v["b"].as<std::string>() == "Hello \"World\"");
+        CHECK(v["b"].raw() == R"("Hello \"World\"")");
+        CHECK(v["f"].as<double>() == -150.0);
+        CHECK(v.mEntries.size() == 6);
+        CHECK(v["a"].as<int>() == 10);
+        CHECK(v.mEntries.size() == 6);
+
+        CHECK(v["c"].isArray());
+        CHECK(v["c"].count() == 4);
+        CHECK(v["c"][1]["x"].as<std::string>() == "]}");
+        CHECK(v["c"][2].raw() == "[]");
+        CHECK(v["c"][3].as<bool>());
+        CHECK(v["c"][4].empty());
+        CHECK(v["g"].isBool());
+        CHECK_FALSE(v["g"].as<bool>());
+        CHECK(v["e"].isNull());
+        CHECK(v["e"].as<int>() == 0);
+        CHECK(v["missing"].empty());
+        CHECK(v["a"]["x"].empty());
+        CHECK(v["c"].type() == JSON_ARRAY);
+        CHECK(v["f"].type() == JSON_NUMBER);
+
+        // only JSON whitespace is skipped, bytes past 0x7f are never whitespace
+        std::string ws{"\t\r\n [\"\xc3\xa0\", 1] \n"};
+        json::View w(ws.data(), ws.size());
+        CHECK(w.raw() == "[\"\xc3\xa0\", 1]");
+        CHECK(w[0].as<std::string>() == "\xc3\xa0");
+        CHECK(w[1].as<int>() == 1);
+
+        auto inner = v["d"].as<Inner>();
+        CHECK(inner.a == 2);
+        CHECK(inner.b == "two");
+        CHECK(v.count() == 7);
+    }
+
+    SECTION("values are enumerated") {
+        json::View v(doc.data(), doc.size());
+        std::vector<std::string> keys;
+        v | [&](const strview& key, json::View) {
+            keys.emplace_back(key);
+            return false;
+        };
+        CHECK((keys == std::vector<std::string>{"a", "b", "c", "d", "e", "f", "g"}));
+
+        std::vector<std::string> raws;
+        v["c"] | [&](json::View e) {
+            raws.emplace_back(e.raw());
+            return raws.size() == 2;
+        };
+        CHECK((raws == std::vector<std::string>{"1", R"({"x": "]}"})"}));
+    }
+
+    SECTION("views are captured by and encoded from iod objects") {
+        typedef decltype(iod::D(
+                tprop(a,           int),
+                tprop(c,           json::View),
+                tprop(d,           json::View),
+                tprop(t,           json::View)
+        )) Partial;
+
+        std::string str{R"({"a":1,"c":[1, 2,{"x":"}"}],"d" : {"a":2,"b":"two"} ,"t":null})"};
+        Partial p;
+        json::decode(str, p);
+        CHECK(p.a == 1);
+        CHECK(p.c.raw() == R"([1, 2,{"x":"}"}])");
+        CHECK(p.d["b"].as<std::string>() == "two");
+        // null values are not captured
+        CHECK(p.t.empty());
+        // the values are forwarded as they were received
+        CHECK(json::encode(p) == R"({"a":1,"c":[1, 2,{"x":"}"}],"d":{"a":2,"b":"two"},"t":null})");
+        OBuffer ob(0);
+        json::encode(p, ob);
+        CHECK(strview(ob) == json::encode(p));
+
+        // a copy outlives the decoded buffer
+        auto d = p.d.dup();
+        str.assign(str.size(), ' ');
+        CHECK(d["a"].as<int>() == 2);
+    }
+
+    SECTION("invalid values are rejected when accessed") {
+        for (auto str: {R"({"a" 1})", R"({"a":1 "b":2})", R"({a:1})", R"({"a":"1)", R"([1,2)"}) {
+            json::View v(String{str});
+            CHECK_THROWS(v.count());
+        }
+        const char *t = "\"abc";
+        CHECK(json::View::skip(t, t+4) == nullptr);
+        const char *s = "[1,[2,\"]\"]]  ";
+        CHECK(json::View::skip(s, s+strlen(s)) == s+11);
+        CHECK(json::View::skip(s, s+10) == nullptr);
+    }
+}
+
+TEST_CASE("suil::json::Stream benchmark", "[.][benchmark][json]")
+{
+    using Clock = std::chrono::steady_clock;
+    typedef decltype(iod::D(
+            tprop(a,           int),
+            tprop(b,           std::string),
+            tprop(c,           double)
+    )) Record;
+
+    OBuffer ob(1024*1024);
+    ob << "[";
+    for (int i = 0; i < 20000; i++) {
+        if (i) ob << ",";
+        ob << "{\"a\":" << i << ",\"b\":\"user " << i << "\",\"c\":" << i << "}";
+    }
+    ob << "]";
+    std::string str(ob.data(), ob.size());
+    const int rounds = 10;
+
+    auto start = Clock::now();
+    size_t total{0};
+    for (int i = 0; i < rounds; i++) {
+        std::vector<Record> all;
+        json::decode(str, all);
+        total += all.size();
+    }
+    auto wholeTime = Clock::now() - start;
+
+    start = Clock::now();
+    size_t peak{0};
+    for (int i = 0; i < rounds; i++) {
+        json::Stream js(json::Stream::Array);
+        Record rec;
+        for (size_t pos = 0; pos < str.size(); pos += 4096) {
+            js.feed(&str[pos], std::min<size_t>(4096, str.size()-pos));
+            peak = std::max(peak, js.buffered());
+            while (js.next(rec))
+                total--;
+        }
+    }
+    auto streamTime = Clock::now() - start;
+    REQUIRE(total == 0);
+
+    WARN("decoding " << str.size() << " bytes, " << rounds << " rounds, whole array: "
+         << std::chrono::duration_cast<std::chrono::microseconds>(wholeTime).count()/rounds
+         << " us, streamed in 4KB chunks: "
+         << std::chrono::duration_cast<std::chrono::microseconds>(streamTime).count()/rounds
+         << " us, peak buffered " << peak << " bytes");
+}
+
+TEST_CASE("suil::json::encode into a buffer benchmark", "[.][benchmark][json]")
+{
+    using Clock = std::chrono::steady_clock;
+    typedef decltype(iod::D(
+            tprop(a,           int),
+            tprop(b,           std::string),
+            tprop(c,           std::string),
+            tprop(d,           double),
+            tprop(e,           std::vector<std::string>)
+    )) User;
+
+    std::vector<User> users(5000);
+    for (int i = 0; i < 5000; i++) {
+        auto& u = users[i];
+        u.a = i;
+        u.b = "user " + std::to_string(i);
+        u.c = "user" + std::to_string(i) + "@example.com";
+        u.d = i * 1.25;
+        u.e = {"a", "b", "c"};
+    }
+    const int rounds = 20;
+
+    auto start = Clock::now();
+    size_t total{0};
+    for (int i = 0; i < rounds; i++) {
+        OBuffer body(0);
+        body << json::encode(users).c_str();
+        total += body.size();
+    }
+    auto stringTime = Clock::now() - start;
+
+    start = Clock::now();
+    for (int i = 0; i < rounds; i++) {
+        OBuffer body(0);
+        json::encode(users, body);
+        total -= body.size();
+    }
+    auto bufferTime = Clock::now() - start;
+    REQUIRE(total == 0);
+
+    WARN("encoding " << users.size() << " records, " << rounds << " rounds, through std::string: "
+         << std::chrono::duration_cast<std::chrono::microseconds>(stringTime).count()/rounds
+         << " us, into OBuffer: "
+         << std::chrono::duration_cast<std::chrono::microseconds>(bufferTime).count()/rounds << " us");
+}
+
+TEST_CASE("suil::json::Tape benchmark", "[.][benchmark][json]")
+{
+    using Clock = std::chrono::steady_clock;
+
+    // an API payload of about 1MB
+    OBuffer ob(1024*1024);
+    ob << "{\"status\":\"ok\",\"items\":[";
+    for (int i = 0; i < 5000; i++) {
+        if (i) ob << ",";
+        ob << "{\"id\":" << i << ",\"name\":\"user " << i << "\",\"email\":\"user"
+           << i << "@example.com\",\"score\":" << (i * 1.25)
+           << ",\"active\":" << ((i % 2)? "true" : "false")
+           << ",\"tags\":[\"a\",\"b\",\"c\"],\"address\":{\"city\":\"Nairobi\",\"zip\":\"00100\"}}";
+    }
+    ob << "]}";
+    std::string str(ob.data(), ob.size());
+    const int rounds = 20;
+
+    auto start = Clock::now();
+    for (int i = 0; i < rounds; i++) {
+        JsonNode *node = json_decode(str.data());
+        REQUIRE(node != nullptr);
+        json_delete(node);
+    }
+    auto nodeTime = Clock::now() - start;
+
+    WARN("payload: " << str.size() << " bytes, " << rounds << " rounds, JsonNode tree: "
+         << std::chrono::duration_cast<std::chrono::microseconds>(nodeTime).count()/rounds << " us");
+
+    auto saved = json::CLASSIFY;
+    for (auto& c: json::CLASSIFIERS) {
+        if (!c.supported)
+            continue;
+        json::CLASSIFY = c.classify;
+        start = Clock::now();
+        double total{0};
+        for (int i = 0; i < rounds; i++) {
+            size_t size{str.size()};
+            auto obj = json::Object::decode(str.data(), size);
+            total += (double) obj["items"][4999]["score"];
+        }
+        auto tapeTime = Clock::now() - start;
+        REQUIRE(total == rounds * 4999 * 1.25);
+
+        WARN("tape (" << c.name << "): "
+             << std::chrono::duration_cast<std::chrono::microseconds>(tapeTime).count()/rounds << " us");
+    }
+    json::CLASSIFY = saved;
+}
+
+TEST_CASE("suil::json::View benchmark", "[.][benchmark][json]")
+{
+    using Clock = std::chrono::steady_clock;
+    typedef decltype(iod::D(
+            tprop(a,           int),
+            tprop(b,           std::string),
+            tprop(c,           double),
+            tprop(d,           std::vector<std::string>)
+    )) Item;
+    typedef decltype(iod::D(
+            tprop(a,           int),
+            tprop(b,           std::string),
+            tprop(c,           std::vector<Item>)
+    )) Full;
+    typedef decltype(iod::D(
+            tprop(a,           int),
+            tprop(b,           std::string),
+            tprop(c,           json::View)
+    )) Partial;
+
+    // a request routed on two fields, the payload is forwarded untouched
+    OBuffer ob(1024*1024);
+    ob << "{\"a\":42,\"b\":\"route\",\"c\":[";
+    for (int i = 0; i < 5000; i++) {
+        if (i) ob << ",";
+        ob << "{\"a\":" << i << ",\"b\":\"user " << i << "\",\"c\":" << i << ",\"d\":[\"x\",\"y\"]}";
+    }
+    ob << "]}";
+    std::string str(ob.data(), ob.size());
+    const int rounds = 20;
+
+    auto start = Clock::now();
+    size_t total{0};
+    for (int i = 0; i < rounds; i++) {
+        Full f;
+        json::decode(str, f);
+        OBuffer out(0);
+        json::encode(f.c, out);
+        total += f.a + out.size();
+    }
+    auto fullTime = Clock::now() - start;
+
+    start = Clock::now();
+    for (int i = 0; i < rounds; i++) {
+        Partial p;
+        json::decode(str, p);
+        OBuffer out(0);
+        json::encode(p.c, out);
+        total -= p.a + out.size();
+    }
+    auto partialTime = Clock::now() - start;
+
+    start = Clock::now();
+    for (int i = 0; i < rounds; i++) {
+        json::View v(str.data(), str.size());
+        OBuffer out(0);
+        out << v["c"].raw();
+        total += v["a"].as<int>() + out.size();
+    }
+    auto viewTime = Clock::now() - start;
+    REQUIRE(total == rounds * (42 + str.size() - 25));
+
+    WARN("payload: " << str.size() << " bytes, " << rounds << " rounds, full decode/encode: "
+         << std::chrono::duration_cast<std::chrono::microseconds>(fullTime).count()/rounds
+         << " us, iod object with a json::View field: "
+         << std::chrono::duration_cast<std::chrono::microseconds>(partialTime).count()/rounds
+         << " us, json::View: "
+         << std::chrono::duration_cast<std::chrono::microseconds>(viewTime).count()/rounds << " us");
+}
+
 #endif
 
@@ -29,6 +29,7 @@
 #include <map>
 #include <memory>
 #include <initializer_list>
+#include <cmath>
 
 #include <iod/json.hh>
 #include <suil/utils.h>
@@ -44,6 +45,7 @@ typedef enum {
 } JsonTag;
 
 typedef struct JsonNode JsonNode;
+typedef struct JsonIndex JsonIndex;
 
 struct JsonNode
 {
@@ -69,6 +71,8 @@ struct JsonNode
         /* JSON_OBJECT */
         struct {
             JsonNode *head, *tail;
+            /* JSON_OBJECT, hash index of the members (built on demand) */
+            JsonIndex *index;
         } children;
     };
 };
@@ -136,6 +140,8 @@ namespace suil {
             T& val;
         };
 
+        struct Tape;
+
         struct Object_t {};
         static const Object_t Obj{};
         struct Array_t {};
@@ -148,14 +154,25 @@ namespace suil {
             public:
                 iterator(JsonNode *node) : mNode(node) {}
 
+                iterator(Tape *tape, uint32_t idx, bool members)
+                    : mTape(tape),
+                      mIdx(idx),
+                      mMembers(members)
+                {}
+
                 iterator operator++();
 
-                bool operator!=(const iterator &other) { return mNode != other.mNode; }
+                bool operator!=(const iterator &other) {
+                    return mNode != other.mNode || mTape != other.mTape || mIdx != other.mIdx;
+                }
 
                 const std::pair<const char *, Object> operator*() const;
 
             private:
-                JsonNode *mNode;
+                JsonNode *mNode{nullptr};
+                Tape     *mTape{nullptr};
+                uint32_t  mIdx{0};
+                bool      mMembers{false};
             };
 
             using const_iterator = const iterator;
@@ -229,13 +246,20 @@ namespace suil {
 
             Object(const Object &o) noexcept
                 : mNode(o.mNode),
+                  mTape(o.mTape),
+                  mIdx(o.mIdx),
                   ref(true)
             { }
 
             Object(Object &&o) noexcept
                 : mNode(o.mNode),
+                  mTape(o.mTape),
+                  mIdx(o.mIdx),
                   ref(o.ref)
-            { o.mNode = nullptr; }
+            {
+                o.mNode = nullptr;
+                o.mTape = nullptr;
+            }
 
             Object &operator=(Object &&o) noexcept;
 
@@ -345,6 +369,12 @@ namespace suil {
 
             operator double() const;
 
+            /**
+             * decodes the JSON value at the start of \a str
+             * @param str the JSON string to decode
+             * @param sz the size of \a str, set to the number of bytes consumed
+             * @return the decoded value, which is read from a compact tape until it's modified
+             */
             static Object decode(const char *str, size_t &sz);
 
             void encode(iod::encode_stream &ss) const;
@@ -493,9 +523,159 @@ namespace suil {
             Object(JsonNode *node, bool ref = true)
                     : mNode(node),
                       ref(ref) {};
+
+            Object(Tape *tape, uint32_t idx, bool ref = true)
+                    : mTape(tape),
+                      mIdx(idx),
+                      ref(ref) {};
+
+            /* decoded values are read from the tape until the document is modified */
+            Tape *tape() const;
+            JsonNode *node() const;
+            JsonNode *modify();
+            JsonNode *detach();
+
             JsonNode *mNode{nullptr};
+            Tape     *mTape{nullptr};
+            uint32_t  mIdx{0};
             bool ref{false};
         };
+
+        /**
+         * A lazy view of a JSON value over the buffer it was read from. Nothing is
+         * decoded up front, members (and elements) are located on first access by
+         * skipping over the values preceding them and are decoded on demand. The
+         * raw bytes of the values not accessed can be forwarded as is.
+         *
+         * The view (and the views of it's members) references the buffer it was
+         * created from, \a dup returns a view owning a copy of the buffer.
+         *
+         * @code
+         * json::View body(req.get_body());
+         * auto id = body["id"].as<int>();
+         * auto user = body["user"].as<User>();
+         * // the payload is forwarded without being decoded
+         * upstream << body["payload"].raw();
+         * @endcode
+         *
+         * A view can also be the type of an iod object's field, the field's value is
+         * then captured (not decoded) when the object is decoded and encoded as is.
+         */
+        struct View {
+            using ArrayEnumerator  = std::function<bool(View)>;
+            using ObjectEnumerator = std::function<bool(const strview& key, View)>;
+
+            View() = default;
+
+            /**
+             * @param data the JSON value to view, must outlive the view
+             * @param size the size of \a data
+             */
+            View(const char *data, size_t size);
+
+            explicit View(const strview& sv)
+                : View(sv.data(), sv.size())
+            {}
+
+            explicit View(const String& str)
+                : View(str.data(), str.size())
+            {}
+
+            /**
+             * finds the member with the given key, the members preceding it
+             * which haven't been accessed yet are skipped over
+             * @param key the key of the member, compared as it appears in the document
+             * @return a view of the member's value, an empty view if the value
+             * is not an object or has no such member
+             */
+            View operator[](const char *key) const;
+
+            /**
+             * @param index the index of the element
+             * @return a view of the element at the given index, an empty view if the
+             * value is not an array or has no such element
+             */
+            View operator[](int index) const;
+
+            /**
+             * decodes the value
+             * @return the decoded value, the default value if the view is empty or null
+             */
+            template <typename T>
+            T as() const {
+                T t{};
+                if (empty() || isNull())
+                    return t;
+                iod::json_internals::json_parser p(iod::stringview(mRaw.data(), mRaw.size()));
+                iod::json_internals::iod_from_json_((T *) nullptr, t, p);
+                return t;
+            }
+
+            /**
+             * @return the number of elements (or members) of an array (or object)
+             */
+            size_t count() const;
+
+            /**
+             * @return the raw bytes of the value
+             */
+            inline strview raw() const {
+                return strview(mRaw.data(), mRaw.size());
+            }
+
+            /**
+             * @return a view owning a copy of the value's bytes
+             */
+            View dup() const;
+
+            /**
+             * @return true if the view doesn't reference a value
+             */
+            inline bool empty() const {
+                return mRaw.empty();
+            }
+
+            JsonTag type() const;
+
+            inline bool isObject() const { return !empty() && mRaw.data()[0] == '{'; }
+
+            inline bool isArray() const { return !empty() && mRaw.data()[0] == '['; }
+
+            inline bool isString() const { return !empty() && mRaw.data()[0] == '"'; }
+
+            inline bool isNull() const { return !empty() && mRaw.data()[0] == 'n'; }
+
+            inline bool isBool() const { return type() == JSON_BOOL; }
+
+            inline bool isNumber() const { return type() == JSON_NUMBER; }
+
+            void operator|(ArrayEnumerator f) const;
+
+            void operator|(ObjectEnumerator f) const;
+
+            /**
+             * finds the end of the JSON value at \a p without decoding it
+             * @return the end of the value, nullptr if the value is invalid or
+             * is not complete
+             */
+            static const char *skip(const char *p, const char *e);
+
+        private suil_ut:
+            /* the location of a member's key and value (or an element) */
+            struct entry_t {
+                uint32_t key, klen;
+                uint32_t val, vlen;
+            };
+
+            /* skips to the next member (or element), false at the end of the value */
+            bool scan() const;
+
+            String mRaw{};
+            /* the members and elements located so far */
+            mutable std::vector<entry_t> mEntries{};
+            mutable uint32_t mCursor{0};
+            mutable bool     mScanned{false};
+        };
     }
 
     template <size_t N>
@@ -578,9 +758,21 @@ namespace iod {
     template<>
     inline json_internals::json_parser& json_internals::json_parser::fill<suil::json::Object>(suil::json::Object& o) {
         // just parse into a json object
-        size_t tmp = str.size();
+        size_t tmp = str.size() - pos;
         o = suil::json::Object::decode(&str[pos], tmp);
         pos += tmp;
+        return *this;
+    }
+
+    template<>
+    inline json_internals::json_parser& json_internals::json_parser::fill<suil::json::View>(suil::json::View& v) {
+        // capture the value, it's decoded if ever accessed
+        auto end = suil::json::View::skip(&str[pos], str.data()+str.size());
+        if (end == nullptr)
+            throw json_error("invalid JSON value");
+        v = suil::json::View(&str[pos], end-&str[pos]);
+        pos = (int) (end-str.data());
+        return *this;
     }
 
     // Decode \o from a json string \b.
@@ -615,9 +807,11 @@ namespace iod {
 
     template<typename S>
     inline void json_decode(suil::json::Object& o, const S& s) {
-        size_t size{s.size()};
+        /* iod::stringview's size is an int */
+        const size_t len = (size_t) s.size();
+        size_t size{len};
         o = suil::json::Object::decode(s.data(), size);
-        if (size != s.size())
+        if (size != len)
             throw suil::Exception("decoding json string failed at pos ", size);
     }
 
@@ -629,6 +823,57 @@ namespace iod {
             json_encode_(sv, ss);
         }
 
+        template<typename S>
+        inline void json_encode_(const double& d, S &ss) {
+            char buf[suil::numfmt::MAX_DOUBLE];
+            if (std::isfinite(d))
+                ss << stringview(buf, suil::numfmt::dtoa(d, buf));
+            else
+                ss << "null";
+        }
+
+        template<typename S>
+        inline void json_encode_(const float& f, S &ss) {
+            char buf[suil::numfmt::MAX_DOUBLE];
+            if (std::isfinite(f))
+                ss << stringview(buf, suil::numfmt::ftoa(f, buf));
+            else
+                ss << "null";
+        }
+
+        template<typename T, typename S>
+        inline void json_encode_integer(T v, S &ss) {
+            char buf[suil::numfmt::MAX_INTEGER];
+            if constexpr (std::is_signed<T>::value)
+                ss << stringview(buf, suil::numfmt::itoa(v, buf));
+            else
+                ss << stringview(buf, suil::numfmt::utoa(v, buf));
+        }
+
+        template<typename S>
+        inline void json_encode_(const short& v, S &ss) { json_encode_integer(v, ss); }
+
+        template<typename S>
+        inline void json_encode_(const int& v, S &ss) { json_encode_integer(v, ss); }
+
+        template<typename S>
+        inline void json_encode_(const long& v, S &ss) { json_encode_integer(v, ss); }
+
+        template<typename S>
+        inline void json_encode_(const long long& v, S &ss) { json_encode_integer(v, ss); }
+
+        template<typename S>
+        inline void json_encode_(const unsigned short& v, S &ss) { json_encode_integer(v, ss); }
+
+        template<typename S>
+        inline void json_encode_(const unsigned int& v, S &ss) { json_encode_integer(v, ss); }
+
+        template<typename S>
+        inline void json_encode_(const unsigned long& v, S &ss) { json_encode_integer(v, ss); }
+
+        template<typename S>
+        inline void json_encode_(const unsigned long long& v, S &ss) { json_encode_integer(v, ss); }
+
         template<typename S>
         inline void json_encode_(const suil::Data& d, S &ss) {
             auto s = suil::utils::hexstr(d.cdata(), d.size());
@@ -650,6 +895,14 @@ namespace iod {
         inline void json_encode_(const suil::json::Object& o, S &ss) {
             o.encode(ss);
         }
+
+        template <typename S>
+        inline void json_encode_(const suil::json::View& v, S &ss) {
+            if (v.empty())
+                ss << "null";
+            else
+                ss << stringview(v.raw().data(), v.raw().size());
+        }
     }
 
     inline std::string json_encode(const suil::json::Object& o) {
@@ -692,6 +945,113 @@ namespace suil {
             return iod::json_encode(o);
         }
 
+        /**
+         * An encoder sink writing directly into an output buffer
+         */
+        struct BufferSink : iod::json_internals::encode_sink {
+            BufferSink(OBuffer& ob)
+                : ob(ob)
+            {}
+
+            char *reserve(size_t n, size_t& cap) override {
+                ob.reserve(n+1);
+                /* the buffer's offset cannot reach it's end */
+                cap = ob.capacity()-1;
+                return ob.data() + ob.size();
+            }
+
+            void commit(size_t n) override {
+                ob.seek(n);
+            }
+
+            OBuffer& ob;
+        };
+
+        /**
+         * estimates the size of the JSON encoding of the given value from it's
+         * schema, used to reserve the output buffer before encoding
+         *
+         * @param o the value to estimate
+         * @return the estimated size in bytes
+         */
+        template <typename T>
+        inline size_t estimate(const T& o);
+
+        template <typename T>
+        inline size_t estimate(const std::vector<T>& v);
+
+        template <typename T>
+        inline size_t estimate(const iod::Nullable<T>& v);
+
+        template <typename... T>
+        inline size_t estimate(const iod::sio<T...>& o);
+
+        template <size_t N>
+        inline size_t estimate(const Blob<N>&) {
+            return (2*N)+2;
+        }
+
+        inline size_t estimate(const View& v) {
+            return v.empty()? 4 : v.raw().size();
+        }
+
+        template <typename T>
+        inline size_t estimate(const T& o) {
+            if constexpr (std::is_same<T, bool>::value)
+                return 5;
+            else if constexpr (std::is_arithmetic<T>::value)
+                return 24;
+            else if constexpr (std::is_same<T, std::string>::value ||
+                               std::is_same<T, String>::value ||
+                               std::is_same<T, iod::stringview>::value)
+                return o.size()+2;
+            else if constexpr (std::is_same<T, Data>::value)
+                return (2*o.size())+2;
+            else if constexpr (std::is_convertible<T, const char*>::value)
+                return (o? strlen(o) : 0)+2;
+            else
+                return 64;
+        }
+
+        template <typename T>
+        inline size_t estimate(const std::vector<T>& v) {
+            size_t sz{2};
+            for (auto& e: v)
+                sz += estimate(e)+1;
+            return sz;
+        }
+
+        template <typename T>
+        inline size_t estimate(const iod::Nullable<T>& v) {
+            return v.empty()? 4 : estimate(*v);
+        }
+
+        template <typename... T>
+        inline size_t estimate(const iod::sio<T...>& o) {
+            size_t sz{2};
+            foreach(o) | [&](const auto& m) {
+                sz += strlen(m.symbol().name())+4+estimate(m.value());
+            };
+            return sz;
+        }
+
+        /**
+         * encodes the given value directly into the output buffer, the buffer
+         * is reserved from the estimated size of the encoding
+         *
+         * @param o the value to encode
+         * @param ob the buffer to append the JSON encoding to
+         * @return the output buffer
+         */
+        template <typename O>
+        inline OBuffer& encode(const O& o, OBuffer& ob) {
+            BufferSink sink(ob);
+            iod::encode_stream ss(sink, estimate(o));
+            iod::json_internals::json_encode_(o, ss);
+            ss.finish();
+            return ob;
+        }
+
         template<typename S, typename O>
         static bool trydecode(const S &s, O &o) {
             iod::stringview sv(s.data(), s.size());
@@ -711,6 +1071,156 @@ namespace suil {
             iod::json_decode(o, sv);
         }
 
+        /**
+         * An incremental decoder of streams of JSON values, e.g newline delimited
+         * JSON (NDJSON) logs or the elements of a huge top level array. The input
+         * is fed in chunks of any size (as read from a socket or a file) and the values
+         * are decoded one at a time, only the value being decoded is kept in memory.
+         *
+         * @code
+         * json::Stream js(json::Stream::Array);
+         * Record rec;
+         * while (js.read(file, rec)) {
+         *     // use rec
+         * }
+         * @endcode
+         */
+        struct Stream {
+            enum Framing : uint8_t {
+                /* values separated by white space (or not separated at all), e.g NDJSON */
+                Values,
+                /* the elements of a single top level array */
+                Array
+            };
+
+            /* the number of bytes read from a source at a time */
+            static constexpr size_t CHUNK{16384};
+
+            /**
+             * @param framing how the values are framed in the stream
+             * @param limit the maximum size of a single value, 0 for no limit
+             */
+            Stream(Framing framing = Values, size_t limit = 0)
+                : mFraming(framing),
+                  mLimit(limit)
+            {}
+
+            Stream(const Stream&) = delete;
+            Stream& operator=(const Stream&) = delete;
+
+            /**
+             * appends the next chunk of the stream
+             * @param data the chunk to append
+             * @param len the size of the chunk
+             */
+            void feed(const char *data, size_t len);
+
+            /**
+             * appends the next chunk of the stream read from the given source
+             * @param src a source with a read(void*, size_t&, int64_t) method, e.g
+             * File or Socket
+             * @param timeout the read timeout
+             * @return false if the source has no more data (or reading failed), the
+             * stream is then finished
+             */
+            template <typename Src>
+            bool fill(Src& src, int64_t timeout = -1) {
+                if (mEnd)
+                    return false;
+                compact();
+                mBuffer.reserve(CHUNK);
+                /* keep a byte for the buffer's offset */
+                size_t len = mBuffer.capacity()-mBuffer.size()-1;
+                bool ok = src.read(mBuffer.data()+mBuffer.size(), len, timeout);
+                if (len)
+                    mBuffer.seek(len);
+                if (!ok || len == 0) {
+                    finish();
+                    return false;
+                }
+                return true;
+            }
+
+            /**
+             * marks the end of the stream, a value at the end of the stream without
+             * a delimiter (e.g a number) is complete once the stream is finished
+             */
+            void finish() {
+                mEnd = true;
+            }
+
+            /**
+             * decodes the next value in the stream
+             * @param o the object to decode into (a json::Object, an iod object, or
+             * any value json::decode supports)
+             * @return true if a value was decoded, false if the stream has no complete
+             * value yet (or no more values once finished)
+             * @throws Exception if the stream is invalid, truncated or if a value
+             * exceeds the limit
+             */
+            template <typename O>
+            bool next(O& o) {
+                const char *p{nullptr};
+                size_t len{0};
+                if (!frame(p, len))
+                    return false;
+                decode(iod::stringview(p, len), o);
+                return true;
+            }
+
+            /**
+             * decodes the next value in the stream, reading from the given source
+             * until a value is available
+             * @param src the source to read from, see \a fill
+             * @param o the object to decode into
+             * @param timeout the timeout of each read
+             * @return true if a value was decoded, false at the end of the stream
+             */
+            template <typename Src, typename O>
+            bool read(Src& src, O& o, int64_t timeout = -1) {
+                while (!next(o)) {
+                    if (!fill(src, timeout))
+                        return next(o);
+                }
+                return true;
+            }
+
+            /**
+             * @return the number of bytes buffered that haven't been decoded yet
+             */
+            inline size_t buffered() const {
+                return mBuffer.size()-mPos;
+            }
+
+        private suil_ut:
+            static constexpr size_t NONE{~size_t(0)};
+
+            enum : uint8_t { Open, First, Element, Next, Closed };
+
+            /* finds the next complete value in the buffer */
+            bool frame(const char *&p, size_t& len);
+            /* drops the decoded values from the buffer */
+            void compact();
+            [[noreturn]] void unexpected(size_t i) const;
+
+            OBuffer  mBuffer{0};
+            /* the offset in the stream of the start of the buffer */
+            size_t   mBase{0};
+            /* the end of the last value framed */
+            size_t   mPos{0};
+            size_t   mScan{0};
+            /* the start of the value being framed */
+            size_t   mStart{NONE};
+            uint32_t mDepth{0};
+            Framing  mFraming;
+            uint8_t  mState{Open};
+            bool     mString{false};
+            bool     mEscape{false};
+            bool     mScalar{false};
+            bool     mEnd{false};
+            size_t   mLimit;
+        };
+
         template <typename Mt>
         inline void metaToJson(const Mt& o, iod::json::jstream& ss)
         {
@@ -737,7 +1247,7 @@ namespace suil {
 
     template <typename... T>
     OBuffer& OBuffer::operator<<(const iod::sio<T...>& o) {
-        return (Ego << json::encode(o));
+        return json::encode(o, Ego);
     }
 }
 
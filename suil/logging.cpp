@@ -71,7 +71,7 @@ namespace suil {
                     "TRC", "DBG", "INF", "NTC", "WRN", "ERR", "CRT"
             };
 
-            char worker[64];
+            char worker[64], date[64];
             size_t sz = SUIL_LOG_BUFFER_SIZE;
             char   *tmp = out;
             const char *name = __Log.app_name() ? __Log.app_name() : "global";
@@ -89,7 +89,8 @@ namespace suil {
                 case log::CRITICAL:
                 case log::WARNING:
                     wr = snprintf(tmp, sz, "%s/%05d: [%s] [%3s] [%10.10s] %s",
-                                  name, getpid(), Datetime()(), LOGLVL_STR[(unsigned char)l],
+                                  name, getpid(), Datetime().str(date, sizeof(date), Datetime::LOG_FMT),
+                                  LOGLVL_STR[(unsigned char)l],
                                   tag, (spid? worker: ""));
                     break;
                 default:
@@ -98,7 +99,9 @@ namespace suil {
             }
 
             sz  -= wr;
-            wr += vsnprintf(tmp + wr, sz, fmt, args);
+            int n = vsnprintf(tmp + wr, sz, fmt, args);
+            /* vsnprintf returns the untruncated size, leave room for the line ending */
+            wr += std::max(0, std::min(n, (int) sz - 2));
             tmp[wr++] = '\n';
             tmp[wr]   = '\0';
 
@@ -234,6 +234,10 @@ namespace suil {
          * opt(sink,    LogSink)    // the logging, where all logs are sent
          * opt(name,    const char) // the name of the logging application
          * @endcode
+         *
+         * @note messages might be logged from threads other than the worker's
+         * (e.g work run on a \ref sql::SQLitePool), the default formatter and
+         * sink are thread safe and custom ones must be as well
          */
         template<typename... Opts>
         inline static void setup(Opts... opts) {
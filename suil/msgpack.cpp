@@ -0,0 +1,504 @@
+//
+// MessagePack encoding of iod objects
+//
+
+#include <suil/msgpack.h>
+
+namespace suil::msgpack {
+
+    void Writer::object(const json::Object& o) {
+        if (o.isNull()) {
+            nil();
+            return;
+        }
+
+        switch (o.type()) {
+            case JSON_BOOL:
+                boolean((bool) o);
+                break;
+            case JSON_NUMBER:
+                number((double) o);
+                break;
+            case JSON_STRING: {
+                const char *s = (const char *) o;
+                str(s, strlen(s));
+                break;
+            }
+            case JSON_ARRAY: {
+                size_t n{0};
+                o | [&](json::Object) {
+                    n++;
+                    return false;
+                };
+                array(n);
+                o | [&](json::Object e) {
+                    object(e);
+                    return false;
+                };
+                break;
+            }
+            case JSON_OBJECT: {
+                size_t n{0};
+                o | [&](const char *, json::Object) {
+                    n++;
+                    return false;
+                };
+                map(n);
+                o | [&](const char *key, json::Object e) {
+                    str(key, strlen(key));
+                    object(e);
+                    return false;
+                };
+                break;
+            }
+            default:
+                nil();
+                break;
+        }
+    }
+
+    void Reader::error(const char *expected, uint8_t tag) const {
+        char hex[3]{0};
+        utils::hexstr(&tag, 1, hex, sizeof(hex));
+        throw Exception::create("msgpack - expecting ", expected, " at offset ", (p-s)-1, " got 0x", hex);
+    }
+
+    uint8_t Reader::next() {
+        if (p >= e)
+            throw Exception::create("msgpack - unexpected end of data at offset ", (p-s));
+        return *p++;
+    }
+
+    const uint8_t* Reader::take(size_t n) {
+        if ((size_t)(e-p) < n)
+            throw Exception::create("msgpack - unexpected end of data at offset ", (p-s));
+        auto data = p;
+        p += n;
+        return data;
+    }
+
+    uint64_t Reader::length(uint8_t tag, uint8_t base) {
+        /* the 8, 16 and 32 bit lengths of str, bin, array and map follow each other */
+        uint16_t u16;
+        uint32_t u32;
+        switch (tag - base) {
+            case 0:
+                return *take(1);
+            case 1:
+                memcpy(&u16, take(2), 2);
+                return be16toh(u16);
+            default:
+                memcpy(&u32, take(4), 4);
+                return be32toh(u32);
+        }
+    }
+
+    bool Reader::nil() {
+        if (p < e && *p == 0xc0) {
+            p++;
+            return true;
+        }
+        return false;
+    }
+
+    bool Reader::boolean() {
+        auto tag = next();
+        if (tag != 0xc2 && tag != 0xc3)
+            error("a boolean", tag);
+        return tag == 0xc3;
+    }
+
+    int64_t Reader::integer() {
+        auto tag = next();
+        if (tag < 0x80)
+            return tag;
+        if (tag >= 0xe0)
+            return (int8_t) tag;
+
+        uint16_t u16;
+        uint32_t u32;
+        uint64_t u64;
+        switch (tag) {
+            case 0xcc:
+                return *take(1);
+            case 0xcd:
+                memcpy(&u16, take(2), 2);
+                return be16toh(u16);
+            case 0xce:
+                memcpy(&u32, take(4), 4);
+                return be32toh(u32);
+            case 0xcf:
+                memcpy(&u64, take(8), 8);
+                u64 = be64toh(u64);
+                if (u64 > (uint64_t) INT64_MAX)
+                    throw Exception::create("msgpack - integer ", u64, " out of range");
+                return (int64_t) u64;
+            case 0xd0:
+                return (int8_t) *take(1);
+            case 0xd1:
+                memcpy(&u16, take(2), 2);
+                return (int16_t) be16toh(u16);
+            case 0xd2:
+                memcpy(&u32, take(4), 4);
+                return (int32_t) be32toh(u32);
+            case 0xd3:
+                memcpy(&u64, take(8), 8);
+                return (int64_t) be64toh(u64);
+            default:
+                error("an integer", tag);
+        }
+    }
+
+    uint64_t Reader::uinteger() {
+        if (p < e && *p == 0xcf) {
+            uint64_t u64;
+            p++;
+            memcpy(&u64, take(8), 8);
+            return be64toh(u64);
+        }
+        auto i = integer();
+        if (i < 0)
+            throw Exception::create("msgpack - integer ", i, " out of range");
+        return (uint64_t) i;
+    }
+
+    double Reader::number() {
+        if (p < e && (*p == 0xca || *p == 0xcb)) {
+            if (*p++ == 0xca) {
+                uint32_t u32;
+                float f;
+                memcpy(&u32, take(4), 4);
+                u32 = be32toh(u32);
+                memcpy(&f, &u32, 4);
+                return f;
+            }
+            uint64_t u64;
+            double d;
+            memcpy(&u64, take(8), 8);
+            u64 = be64toh(u64);
+            memcpy(&d, &u64, 8);
+            return d;
+        }
+        if (p < e && *p == 0xcf)
+            return (double) uinteger();
+        return (double) integer();
+    }
+
+    strview Reader::str() {
+        auto tag = next();
+        size_t len;
+        if ((tag & 0xe0) == 0xa0)
+            len = tag & 0x1f;
+        else if (tag >= 0xd9 && tag <= 0xdb)
+            len = length(tag, 0xd9);
+        else if (tag >= 0xc4 && tag <= 0xc6)
+            len = length(tag, 0xc4);
+        else
+            error("a string", tag);
+        return strview((const char *) take(len), len);
+    }
+
+    uint32_t Reader::array() {
+        auto tag = next();
+        if ((tag & 0xf0) == 0x90)
+            return tag & 0x0f;
+        if (tag == 0xdc || tag == 0xdd)
+            return (uint32_t) length(tag+1, 0xdc);
+        error("an array", tag);
+    }
+
+    uint32_t Reader::map() {
+        auto tag = next();
+        if ((tag & 0xf0) == 0x80)
+            return tag & 0x0f;
+        if (tag == 0xde || tag == 0xdf)
+            return (uint32_t) length(tag+1, 0xde);
+        error("a map", tag);
+    }
+
+    void Reader::skip() {
+        auto tag = next();
+        if (tag < 0x80 || tag >= 0xe0 || tag == 0xc0 || tag == 0xc2 || tag == 0xc3)
+            return;
+        if ((tag & 0xe0) == 0xa0) {
+            take(tag & 0x1f);
+            return;
+        }
+        if ((tag & 0xf0) == 0x90 || (tag & 0xf0) == 0x80) {
+            size_t n = (tag & 0x0f) * ((tag & 0xf0) == 0x80? 2 : 1);
+            while (n--)
+                skip();
+            return;
+        }
+
+        switch (tag) {
+            case 0xcc: case 0xd0:
+                take(1);
+                break;
+            case 0xcd: case 0xd1:
+                take(2);
+                break;
+            case 0xce: case 0xd2: case 0xca:
+                take(4);
+                break;
+            case 0xcf: case 0xd3: case 0xcb:
+                take(8);
+                break;
+            case 0xc4: case 0xc5: case 0xc6:
+                take(length(tag, 0xc4));
+                break;
+            case 0xd9: case 0xda: case 0xdb:
+                take(length(tag, 0xd9));
+                break;
+            case 0xdc: case 0xdd:
+            case 0xde: case 0xdf: {
+                uint64_t n = length(tag+1, (tag <= 0xdd)? 0xdc : 0xde);
+                if (tag >= 0xde)
+                    n *= 2;
+                while (n--)
+                    skip();
+                break;
+            }
+            case 0xd4: case 0xd5: case 0xd6: case 0xd7: case 0xd8:
+                /* fixext, a type followed by 1, 2, 4, 8 or 16 bytes */
+                take(1 + (1u << (tag-0xd4)));
+                break;
+            case 0xc7: case 0xc8: case 0xc9: {
+                auto len = length(tag, 0xc7);
+                take(1 + len);
+                break;
+            }
+            default:
+                error("a value", tag);
+        }
+    }
+
+    json::Object Reader::object() {
+        if (p >= e)
+            throw Exception::create("msgpack - unexpected end of data at offset ", (p-s));
+
+        uint8_t tag = *p;
+        if (nil())
+            return json::Object(nullptr);
+        if (tag == 0xc2 || tag == 0xc3)
+            return json::Object(boolean());
+        if (tag == 0xca || tag == 0xcb || tag < 0x80 || tag >= 0xe0 || (tag >= 0xcc && tag <= 0xd3))
+            return json::Object(number());
+        if ((tag & 0xe0) == 0xa0 || (tag >= 0xd9 && tag <= 0xdb)) {
+            auto sv = str();
+            return json::Object(String{sv.data(), sv.size(), false});
+        }
+        if (tag >= 0xc4 && tag <= 0xc6) {
+            /* binary data is a hex string in JSON */
+            auto sv = str();
+            return json::Object(utils::hexstr((const uint8_t *) sv.data(), sv.size()));
+        }
+        if ((tag & 0xf0) == 0x90 || tag == 0xdc || tag == 0xdd) {
+            json::Object arr(json::Arr);
+            for (uint32_t n = array(); n > 0; n--)
+                arr.push(object());
+            return arr;
+        }
+        if ((tag & 0xf0) == 0x80 || tag == 0xde || tag == 0xdf) {
+            json::Object obj(json::Obj);
+            for (uint32_t n = map(); n > 0; n--) {
+                auto key = str();
+                std::string k(key.data(), key.size());
+                obj.set(k.c_str(), object());
+            }
+            return obj;
+        }
+        error("a JSON value", next());
+    }
+}
+
+#ifdef unit_test
+#include <catch/catch.hpp>
+#include <chrono>
+#include "tests/test_symbols.h"
+
+using namespace suil;
+
+template <typename T>
+static std::vector<uint8_t> packed(const T& v) {
+    OBuffer ob{32};
+    msgpack::encode(v, ob);
+    auto data = (const uint8_t *) ob.data();
+    return std::vector<uint8_t>(data, data+ob.size());
+}
+
+TEST_CASE("suil::msgpack", "[msgpack]")
+{
+    SECTION("Encoding scalars") {
+        CHECK((packed(0) == std::vector<uint8_t>{0x00}));
+        CHECK((packed(127) == std::vector<uint8_t>{0x7f}));
+        CHECK((packed(128) == std::vector<uint8_t>{0xcc, 0x80}));
+        CHECK((packed(256) == std::vector<uint8_t>{0xcd, 0x01, 0x00}));
+        CHECK((packed(65536) == std::vector<uint8_t>{0xce, 0x00, 0x01, 0x00, 0x00}));
+        CHECK((packed(-1) == std::vector<uint8_t>{0xff}));
+        CHECK((packed(-32) == std::vector<uint8_t>{0xe0}));
+        CHECK((packed(-33) == std::vector<uint8_t>{0xd0, 0xdf}));
+        CHECK((packed(-129) == std::vector<uint8_t>{0xd1, 0xff, 0x7f}));
+        CHECK((packed(true) == std::vector<uint8_t>{0xc3}));
+        CHECK((packed(2.0) == std::vector<uint8_t>{0x02}));
+        CHECK((packed(1.5) == std::vector<uint8_t>{0xcb, 0x3f, 0xf8, 0, 0, 0, 0, 0, 0}));
+        CHECK((packed(std::string("abc")) == std::vector<uint8_t>{0xa3, 'a', 'b', 'c'}));
+        auto s32 = packed(std::string(32, 'x'));
+        CHECK(s32.size() == 34);
+        CHECK((s32[0] == 0xd9 && s32[1] == 32));
+        CHECK((packed(std::vector<int>{1, 2}) == std::vector<uint8_t>{0x92, 0x01, 0x02}));
+    }
+
+    SECTION("Decoding scalars") {
+        int i{0};
+        msgpack::decode(std::string("\xd1\xff\x7f"), i);
+        CHECK(i == -129);
+        uint64_t u{0};
+        msgpack::decode(std::string("\xcf\xff\xff\xff\xff\xff\xff\xff\xff"), u);
+        CHECK(u == UINT64_MAX);
+        double d{0};
+        msgpack::decode(std::string("\xca\x3f\xc0\x00\x00", 5), d);
+        CHECK(d == 1.5);
+        uint8_t small{0};
+        CHECK_THROWS(msgpack::decode(std::string("\xcd\x01\x00", 3), small));
+        CHECK_THROWS(msgpack::decode(std::string("\xff"), u));
+        String s;
+        msgpack::decode(std::string("\xa3" "abc"), s);
+        CHECK(s == "abc");
+    }
+
+    SECTION("Round trip of iod objects") {
+        typedef decltype(iod::D(
+                tprop(a,                int),
+                tprop(b,                String),
+                tprop(c,                std::vector<int>),
+                tprop(d,                iod::Nullable<int>),
+                tprop(e,                Data),
+                tprop(f,                json::Object),
+                tprop(g,                double),
+                tprop(h(var(optional)), std::string)
+        )) Record;
+
+        Record in;
+        in.a = -42;
+        in.b = String{"hello"};
+        in.c = {1, 300, -70000};
+        in.e = Data("\x00\x01\x02", 3, false).copy();
+        in.f = json::Object(json::Obj, "x", 1, "y", json::Object(json::Arr, "one", true));
+        in.g = 3.25;
+        in.h = "optional";
+
+        OBuffer ob{128};
+        msgpack::encode(in, ob);
+        REQUIRE(msgpack::detect(ob.data(), ob.size()));
+
+        Record out;
+        msgpack::decode(ob, out);
+        CHECK(out.a == -42);
+        CHECK(out.b == "hello");
+        CHECK((out.c == std::vector<int>{1, 300, -70000}));
+        CHECK_FALSE(out.d);
+        CHECK(out.e.size() == 3);
+        CHECK(memcmp(out.e.cdata(), "\x00\x01\x02", 3) == 0);
+        CHECK(json::encode(out.f) == json::encode(in.f));
+        CHECK(out.g == 3.25);
+        CHECK(out.h == "optional");
+    }
+
+    SECTION("Schema mismatches") {
+        typedef decltype(iod::D(
+                tprop(a,                int),
+                tprop(b,                String),
+                tprop(c,                std::vector<int>)
+        )) Wide;
+        typedef decltype(iod::D(
+                tprop(b,                String)
+        )) Narrow;
+        typedef decltype(iod::D(
+                tprop(a,                int),
+                tprop(t,                int)
+        )) Missing;
+
+        Wide w;
+        w.a = 1;
+        w.b = String{"b"};
+        w.c = {1, 2, 3};
+        OBuffer ob{64};
+        msgpack::encode(w, ob);
+
+        // unknown fields are skipped
+        Narrow n;
+        msgpack::decode(ob, n);
+        CHECK(n.b == "b");
+
+        // a required field that is not in the data
+        Missing m;
+        CHECK_THROWS(msgpack::decode(ob, m));
+
+        // truncated data
+        Wide t;
+        CHECK_THROWS(msgpack::decode(ob.data(), ob.size()-1, t));
+        CHECK_FALSE(msgpack::trydecode(std::string("{\"a\": 1}"), t));
+        CHECK_FALSE(msgpack::detect("{\"a\": 1}", 8));
+    }
+}
+
+TEST_CASE("suil::msgpack benchmark", "[.][benchmark][msgpack]")
+{
+    using Clock = std::chrono::steady_clock;
+    typedef decltype(iod::D(
+            tprop(a,           int),
+            tprop(b,           std::string),
+            tprop(c,           double),
+            tprop(d,           bool),
+            tprop(e,           std::vector<std::string>)
+    )) Item;
+
+    std::vector<Item> items(5000);
+    for (int i = 0; i < (int) items.size(); i++) {
+        items[i].a = i;
+        items[i].b = "user " + std::to_string(i);
+        items[i].c = i * 1.25;
+        items[i].d = (i % 2) == 0;
+        items[i].e = {"a", "b", "c"};
+    }
+    const int rounds = 20;
+
+    OBuffer js{1024*1024}, mp{1024*1024};
+    auto start = Clock::now();
+    for (int i = 0; i < rounds; i++) {
+        js.reset(1024*1024, true);
+        json::encode(items, js);
+    }
+    auto jsEncode = Clock::now() - start;
+
+    start = Clock::now();
+    for (int i = 0; i < rounds; i++) {
+        mp.reset(1024*1024, true);
+        msgpack::encode(items, mp);
+    }
+    auto mpEncode = Clock::now() - start;
+
+    start = Clock::now();
+    for (int i = 0; i < rounds; i++) {
+        std::vector<Item> out;
+        json::decode(js, out);
+        REQUIRE(out.size() == items.size());
+    }
+    auto jsDecode = Clock::now() - start;
+
+    start = Clock::now();
+    for (int i = 0; i < rounds; i++) {
+        std::vector<Item> out;
+        msgpack::decode(mp, out);
+        REQUIRE(out.size() == items.size());
+    }
+    auto mpDecode = Clock::now() - start;
+
+    auto us = [&](auto d) {
+        return std::chrono::duration_cast<std::chrono::microseconds>(d).count()/rounds;
+    };
+    WARN("JSON: " << js.size() << " bytes, encode " << us(jsEncode) << " us, decode " << us(jsDecode) << " us");
+    WARN("MessagePack: " << mp.size() << " bytes, encode " << us(mpEncode) << " us, decode " << us(mpDecode) << " us");
+}
+#endif
@@ -0,0 +1,489 @@
+//
+// MessagePack encoding of iod objects
+//
+
+#ifndef SUIL_MSGPACK_H
+#define SUIL_MSGPACK_H
+
+#include <endian.h>
+#include <limits>
+
+#include <suil/json.h>
+
+namespace suil {
+
+    /**
+     * A compact binary alternative to JSON (https://msgpack.org) for services talking
+     * to each other. Values are encoded from the same iod reflection used by the JSON
+     * codec: iod objects are encoded as maps keyed by the name of their fields,
+     * vectors as arrays, String/std::string as strings, Data as binary and json::Object
+     * as the corresponding MessagePack value.
+     *
+     * @code
+     * OBuffer ob;
+     * msgpack::encode(user, ob);
+     * User other;
+     * msgpack::decode(ob, other);
+     * @endcode
+     */
+    namespace msgpack {
+
+        /* the content type of MessagePack encoded bodies */
+        static constexpr const char *CONTENT_TYPE{"application/msgpack"};
+
+        /**
+         * Appends MessagePack values to an output buffer
+         */
+        struct Writer {
+            Writer(OBuffer& ob)
+                : ob(ob)
+            {}
+
+            inline void nil() {
+                put(0xc0);
+            }
+
+            inline void boolean(bool b) {
+                put(b? 0xc3 : 0xc2);
+            }
+
+            /* integers are written in the smallest format that fits */
+            inline void integer(int64_t v) {
+                if (v >= 0)
+                    uinteger((uint64_t) v);
+                else if (v >= -32)
+                    put((uint8_t) v);
+                else if (v >= INT8_MIN)
+                    put(0xd0, (uint8_t) v);
+                else if (v >= INT16_MIN)
+                    put(0xd1, htobe16((uint16_t) v));
+                else if (v >= INT32_MIN)
+                    put(0xd2, htobe32((uint32_t) v));
+                else
+                    put(0xd3, htobe64((uint64_t) v));
+            }
+
+            inline void uinteger(uint64_t v) {
+                if (v < 128)
+                    put((uint8_t) v);
+                else if (v <= UINT8_MAX)
+                    put(0xcc, (uint8_t) v);
+                else if (v <= UINT16_MAX)
+                    put(0xcd, htobe16((uint16_t) v));
+                else if (v <= UINT32_MAX)
+                    put(0xce, htobe32((uint32_t) v));
+                else
+                    put(0xcf, htobe64(v));
+            }
+
+            /* doubles without a fractional part are written as integers */
+            inline void number(double d) {
+                if (d >= -9.2e18 && d <= 9.2e18 && d == (double) (int64_t) d && (d != 0 || !std::signbit(d))) {
+                    integer((int64_t) d);
+                    return;
+                }
+                uint64_t u;
+                memcpy(&u, &d, sizeof(u));
+                put(0xcb, htobe64(u));
+            }
+
+            inline void number(float f) {
+                uint32_t u;
+                memcpy(&u, &f, sizeof(u));
+                put(0xca, htobe32(u));
+            }
+
+            inline void str(const char *s, size_t len) {
+                if (len < 32)
+                    put((uint8_t) (0xa0 | len));
+                else if (len <= UINT8_MAX)
+                    put(0xd9, (uint8_t) len);
+                else if (len <= UINT16_MAX)
+                    put(0xda, htobe16((uint16_t) len));
+                else
+                    put(0xdb, htobe32((uint32_t) len));
+                ob.append(s, len);
+            }
+
+            inline void bin(const void *data, size_t len) {
+                if (len <= UINT8_MAX)
+                    put(0xc4, (uint8_t) len);
+                else if (len <= UINT16_MAX)
+                    put(0xc5, htobe16((uint16_t) len));
+                else
+                    put(0xc6, htobe32((uint32_t) len));
+                ob.append(data, len);
+            }
+
+            inline void array(size_t n) {
+                header(0x90, 0xdc, n);
+            }
+
+            inline void map(size_t n) {
+                header(0x80, 0xde, n);
+            }
+
+            void object(const json::Object& o);
+
+        private:
+            inline void put(uint8_t tag) {
+                ob.append(&tag, 1);
+            }
+
+            template <typename T>
+            inline void put(uint8_t tag, T v) {
+                uint8_t tmp[sizeof(T)+1];
+                tmp[0] = tag;
+                memcpy(&tmp[1], &v, sizeof(T));
+                ob.append(tmp, sizeof(tmp));
+            }
+
+            inline void header(uint8_t fix, uint8_t tag, size_t n) {
+                if (n < 16)
+                    put((uint8_t) (fix | n));
+                else if (n <= UINT16_MAX)
+                    put(tag, htobe16((uint16_t) n));
+                else
+                    put(tag+1, htobe32((uint32_t) n));
+            }
+
+            OBuffer& ob;
+        };
+
+        /**
+         * Reads MessagePack values from a buffer, values of the wrong type or
+         * reading past the end of the buffer throw an exception
+         */
+        struct Reader {
+            Reader(const void *data, size_t size)
+                : s((const uint8_t *) data),
+                  p((const uint8_t *) data),
+                  e((const uint8_t *) data + size)
+            {}
+
+            /* consumes the next value if it's nil */
+            bool nil();
+
+            bool boolean();
+
+            int64_t integer();
+
+            uint64_t uinteger();
+
+            /* an integer or a float */
+            double number();
+
+            /* a string or binary value, references the buffer */
+            strview str();
+
+            uint32_t array();
+
+            uint32_t map();
+
+            json::Object object();
+
+            /* skips the next value */
+            void skip();
+
+            inline bool eof() const {
+                return p == e;
+            }
+
+            inline size_t offset() const {
+                return p-s;
+            }
+
+        private suil_ut:
+            uint8_t next();
+            const uint8_t *take(size_t n);
+            uint64_t length(uint8_t tag, uint8_t base);
+            [[noreturn]] void error(const char *expected, uint8_t tag) const;
+
+            const uint8_t *s, *p, *e;
+        };
+
+        template <typename T>
+        struct is_nullable : std::false_type {};
+
+        template <typename T>
+        struct is_nullable<iod::Nullable<T>> : std::true_type {};
+
+        /* fields with the ignore attribute are not encoded when they are empty */
+        template <typename T>
+        inline bool ignored(const T& v) {
+            if constexpr (std::is_arithmetic<T>::value)
+                return v == 0;
+            else if constexpr (is_nullable<T>::value)
+                return v.isNull;
+            else if constexpr (std::is_base_of<iod::MetaType, T>::value)
+                return false;
+            else if constexpr (std::is_pointer<T>::value)
+                return v == nullptr || v[0] == '\0';
+            else
+                return v.empty();
+        }
+
+        template <typename T>
+        inline void pack(Writer& w, const T& v);
+
+        template <typename T>
+        inline void pack(Writer& w, const std::vector<T>& v);
+
+        template <typename T>
+        inline void pack(Writer& w, const iod::Nullable<T>& v);
+
+        template <typename... T>
+        inline void pack(Writer& w, const iod::sio<T...>& o);
+
+        template <size_t N>
+        inline void pack(Writer& w, const Blob<N>& b) {
+            w.bin(&b.cbin(), b.size());
+        }
+
+        template <typename S, typename O>
+        inline void pack_fields(Writer& w, const S& schema, const O& o) {
+            size_t n{0};
+            iod::foreach(schema) | [&](const auto& m) {
+                if (!m.attributes().has(iod::_json_skip) &&
+                    !(m.attributes().has(iod::_ignore) && ignored(m.symbol().member_access(o))))
+                    n++;
+            };
+            w.map(n);
+            iod::foreach(schema) | [&](const auto& m) {
+                const auto& val = m.symbol().member_access(o);
+                if (!m.attributes().has(iod::_json_skip) &&
+                    !(m.attributes().has(iod::_ignore) && ignored(val))) {
+                    w.str(m.symbol().name(), strlen(m.symbol().name()));
+                    pack(w, val);
+                }
+            };
+        }
+
+        template <typename T>
+        inline void pack(Writer& w, const T& v) {
+            if constexpr (std::is_same<T, bool>::value)
+                w.boolean(v);
+            else if constexpr (std::is_integral<T>::value && std::is_signed<T>::value)
+                w.integer(v);
+            else if constexpr (std::is_integral<T>::value)
+                w.uinteger(v);
+            else if constexpr (std::is_floating_point<T>::value)
+                w.number(v);
+            else if constexpr (std::is_same<T, std::string>::value ||
+                               std::is_same<T, String>::value ||
+                               std::is_same<T, strview>::value ||
+                               std::is_same<T, iod::stringview>::value)
+                w.str(v.data(), v.size());
+            else if constexpr (std::is_pointer<T>::value) {
+                if (v == nullptr)
+                    w.nil();
+                else
+                    w.str(v, strlen(v));
+            }
+            else if constexpr (std::is_same<T, Data>::value)
+                w.bin(v.cdata(), v.size());
+            else if constexpr (std::is_same<T, json::Object>::value)
+                w.object(v);
+            else {
+                static_assert(std::is_base_of<iod::MetaType, T>::value,
+                              "type cannot be encoded with MessagePack");
+                pack_fields(w, T::Meta, v);
+            }
+        }
+
+        template <typename T>
+        inline void pack(Writer& w, const std::vector<T>& v) {
+            w.array(v.size());
+            for (auto& e: v)
+                pack(w, e);
+        }
+
+        template <typename T>
+        inline void pack(Writer& w, const iod::Nullable<T>& v) {
+            if (v.isNull)
+                w.nil();
+            else
+                pack(w, *v);
+        }
+
+        template <typename... T>
+        inline void pack(Writer& w, const iod::sio<T...>& o) {
+            pack_fields(w, o, o);
+        }
+
+        template <typename T>
+        inline void unpack(Reader& r, T& v);
+
+        template <typename T>
+        inline void unpack(Reader& r, std::vector<T>& v);
+
+        template <typename T>
+        inline void unpack(Reader& r, iod::Nullable<T>& v);
+
+        template <typename... T>
+        inline void unpack(Reader& r, iod::sio<T...>& o);
+
+        template <size_t N>
+        inline void unpack(Reader& r, Blob<N>& b) {
+            auto s = r.str();
+            if (s.size() > N)
+                throw Exception::indexOutOfBounds("msgpack - source data cannot fit into blob");
+            b.copy(s.data(), s.size());
+        }
+
+        template <typename S, typename O>
+        inline void unpack_fields(Reader& r, const S& schema, O& o) {
+            bool filled[S::size()];
+            memset(filled, 0, sizeof(filled));
+            for (uint32_t n = r.map(); n > 0; n--) {
+                auto key = r.str();
+                bool found{false};
+                size_t i{0};
+                iod::foreach(schema) | [&](const auto& m) {
+                    if (!found && !m.attributes().has(iod::_json_skip) && key == m.symbol().name()) {
+                        found = filled[i] = true;
+                        /* null values are not decoded */
+                        if (!r.nil())
+                            unpack(r, m.symbol().member_access(o));
+                    }
+                    i++;
+                };
+                /* unknown fields are skipped */
+                if (!found)
+                    r.skip();
+            }
+
+            size_t i{0};
+            iod::foreach(schema) | [&](const auto& m) {
+                if (!m.attributes().has(iod::_json_skip) && !m.attributes().has(iod::_optional) && !filled[i])
+                    throw Exception::create("msgpack - missing field ", m.symbol().name());
+                i++;
+            };
+        }
+
+        template <typename T>
+        inline void unpack(Reader& r, T& v) {
+            if constexpr (std::is_same<T, bool>::value)
+                v = r.boolean();
+            else if constexpr (std::is_integral<T>::value) {
+                if constexpr (std::is_signed<T>::value) {
+                    auto i = r.integer();
+                    if (i < std::numeric_limits<T>::min() || i > std::numeric_limits<T>::max())
+                        throw Exception::create("msgpack - integer ", i, " out of range");
+                    v = (T) i;
+                }
+                else {
+                    auto u = r.uinteger();
+                    if (u > std::numeric_limits<T>::max())
+                        throw Exception::create("msgpack - integer ", u, " out of range");
+                    v = (T) u;
+                }
+            }
+            else if constexpr (std::is_floating_point<T>::value)
+                v = (T) r.number();
+            else if constexpr (std::is_same<T, std::string>::value) {
+                auto s = r.str();
+                v.assign(s.data(), s.size());
+            }
+            else if constexpr (std::is_same<T, String>::value) {
+                auto s = r.str();
+                v = String{s.data(), s.size(), false}.dup();
+            }
+            else if constexpr (std::is_same<T, Data>::value) {
+                auto s = r.str();
+                v = Data{s.data(), s.size(), false}.copy();
+            }
+            else if constexpr (std::is_same<T, json::Object>::value)
+                v = r.object();
+            else {
+                static_assert(std::is_base_of<iod::MetaType, T>::value,
+                              "type cannot be decoded from MessagePack");
+                unpack_fields(r, T::Meta, v);
+            }
+        }
+
+        template <typename T>
+        inline void unpack(Reader& r, std::vector<T>& v) {
+            uint32_t n = r.array();
+            v.clear();
+            v.reserve(n);
+            for (uint32_t i = 0; i < n; i++) {
+                T t{};
+                unpack(r, t);
+                v.push_back(std::move(t));
+            }
+        }
+
+        template <typename T>
+        inline void unpack(Reader& r, iod::Nullable<T>& v) {
+            if (r.nil()) {
+                v.isNull = true;
+                return;
+            }
+            unpack(r, *v);
+            v.isNull = false;
+        }
+
+        template <typename... T>
+        inline void unpack(Reader& r, iod::sio<T...>& o) {
+            unpack_fields(r, o, o);
+        }
+
+        /**
+         * encodes the given value as MessagePack
+         * @param o the value to encode
+         * @param ob the buffer to append the encoding to
+         * @return the output buffer
+         */
+        template <typename O>
+        inline OBuffer& encode(const O& o, OBuffer& ob) {
+            Writer w(ob);
+            pack(w, o);
+            return ob;
+        }
+
+        /**
+         * decodes a MessagePack encoded value
+         * @param data the encoded value
+         * @param size the size of \a data, the whole buffer must be consumed
+         * @param o the object to decode into
+         */
+        template <typename O>
+        inline void decode(const void *data, size_t size, O& o) {
+            Reader r(data, size);
+            unpack(r, o);
+            if (!r.eof())
+                throw Exception::create("msgpack - unexpected data at offset ", r.offset());
+        }
+
+        template <typename S, typename O>
+        inline void decode(const S& s, O& o) {
+            decode(s.data(), s.size(), o);
+        }
+
+        template <typename S, typename O>
+        static bool trydecode(const S& s, O& o) {
+            try {
+                decode(s, o);
+                return true;
+            }
+            catch (...) {
+                sdebug("decoding MessagePack failed: %s", Exception::fromCurrent().what());
+                return false;
+            }
+        }
+
+        /**
+         * @return true if the given buffer starts with an encoded array or map (as
+         * opposed to a JSON document)
+         */
+        inline bool detect(const void *data, size_t size) {
+            if (size == 0)
+                return false;
+            uint8_t c = *(const uint8_t *) data;
+            return (c >= 0x80 && c <= 0x9f) || (c >= 0xdc && c <= 0xdf);
+        }
+    }
+}
+
+#endif //SUIL_MSGPACK_H
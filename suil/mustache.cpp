@@ -604,7 +604,7 @@ TEST_CASE("Mustache tests", "[template][mustache]")
                                        "planet", "Mars"));
             REQUIRE(rr == String{"Hello Carter, welcome to Mars!"});
             /* different variable types */
-            m = Mustache::fromString("Test variable types {{type}}={{val}}");
+            m = Mustache::fromString("Test variable types {{type}}={{value}}");
             rr = m.render(json::Object(json::Obj,
                     "type", "int", "value", 6));
             REQUIRE(rr == String{"Test variable types int=6"});
@@ -0,0 +1,467 @@
+//
+// Fast number formatting
+//
+
+#include <cstring>
+
+#include "numfmt.h"
+
+namespace suil {
+
+    namespace numfmt {
+
+        namespace {
+
+            const char DIGITS[] =
+            "0001020304050607080910111213141516171819"
+            "2021222324252627282930313233343536373839"
+            "4041424344454647484950515253545556575859"
+            "6061626364656667686970717273747576777879"
+            "8081828384858687888990919293949596979899";
+
+            inline uint32_t digits10(uint64_t v) {
+                uint32_t n{1};
+                while (true) {
+                    if (v < 10) return n;
+                    if (v < 100) return n+1;
+                    if (v < 1000) return n+2;
+                    if (v < 10000) return n+3;
+                    v /= 10000;
+                    n += 4;
+                }
+            }
+
+            /* a floating point number f * 2^e with a 64-bit significand */
+            struct diyfp_t {
+                uint64_t f;
+                int      e;
+            };
+
+            inline diyfp_t multiply(const diyfp_t& a, const diyfp_t& b) {
+                unsigned __int128 p = (unsigned __int128) a.f * b.f;
+                auto h = (uint64_t) (p >> 64);
+                auto l = (uint64_t) p;
+                /* round the lower half */
+                if (l & (1ull << 63))
+                    h++;
+                return {h, a.e + b.e + 64};
+            }
+
+            inline diyfp_t normalize(const diyfp_t& v) {
+                int s = __builtin_clzll(v.f);
+                return {v.f << s, v.e - s};
+            }
+
+            struct cached_power_t {
+                uint64_t f;
+                int16_t  e;
+            };
+
+            /* normalized 10^k for k = -348, -340, ..., 340 */
+            const cached_power_t CACHED_POWERS[] = {
+            {0xfa8fd5a0081c0288ull, -1220}, {0xbaaee17fa23ebf76ull, -1193}, {0x8b16fb203055ac76ull, -1166},
+            {0xcf42894a5dce35eaull, -1140}, {0x9a6bb0aa55653b2dull, -1113}, {0xe61acf033d1a45dfull, -1087},
+            {0xab70fe17c79ac6caull, -1060}, {0xff77b1fcbebcdc4full, -1034}, {0xbe5691ef416bd60cull, -1007},
+            {0x8dd01fad907ffc3cull,  -980}, {0xd3515c2831559a83ull,  -954}, {0x9d71ac8fada6c9b5ull,  -927},
+            {0xea9c227723ee8bcbull,  -901}, {0xaecc49914078536dull,  -874}, {0x823c12795db6ce57ull,  -847},
+            {0xc21094364dfb5637ull,  -821}, {0x9096ea6f3848984full,  -794}, {0xd77485cb25823ac7ull,  -768},
+            {0xa086cfcd97bf97f4ull,  -741}, {0xef340a98172aace5ull,  -715}, {0xb23867fb2a35b28eull,  -688},
+            {0x84c8d4dfd2c63f3bull,  -661}, {0xc5dd44271ad3cdbaull,  -635}, {0x936b9fcebb25c996ull,  -608},
+            {0xdbac6c247d62a584ull,  -582}, {0xa3ab66580d5fdaf6ull,  -555}, {0xf3e2f893dec3f126ull,  -529},
+            {0xb5b5ada8aaff80b8ull,  -502}, {0x87625f056c7c4a8bull,  -475}, {0xc9bcff6034c13053ull,  -449},
+            {0x964e858c91ba2655ull,  -422}, {0xdff9772470297ebdull,  -396}, {0xa6dfbd9fb8e5b88full,  -369},
+            {0xf8a95fcf88747d94ull,  -343}, {0xb94470938fa89bcfull,  -316}, {0x8a08f0f8bf0f156bull,  -289},
+            {0xcdb02555653131b6ull,  -263}, {0x993fe2c6d07b7facull,  -236}, {0xe45c10c42a2b3b06ull,  -210},
+            {0xaa242499697392d3ull,  -183}, {0xfd87b5f28300ca0eull,  -157}, {0xbce5086492111aebull,  -130},
+            {0x8cbccc096f5088ccull,  -103}, {0xd1b71758e219652cull,   -77}, {0x9c40000000000000ull,   -50},
+            {0xe8d4a51000000000ull,   -24}, {0xad78ebc5ac620000ull,     3}, {0x813f3978f8940984ull,    30},
+            {0xc097ce7bc90715b3ull,    56}, {0x8f7e32ce7bea5c70ull,    83}, {0xd5d238a4abe98068ull,   109},
+            {0x9f4f2726179a2245ull,   136}, {0xed63a231d4c4fb27ull,   162}, {0xb0de65388cc8ada8ull,   189},
+            {0x83c7088e1aab65dbull,   216}, {0xc45d1df942711d9aull,   242}, {0x924d692ca61be758ull,   269},
+            {0xda01ee641a708deaull,   295}, {0xa26da3999aef774aull,   322}, {0xf209787bb47d6b85ull,   348},
+            {0xb454e4a179dd1877ull,   375}, {0x865b86925b9bc5c2ull,   402}, {0xc83553c5c8965d3dull,   428},
+            {0x952ab45cfa97a0b3ull,   455}, {0xde469fbd99a05fe3ull,   481}, {0xa59bc234db398c25ull,   508},
+            {0xf6c69a72a3989f5cull,   534}, {0xb7dcbf5354e9beceull,   561}, {0x88fcf317f22241e2ull,   588},
+            {0xcc20ce9bd35c78a5ull,   614}, {0x98165af37b2153dfull,   641}, {0xe2a0b5dc971f303aull,   667},
+            {0xa8d9d1535ce3b396ull,   694}, {0xfb9b7cd9a4a7443cull,   720}, {0xbb764c4ca7a44410ull,   747},
+            {0x8bab8eefb6409c1aull,   774}, {0xd01fef10a657842cull,   800}, {0x9b10a4e5e9913129ull,   827},
+            {0xe7109bfba19c0c9dull,   853}, {0xac2820d9623bf429ull,   880}, {0x80444b5e7aa7cf85ull,   907},
+            {0xbf21e44003acdd2dull,   933}, {0x8e679c2f5e44ff8full,   960}, {0xd433179d9c8cb841ull,   986},
+            {0x9e19db92b4e31ba9ull,  1013}, {0xeb96bf6ebadf77d9ull,  1039}, {0xaf87023b9bf0ee6bull,  1066},
+            };
+
+            const uint64_t POW10[] = {
+                1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull, 1000000ull, 10000000ull,
+                100000000ull, 1000000000ull, 10000000000ull, 100000000000ull, 1000000000000ull,
+                10000000000000ull, 100000000000000ull, 1000000000000000ull, 10000000000000000ull,
+                100000000000000000ull, 1000000000000000000ull, 10000000000000000000ull
+            };
+
+            /* the cached power c such that the product of c and a number with binary exponent e
+             * has a binary exponent between -60 and -32 */
+            inline diyfp_t cached_power(int e, int& K) {
+                double dk = (-61 - e) * 0.30102999566398114 + 347;
+                auto k = (int) dk;
+                if (dk - k > 0.0)
+                    k++;
+                auto index = (unsigned) ((k >> 3) + 1);
+                K = -(-348 + (int) (index << 3));
+                return {CACHED_POWERS[index].f, CACHED_POWERS[index].e};
+            }
+
+            inline void grisu_round(char *buf, int len, uint64_t delta, uint64_t rest, uint64_t tenKappa, uint64_t wpw) {
+                /* move the last digit closer to the exact value while within the rounding interval */
+                while (rest < wpw && delta - rest >= tenKappa &&
+                       (rest + tenKappa < wpw || wpw - rest > rest + tenKappa - wpw)) {
+                    buf[len-1]--;
+                    rest += tenKappa;
+                }
+            }
+
+            void digit_gen(const diyfp_t& W, const diyfp_t& Mp, uint64_t delta, char *buf, int& len, int& K) {
+                const diyfp_t one{1ull << -Mp.e, Mp.e};
+                const uint64_t wpw = Mp.f - W.f;
+                auto p1 = (uint32_t) (Mp.f >> -one.e);
+                uint64_t p2 = Mp.f & (one.f - 1);
+                auto kappa = (int) digits10(p1);
+                len = 0;
+
+                while (kappa > 0) {
+                    uint32_t d = p1 / (uint32_t) POW10[kappa-1];
+                    p1 %= (uint32_t) POW10[kappa-1];
+                    if (d || len)
+                        buf[len++] = (char) ('0' + d);
+                    kappa--;
+                    uint64_t tmp = ((uint64_t) p1 << -one.e) + p2;
+                    if (tmp <= delta) {
+                        K += kappa;
+                        grisu_round(buf, len, delta, tmp, POW10[kappa] << -one.e, wpw);
+                        return;
+                    }
+                }
+
+                while (true) {
+                    p2 *= 10;
+                    delta *= 10;
+                    auto d = (char) (p2 >> -one.e);
+                    if (d || len)
+                        buf[len++] = (char) ('0' + d);
+                    p2 &= one.f - 1;
+                    kappa--;
+                    if (p2 < delta) {
+                        K += kappa;
+                        int index = -kappa;
+                        grisu_round(buf, len, delta, p2, one.f, wpw * (index < 20? POW10[index] : 0));
+                        return;
+                    }
+                }
+            }
+
+            /* the shortest digits of f * 2^e, the value is digits * 10^K */
+            void grisu2(uint64_t f, int e, bool lowerCloser, char *buf, int& len, int& K) {
+                diyfp_t plus = normalize({(f << 1) + 1, e - 1});
+                diyfp_t minus = lowerCloser? diyfp_t{(f << 2) - 1, e - 2} : diyfp_t{(f << 1) - 1, e - 1};
+                minus.f <<= minus.e - plus.e;
+                minus.e = plus.e;
+
+                diyfp_t c = cached_power(plus.e, K);
+                diyfp_t W  = multiply(normalize({f, e}), c);
+                diyfp_t Wp = multiply(plus, c);
+                diyfp_t Wm = multiply(minus, c);
+                Wm.f++;
+                Wp.f--;
+                digit_gen(W, Wp, Wp.f - Wm.f, buf, len, K);
+            }
+
+            /* renders digits * 10^K like javascript's Number.prototype.toString */
+            size_t render(char *out, bool neg, const char *digits, int len, int K) {
+                char *p = out;
+                int kk = len + K;
+                if (neg)
+                    *p++ = '-';
+
+                if (len <= kk && kk <= 21) {
+                    /* 1234e7 -> 12340000000 */
+                    memcpy(p, digits, len);
+                    memset(p + len, '0', kk - len);
+                    p += kk;
+                }
+                else if (0 < kk && kk <= 21) {
+                    /* 1234e-2 -> 12.34 */
+                    memcpy(p, digits, kk);
+                    p[kk] = '.';
+                    memcpy(p + kk + 1, digits + kk, len - kk);
+                    p += len + 1;
+                }
+                else if (-6 < kk && kk <= 0) {
+                    /* 1234e-6 -> 0.001234 */
+                    *p++ = '0';
+                    *p++ = '.';
+                    memset(p, '0', -kk);
+                    memcpy(p - kk, digits, len);
+                    p += len - kk;
+                }
+                else {
+                    /* 1234e30 -> 1.234e+33 */
+                    *p++ = digits[0];
+                    if (len > 1) {
+                        *p++ = '.';
+                        memcpy(p, digits + 1, len - 1);
+                        p += len - 1;
+                    }
+                    *p++ = 'e';
+                    *p++ = kk > 0? '+' : '-';
+                    p += utoa((uint64_t) (kk > 0? kk - 1 : 1 - kk), p);
+                }
+
+                *p = '\0';
+                return p - out;
+            }
+
+            inline size_t special(char *out, bool neg, bool nan) {
+                const char *s = nan? "NaN" : (neg? "-Infinity" : "Infinity");
+                size_t n = strlen(s);
+                memcpy(out, s, n+1);
+                return n;
+            }
+        }
+
+        size_t utoa(uint64_t v, char *out) {
+            uint32_t n = digits10(v);
+            char *p = out + n;
+            *p = '\0';
+            while (v >= 100) {
+                auto i = (uint32_t) (v % 100) * 2;
+                v /= 100;
+                *--p = DIGITS[i+1];
+                *--p = DIGITS[i];
+            }
+            if (v < 10) {
+                *--p = (char) ('0' + v);
+            }
+            else {
+                auto i = (uint32_t) v * 2;
+                *--p = DIGITS[i+1];
+                *--p = DIGITS[i];
+            }
+            return n;
+        }
+
+        size_t itoa(int64_t v, char *out) {
+            if (v < 0) {
+                *out = '-';
+                return utoa(0 - (uint64_t) v, out+1) + 1;
+            }
+            return utoa((uint64_t) v, out);
+        }
+
+        size_t xtoa(uint64_t v, char *out, int width, bool caps) {
+            const char *hex = caps? "0123456789ABCDEF" : "0123456789abcdef";
+            int n = v? (67 - __builtin_clzll(v)) / 4 : 1;
+            if (n < width)
+                n = width;
+            out[n] = '\0';
+            for (int i = n-1; i >= 0; i--, v >>= 4)
+                out[i] = hex[v & 0xF];
+            return (size_t) n;
+        }
+
+        size_t dtoa(double v, char *out) {
+            uint64_t bits;
+            memcpy(&bits, &v, sizeof(bits));
+            bool neg = (bits >> 63) != 0;
+            auto biased = (int) ((bits >> 52) & 0x7FF);
+            uint64_t significand = bits & ((1ull << 52) - 1);
+
+            if (biased == 0x7FF)
+                return special(out, neg, significand != 0);
+            if (biased == 0 && significand == 0) {
+                /* like javascript, -0 is rendered as 0 */
+                out[0] = '0';
+                out[1] = '\0';
+                return 1;
+            }
+
+            char digits[24];
+            int len, K;
+            if (biased != 0)
+                grisu2(significand | (1ull << 52), biased - 1075, significand == 0, digits, len, K);
+            else
+                grisu2(significand, -1074, false, digits, len, K);
+            return render(out, neg, digits, len, K);
+        }
+
+        size_t ftoa(float v, char *out) {
+            uint32_t bits;
+            memcpy(&bits, &v, sizeof(bits));
+            bool neg = (bits >> 31) != 0;
+            auto biased = (int) ((bits >> 23) & 0xFF);
+            uint64_t significand = bits & ((1u << 23) - 1);
+
+            if (biased == 0xFF)
+                return special(out, neg, significand != 0);
+            if (biased == 0 && significand == 0) {
+                out[0] = '0';
+                out[1] = '\0';
+                return 1;
+            }
+
+            char digits[24];
+            int len, K;
+            if (biased != 0)
+                grisu2(significand | (1u << 23), biased - 150, significand == 0, digits, len, K);
+            else
+                grisu2(significand, -149, false, digits, len, K);
+            return render(out, neg, digits, len, K);
+        }
+    }
+}
+
+#ifdef unit_test
+#include <catch/catch.hpp>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace suil;
+
+TEST_CASE("suil::numfmt", "[numfmt]")
+{
+    char buf[64], expected[64];
+    std::mt19937_64 rng(7);
+
+    SECTION("integers are formatted like printf") {
+        for (int64_t v: std::vector<int64_t>{0, 1, -1, 9, 10, 99, 100, 12345, -100000,
+                                             INT64_MAX, INT64_MIN, INT32_MAX, INT32_MIN}) {
+            snprintf(expected, sizeof(expected), "%lld", (long long) v);
+            CHECK(numfmt::itoa(v, buf) == strlen(expected));
+            CHECK(std::string(buf) == expected);
+        }
+        CHECK(numfmt::utoa(UINT64_MAX, buf) == 20);
+        CHECK(std::string(buf) == "18446744073709551615");
+
+        for (int i = 0; i < 10000; i++) {
+            // numbers of all lengths
+            auto v = (int64_t) (rng() >> (rng() % 64));
+            snprintf(expected, sizeof(expected), "%lld", (long long) v);
+            numfmt::itoa(v, buf);
+            REQUIRE(std::string(buf) == expected);
+            snprintf(expected, sizeof(expected), "%llx", (unsigned long long) v);
+            numfmt::xtoa((uint64_t) v, buf);
+            REQUIRE(std::string(buf) == expected);
+        }
+
+        CHECK(numfmt::xtoa(0, buf) == 1);
+        CHECK(std::string(buf) == "0");
+        CHECK(numfmt::xtoa(0xBEEF, buf, 8, true) == 8);
+        CHECK(std::string(buf) == "0000BEEF");
+    }
+
+    SECTION("doubles are formatted with the shortest round trip digits") {
+        auto fmt = [&](double d) {
+            numfmt::dtoa(d, buf);
+            return std::string(buf);
+        };
+        CHECK(fmt(0.1) == "0.1");
+        CHECK(fmt(0.3) == "0.3");
+        CHECK(fmt(1.0) == "1");
+        CHECK(fmt(-1.5) == "-1.5");
+        CHECK(fmt(123.456) == "123.456");
+        CHECK(fmt(1e20) == "100000000000000000000");
+        CHECK(fmt(1e21) == "1e+21");
+        CHECK(fmt(1.5e300) == "1.5e+300");
+        CHECK(fmt(0.000001) == "0.000001");
+        CHECK(fmt(1.25e-7) == "1.25e-7");
+        CHECK(fmt(9007199254740993.0) == "9007199254740992");
+        CHECK(fmt(DBL_MAX) == "1.7976931348623157e+308");
+        CHECK(fmt(DBL_MIN) == "2.2250738585072014e-308");
+        CHECK(fmt(5e-324) == "5e-324");
+        CHECK(fmt(0.0) == "0");
+        CHECK(fmt(-0.0) == "0");
+        CHECK(fmt(NAN) == "NaN");
+        CHECK(fmt(-INFINITY) == "-Infinity");
+
+        for (int i = 0; i < 100000; i++) {
+            uint64_t bits = rng();
+            double d;
+            memcpy(&d, &bits, sizeof(d));
+            if (!std::isfinite(d))
+                continue;
+            auto n = numfmt::dtoa(d, buf);
+            REQUIRE(n < numfmt::MAX_DOUBLE);
+            REQUIRE(strtod(buf, nullptr) == d);
+        }
+        for (int i = 0; i < 10000; i++) {
+            // numbers with few significant digits
+            double d = (double) (int64_t) (rng() % 2000001 - 1000000) / 1000.0;
+            snprintf(expected, sizeof(expected), "%.15g", d);
+            REQUIRE(strlen(fmt(d).c_str()) <= strlen(expected));
+        }
+    }
+
+    SECTION("floats are formatted with the shortest round trip digits") {
+        auto fmt = [&](float f) {
+            numfmt::ftoa(f, buf);
+            return std::string(buf);
+        };
+        CHECK(fmt(1.1f) == "1.1");
+        CHECK(fmt(0.3f) == "0.3");
+        CHECK(fmt(16777216.0f) == "16777216");
+        CHECK(fmt(FLT_MAX) == "3.4028235e+38");
+        CHECK(fmt(1e-45f) == "1e-45");
+
+        for (int i = 0; i < 100000; i++) {
+            auto bits = (uint32_t) rng();
+            float f;
+            memcpy(&f, &bits, sizeof(f));
+            if (!std::isfinite(f))
+                continue;
+            numfmt::ftoa(f, buf);
+            REQUIRE(strtof(buf, nullptr) == f);
+        }
+    }
+}
+
+TEST_CASE("suil::numfmt benchmark", "[.][benchmark][numfmt]")
+{
+    using Clock = std::chrono::steady_clock;
+    std::mt19937_64 rng(7);
+    std::vector<int64_t> ints(1000000);
+    std::vector<double> doubles(1000000);
+    for (size_t i = 0; i < ints.size(); i++) {
+        ints[i] = (int64_t) (rng() >> (rng() % 64));
+        doubles[i] = (double) (int64_t) (rng() % 100000000) / 1000.0 * ((i % 3)? 1.0 : 1e-9);
+    }
+
+    char buf[64];
+    size_t total{0};
+    auto start = Clock::now();
+    for (auto v: ints)
+        total += snprintf(buf, sizeof(buf), "%lld", (long long) v);
+    auto sprintfInts = Clock::now() - start;
+
+    start = Clock::now();
+    for (auto v: ints)
+        total -= numfmt::itoa(v, buf);
+    auto itoaInts = Clock::now() - start;
+    REQUIRE(total == 0);
+
+    start = Clock::now();
+    for (auto v: doubles)
+        total += snprintf(buf, sizeof(buf), "%.17g", v);
+    auto sprintfDoubles = Clock::now() - start;
+
+    start = Clock::now();
+    for (auto v: doubles)
+        total += numfmt::dtoa(v, buf);
+    auto dtoaDoubles = Clock::now() - start;
+
+    using us = std::chrono::microseconds;
+    WARN(ints.size() << " integers, snprintf: " << std::chrono::duration_cast<us>(sprintfInts).count()
+         << " us, itoa: " << std::chrono::duration_cast<us>(itoaInts).count() << " us");
+    WARN(doubles.size() << " doubles, snprintf(%.17g): " << std::chrono::duration_cast<us>(sprintfDoubles).count()
+         << " us, dtoa: " << std::chrono::duration_cast<us>(dtoaDoubles).count() << " us");
+}
+#endif
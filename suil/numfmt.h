@@ -0,0 +1,62 @@
+//
+// Fast number formatting
+//
+
+#ifndef SUIL_NUMFMT_H
+#define SUIL_NUMFMT_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace suil {
+
+    /**
+     * Number to text conversions used where numbers are serialized (JSON, output
+     * buffers, HTTP headers). Integers are converted two digits at a time from a
+     * lookup table, doubles are converted to the shortest string that parses back
+     * to the same value (Grisu2) and rendered the way JavaScript renders numbers.
+     *
+     * The functions write into the given buffer, which must be at least \a MAX_INTEGER
+     * (or \a MAX_DOUBLE) bytes, null terminate it and return the number of characters
+     * written (excluding the null terminator).
+     */
+    namespace numfmt {
+
+        /* the buffer size required to format any integer, "-9223372036854775808" */
+        static constexpr size_t MAX_INTEGER{21};
+        /* the buffer size required to format any double, e.g "-1.2345678901234567e-308" */
+        static constexpr size_t MAX_DOUBLE{26};
+
+        /**
+         * formats the given unsigned integer in base 10
+         */
+        size_t utoa(uint64_t v, char *out);
+
+        /**
+         * formats the given signed integer in base 10
+         */
+        size_t itoa(int64_t v, char *out);
+
+        /**
+         * formats the given unsigned integer in base 16
+         * @param width the minimum number of digits, the number is padded with 0's
+         * @param caps true to use upper case digits
+         */
+        size_t xtoa(uint64_t v, char *out, int width = 0, bool caps = false);
+
+        /**
+         * formats the given double with the least number of digits needed to
+         * parse back to the same value, e.g 0.1, 1.5e+300, 123456789012
+         * Not-a-number and infinite values are formatted as NaN, Infinity and -Infinity
+         */
+        size_t dtoa(double v, char *out);
+
+        /**
+         * formats the given float with the least number of digits needed to
+         * parse back (as a float) to the same value
+         */
+        size_t ftoa(float v, char *out);
+    }
+}
+
+#endif //SUIL_NUMFMT_H
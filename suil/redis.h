@@ -8,6 +8,7 @@
 
 #include <deque>
 #include <suil/net.h>
+#include <suil/resolver.h>
 #include <suil/blob.h>
 
 namespace suil {
@@ -702,7 +703,8 @@ namespace suil {
         struct RedisDb : LOGGER(REDIS) {
             template <typename... Args>
             RedisDb(const char *host, int port, Args... args)
-                : addr(ipremote(host, port, 0, utils::after(3000)))
+                : host(String{host}.dup()),
+                  port(port)
             {
                 utils::apply_config(config, args...);
             }
@@ -712,14 +714,22 @@ namespace suil {
 
             template <typename Opts>
             void configure(const char *host, int port, Opts& opts) {
-                addr = ipremote(host, port, 0, utils::after(3000));
+                Ego.host = String{host}.dup();
+                Ego.port = port;
                 utils::apply_options(Ego.config, opts);
             }
 
             Client<Proto> connect(int db = 0) {
                 Proto proto;
                 trace("opening redis Connection");
+                /* resolved on every connect as the server address might change */
+                addr = ipresolve(host.data(), port, 0, 3000);
+                if (errno != 0) {
+                    throw Exception::create("resolving redis server '",
+                            host, ":", port, "' failed: ", errno_s);
+                }
                 if (!proto.connect(addr, config.timeout)) {
+                    Resolver::get().failed(host.data(), addr);
                     throw Exception::create("connecting to redis server '",
                             ipstr(addr), "' failed: ", errno_s);
                 }
@@ -764,7 +774,9 @@ namespace suil {
 
         private:
 
-            ipaddr         addr;
+            String         host{};
+            int            port{6379};
+            ipaddr         addr{};
             redisdb_config config{1500, ""};
             ServerInfo     srvinfo;
         };
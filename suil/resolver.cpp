@@ -0,0 +1,393 @@
+//
+// Caching asynchronous DNS resolver
+//
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <netdb.h>
+#include <poll.h>
+
+#include <suil/resolver.h>
+#include <suil/sock.h>
+
+extern "C" {
+/* dns.h uses C++ keywords as field names */
+#define class dns_class_
+#define _Bool bool
+#include <libmill/dns/dns.h>
+#undef _Bool
+#undef class
+}
+
+namespace suil {
+
+    namespace {
+
+        struct dns_config_t {
+            dns_config_t() {
+                int rc{0};
+                conf = dns_resconf_local(&rc);
+                if (conf != nullptr) {
+                    hosts = dns_hosts_local(&rc);
+                    hints = dns_hints_local(conf, &rc);
+                }
+            }
+
+            ~dns_config_t() {
+                if (hints) dns_hints_close(hints);
+                if (hosts) dns_hosts_close(hosts);
+                if (conf)  dns_resconf_close(conf);
+            }
+
+            inline bool ok() const {
+                return conf && hosts && hints;
+            }
+
+            struct dns_resolv_conf *conf{nullptr};
+            struct dns_hosts       *hosts{nullptr};
+            struct dns_hints       *hints{nullptr};
+        };
+
+        /* resolver configuration files are loaded once per thread */
+        dns_config_t& dnsconfig() {
+            static thread_local dns_config_t config;
+            return config;
+        }
+
+        inline int family(const ipaddr& addr) {
+            return ((const struct sockaddr *)&addr)->sa_family;
+        }
+
+        inline bool sameaddr(const ipaddr& a, const ipaddr& b) {
+            if (family(a) != family(b))
+                return false;
+            if (family(a) == AF_INET)
+                return ((const sockaddr_in *)&a)->sin_addr.s_addr ==
+                       ((const sockaddr_in *)&b)->sin_addr.s_addr;
+            return memcmp(&((const sockaddr_in6 *)&a)->sin6_addr,
+                          &((const sockaddr_in6 *)&b)->sin6_addr, sizeof(in6_addr)) == 0;
+        }
+
+        inline bool isliteral(const char *name) {
+            char buf[sizeof(in6_addr)];
+            return inet_pton(AF_INET, name, buf) == 1 || inet_pton(AF_INET6, name, buf) == 1;
+        }
+    }
+
+    Resolver& Resolver::get() {
+        static thread_local Resolver resolver;
+        return resolver;
+    }
+
+    bool Resolver::query(std::vector<record_t>& out, int64_t& ttl, const char *name, int type, int64_t dd) {
+        auto& config = dnsconfig();
+        if (!config.ok()) {
+            errno = ENOENT;
+            return false;
+        }
+
+        int rc{0};
+        struct dns_options opts;
+        memset(&opts, 0, sizeof(opts));
+        std::unique_ptr<struct dns_resolver, decltype(&dns_res_close)> res{
+            dns_res_open(config.conf, config.hosts, config.hints, nullptr, &opts, &rc), dns_res_close};
+        if (res == nullptr) {
+            errno = rc > 0? rc : ENOMEM;
+            return false;
+        }
+
+        rc = dns_res_submit(res.get(), name, (enum dns_type) type, DNS_C_IN);
+        while (rc == 0 && (rc = dns_res_check(res.get())) == EAGAIN) {
+            /* wait for the name server without blocking the other coroutines */
+            int64_t now = mnow();
+            if (dd >= 0 && now >= dd) {
+                errno = ETIMEDOUT;
+                return false;
+            }
+            int64_t wait = now + std::max<int64_t>(dns_res_timeout(res.get()), 0) * 1000;
+            if (dd >= 0 && dd < wait)
+                wait = dd;
+
+            int fd = dns_res_pollfd(res.get());
+            if (fd < 0) {
+                msleep(std::min(wait, now + 10));
+                continue;
+            }
+            int events = dns_res_events(res.get());
+            events = ((events & DNS_POLLIN)? FDW_IN : 0) | ((events & DNS_POLLOUT)? FDW_OUT : 0);
+            fdwait(fd, events? events : FDW_IN, wait);
+            /* the resolver might use a different descriptor next time */
+            fdclean(fd);
+            rc = 0;
+        }
+
+        if (rc != 0) {
+            strace("%s - resolving failed: %s", name, dns_strerror(rc));
+            errno = rc > 0? rc : ENOENT;
+            return false;
+        }
+
+        std::unique_ptr<struct dns_packet, decltype(&free)> pkt{dns_res_fetch(res.get(), &rc), free};
+        if (pkt == nullptr) {
+            errno = rc > 0? rc : ENOENT;
+            return false;
+        }
+
+        struct dns_rr_i it;
+        memset(&it, 0, sizeof(it));
+        it.section = DNS_S_AN;
+        it.type    = (enum dns_type) type;
+        dns_rr_i_init(&it, pkt.get());
+
+        struct dns_rr rr;
+        rc = 0;
+        while (dns_rr_grep(&rr, 1, &it, pkt.get(), &rc)) {
+            record_t rec{};
+            if (rr.type == DNS_T_A) {
+                struct dns_a a;
+                if (dns_a_parse(&a, &rr, pkt.get()))
+                    continue;
+                auto *sa = (sockaddr_in *) &rec.addr;
+                sa->sin_family = AF_INET;
+                sa->sin_addr   = a.addr;
+            }
+            else if (rr.type == DNS_T_AAAA) {
+                struct dns_aaaa aaaa;
+                if (dns_aaaa_parse(&aaaa, &rr, pkt.get()))
+                    continue;
+                auto *sa = (sockaddr_in6 *) &rec.addr;
+                sa->sin6_family = AF_INET6;
+                sa->sin6_addr   = aaaa.addr;
+            }
+            else {
+                continue;
+            }
+
+            ttl = std::min<int64_t>(ttl, int64_t(rr.ttl) * 1000);
+            out.push_back(rec);
+        }
+
+        return true;
+    }
+
+    void Resolver::lookup(entry_t& entry, const char *name, int mode, int64_t timeout) {
+        int64_t dd = timeout < 0? -1 : mnow() + timeout;
+        int first  = (mode == IPADDR_IPV6 || mode == IPADDR_PREF_IPV6)? DNS_T_AAAA : DNS_T_A;
+        int second = first == DNS_T_A? DNS_T_AAAA : DNS_T_A;
+
+        std::vector<record_t> records;
+        int64_t ttl{maxTtl};
+        bool ok = query(records, ttl, name, first, dd);
+        if (records.empty() && (mode == IPADDR_PREF_IPV4 || mode == IPADDR_PREF_IPV6)) {
+            /* fallback to the other family */
+            ok = query(records, ttl, name, second, dd);
+        }
+
+        entry.mode = mode;
+        entry.refreshing = false;
+        if (!ok || records.empty()) {
+            entry.error = ok? ENOENT : errno;
+            entry.records.clear();
+            entry.ttl = negativeTtl;
+            entry.expires = mnow() + negativeTtl;
+            idebug("%s - lookup failed: %s", name, strerror(entry.error));
+            return;
+        }
+
+        /* keep the down status of addresses that were not changed */
+        for (auto& rec: records) {
+            for (auto& old: entry.records) {
+                if (sameaddr(rec.addr, old.addr)) {
+                    rec.down = old.down;
+                    break;
+                }
+            }
+        }
+
+        entry.ttl     = std::max(minTtl, std::min(maxTtl, ttl));
+        entry.expires = mnow() + entry.ttl;
+        entry.error   = 0;
+        entry.records = std::move(records);
+        if (entry.next >= entry.records.size())
+            entry.next = 0;
+        trace("%s - resolved %zu addresses, ttl %ld ms", name, entry.records.size(), entry.ttl);
+    }
+
+    void Resolver::refresh(String name) {
+        entry_t tmp;
+        auto it = entries.find(name);
+        if (it == entries.end())
+            return;
+        /* the map might change while waiting for the name server */
+        tmp = it->second;
+        lookup(tmp, name(), tmp.mode, 3000);
+
+        it = entries.find(name);
+        if (it != entries.end()) {
+            if (tmp.error && !it->second.records.empty()) {
+                /* keep using the known addresses, refresh again later */
+                it->second.refreshing = false;
+                it->second.expires = std::max(it->second.expires, mnow() + negativeTtl);
+            }
+            else {
+                tmp.next = it->second.next < tmp.records.size()? it->second.next : 0;
+                it->second = std::move(tmp);
+            }
+        }
+    }
+
+    ipaddr Resolver::pick(entry_t& entry, int port, int mode) {
+        ipaddr addr{};
+        size_t n = entry.records.size();
+        int64_t now = mnow();
+        size_t i = entry.next % n;
+        for (size_t k = 0; k < n; k++) {
+            /* skip addresses that recently failed */
+            auto& rec = entry.records[(entry.next + k) % n];
+            if (rec.down <= now) {
+                i = (entry.next + k) % n;
+                break;
+            }
+        }
+        entry.next = (i + 1) % n;
+
+        addr = entry.records[i].addr;
+        if (family(addr) == AF_INET)
+            ((sockaddr_in *) &addr)->sin_port = htons((uint16_t) port);
+        else
+            ((sockaddr_in6 *) &addr)->sin6_port = htons((uint16_t) port);
+        errno = 0;
+        return addr;
+    }
+
+    ipaddr Resolver::resolve(const char *name, int port, int mode, int64_t timeout) {
+        if (name == nullptr || isliteral(name)) {
+            /* no need to lookup literal addresses */
+            return ipremote(name, port, mode, -1);
+        }
+
+        if (mode == 0)
+            mode = IPADDR_PREF_IPV4;
+
+        auto it = entries.find(String{name});
+        if (it == entries.end())
+            it = entries.emplace(String{name}.dup(), entry_t{}).first;
+        /* lookups yield and other coroutines might insert entries causing a rehash,
+         * iterators are invalidated but references to elements remain valid */
+        auto& entry = it->second;
+        int64_t now = mnow();
+        if (entry.mode != mode || entry.expires <= now) {
+            /* new, looked up for another mode or expired, cannot serve stale addresses */
+            lookup(entry, name, mode, timeout);
+        }
+        else if (!entry.error && !entry.refreshing && (entry.expires - entry.ttl/5) <= now) {
+            /* about to expire, refresh in the background */
+            entry.refreshing = true;
+            go(refresher(this, String{name}.dup()));
+        }
+
+        if (entry.records.empty()) {
+            errno = entry.error? entry.error : ENOENT;
+            ipaddr addr{};
+            ((struct sockaddr *)&addr)->sa_family = AF_UNSPEC;
+            return addr;
+        }
+
+        return pick(entry, port, mode);
+    }
+
+    void Resolver::failed(const char *name, const ipaddr& addr) {
+        auto it = entries.find(String{name});
+        if (it == entries.end())
+            return;
+
+        for (auto& rec: it->second.records) {
+            if (sameaddr(rec.addr, addr)) {
+                rec.down = mnow() + downTime;
+                idebug("%s - %s marked down for %ld ms", name, ipstr(addr), downTime);
+                break;
+            }
+        }
+    }
+
+    size_t Resolver::cached(const char *name) const {
+        auto it = entries.find(String{name});
+        return it == entries.end()? 0 : it->second.records.size();
+    }
+
+    coroutine void Resolver::refresher(Resolver *r, String name) {
+        r->refresh(std::move(name));
+    }
+}
+
+#ifdef unit_test
+#include <catch/catch.hpp>
+
+using namespace suil;
+
+TEST_CASE("suil::Resolver", "[resolver]")
+{
+    Resolver resolver;
+
+    SECTION("literal addresses are not cached") {
+        auto addr = resolver.resolve("127.0.0.1", 8080);
+        REQUIRE(errno == 0);
+        CHECK(strcmp(ipstr(addr), "127.0.0.1") == 0);
+        CHECK(ntohs(((sockaddr_in *) &addr)->sin_port) == 8080);
+        CHECK(resolver.cached("127.0.0.1") == 0);
+    }
+
+    SECTION("resolved addresses are cached") {
+        auto addr = resolver.resolve("localhost", 80, IPADDR_IPV4);
+        REQUIRE(errno == 0);
+        CHECK(strcmp(ipstr(addr), "127.0.0.1") == 0);
+        CHECK(ntohs(((sockaddr_in *) &addr)->sin_port) == 80);
+        CHECK(resolver.cached("localhost") == 1);
+
+        /* served from the cache with the requested port */
+        addr = resolver.resolve("localhost", 443, IPADDR_IPV4);
+        REQUIRE(errno == 0);
+        CHECK(ntohs(((sockaddr_in *) &addr)->sin_port) == 443);
+    }
+
+    SECTION("addresses are used in a round robin fashion") {
+        Resolver::entry_t entry;
+        for (int i = 1; i <= 3; i++) {
+            Resolver::record_t rec{};
+            auto *sa = (sockaddr_in *) &rec.addr;
+            sa->sin_family = AF_INET;
+            sa->sin_addr.s_addr = htonl(0x0A000000 | i);
+            entry.records.push_back(rec);
+        }
+        entry.mode    = IPADDR_PREF_IPV4;
+        entry.ttl     = 60000;
+        entry.expires = mnow() + entry.ttl;
+        resolver.entries.emplace(String{"cluster.test"}.dup(), std::move(entry));
+
+        CHECK(strcmp(ipstr(resolver.resolve("cluster.test", 80)), "10.0.0.1") == 0);
+        CHECK(strcmp(ipstr(resolver.resolve("cluster.test", 80)), "10.0.0.2") == 0);
+        CHECK(strcmp(ipstr(resolver.resolve("cluster.test", 80)), "10.0.0.3") == 0);
+        CHECK(strcmp(ipstr(resolver.resolve("cluster.test", 80)), "10.0.0.1") == 0);
+
+        /* failed addresses are skipped */
+        resolver.failed("cluster.test", resolver.resolve("cluster.test", 80));
+        CHECK(strcmp(ipstr(resolver.resolve("cluster.test", 80)), "10.0.0.3") == 0);
+        CHECK(strcmp(ipstr(resolver.resolve("cluster.test", 80)), "10.0.0.1") == 0);
+        CHECK(strcmp(ipstr(resolver.resolve("cluster.test", 80)), "10.0.0.3") == 0);
+    }
+
+    SECTION("failed lookups are cached") {
+        Resolver::entry_t entry;
+        entry.mode    = IPADDR_PREF_IPV4;
+        entry.error   = ENOENT;
+        entry.ttl     = resolver.negativeTtl;
+        entry.expires = mnow() + entry.ttl;
+        resolver.entries.emplace(String{"unknown.test"}.dup(), std::move(entry));
+
+        resolver.resolve("unknown.test", 80);
+        CHECK(errno == ENOENT);
+        CHECK(resolver.cached("unknown.test") == 0);
+    }
+}
+#endif
@@ -0,0 +1,115 @@
+//
+// Caching asynchronous DNS resolver
+//
+
+#ifndef SUIL_RESOLVER_H
+#define SUIL_RESOLVER_H
+
+#include <suil/utils.h>
+#include <suil/logging.h>
+
+namespace suil {
+
+    define_log_tag(RESOLVER);
+
+    /**
+     * A DNS resolver shared by all the clients running on the current thread
+     * (HTTP client, Redis and SMTP). Answers are cached for the TTL reported by
+     * the name server, failed lookups are cached for a short period, hosts with
+     * multiple addresses are used in a round robin fashion, and entries that
+     * are about to expire are refreshed in the background while the cached
+     * addresses keep being served.
+     */
+    struct Resolver : LOGGER(RESOLVER) {
+
+        /**
+         * @return the resolver for the current thread
+         */
+        static Resolver& get();
+
+        /**
+         * resolves the given host name, using the cache whenever possible
+         *
+         * @param name the host name (or a literal IP address) to resolve
+         * @param port the port number to set on the returned address
+         * @param mode one of IPADDR_IPV4, IPADDR_IPV6, IPADDR_PREF_IPV4,
+         * IPADDR_PREF_IPV6 (0 is equivalent to IPADDR_PREF_IPV4)
+         * @param timeout the time to wait for the name server in milliseconds
+         *
+         * @return the next available address of the host. On failure errno is
+         * set to a non-zero value (ETIMEDOUT, ENOENT...)
+         */
+        ipaddr resolve(const char *name, int port, int mode = 0, int64_t timeout = 3000);
+
+        /**
+         * reports that connecting to the given address failed, the address
+         * will be skipped for \a downTime milliseconds unless all the addresses
+         * of the host are down
+         *
+         * @param name the host name the address was resolved from
+         * @param addr the address that could not be reached
+         */
+        void failed(const char *name, const ipaddr& addr);
+
+        /**
+         * @return the number of cached addresses of the given host, 0 if the
+         * host is not cached
+         */
+        size_t cached(const char *name) const;
+
+        /**
+         * drops all the cached addresses, forcing the next \a resolve to
+         * query the name server
+         */
+        void clear() {
+            /* entries are not erased as pending lookups reference them */
+            for (auto& e: entries) {
+                e.second.records.clear();
+                e.second.expires = 0;
+            }
+        }
+
+        /* lower bound of the time (ms) an answer is cached */
+        int64_t minTtl{1000};
+        /* upper bound of the time (ms) an answer is cached */
+        int64_t maxTtl{300000};
+        /* the time (ms) a failed lookup is cached */
+        int64_t negativeTtl{5000};
+        /* the time (ms) an address is skipped after a connection failure */
+        int64_t downTime{10000};
+
+    private suil_ut:
+        struct record_t {
+            ipaddr  addr;
+            int64_t down{0};
+        };
+
+        struct entry_t {
+            std::vector<record_t> records;
+            size_t  next{0};
+            int64_t expires{0};
+            int64_t ttl{0};
+            int     error{0};
+            int     mode{0};
+            bool    refreshing{false};
+        };
+
+        void lookup(entry_t& entry, const char *name, int mode, int64_t timeout);
+        void refresh(String name);
+        static void refresher(Resolver *r, String name);
+        ipaddr pick(entry_t& entry, int port, int mode);
+        static bool query(std::vector<record_t>& out, int64_t& ttl, const char *name, int type, int64_t dd);
+
+        Map<entry_t> entries;
+    };
+
+    /**
+     * resolves \param name using the thread's shared resolver
+     * @see Resolver::resolve
+     */
+    inline ipaddr ipresolve(const char *name, int port, int mode = 0, int64_t timeout = 3000) {
+        return Resolver::get().resolve(name, port, mode, timeout);
+    }
+}
+
+#endif //SUIL_RESOLVER_H
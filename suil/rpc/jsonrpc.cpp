@@ -20,14 +20,15 @@ namespace suil::rpc {
     {
         Ego.handler = h;
         try {
-            OBuffer ob{1024};
+            OBuffer ob{1024}, out{1024};
             do {
                 ob.reset(1024, true);
                 if (!Ego.receiveRaw(sock, ob))
                     break;
 
-                auto resp = handleRequest(ob);
-                if (!Ego.sendRaw(sock, resp))
+                out.reset(1024, true);
+                handleRequest(out, ob);
+                if (!Ego.sendRaw(sock, out.cdata()))
                     break;
 
             } while (sock.isopen());
@@ -42,7 +43,10 @@ namespace suil::rpc {
     String JsonRpcServerConnection::parse_Request(std::vector<JrpcRequest> &req, const suil::OBuffer &ob)
     {
         try {
-            json::decode(ob, req);
+            if (msgpack::detect(ob.data(), ob.size()))
+                msgpack::decode(ob, req);
+            else
+                json::decode(ob, req);
             return nullptr;
         }
         catch (...) {
@@ -51,7 +55,7 @@ namespace suil::rpc {
         }
     }
 
-    std::string JsonRpcServerConnection::handleRequest(const OBuffer &buf)
+    void JsonRpcServerConnection::handleRequest(OBuffer& out, const OBuffer &buf)
     {
         std::vector<JrpcResponse> resps{};
         std::vector<JrpcRequest>  reqs;
@@ -83,15 +87,19 @@ namespace suil::rpc {
                 json::Object &obj = (*req.params).empty() ? __ : *req.params;
                 if (req.method.substr(0, 4) == "rpc_") {
                     /* system extension method */
-                    resps.push_back(handle_Extension(req.method, obj, req.id));
+                    resps.push_back(handle_Extension(req.method, obj, *req.id));
                 } else {
                     /* parse to service handler */
-                    resps.push_back(handle_WithHandler(*handler, req.method, obj, req.id));
+                    resps.push_back(handle_WithHandler(*handler, req.method, obj, *req.id));
                 }
             }
         }
 
-        return json::encode(resps);
+        /* respond with the encoding used by the request */
+        if (msgpack::detect(buf.data(), buf.size()))
+            msgpack::encode(resps, out);
+        else
+            json::encode(resps, out);
     }
 
     JrpcResponse JsonRpcServerConnection::handle_WithHandler(
@@ -211,8 +219,12 @@ namespace suil::rpc {
     {
         std::vector<JrpcResponse> resps;
         /* encode request and send */
-        auto raw = json::encode(package);
-        if (!Ego.sendRaw(sock, raw)) {
+        OBuffer raw{1024};
+        if (useMsgPack)
+            msgpack::encode(package, raw);
+        else
+            json::encode(package, raw);
+        if (!Ego.sendRaw(sock, raw.cdata())) {
             /* sending failed */
             throw Exception::create(JRPC_INTERNAL_ERROR, "Sending requests JSON RPC server failed - ", errno_s);
         }
@@ -225,7 +237,10 @@ namespace suil::rpc {
 
         try {
             /* decode received responses */
-            json::decode(rxb, resps);
+            if (msgpack::detect(rxb.data(), rxb.size()))
+                msgpack::decode(rxb, resps);
+            else
+                json::decode(rxb, resps);
         }
         catch (...) {
             /* server returned junk */
@@ -273,4 +288,127 @@ namespace suil::rpc {
         return std::move(res);
     }
 
-}
\ No newline at end of file
+}
+#ifdef unit_test
+#include <catch/catch.hpp>
+
+using namespace suil;
+using namespace suil::rpc;
+
+namespace {
+    /* echoes the parameters of the `echo` method */
+    struct EchoHandler : JsonRpcHandler {
+        ReturnType operator()(const String& method, const json::Object& params, int id) override {
+            if (method == "echo")
+                return std::make_pair(0, json::Object(params));
+            return JsonRpcHandler::operator()(method, params, id);
+        }
+    };
+}
+
+static std::vector<JrpcRequest> testRequests() {
+    std::vector<JrpcRequest> reqs(2);
+    for (auto& req: reqs)
+        iod::zero(req);
+    reqs[0].jsonrpc = JSON_RPC_VERSION;
+    reqs[0].method  = "echo";
+    reqs[0].id      = 1;
+    reqs[0].params  = json::Object(json::Obj, "name", "Carter", "age", 42);
+    reqs[1].jsonrpc = JSON_RPC_VERSION;
+    reqs[1].method  = "rpc_Version";
+    reqs[1].id      = 2;
+    return reqs;
+}
+
+static int freeport() {
+    tcpsock ls = tcplisten(iplocal("127.0.0.1", 0, 0), 1);
+    int port = tcpport(ls);
+    tcpclose(ls);
+    return port;
+}
+
+static coroutine void runServer(JsonRpcServer& srv, bool& done) {
+    srv.run();
+    done = true;
+}
+
+TEST_CASE("suil::rpc::JsonRpc MessagePack", "[rpc][jsonrpc]")
+{
+    EchoHandler handler;
+
+    SECTION("requests are answered with the encoding they were sent in") {
+        JsonRpcServerConnection conn;
+        conn.handler = &handler;
+        auto reqs = testRequests();
+
+        OBuffer in{256}, out{256};
+        msgpack::encode(reqs, in);
+        REQUIRE(msgpack::detect(in.data(), in.size()));
+        conn.handleRequest(out, in);
+        REQUIRE(msgpack::detect(out.data(), out.size()));
+
+        std::vector<JrpcResponse> resps;
+        msgpack::decode(out, resps);
+        REQUIRE(resps.size() == 2);
+        CHECK(*resps[0].id == 1);
+        CHECK_FALSE(resps[0].error);
+        REQUIRE(resps[0].result);
+        CHECK((String) (*resps[0].result)["name"] == "Carter");
+        CHECK((int) (*resps[0].result)["age"] == 42);
+        CHECK(*resps[1].id == 2);
+        REQUIRE(resps[1].result);
+        CHECK((String) *resps[1].result == SUIL_VERSION_STRING);
+
+        // JSON requests are still answered in JSON
+        in.reset(256, true);
+        out.reset(256, true);
+        json::encode(reqs, in);
+        conn.handleRequest(out, in);
+        REQUIRE(out.size() > 0);
+        CHECK_FALSE(msgpack::detect(out.data(), out.size()));
+        CHECK(out.data()[0] == '[');
+    }
+
+    SECTION("malformed MessagePack requests are parse errors") {
+        JsonRpcServerConnection conn;
+        conn.handler = &handler;
+        auto reqs = testRequests();
+        OBuffer in{256}, out{256};
+        msgpack::encode(reqs, in);
+        // truncate the payload
+        in.seek(-4);
+
+        conn.handleRequest(out, in);
+        std::vector<JrpcResponse> resps;
+        msgpack::decode(out, resps);
+        REQUIRE(resps.size() == 1);
+        REQUIRE(resps[0].error);
+        CHECK(resps[0].error->code == JRPC_PARSE_ERROR);
+    }
+
+    SECTION("a client using MessagePack talks to the server") {
+        int port = freeport();
+        bool done{false};
+        JsonRpcServer srv(handler, opt(port, port));
+        REQUIRE(srv.listen() == 0);
+        go(runServer(srv, done));
+        {
+            JsonRpcClient client;
+            client.useMsgPack = true;
+            REQUIRE(client.connect("127.0.0.1", port));
+            auto [code, ret] = client.call("echo", "name", "Carter", "age", 42);
+            CHECK(code == 0);
+            CHECK((String) ret["name"] == "Carter");
+            CHECK((int) ret["age"] == 42);
+
+            // errors returned by the handler are API errors
+            auto [err, msg] = client.call("unknown");
+            CHECK(err == JRPC_API_ERROR);
+        }
+        srv.stop();
+        for (int i = 0; i < 100 && !done; i++)
+            msleep(mnow() + 10);
+        CHECK(done);
+    }
+}
+#endif
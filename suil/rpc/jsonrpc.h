@@ -6,6 +6,7 @@
 #define SUIL_JSONRPC_H
 
 #include <suil/json.h>
+#include <suil/msgpack.h>
 #include <suil/rpc/common.h>
 
 #ifndef JSON_RPC_VERSION
@@ -53,15 +54,15 @@ namespace suil::rpc {
 
         void operator()(SocketAdaptor& sock, JsonRpcHandler *h);
 
-    private:
+    private suil_ut:
         json::Object getVersion();
         json::Object rpcConfigure(json::Object &obj);
         String parse_Request(std::vector<JrpcRequest>& req, const OBuffer& ob);
-        std::string handleRequest(const OBuffer &req);
+        void handleRequest(OBuffer& out, const OBuffer &req);
         JrpcResponse handle_Extension(const String& method, const json::Object& req, int id = 0);
         JrpcResponse handle_WithHandler(JsonRpcHandler& h, const String& method, const json::Object& req, int id);
 
-    private:
+    private suil_ut:
         using ExtensionMethod = std::function<ReturnType(const json::Object& params)>;
         JsonRpcHandler      *handler;
         Map<ExtensionMethod> extensionMethods{};
@@ -104,6 +105,10 @@ namespace suil::rpc {
 
         ReturnType call(String&& method, json::Object&& params);
 
+        /* encode requests as MessagePack instead of JSON, the server
+         * detects the encoding and responds with the same */
+        bool useMsgPack{false};
+
         template <typename... Args>
         std::vector<ReturnType> batch(String&& method, json::Object&& params, Args... args) {
             std::vector<JrpcRequest> package;
@@ -2,6 +2,8 @@
 // Created by dc on 30/10/18.
 //
 
+#include <sys/socket.h>
+
 #include <suil/sock.h>
 
 namespace suil {
@@ -153,6 +155,12 @@ namespace suil {
         return raw != nullptr;
     }
 
+    void SslSock::shutdown() {
+        if (isopen()) {
+            sslshutdown(raw, SHUT_RDWR);
+        }
+    }
+
     void SslSock::close() {
         if (isopen()) {
             flush(500);
@@ -320,6 +328,12 @@ namespace suil {
         return raw != nullptr;
     }
 
+    void TcpSock::shutdown() {
+        if (raw != nullptr) {
+            tcpshutdown(raw, SHUT_RDWR);
+        }
+    }
+
     void TcpSock::close() {
         if (raw != nullptr) {
             tcpclose(raw);
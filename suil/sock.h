@@ -61,6 +61,9 @@ namespace suil {
                                   size_t,
                                   int64_t timeout = -1) = 0;
         virtual bool isopen() const  = 0;
+        /* shuts the connection down without closing the socket, a coroutine
+         * blocked on the socket wakes up and fails */
+        virtual void shutdown() = 0;
         virtual void close() = 0;
 
         const char *id() {
@@ -122,6 +125,8 @@ namespace suil {
 
         virtual bool isopen() const;
 
+        virtual void shutdown();
+
         virtual void close() ;
 
         virtual ~SslSock();
@@ -165,6 +170,8 @@ namespace suil {
 
         virtual bool isopen() const;
 
+        virtual void shutdown();
+
         virtual void close();
 
         virtual void buffering(bool on, int64_t dd) {
@@ -5,6 +5,9 @@
 #ifndef SUIL_ORM_HPP
 #define SUIL_ORM_HPP
 
+#include <atomic>
+#include <map>
+
 #include <iod/utils.hh>
 #include <suil/utils.h>
 #include <suil/logging.h>
@@ -29,6 +32,23 @@ namespace suil {
             template <typename T>
             using remove_primary_keys_t =
             decltype(suil::__internal::remove_members_with_attribute(std::declval<T>(), sym(PRIMARY_KEY)));
+
+            /* the schema of a type, meta types declare their schema */
+            template <typename T, typename = void>
+            struct schema_of {
+                using type = T;
+            };
+
+            template <typename T>
+            struct schema_of<T, typename std::enable_if<std::is_base_of<iod::MetaType, T>::value>::type> {
+                using type = typename T::Schema;
+            };
+
+            /* allocates a statement slot, unique across all generated statements */
+            inline size_t statement_slot() {
+                static std::atomic<size_t> next{0};
+                return next++;
+            }
         }
 
         template<typename Connection, typename Type, typename Schema = Type>
@@ -45,6 +65,13 @@ namespace suil {
             static_assert(!std::is_same<PrimaryKeys, void>::value,
                 "ORM requires that at least 1 member of CRUD be a primary key");
 
+            /* a generated statement, its slot binds it to the prepared statement
+             * of each connection without looking up the statement text */
+            struct Statement {
+                String text;
+                size_t slot;
+            };
+
             Orm(const suil::String&& tbl, Connection& conn)
                 : conn(conn.get()),
                   table(std::move(tbl))
@@ -53,67 +80,131 @@ namespace suil {
             template<typename  T>
             bool find(int id, T& o)
             {
-                OBuffer qb(32);
-                bool first = true;
-                qb << "select ";
-
-                iod::foreach2(WithoutIgnore()) |
-                [&](auto& m) {
-                    if (!first) {
-                        qb << ", ";
-                    }
-                    first = false;
-                    qb << m.symbol().name();
-                };
-                qb << " from " << table << " where id = ";
-                Connection::params(qb, 1);
+                static thread_local Map<Statement> cache;
+                auto& stmt = statement(cache, table, [&](OBuffer& qb) {
+                    bool first = true;
+                    qb << "select ";
+
+                    iod::foreach2(WithoutIgnore()) |
+                    [&](auto& m) {
+                        if (!first) {
+                            qb << ", ";
+                        }
+                        first = false;
+                        qb << m.symbol().name();
+                    };
+                    qb << " from " << table << " where id = ";
+                    Connection::params(qb, 1);
+                });
 
                 // execute query
-                return conn(qb)(id) >> o;
+                return conn(stmt.slot, stmt.text)(id) >> o;
             }
 
             template <typename V>
             bool has(const char *col, const V& v) {
-                OBuffer qb(32);
-                qb << "SELECT COUNT("<<col << ") FROM " << table << " WHERE " << col << "= ";
-                Connection::params(qb, 1);
+                static thread_local Map<Map<Statement>> cache;
+                auto& stmt = statement(tableCache(cache), String{col}, [&](OBuffer& qb) {
+                    qb << "SELECT COUNT("<<col << ") FROM " << table << " WHERE " << col << "= ";
+                    Connection::params(qb, 1);
+                });
                 int count{0};
-                conn(qb)(v) >> count;
+                conn(stmt.slot, stmt.text)(v) >> count;
                 return count != 0;
             }
 
             template<typename T>
             bool insert(const T& o)
             {
-                OBuffer qb(32), vb(32);
+                typedef decltype(WithoutAutoIncrement()) __tmp;
+                static thread_local Map<Statement> cache;
+                auto& stmt = statement(cache, table, [&](OBuffer& qb) {
+                    OBuffer vb(32);
+                    qb << "insert into " << table << "(";
+
+                    bool first = true;
+                    int i = 1;
+                    iod::foreach2(WithoutIgnore2<__tmp>()) |
+                    [&](auto& m) {
+                        if (!first) {
+                            qb << ", ";
+                            vb << ", ";
+                        }
+                        first = false;
+                        qb << m.symbol().name();
+                        Connection::params(vb, i++);
+                    };
 
-                qb << "insert into " << table << "(";
+                    qb << ") values (" << vb << ")";
+                });
 
-                bool first = true;
-                int i = 1;
-                typedef decltype(WithoutAutoIncrement()) __tmp;
                 auto values = iod::foreach2(WithoutIgnore2<__tmp>()) |
                 [&](auto& m) {
-                    if (!first) {
-                        qb << ", ";
-                        vb << ", ";
-                    }
-                    first = false;
-                    qb << m.symbol().name();
-                    Connection::params(vb, i++);
-
                     return m.symbol() = m.symbol().member_access(o);
                 };
 
-                qb << ") values (" << vb << ")";
-
                 // execute query
-                auto req = conn(qb);
+                auto req = conn(stmt.slot, stmt.text);
                 iod::apply(values, req);
 
                 return req.status();
             }
 
+            /**
+             * inserts the given objects using multi-row VALUES lists
+             * @param objs the objects to insert
+             * @param batch the maximum number of rows inserted per statement
+             * @return true if all the objects were inserted
+             */
+            template <typename T>
+            bool insertMany(const std::vector<T>& objs, size_t batch = 256) {
+                static thread_local Map<std::map<size_t, Statement>> cache;
+                return many(tableCache(cache), objs, batch, false);
+            }
+
+            /**
+             * inserts the given objects using multi-row VALUES lists, objects whose
+             * primary keys conflict with existing rows update those rows instead
+             * @param objs the objects to insert or update
+             * @param batch the maximum number of rows per statement
+             * @return true if all the objects were inserted or updated
+             */
+            template <typename T>
+            bool upsertMany(const std::vector<T>& objs, size_t batch = 256) {
+                static thread_local Map<std::map<size_t, Statement>> cache;
+                return many(tableCache(cache), objs, batch, true);
+            }
+
+            /**
+             * finds the objects with the given ids with a single statement
+             * @param ids the ids of the objects to find
+             * @param out receives the objects found, room is reserved for all the ids
+             * @return true if at least one object was found
+             */
+            template <typename T>
+            bool findMany(const std::vector<int>& ids, std::vector<T>& out) {
+                static thread_local Map<Statement> cache;
+                auto& stmt = statement(cache, table, [&](OBuffer& qb) {
+                    bool first = true;
+                    qb << "select ";
+
+                    iod::foreach2(WithoutIgnore()) |
+                    [&](auto& m) {
+                        if (!first) {
+                            qb << ", ";
+                        }
+                        first = false;
+                        qb << m.symbol().name();
+                    };
+                    qb << " from " << table << " where id = ANY(";
+                    Connection::params(qb, 1);
+                    qb << ")";
+                });
+
+                out.reserve(out.size() + ids.size());
+                return conn(stmt.slot, stmt.text)(ids) >> out;
+            }
+
             // initialize a table for this table
             bool cifne() {
                 // pass the request to respective connection
@@ -129,14 +220,10 @@ namespace suil {
                 // create table if does not exist
                 if (Ego.cifne()) {
                     // if created seed with data
-                    if (!seed.empty()) {
-                        for(auto& data: seed) {
-                            if(!Ego.insert(data)) {
-                                // inserting seed user failed
-                                sdebug("inserting seed entry into table '%' failed", table());
-                                return false;
-                            }
-                        }
+                    if (!seed.empty() && !Ego.insertMany(seed)) {
+                        // inserting seed entries failed
+                        sdebug("inserting seed entries into table '%s' failed", table());
+                        return false;
                     }
                     return true;
                 }
@@ -145,9 +232,11 @@ namespace suil {
 
             template <typename __F>
             void forall(__F f) {
-                OBuffer qb(32);
-                qb << "select * from " << table;
-                conn(qb)() | f;
+                static thread_local Map<Statement> cache;
+                auto& stmt = statement(cache, table, [&](OBuffer& qb) {
+                    qb << "select * from " << table;
+                });
+                conn(stmt.slot, stmt.text)() | f;
             }
 
             std::vector<Type> getAll() {
@@ -162,45 +251,53 @@ namespace suil {
             template <typename T>
             bool update(const T& o)
             {
-                using _Schema = typename std::conditional<std::is_base_of<iod::MetaType, T>::value, typename T::Schema,T>::type;
+                using _Schema = typename __internal::schema_of<T>::type;
                 auto pk = iod::intersect(_Schema(), PrimaryKeys());
                 static_assert(decltype(pk)::size() > 0,
                         "primary key required in order to update an object.");
 
-                OBuffer qb(32);
-                qb << "update " << table << " set ";
-                bool first = true;
-                int i = 1;
                 typedef decltype(WithoutAutoIncrement()) __tmp;
+                static thread_local Map<Statement> cache;
+                auto& stmt = statement(cache, table, [&](OBuffer& qb) {
+                    qb << "update " << table << " set ";
+                    bool first = true;
+                    int i = 1;
+                    iod::foreach2(WithoutIgnore2<__tmp>()) |
+                    [&](auto& m) {
+                        if (!first) {
+                            qb << ", ";
+                        }
+                        first = false;
+                        qb << m.symbol().name() << " = ";
+                        Connection::params(qb, i++);
+                    };
+
+                    qb << " where ";
+                    first = true;
+
+                    iod::foreach2(pk) |
+                    [&](auto& m) {
+                        if (!first) {
+                            qb << " and ";
+                        }
+                        first = false;
+                        qb << m.symbol().name() << " = ";
+                        Connection::params(qb, i++);
+                    };
+                });
+
                 auto values = iod::foreach2(WithoutIgnore2<__tmp>()) |
                 [&](auto& m) {
-                    if (!first) {
-                        qb << ", ";
-                    }
-                    first = false;
-                    qb << m.symbol().name() << " = ";
-                    Connection::params(qb, i++);
-
                     return m.symbol() = m.symbol().member_access(o);
                 };
 
-                qb << " where ";
-                first = true;
-
                 auto pks = iod::foreach2(pk) |
                 [&](auto& m) {
-                    if (!first) {
-                        qb << " and ";
-                    }
-                    first = false;
-                    qb << m.symbol().name() << " = ";
-                    Connection::params(qb, i++);
-
                     return m.symbol() = m.symbol().member_access(o);
                 };
 
                 // execute query
-                auto req = conn(qb);
+                auto req = conn(stmt.slot, stmt.text);
                 iod::apply(values, pks, req);
 
                 return req.status();
@@ -208,25 +305,29 @@ namespace suil {
 
             template <typename T>
             void remove(T& o) {
-                OBuffer qb(32);
-
-                qb << "delete from " << table << " where ";
-                bool first = true;
-                int i = 1;
+                static thread_local Map<Statement> cache;
+                auto& stmt = statement(cache, table, [&](OBuffer& qb) {
+                    qb << "delete from " << table << " where ";
+                    bool first = true;
+                    int i = 1;
+
+                    iod::foreach(PrimaryKeys()) |
+                    [&](auto& m) {
+                        if (!first) {
+                            qb << " and ";
+                        }
+                        first = false;
+                        qb << m.symbol().name() << " = ";
+                        Connection::params(qb, i++);
+                    };
+                });
 
                 auto values = iod::foreach(PrimaryKeys()) |
                 [&](auto& m) {
-                    if (!first) {
-                        qb << " and ";
-                    }
-                    first = false;
-                    qb << m.symbol().name() << " = ";
-                    Connection::params(qb, i++);
-
                     return m.symbol() = m.symbol().member_access(o);
                 };
                 // execute query
-                iod::apply(values, conn(qb));
+                iod::apply(values, conn(stmt.slot, stmt.text));
             }
 
             ~Orm() {
@@ -237,6 +338,120 @@ namespace suil {
 
 
         private:
+            /**
+             * gets a statement from the given cache, building it on first use. The
+             * text of a statement only depends on the type and table, so each operation
+             * keeps a cache of statements per table
+             * @param cache the operation's statement cache
+             * @param key the key of the statement in the cache
+             * @param build builds the statement text into the given buffer
+             * @return the cached statement
+             */
+            template <typename Build>
+            static const Statement& statement(Map<Statement>& cache, const String& key, Build build) {
+                auto it = cache.find(key);
+                if (it != cache.end())
+                    return it->second;
+
+                OBuffer qb(64);
+                build(qb);
+                return cache.emplace(key.dup(), Statement{String(qb), __internal::statement_slot()}).first->second;
+            }
+
+            template <typename Build>
+            static const Statement& statement(std::map<size_t, Statement>& cache, size_t key, Build build) {
+                auto it = cache.find(key);
+                if (it != cache.end())
+                    return it->second;
+
+                OBuffer qb(64);
+                build(qb);
+                return cache.emplace(key, Statement{String(qb), __internal::statement_slot()}).first->second;
+            }
+
+            /* gets the statement cache of the current table from a cache of per table caches */
+            template <typename C>
+            C& tableCache(Map<C>& caches) {
+                auto it = caches.find(table);
+                if (it == caches.end())
+                    it = caches.emplace(table.dup(), C{}).first;
+                return it->second;
+            }
+
+            template <typename T>
+            bool many(std::map<size_t, Statement>& cache, const std::vector<T>& objs, size_t batch, bool upsert) {
+                typedef WithoutIgnore2<decltype(WithoutAutoIncrement())> Fields;
+                /* keep the number of parameters per statement within what drivers support */
+                const size_t nfields = MAX(1, Fields::size());
+                batch = MAX(1, MIN(batch, 32766/nfields));
+
+                for (size_t next = 0; next < objs.size(); next += batch) {
+                    size_t nrows = MIN(batch, objs.size() - next);
+                    auto& stmt = statement(cache, nrows, [&](OBuffer& qb) {
+                        qb << "insert into " << table << "(";
+                        bool first = true;
+                        iod::foreach2(Fields()) |
+                        [&](auto& m) {
+                            if (!first) {
+                                qb << ", ";
+                            }
+                            first = false;
+                            qb << m.symbol().name();
+                        };
+
+                        qb << ") values ";
+                        int i = 1;
+                        for (size_t row = 0; row < nrows; row++) {
+                            qb << (row? ", (" : "(");
+                            for (size_t f = 0; f < nfields; f++) {
+                                if (f) qb << ", ";
+                                Connection::params(qb, i++);
+                            }
+                            qb << ")";
+                        }
+
+                        if (upsert) {
+                            qb << " on conflict (";
+                            first = true;
+                            iod::foreach(PrimaryKeys()) |
+                            [&](auto& m) {
+                                if (!first) {
+                                    qb << ", ";
+                                }
+                                first = false;
+                                qb << m.symbol().name();
+                            };
+                            qb << ") do ";
+
+                            typedef __internal::remove_primary_keys_t<Fields> Updates;
+                            iod::static_if<std::is_void<Updates>::value>(
+                            [&](auto) {
+                                /* only primary keys, nothing to update */
+                                qb << "nothing";
+                            },
+                            [&](auto fields) {
+                                first = true;
+                                iod::foreach2(__internal::remove_primary_keys_t<decltype(fields)>()) |
+                                [&](auto& m) {
+                                    qb << (first? "update set " : ", ");
+                                    first = false;
+                                    qb << m.symbol().name() << " = excluded." << m.symbol().name();
+                                };
+                            }, Fields());
+                        }
+                    });
+
+                    // execute query
+                    auto req = conn(stmt.slot, stmt.text);
+                    if (!req.many(Fields(), objs.begin() + next, objs.begin() + next + nrows).status()) {
+                        sdebug("inserting %lu rows into table '%s' failed", nrows, table());
+                        return false;
+                    }
+                }
+
+                return true;
+            }
+
             Connection& conn;
             suil::String table{nullptr};
         };
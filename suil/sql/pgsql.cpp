@@ -3,26 +3,295 @@
 //
 
 #include <suil/sql/pgsql.h>
+#include <suil/numfmt.h>
 
 namespace suil::sql {
 
+    bool __internal::binary_decodable(Oid oid, PGconn *conn) {
+        switch (oid) {
+            case BOOLOID:   case BYTEAOID:   case NAMEOID:   case OIDOID:
+            case INT8OID:   case INT2OID:    case INT4OID:   case TEXTOID:
+            case FLOAT4OID: case FLOAT8OID:  case JSONOID:   case JSONBOID:
+            case BPCHAROID: case VARCHAROID:
+                return true;
+            case TIMESTAMPOID:
+            case TIMESTAMPTZOID: {
+                const char *style = conn? PQparameterStatus(conn, "DateStyle") : nullptr;
+                if (style == nullptr || strncmp(style, "ISO", 3) != 0)
+                    return false;
+                if (oid == TIMESTAMPOID)
+                    return true;
+                const char *tz = PQparameterStatus(conn, "TimeZone");
+                return tz != nullptr &&
+                       (!strcmp(tz, "UTC") || !strcmp(tz, "Etc/UTC") || !strcmp(tz, "GMT") || !strcmp(tz, "Etc/GMT"));
+            }
+            default:
+                return false;
+        }
+    }
+
+    bool __internal::iso_to_epoch(const char *text, long long& us) {
+        if (!strcmp(text, "infinity")) {
+            us = LLONG_MAX;
+            return true;
+        }
+        if (!strcmp(text, "-infinity")) {
+            us = LLONG_MIN;
+            return true;
+        }
+
+        struct tm tm{};
+        int n{0};
+        if (sscanf(text, "%d-%d-%d %d:%d:%d%n", &tm.tm_year, &tm.tm_mon, &tm.tm_mday,
+                   &tm.tm_hour, &tm.tm_min, &tm.tm_sec, &n) != 6)
+            return false;
+
+        const char *p = &text[n];
+        long frac{0};
+        if (*p == '.') {
+            /* up to microseconds */
+            int digits{0};
+            for (p++; isdigit((unsigned char) *p); p++) {
+                if (digits++ < 6) frac = frac*10 + (*p - '0');
+            }
+            for (; digits < 6; digits++) frac *= 10;
+        }
+
+        long offset{0};
+        if (*p == '+' || *p == '-') {
+            /* +HH[:MM[:SS]] */
+            int sign = *p++ == '-'? -1 : 1, hh{0}, mm{0}, ss{0};
+            sscanf(p, "%d:%d:%d", &hh, &mm, &ss);
+            offset = sign * (hh*3600 + mm*60 + ss);
+            while (*p && *p != ' ') p++;
+        }
+
+        if (!strcmp(p, " BC"))
+            tm.tm_year = 1 - tm.tm_year;
+        tm.tm_year -= 1900;
+        tm.tm_mon  -= 1;
+        us = ((long long) timegm(&tm) - offset) * 1000000 + frac;
+        return true;
+    }
+
+    strview __internal::vnod_to_text(const char *buf, int len, Oid oid, char (&scratch)[64]) {
+        size_t n{0};
+        switch (oid) {
+            case BOOLOID:
+                return strview{buf[0]? "t" : "f", 1};
+            case INT2OID:
+            case INT4OID:
+            case INT8OID:
+            case OIDOID: {
+                long long v{0};
+                vnod_to_number(buf, len, oid, v);
+                n = numfmt::itoa(v, scratch);
+                break;
+            }
+            case FLOAT4OID: {
+                /* NaN and infinite values are written like postgres does */
+                float v{0};
+                vnod_to_number(buf, len, oid, v);
+                n = numfmt::ftoa(v, scratch);
+                break;
+            }
+            case FLOAT8OID: {
+                double v{0};
+                vnod_to_number(buf, len, oid, v);
+                n = numfmt::dtoa(v, scratch);
+                break;
+            }
+            case TIMESTAMPOID:
+            case TIMESTAMPTZOID: {
+                /* formatted like postgres does with the ISO DateStyle, timestamptz is
+                 * only sent in binary for UTC sessions */
+                long long us{0};
+                vnod_to_vhod(buf, us);
+                if (us == LLONG_MAX || us == LLONG_MIN)
+                    return us == LLONG_MAX? strview{"infinity"} : strview{"-infinity"};
+                long long secs = us / 1000000;
+                long frac = (long) (us % 1000000);
+                if (frac < 0) {
+                    frac += 1000000;
+                    secs--;
+                }
+                auto t = (time_t) (secs + PGSQL_EPOCH_OFFSET);
+                struct tm tm{};
+                gmtime_r(&t, &tm);
+                int year = tm.tm_year + 1900;
+                bool bc = year <= 0;
+                int w = snprintf(scratch, sizeof(scratch), "%04d-%02d-%02d %02d:%02d:%02d",
+                                 bc? 1 - year : year, tm.tm_mon+1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec);
+                n = (size_t) MAX(w, 0);
+                if (frac) {
+                    n += snprintf(&scratch[n], sizeof(scratch)-n, ".%06ld", frac);
+                    while (scratch[n-1] == '0') n--;
+                }
+                if (oid == TIMESTAMPTZOID) {
+                    memcpy(&scratch[n], "+00", 3);
+                    n += 3;
+                }
+                if (bc) {
+                    memcpy(&scratch[n], " BC", 3);
+                    n += 3;
+                }
+                scratch[n] = '\0';
+                break;
+            }
+            case JSONBOID:
+                /* binary jsonb is the textual json prefixed with a version byte */
+                if (len > 0 && buf[0] == 1)
+                    return strview{&buf[1], (size_t) len-1};
+                return strview{buf, (size_t) len};
+            default:
+                /* text types and bytea are sent as is */
+                return strview{buf, (size_t) len};
+        }
+
+        return strview{scratch, n};
+    }
+
+    void __internal::copy_escape(OBuffer& b, const char *data, size_t len) {
+        b.reserve(len + 8);
+        const char *p = data, *end = data + len;
+        while (p < end) {
+            /* copy runs of characters that don't need escaping at once */
+            const char *s = p;
+            while (p < end && *p != '\\' && *p != '\t' && *p != '\n' && *p != '\r')
+                p++;
+            if (p != s)
+                b.append(s, p - s);
+            if (p == end)
+                break;
+
+            char esc[2] = {'\\', *p};
+            switch (*p) {
+                case '\t': esc[1] = 't'; break;
+                case '\n': esc[1] = 'n'; break;
+                case '\r': esc[1] = 'r'; break;
+                default: break;
+            }
+            b.append(esc, sizeof(esc));
+            p++;
+        }
+    }
+
+    void __internal::copy_unescape(OBuffer& b, const char *data, size_t len) {
+        b.reserve(len);
+        const char *p = data, *end = data + len;
+        while (p < end) {
+            auto *s = (const char *) memchr(p, '\\', end - p);
+            if (s == nullptr) {
+                b.append(p, end - p);
+                break;
+            }
+            if (s != p)
+                b.append(p, s - p);
+            if (++s == end)
+                break;
+
+            char c = *s;
+            switch (c) {
+                case 't': c = '\t'; break;
+                case 'n': c = '\n'; break;
+                case 'r': c = '\r'; break;
+                case 'b': c = '\b'; break;
+                case 'f': c = '\f'; break;
+                case 'v': c = '\v'; break;
+                default: break;
+            }
+            b.append(c);
+            p = s + 1;
+        }
+    }
+
+    /* waits for the next result of the command running on the connection */
+    static bool copy_result(PGconn *conn, bool async, int64_t timeout, PGresult*& result) {
+        result = nullptr;
+        if (async) {
+            int rc;
+            while ((rc = PQflush(conn)) == 1) {
+                if (__internal::pgsql_wait(conn, FDW_OUT, timeout))
+                    return false;
+            }
+            if (rc < 0)
+                return false;
+
+            while (PQisBusy(conn)) {
+                if (__internal::pgsql_wait(conn, FDW_IN, timeout) || !PQconsumeInput(conn))
+                    return false;
+            }
+        }
+        result = PQgetResult(conn);
+        return true;
+    }
+
+    /* reads the results terminating a COPY, returns true if it succeeded */
+    static bool copy_finish(PGconn *conn, bool async, int64_t timeout, String& error) {
+        PGresult *result{nullptr};
+        bool status{true};
+        while (true) {
+            if (!copy_result(conn, async, timeout, result)) {
+                error = String{PQerrorMessage(conn)}.dup();
+                return false;
+            }
+            if (result == nullptr)
+                break;
+            if (PQresultStatus(result) != PGRES_COMMAND_OK) {
+                error = String{PQresultErrorMessage(result)}.dup();
+                status = false;
+            }
+            PQclear(result);
+        }
+        return status;
+    }
+
+    /* sends a COPY statement and waits for the server to switch into copy mode */
+    static void copy_start(PGconn *conn, bool async, int64_t timeout, const char *stmt, ExecStatusType expected) {
+        if (!PQsendQuery(conn, stmt)) {
+            throw Exception::create("sending COPY failed: ", PQerrorMessage(conn));
+        }
+
+        PGresult *result{nullptr};
+        if (!copy_result(conn, async, timeout, result) || result == nullptr) {
+            throw Exception::create("starting COPY failed: ", PQerrorMessage(conn));
+        }
+
+        if (PQresultStatus(result) != expected) {
+            String msg = String{PQresultErrorMessage(result)}.dup();
+            PQclear(result);
+            /* drain whatever is left of the command */
+            String tmp;
+            copy_finish(conn, async, timeout, tmp);
+            throw Exception::create("starting COPY failed: ", msg);
+        }
+        PQclear(result);
+    }
+
     PGSQLStatement PgSqlConnection::operator()(OBuffer& req) {
         /* temporary zero copy string */
         String tmp(req, false);
         trace("%s", tmp());
 
-        auto it = stmt_cache.find(tmp);
-        if (it != stmt_cache.end()) {
+        auto it = stmt_cache->find(tmp);
+        if (it != stmt_cache->end()) {
             return it->second;
         }
 
         /* statement not cached, create new */
         String key(req);
+        String name{nullptr};
+        if (prepare) {
+            /* the name of the server side prepared statement, unique per connection */
+            OBuffer nb(16);
+            nb << "suil_stmt_" << stmt_cache->size();
+            name = String(nb);
+        }
         /* the key will be copied to statement so it won't be delete
          * when the statement is deleted */
-        auto ret = stmt_cache.insert(it,
+        auto ret = stmt_cache->insert(it,
                                      std::make_pair(std::move(key),
-                                                    PGSQLStatement(conn, key, async, timeout)));
+                                                    PGSQLStatement(conn, key, async, timeout, std::move(name))));
 
         return ret->second;
     }
@@ -32,8 +301,8 @@ namespace suil::sql {
         String tmp(req);
         trace("%s", tmp());
 
-        auto it = stmt_cache.find(tmp);
-        if (it != stmt_cache.end()) {
+        auto it = stmt_cache->find(tmp);
+        if (it != stmt_cache->end()) {
             return it->second;
         }
 
@@ -42,6 +311,21 @@ namespace suil::sql {
         return (*this)(breq);
     }
 
+    PGSQLStatement PgSqlConnection::operator()(size_t slot, const String& req) {
+        auto& slots = stmt_cache->slots;
+        if (slot < slots.size() && slots[slot] != nullptr) {
+            return *slots[slot];
+        }
+
+        OBuffer breq(req.size()+1);
+        breq << req;
+        auto stmt = (*this)(breq);
+        if (slot >= slots.size())
+            slots.resize(slot+1, nullptr);
+        slots[slot] = &stmt_cache->find(req)->second;
+        return stmt;
+    }
+
     void PgSqlConnection::destroy(bool dctor) {
         if (conn == nullptr || --refs > 0) {
             /* Connection still being used */
@@ -72,6 +356,363 @@ namespace suil::sql {
         }
     }
 
+    PgSqlBatch PgSqlConnection::batch(size_t chunk) {
+        return PgSqlBatch(Ego, chunk);
+    }
+
+    bool PgSqlBatch::exec(handler_t handler) {
+        bool status{true};
+        /* statements are prepared before sending anything */
+        for (auto& e: entries) {
+            auto& prepared = e.stmt.prepared;
+            if (prepared && !prepared->ready && !prepared->failed)
+                e.stmt.prepare(e.oids.data(), (int) e.oids.size());
+        }
+
+#ifdef LIBPQ_HAS_PIPELINING
+        status = pipeline(handler);
+#else
+        /* no pipeline support, send executions one after the other */
+        for (size_t i = 0; i < entries.size(); i++) {
+            auto& e = entries[i];
+            try {
+                execute(e);
+            }
+            catch (...) {
+                ierror("BATCH: %s failed: %s", e.stmt.stmt(), Exception::fromCurrent().what());
+                e.stmt.results.fail();
+            }
+
+            if (handler) handler(i, e.stmt);
+            if (!e.stmt.status()) {
+                status = false;
+                break;
+            }
+        }
+#endif
+        entries.clear();
+        return status;
+    }
+
+    void PgSqlBatch::execute(entry_t& e) {
+        std::vector<const char *> values(e.offsets.size(), nullptr);
+        for (size_t i = 0; i < e.offsets.size(); i++) {
+            if (e.offsets[i] >= 0)
+                values[i] = &e.data[e.offsets[i]];
+        }
+        e.stmt.execute((int) values.size(), values.data(), e.oids.data(), e.lens.data(), e.bins.data());
+    }
+
+    bool PgSqlBatch::send(entry_t& e) {
+        std::vector<const char *> values(e.offsets.size(), nullptr);
+        for (size_t i = 0; i < e.offsets.size(); i++) {
+            if (e.offsets[i] >= 0)
+                values[i] = &e.data[e.offsets[i]];
+        }
+
+        return e.stmt.send((int) values.size(), values.data(), e.oids.data(), e.lens.data(), e.bins.data());
+    }
+
+#ifdef LIBPQ_HAS_PIPELINING
+    /* reads the results of a pipeline up to its next synchronization point */
+    static bool pipeline_sync(PGconn *pg, int64_t timeout) {
+        bool empty{false};
+        while (true) {
+            while (PQisBusy(pg)) {
+                if (__internal::pgsql_wait(pg, FDW_IN, timeout) || !PQconsumeInput(pg))
+                    return false;
+            }
+
+            PGresult *result = PQgetResult(pg);
+            if (result == nullptr) {
+                /* a null result ends the results of each execution, two in
+                 * a row means that nothing is left in the pipeline */
+                if (empty) return false;
+                empty = true;
+                continue;
+            }
+            empty = false;
+
+            ExecStatusType status = PQresultStatus(result);
+            PQclear(result);
+            if (status == PGRES_PIPELINE_SYNC)
+                return true;
+        }
+    }
+#endif
+
+    bool PgSqlBatch::pipeline(handler_t& handler) {
+#ifdef LIBPQ_HAS_PIPELINING
+        PGconn *pg = conn.conn;
+        if (entries.empty())
+            return true;
+
+        if (!PQenterPipelineMode(pg)) {
+            ierror("BATCH: entering pipeline mode failed: %s", PQerrorMessage(pg));
+            throw Exception::create("entering pipeline mode failed: ", PQerrorMessage(pg));
+        }
+
+        /* leaves pipeline mode however the batch ends (including exceptions thrown by
+         * the handler), draining the executions still in flight. A connection that
+         * cannot be drained stays in pipeline mode and is not returned to the pool */
+        struct pipeline_guard {
+            PgSqlBatch& batch;
+            PGconn     *pg;
+            size_t      syncs{0};
+            bool        unsynced{false};
+
+            ~pipeline_guard() {
+                bool ok{true};
+                if (unsynced) {
+                    /* executions were sent without their synchronization point */
+                    ok = PQpipelineSync(pg) != 0;
+                    if (ok) syncs++;
+                }
+                for (; ok && syncs > 0; syncs--)
+                    ok = pipeline_sync(pg, batch.conn.timeout);
+
+                if (!ok || !PQexitPipelineMode(pg)) {
+                    lerror(&batch, "BATCH: leaving pipeline mode failed: %s", PQerrorMessage(pg));
+                }
+            }
+        } guard{Ego, pg};
+
+        bool status{true};
+        size_t next{0};
+        while (status && next < entries.size()) {
+            size_t end = MIN(next + chunk, entries.size());
+            for (size_t i = next; i < end; i++) {
+                guard.unsynced = true;
+                if (!send(entries[i])) {
+                    ierror("BATCH: sending %s failed: %s", entries[i].stmt.stmt(), PQerrorMessage(pg));
+                    throw Exception::create("sending batch failed: ", PQerrorMessage(pg));
+                }
+            }
+
+            if (!PQpipelineSync(pg)) {
+                ierror("BATCH: pipeline sync failed: %s", PQerrorMessage(pg));
+                throw Exception::create("sending batch failed: ", PQerrorMessage(pg));
+            }
+            guard.unsynced = false;
+            guard.syncs++;
+
+            for (size_t i = next; i < end; i++) {
+                auto& stmt = entries[i].stmt;
+                bool ok{true};
+                stmt.results.clear();
+                /* results of each execution are terminated by a null result */
+                bool done = stmt.waitResults([&](PGresult *result) {
+                    switch (PQresultStatus(result)) {
+                        case PGRES_TUPLES_OK:
+                        case PGRES_SINGLE_TUPLE:
+                            if (PQntuples(result) > 0) {
+                                stmt.results.add(result);
+                                break;
+                            }
+                        case PGRES_COMMAND_OK:
+                        case PGRES_NONFATAL_ERROR:
+                            PQclear(result);
+                            break;
+                        case PGRES_PIPELINE_ABORTED:
+                            /* a previous execution in this chunk failed */
+                            ok = false;
+                            PQclear(result);
+                            break;
+                        default:
+                            ierror("BATCH: %s failed: %s", stmt.stmt(), PQresultErrorMessage(result));
+                            ok = false;
+                            PQclear(result);
+                            break;
+                    }
+                    return true;
+                });
+
+                if (!done) {
+                    throw Exception::create("receiving batch results failed: ", PQerrorMessage(pg));
+                }
+
+                if (!ok) {
+                    stmt.results.fail();
+                    status = false;
+                }
+
+                if (handler) handler(i, stmt);
+            }
+
+            /* consume the synchronization point of the chunk */
+            if (!pipeline_sync(pg, conn.timeout)) {
+                ierror("BATCH: receiving pipeline sync failed: %s", PQerrorMessage(pg));
+                throw Exception::create("receiving batch results failed: ", PQerrorMessage(pg));
+            }
+            guard.syncs--;
+            next = end;
+        }
+
+        return status;
+#else
+        return false;
+#endif
+    }
+
+    PgSqlCopyIn PgSqlConnection::copyIn(const char *stmt, bool binary) {
+        return PgSqlCopyIn(Ego, stmt, binary);
+    }
+
+    ssize_t PgSqlConnection::copyOut(const char *stmt, std::function<bool(const char *, size_t)> f) {
+        trace("COPY OUT: %s", stmt);
+        copy_start(conn, async, timeout, stmt, PGRES_COPY_OUT);
+
+        ssize_t nrows{0};
+        bool more{true};
+        char *data{nullptr};
+        while (true) {
+            int len = PQgetCopyData(conn, &data, async);
+            if (len > 0) {
+                /* once the callback is done, remaining rows are just drained */
+                if (more)
+                    more = f(data, (size_t) len);
+                PQfreemem(data);
+                nrows++;
+                continue;
+            }
+
+            if (len == 0) {
+                /* no row available yet on non blocking connection */
+                if (__internal::pgsql_wait(conn, FDW_IN, timeout) || !PQconsumeInput(conn)) {
+                    ierror("COPY OUT: receiving rows failed: %s", PQerrorMessage(conn));
+                    throw Exception::create("COPY OUT receiving rows failed: ", PQerrorMessage(conn));
+                }
+                continue;
+            }
+
+            if (len == -1)
+                break;
+
+            ierror("COPY OUT: %s", PQerrorMessage(conn));
+            throw Exception::create("COPY OUT failed: ", PQerrorMessage(conn));
+        }
+
+        String error;
+        if (!copy_finish(conn, async, timeout, error)) {
+            ierror("COPY OUT: %s failed: %s", stmt, error());
+            throw Exception::create("COPY OUT failed: ", error);
+        }
+
+        return nrows;
+    }
+
+    PgSqlCopyIn::PgSqlCopyIn(PgSqlConnection& conn, const char *stmt, bool binary, size_t threshold)
+        : conn(conn),
+          buffer(threshold + 64),
+          threshold(threshold),
+          binary(binary)
+    {
+        trace("COPY IN: %s", stmt);
+        copy_start(conn.conn, conn.async, conn.timeout, stmt, PGRES_COPY_IN);
+        active = true;
+
+        if (binary) {
+            /* signature, flags and header extension length */
+            static const char SIGNATURE[] = "PGCOPY\n\377\r\n";
+            buffer.append(SIGNATURE, sizeof(SIGNATURE));
+            buffer.append((unsigned int) 0);
+            buffer.append((unsigned int) 0);
+        }
+    }
+
+    void PgSqlCopyIn::write(const void *data, size_t len) {
+        if (!active) {
+            throw Exception::create("COPY IN: writing to a COPY that has ended");
+        }
+        buffer.append(data, len);
+        if (buffer.size() >= threshold)
+            flush();
+    }
+
+    void PgSqlCopyIn::flush() {
+        PGconn *pg = conn.conn;
+        if (!buffer.empty()) {
+            int rc;
+            while ((rc = PQputCopyData(pg, buffer.data(), (int) buffer.size())) == 0) {
+                /* libpq's buffer is full, wait until it can be flushed */
+                if (__internal::pgsql_wait(pg, FDW_OUT, conn.timeout)) {
+                    ierror("COPY IN: wait write failed: %s", errno_s);
+                    throw Exception::create("COPY IN sending data failed: ", errno_s);
+                }
+                PQflush(pg);
+            }
+            if (rc < 0) {
+                ierror("COPY IN: sending data failed: %s", PQerrorMessage(pg));
+                throw Exception::create("COPY IN sending data failed: ", PQerrorMessage(pg));
+            }
+            buffer.reset(threshold + 64, true);
+        }
+
+        int rc;
+        while ((rc = PQflush(pg)) == 1) {
+            if (__internal::pgsql_wait(pg, FDW_OUT, conn.timeout)) {
+                ierror("COPY IN: wait write failed: %s", errno_s);
+                throw Exception::create("COPY IN sending data failed: ", errno_s);
+            }
+        }
+        if (rc < 0) {
+            ierror("COPY IN: sending data failed: %s", PQerrorMessage(pg));
+            throw Exception::create("COPY IN sending data failed: ", PQerrorMessage(pg));
+        }
+    }
+
+    bool PgSqlCopyIn::end(const char *error) {
+        if (!active)
+            return false;
+
+        PGconn *pg = conn.conn;
+        if (error == nullptr) {
+            if (binary) {
+                /* file trailer */
+                buffer.append((unsigned short) 0xFFFF);
+            }
+            flush();
+        }
+        else {
+            buffer.clear();
+        }
+        active = false;
+
+        int rc;
+        while ((rc = PQputCopyEnd(pg, error)) == 0) {
+            if (__internal::pgsql_wait(pg, FDW_OUT, conn.timeout)) {
+                ierror("COPY IN: wait write failed: %s", errno_s);
+                throw Exception::create("COPY IN ending failed: ", errno_s);
+            }
+        }
+        if (rc < 0) {
+            ierror("COPY IN: ending failed: %s", PQerrorMessage(pg));
+            throw Exception::create("COPY IN ending failed: ", PQerrorMessage(pg));
+        }
+
+        String msg;
+        if (!copy_finish(pg, conn.async, conn.timeout, msg)) {
+            if (error == nullptr)
+                ierror("COPY IN: failed: %s", msg());
+            return false;
+        }
+
+        idebug("COPY IN: copied %lu rows", nrows);
+        return true;
+    }
+
+    PgSqlCopyIn::~PgSqlCopyIn() {
+        if (active) {
+            /* COPY was not ended, abort it */
+            try {
+                end("COPY aborted");
+            }
+            catch (...) {
+                iwarn("COPY IN: aborting failed: %s", Exception::fromCurrent().what());
+            }
+        }
+    }
+
     bool PgSqlTransaction::begin() {
         if (!Ego.valid) {
             Ego.valid = true;
@@ -132,6 +773,7 @@ namespace suil::sql {
 
     PgSqlDb::Connection& PgSqlDb::connection() {
         PGconn *conn{nullptr};
+        Connection::stmt_map_ptr_t stmts{nullptr};
         if (conns.empty()) {
             /* open a new Connection */
             int y{2};
@@ -149,6 +791,8 @@ namespace suil::sql {
                 /* cancel Connection expiry */
                 h.alive = -1;
                 conn = h.conn;
+                /* statements already prepared on the connection */
+                stmts = h.stmts;
                 conns.pop_back();
             }
             else {
@@ -161,7 +805,8 @@ namespace suil::sql {
                 conn, dbname, async, timeout,
                 [&](Connection* _conn) {
                     free(_conn);
-                });
+                },
+                std::move(stmts), prepare);
         return *c;
     }
 
@@ -234,9 +879,9 @@ namespace suil::sql {
     }
 
     void PgSqlDb::free(Connection* conn) {
-        conn_handle_t h {conn->conn, -1};
+        conn_handle_t h {conn->conn, -1, conn->stmt_cache};
 
-        if (keep_alive != 0) {
+        if (keep_alive != 0 && conn->idle()) {
             /* set connections keep alive */
             h.alive = mnow() + keep_alive;
             conns.push_back(h);
@@ -253,4 +898,778 @@ namespace suil::sql {
         }
     }
 
-}
\ No newline at end of file
+}
+#ifdef unit_test
+#include <chrono>
+#include <catch/catch.hpp>
+#include "tests/test_symbols.h"
+
+using namespace suil;
+
+typedef decltype(iod::D(
+        tprop(a, int), tprop(b, String), tprop(c, int), tprop(d, String), tprop(e, int),
+        tprop(f, String), tprop(g, int), tprop(h, String), tprop(i, int), tprop(j, String),
+        tprop(k, int), tprop(l, String), tprop(m, int), tprop(n, String), tprop(o, int),
+        tprop(p, String), tprop(q, int), tprop(r, String), tprop(s, int), tprop(t, String)
+)) WideRow;
+
+static PGresult* makeWideResult(int nrows) {
+    static const char *names[] = {"a", "b", "c", "d", "e", "f", "g", "h", "i", "j",
+                                  "k", "l", "m", "n", "o", "p", "q", "r", "s", "t"};
+    const int ncols = sizeof(names)/sizeof(names[0]);
+    PGresAttDesc attrs[ncols];
+    memset(attrs, 0, sizeof(attrs));
+    /* columns in reverse order of the fields */
+    for (int i = 0; i < ncols; i++) {
+        attrs[i].name = (char *) names[ncols-1-i];
+        attrs[i].typid = ((ncols-1-i)%2)? sql::TEXTOID : sql::INT4OID;
+        attrs[i].typlen = -1;
+        attrs[i].atttypmod = -1;
+    }
+
+    PGresult *res = PQmakeEmptyPGresult(nullptr, PGRES_TUPLES_OK);
+    PQsetResultAttrs(res, ncols, attrs);
+    char value[16];
+    for (int row = 0; row < nrows; row++) {
+        for (int col = 0; col < ncols; col++) {
+            int len = snprintf(value, sizeof(value), "%d", row+col);
+            PQsetvalue(res, row, col, value, len);
+        }
+    }
+    return res;
+}
+
+/* a server speaking just enough of the postgres protocol to run statements */
+struct PgTestServer {
+    using ParseError = std::function<const char*(const std::string&)>;
+    using ExecError  = std::function<const char*(const std::string&, const std::vector<std::string>&)>;
+    using Rows       = std::function<std::vector<std::string>(const std::string&, const std::vector<std::string>&)>;
+
+    tcpsock ls{tcplisten(iplocal("127.0.0.1", 0, 0), 10)};
+    bool    stop{false};
+    /* the text of every statement parsed or queried */
+    std::vector<std::string> queries{};
+    /* the parameters of every execution */
+    std::vector<std::vector<std::string>> params{};
+    /* returns an error message for statements failing to parse */
+    ParseError parseError{nullptr};
+    /* returns an error message for executions that fail */
+    ExecError  execError{nullptr};
+    /* returns the rows of SELECT statements, which have a single text column v */
+    Rows       rows{nullptr};
+    /* the send and receive buffer sizes of connections, 0 for the defaults */
+    int        sockbuf{0};
+    String     dbname{"test"};
+    std::vector<std::unique_ptr<sql::PgSqlConnection>> conns{};
+
+    PgTestServer() {
+        go(serve(this));
+    }
+
+    /* opens an asynchronous connection to the server, closed with the server */
+    sql::PgSqlConnection& connection(bool prepare = true) {
+        OBuffer ob(64);
+        ob << "host=127.0.0.1 port=" << tcpport(ls)
+           << " user=test dbname=test sslmode=disable gssencmode=disable";
+        PGconn *pg = PQconnectStart((const char *) ob);
+        PostgresPollingStatusType st{PGRES_POLLING_WRITING};
+        while (st != PGRES_POLLING_OK && st != PGRES_POLLING_FAILED) {
+            int sock = PQsocket(pg);
+            fdwait(sock, st == PGRES_POLLING_READING? FDW_IN : FDW_OUT, mnow() + 1000);
+            /* libpq might replace the socket while connecting */
+            fdclean(sock);
+            st = PQconnectPoll(pg);
+        }
+        PQsetnonblocking(pg, 1);
+        if (sockbuf) {
+            /* both ends of the connection, the server's end is the socket
+             * connected to the client's address */
+            sockaddr_in local{}, peer{};
+            socklen_t len = sizeof(local);
+            getsockname(PQsocket(pg), (sockaddr *) &local, &len);
+            for (int fd = 0; fd < 1024; fd++) {
+                len = sizeof(peer);
+                if (fd != PQsocket(pg) &&
+                    (getpeername(fd, (sockaddr *) &peer, &len) || peer.sin_port != local.sin_port))
+                    continue;
+                setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &sockbuf, sizeof(sockbuf));
+                setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &sockbuf, sizeof(sockbuf));
+            }
+        }
+        conns.emplace_back(new sql::PgSqlConnection(pg, dbname, true, 1000,
+            [pg](sql::PgSqlConnection *) {
+                fdclean(PQsocket(pg));
+                PQfinish(pg);
+            }, nullptr, prepare));
+        return *conns.back();
+    }
+
+    ~PgTestServer() {
+        conns.clear();
+        stop = true;
+        msleep(mnow() + 50);
+    }
+
+private:
+    static void reply(tcpsock as, char type, const std::string& body = "") {
+        uint32_t len = htonl((uint32_t) body.size() + 4);
+        tcpsend(as, &type, 1, -1);
+        tcpsend(as, &len, 4, -1);
+        tcpsend(as, body.data(), body.size(), -1);
+    }
+
+    static void error(tcpsock as, const char *msg) {
+        std::string body;
+        body.append("SERROR", 7).append("VERROR", 7).append("C42000", 7);
+        body.append("M").append(msg).append(1, '\0').append(1, '\0');
+        reply(as, 'E', body);
+    }
+
+    static std::string cstr(const std::string& msg, size_t& pos) {
+        std::string s(&msg[pos]);
+        pos += s.size() + 1;
+        return s;
+    }
+
+    static int32_t i32(const std::string& msg, size_t& pos) {
+        uint32_t v;
+        memcpy(&v, &msg[pos], 4);
+        pos += 4;
+        return (int32_t) ntohl(v);
+    }
+
+    bool selects(const std::string& query) const {
+        return rows != nullptr && strncasecmp(query.c_str(), "SELECT", 6) == 0;
+    }
+
+    static void describeRows(tcpsock as) {
+        std::string body("\0\1v\0", 4);
+        uint32_t u32 = 0;
+        body.append((const char *) &u32, 4);
+        body.append(2, '\0');
+        u32 = htonl(sql::TEXTOID);
+        body.append((const char *) &u32, 4);
+        uint16_t u16 = htons((uint16_t) -1);
+        body.append((const char *) &u16, 2);
+        u32 = htonl((uint32_t) -1);
+        body.append((const char *) &u32, 4);
+        body.append(2, '\0');
+        reply(as, 'T', body);
+    }
+
+    static int16_t i16(const std::string& msg, size_t& pos) {
+        uint16_t v;
+        memcpy(&v, &msg[pos], 2);
+        pos += 2;
+        return (int16_t) ntohs(v);
+    }
+
+    static coroutine void serve(PgTestServer *srv) {
+        while (!srv->stop) {
+            tcpsock as = tcpaccept(srv->ls, mnow() + 10);
+            if (as == nullptr) continue;
+            go(session(srv, as));
+        }
+    }
+
+    static coroutine void session(PgTestServer *srv, tcpsock as) {
+        uint32_t len;
+        /* startup packet */
+        if (tcprecv(as, &len, 4, mnow() + 1000) != 4) {
+            tcpclose(as);
+            return;
+        }
+        std::string msg(ntohl(len) - 4, '\0');
+        tcprecv(as, &msg[0], msg.size(), mnow() + 1000);
+        reply(as, 'R', std::string("\0\0\0\0", 4));
+        reply(as, 'S', std::string("server_version\0" "15.0\0", 20));
+        reply(as, 'S', std::string("client_encoding\0" "UTF8\0", 21));
+        reply(as, 'S', std::string("standard_conforming_strings\0" "on\0", 31));
+        reply(as, 'Z', "I");
+        tcpflush(as, -1);
+
+        /* the text and number of parameters of statements by name */
+        std::map<std::string, std::pair<std::string, int16_t>> stmts;
+        /* the statement and parameters of the unnamed portal */
+        std::string bound;
+        std::vector<std::string> boundParams;
+        bool failed{false};
+        char type;
+        while (!srv->stop) {
+            if (tcprecv(as, &type, 1, mnow() + 100) != 1) {
+                if (errno == ETIMEDOUT) continue;
+                break;
+            }
+            tcprecv(as, &len, 4, -1);
+            msg.assign(ntohl(len) - 4, '\0');
+            if (!msg.empty())
+                tcprecv(as, &msg[0], msg.size(), -1);
+            size_t pos{0};
+
+            if (type == 'X') break;
+            if (type == 'S') {
+                /* sync ends the error state */
+                failed = false;
+                reply(as, 'Z', "I");
+                tcpflush(as, -1);
+                continue;
+            }
+            if (failed) continue;
+
+            switch (type) {
+                case 'Q': {
+                    srv->queries.push_back(cstr(msg, pos));
+                    reply(as, 'C', std::string("SET\0", 4));
+                    reply(as, 'Z', "I");
+                    break;
+                }
+                case 'P': {
+                    std::string name = cstr(msg, pos), query = cstr(msg, pos);
+                    srv->queries.push_back(query);
+                    const char *err = srv->parseError? srv->parseError(query) : nullptr;
+                    if (err) {
+                        error(as, err);
+                        failed = true;
+                        break;
+                    }
+                    stmts[name] = {query, i16(msg, pos)};
+                    reply(as, '1');
+                    break;
+                }
+                case 'B': {
+                    cstr(msg, pos);
+                    std::string name = cstr(msg, pos);
+                    int16_t nfmts = i16(msg, pos);
+                    pos += 2 * nfmts;
+                    std::vector<std::string> values(i16(msg, pos));
+                    for (auto& v: values) {
+                        int32_t n = i32(msg, pos);
+                        if (n < 0) continue;
+                        v.assign(&msg[pos], (size_t) n);
+                        pos += n;
+                    }
+                    srv->params.push_back(values);
+                    bound = name;
+                    boundParams = values;
+                    const char *err = srv->execError? srv->execError(stmts[name].first, values) : nullptr;
+                    if (err) {
+                        error(as, err);
+                        failed = true;
+                        break;
+                    }
+                    reply(as, '2');
+                    break;
+                }
+                case 'D': {
+                    pos = 1;
+                    std::string name = msg[0] == 'S'? cstr(msg, pos) : bound;
+                    if (msg[0] == 'S') {
+                        /* parameter descriptions, all parameters are text */
+                        int16_t n = stmts[name].second;
+                        std::string body(2, '\0');
+                        uint16_t tmp = htons((uint16_t) n);
+                        memcpy(&body[0], &tmp, 2);
+                        for (int i = 0; i < n; i++) {
+                            uint32_t oid = htonl(sql::TEXTOID);
+                            body.append((const char *) &oid, 4);
+                        }
+                        reply(as, 't', body);
+                    }
+                    if (srv->selects(stmts[name].first))
+                        describeRows(as);
+                    else
+                        reply(as, 'n');
+                    break;
+                }
+                case 'E': {
+                    auto& query = stmts[bound].first;
+                    if (!srv->selects(query)) {
+                        reply(as, 'C', std::string("INSERT 0 1\0", 11));
+                        break;
+                    }
+                    auto values = srv->rows(query, boundParams);
+                    for (auto& v: values) {
+                        std::string body("\0\1", 2);
+                        uint32_t n = htonl((uint32_t) v.size());
+                        body.append((const char *) &n, 4).append(v);
+                        reply(as, 'D', body);
+                    }
+                    std::string tag = "SELECT " + std::to_string(values.size());
+                    reply(as, 'C', tag.append(1, '\0'));
+                    break;
+                }
+                case 'C':
+                    reply(as, '3');
+                    break;
+                default:
+                    break;
+            }
+            tcpflush(as, -1);
+        }
+        tcpclose(as);
+    }
+};
+
+TEST_CASE("suil::sql::PGSQLStatement", "[sql][pgsql]")
+{
+    SECTION("mapping rows to objects") {
+        sql::PGSQLStatement stmt(nullptr, "SELECT", false);
+        stmt.results.add(makeWideResult(3));
+        stmt.results.add(makeWideResult(2));
+        stmt.results.reset();
+
+        std::vector<WideRow> rows;
+        REQUIRE(stmt >> rows);
+        REQUIRE(rows.size() == 5);
+        // column 0 is field t, column 19 is field a
+        CHECK(rows[0].a == 19);
+        CHECK(rows[0].t == "0");
+        CHECK(rows[2].a == 21);
+        CHECK(rows[2].b == "20");
+        CHECK(rows[3].a == 19);
+        CHECK(rows[4].s == 2);
+    }
+
+    SECTION("streaming rows keeps the column mapping") {
+        sql::PGSQLStatement stmt(nullptr, "SELECT", false);
+        for (int i = 0; i < 3; i++) {
+            stmt.results.add(makeWideResult(1));
+            stmt.results.reset();
+            WideRow row;
+            REQUIRE(stmt >> row);
+            CHECK(row.a == 19);
+            CHECK(row.t == "0");
+            auto mapped = stmt.results.mapped;
+            stmt.results.drop();
+            CHECK(stmt.results.empty());
+            CHECK(stmt.results.mapped == mapped);
+        }
+    }
+
+    SECTION("binary and text values are decoded alike") {
+        CHECK(sql::__internal::binary_decodable(sql::INT8OID, nullptr));
+        CHECK(sql::__internal::binary_decodable(sql::FLOAT8OID, nullptr));
+        CHECK(sql::__internal::binary_decodable(sql::BYTEAOID, nullptr));
+        CHECK_FALSE(sql::__internal::binary_decodable(sql::INT4ARRAYOID, nullptr));
+        /* depends on the session's DateStyle and TimeZone */
+        CHECK_FALSE(sql::__internal::binary_decodable(sql::TIMESTAMPOID, nullptr));
+
+        const Oid types[] = {sql::INT4OID, sql::BOOLOID, sql::FLOAT8OID, sql::FLOAT4OID,
+                             sql::TIMESTAMPOID, sql::TIMESTAMPTZOID, sql::BYTEAOID, sql::JSONBOID};
+        const char *texts[] = {"42", "t", "0.1", "-Infinity", "2020-01-02 03:04:05.25",
+                               "1999-12-31 23:59:59.5+00", "\\x00ff41", "{\"a\": 1}"};
+        unsigned long long f8, f4, ts, tstz;
+        uint32_t i4 = htonl(42);
+        sql::__internal::vhod_to_vnod(f8, 0.1);
+        sql::__internal::vhod_to_vnod(f4, -INFINITY);
+        sql::__internal::vhod_to_vnod(ts, (long long) 631249445250000);
+        sql::__internal::vhod_to_vnod(tstz, (long long) -500000);
+        std::pair<const void*, int> binaries[] = {
+            {&i4, 4}, {"\1", 1}, {&f8, 8}, {&f4, 4}, {&ts, 8}, {&tstz, 8},
+            {"\0\377A", 3}, {"\1{\"a\": 1}", 9}};
+
+        auto decode = [&](bool binary) {
+            PGresAttDesc attrs[8];
+            memset(attrs, 0, sizeof(attrs));
+            const char *names[] = {"a", "b", "c", "d", "e", "f", "g", "h"};
+            for (int col = 0; col < 8; col++) {
+                attrs[col].name = (char *) names[col];
+                attrs[col].typid = types[col];
+                attrs[col].format = binary? sql::PGSQL_BINARY_FORMAT : sql::PGSQL_TEXT_FORMAT;
+            }
+            PGresult *res = PQmakeEmptyPGresult(nullptr, PGRES_TUPLES_OK);
+            PQsetResultAttrs(res, 8, attrs);
+            for (int col = 0; col < 8; col++) {
+                if (binary)
+                    PQsetvalue(res, 0, col, (char *) binaries[col].first, binaries[col].second);
+                else
+                    PQsetvalue(res, 0, col, (char *) texts[col], (int) strlen(texts[col]));
+            }
+
+            sql::PGSQLStatement stmt(nullptr, "SELECT", false);
+            stmt.results.add(res);
+            stmt.results.reset();
+            auto& r = stmt.results;
+            std::vector<String> strs(8);
+            for (int col = 0; col < 8; col++)
+                REQUIRE(r.read(strs[col], col));
+            /* bytea is read as the raw bytes in both formats */
+            std::string raw;
+            REQUIRE(r.read(raw, 6));
+            CHECK(raw == std::string("\0\377A", 3));
+
+            int i{0}, ib{0};
+            bool b{false};
+            double d{0}, tsd{0}, tstzd{0};
+            float f{0};
+            int64_t tsi{0}, tstzi{0};
+            Blob<3> blob;
+            REQUIRE(r.read(i, 0));
+            REQUIRE(r.read(b, 1));
+            REQUIRE(r.read(ib, 1));
+            REQUIRE(r.read(d, 2));
+            REQUIRE(r.read(f, 3));
+            REQUIRE(r.read(tsi, 4));
+            REQUIRE(r.read(tsd, 4));
+            REQUIRE(r.read(tstzi, 5));
+            REQUIRE(r.read(tstzd, 5));
+            REQUIRE(r.read(blob, 6));
+
+            CHECK(i == 42);
+            CHECK(b);
+            CHECK(ib == 1);
+            CHECK(d == 0.1);
+            CHECK(f == -INFINITY);
+            CHECK(tsi == 1577934245);
+            CHECK(tsd == 1577934245.25);
+            CHECK(tstzi == 946684799);
+            CHECK(tstzd == 946684799.5);
+            CHECK(memcmp(blob.cbegin(), "\0\377A", 3) == 0);
+            return strs;
+        };
+
+        auto fromText = decode(false);
+        auto fromBinary = decode(true);
+        for (int col = 0; col < 8; col++) {
+            if (col == 6) continue;
+            CHECK(fromText[col] == texts[col]);
+            CHECK(fromBinary[col] == texts[col]);
+        }
+    }
+
+    SECTION("statements failing to prepare report the server error") {
+        PgTestServer srv;
+        REQUIRE(srv.ls != nullptr);
+        srv.parseError = [](const std::string& query) -> const char * {
+            if (query.find("missing") != std::string::npos)
+                return "relation \"missing\" does not exist";
+            return nullptr;
+        };
+        auto& conn = srv.connection();
+
+        auto stmt = conn("SELECT * FROM missing");
+        CHECK_THROWS_WITH(stmt(), Catch::Contains("relation \"missing\" does not exist"));
+        /* prepared, then executed unnamed */
+        CHECK(srv.queries.size() == 2);
+        /* no result is left pending on the connection */
+        CHECK_NOTHROW(conn("INSERT INTO users(name) VALUES($1)")("dc"));
+        REQUIRE_FALSE(srv.params.empty());
+        CHECK(srv.params.back() == std::vector<std::string>{"dc"});
+    }
+
+    SECTION("COPY text format encoding") {
+        OBuffer ob(16);
+        sql::__internal::copy_text(ob, String{"a\tb\\c\n"});
+        CHECK(strview(ob.data(), ob.size()) == "a\\tb\\\\c\\n");
+
+        OBuffer ub(16);
+        sql::__internal::copy_unescape(ub, ob.data(), ob.size());
+        CHECK(strview(ub.data(), ub.size()) == "a\tb\\c\n");
+
+        ob.clear();
+        sql::__internal::copy_text(ob, true);
+        sql::__internal::copy_text(ob, -42);
+        CHECK(strview(ob.data(), ob.size()) == "t-42");
+
+        ob.clear();
+        sql::__internal::copy_text(ob, 0.1);
+        ob << '\t';
+        sql::__internal::copy_text(ob, 0.1f);
+        ob << '\t';
+        sql::__internal::copy_text(ob, NAN);
+        ob << '\t';
+        sql::__internal::copy_text(ob, -INFINITY);
+        ob << '\t';
+        sql::__internal::copy_text(ob, 1e300);
+        CHECK(strview(ob.data(), ob.size()) == "0.1\t0.1\tNaN\t-Infinity\t1e+300");
+
+        int i{0};
+        String str;
+        sql::__internal::copy_parse(String{"1024"}, i);
+        sql::__internal::copy_parse(String{"hello"}, str);
+        CHECK(i == 1024);
+        CHECK(str == "hello");
+    }
+}
+
+TEST_CASE("suil::sql::PgSqlBatch", "[sql][pgsql]")
+{
+    PgTestServer srv;
+    REQUIRE(srv.ls != nullptr);
+    srv.execError = [](const std::string&, const std::vector<std::string>& params) -> const char * {
+        if (!params.empty() && params[0] == "bad")
+            return "duplicate key value violates unique constraint";
+        return nullptr;
+    };
+    auto& conn = srv.connection();
+    const char *insert = "INSERT INTO users(name) VALUES($1)";
+
+    SECTION("executions are pipelined in order") {
+        const char *names[] = {"a", "b", "c", "d", "e"};
+        auto batch = conn.batch(2);
+        for (auto name: names)
+            batch(insert, name);
+        std::vector<size_t> order;
+        REQUIRE(batch.exec([&](size_t i, sql::PGSQLStatement& stmt) {
+            CHECK(stmt.status());
+            order.push_back(i);
+        }));
+        CHECK((order == std::vector<size_t>{0, 1, 2, 3, 4}));
+        REQUIRE(srv.params.size() == 5);
+        for (int i = 0; i < 5; i++)
+            CHECK(srv.params[i][0] == names[i]);
+        /* prepared once */
+        CHECK(srv.queries.size() == 1);
+        CHECK(conn.idle());
+    }
+
+    SECTION("a failed execution aborts the rest of its chunk") {
+        auto batch = conn.batch(3);
+        batch(insert, "a")(insert, "bad")(insert, "c")(insert, "d");
+        std::vector<bool> statuses;
+        CHECK_FALSE(batch.exec([&](size_t, sql::PGSQLStatement& stmt) {
+            statuses.push_back(stmt.status());
+        }));
+        CHECK((statuses == std::vector<bool>{true, false, false}));
+        /* the next chunk is not sent */
+        CHECK(srv.params.size() == 2);
+        CHECK(conn.idle());
+        CHECK_NOTHROW(conn(insert)("e"));
+        CHECK(srv.params.back()[0] == "e");
+    }
+
+    SECTION("results are read while large chunks are sent") {
+        /* the server stops reading once it's blocked sending results, the small
+         * socket buffers and large rows make that happen early in the chunks */
+        PgTestServer big;
+        big.sockbuf = 65536;
+        big.rows = [](const std::string&, const std::vector<std::string>& params) {
+            return std::vector<std::string>{std::string(32*params[0].size(), params[0][0])};
+        };
+        auto& c = big.connection();
+        auto batch = c.batch(500);
+        std::vector<std::string> values(1000);
+        for (size_t i = 0; i < values.size(); i++) {
+            values[i].assign(1024, (char) ('a' + i%26));
+            batch("SELECT v FROM blobs WHERE k = $1", values[i]);
+        }
+
+        size_t count{0};
+        REQUIRE(batch.exec([&](size_t i, sql::PGSQLStatement& stmt) {
+            REQUIRE(stmt.status());
+            CHECK(i == count++);
+            std::string v;
+            REQUIRE(stmt.results.read(v, 0));
+            CHECK(v == std::string(32*1024, values[i][0]));
+        }));
+        CHECK(count == values.size());
+        CHECK(big.params.size() == values.size());
+        CHECK(c.idle());
+    }
+
+    SECTION("exceptions leave pipeline mode") {
+        auto batch = conn.batch(2);
+        batch(insert, "a")(insert, "b")(insert, "c");
+        CHECK_THROWS(batch.exec([&](size_t, sql::PGSQLStatement&) {
+            throw Exception::create("handler failed");
+        }));
+        CHECK(conn.idle());
+        CHECK_NOTHROW(conn(insert)("d"));
+        CHECK(srv.params.back()[0] == "d");
+    }
+}
+
+TEST_CASE("suil::sql::PGSQLStatement streaming", "[sql][pgsql]")
+{
+    PgTestServer srv;
+    REQUIRE(srv.ls != nullptr);
+    /* many more rows than a single read of the socket delivers */
+    const size_t nrows = 20000;
+    srv.rows = [&](const std::string&, const std::vector<std::string>& params) {
+        std::vector<std::string> values(nrows);
+        for (size_t i = 0; i < nrows; i++)
+            values[i] = params[0] + "-" + std::to_string(i);
+        return values;
+    };
+    auto& conn = srv.connection();
+    const char *select = "SELECT v FROM logs WHERE day = $1";
+
+    SECTION("every row is received in order") {
+        size_t count{0};
+        size_t n = conn(select).stream([&](std::string& row) {
+            CHECK(row == "mon-" + std::to_string(count++));
+        }, "mon");
+        CHECK(n == nrows);
+        CHECK(count == nrows);
+        CHECK(conn.idle());
+    }
+
+    SECTION("breaking out of the handler drains the connection") {
+        size_t count{0};
+        size_t n = conn(select).stream([&](std::string& row) {
+            CHECK(row == "mon-" + std::to_string(count));
+            return ++count < 10;
+        }, "mon");
+        CHECK(n == 10);
+        CHECK(count == 10);
+        CHECK(conn.idle());
+
+        /* the remaining rows were consumed, the next query gets its own rows */
+        std::string last;
+        n = conn(select).stream([&](std::string& row) {
+            last = row;
+        }, "tue");
+        CHECK(n == nrows);
+        CHECK(last == "tue-" + std::to_string(nrows-1));
+        CHECK(conn.idle());
+    }
+}
+
+typedef decltype(iod::D(
+    s::_id(var(PRIMARY_KEY)) = int(),
+    prop(name, String),
+    prop(age,  int)
+)) OrmPerson;
+
+TEST_CASE("suil::sql::Orm", "[sql][pgsql][orm]")
+{
+    PgTestServer srv;
+    REQUIRE(srv.ls != nullptr);
+    auto& conn = srv.connection();
+
+    SECTION("generated statements are prepared once per connection") {
+        OrmPerson p;
+        p.name = "dc";
+        for (int i = 0; i < 3; i++) {
+            sql::PgsqlOrm<OrmPerson> orm("people", conn);
+            p.id = i;
+            REQUIRE(orm.insert(p));
+            CHECK_FALSE(orm.find(i, p));
+        }
+        REQUIRE(srv.queries.size() == 2);
+        CHECK(srv.queries[0] == "insert into people(id, name, age) values ($1, $2, $3)");
+        CHECK(srv.queries[1] == "select id, name, age from people where id = $1");
+        CHECK(srv.params.size() == 6);
+
+        /* the slots are bound to the statements of the connection */
+        auto& other = srv.connection();
+        sql::PgsqlOrm<OrmPerson> orm("people", other);
+        REQUIRE(orm.insert(p));
+        CHECK(srv.queries.size() == 3);
+        CHECK(srv.queries[2] == srv.queries[0]);
+    }
+
+    SECTION("objects are inserted with multi-row VALUES lists") {
+        std::vector<OrmPerson> people(5);
+        for (int i = 0; i < 5; i++) {
+            people[i].id = i;
+            people[i].name = utils::catstr("p", i);
+            people[i].age = 20+i;
+        }
+        sql::PgsqlOrm<OrmPerson> orm("people", conn);
+        REQUIRE(orm.insertMany(people, 2));
+        /* two statements of 2 rows and one of 1 row */
+        REQUIRE(srv.queries.size() == 2);
+        CHECK(srv.queries[0] == "insert into people(id, name, age) values ($1, $2, $3), ($4, $5, $6)");
+        CHECK(srv.queries[1] == "insert into people(id, name, age) values ($1, $2, $3)");
+        REQUIRE(srv.params.size() == 3);
+        CHECK(srv.params[0].size() == 6);
+        CHECK(srv.params[0][1] == "p0");
+        CHECK(srv.params[0][4] == "p1");
+        CHECK(srv.params[2].size() == 3);
+        CHECK(srv.params[2][1] == "p4");
+    }
+
+    SECTION("rows per statement are capped by the parameter limit") {
+        std::vector<OrmPerson> people(10923);
+        sql::PgsqlOrm<OrmPerson> orm("people", conn);
+        REQUIRE(orm.insertMany(people, 20000));
+        /* the statement at the cap is too large to be described but still prepared */
+        REQUIRE(srv.queries.size() == 2);
+        CHECK(srv.queries[0].find("($32764, $32765, $32766)") != std::string::npos);
+        REQUIRE(srv.params.size() == 2);
+        CHECK(srv.params[0].size() == 32766);
+        CHECK(srv.params[1].size() == 3);
+    }
+
+    SECTION("conflicting objects are updated") {
+        std::vector<OrmPerson> people(2);
+        sql::PgsqlOrm<OrmPerson> orm("people", conn);
+        REQUIRE(orm.upsertMany(people));
+        REQUIRE(srv.queries.size() == 1);
+        CHECK(srv.queries[0] == "insert into people(id, name, age) values ($1, $2, $3), ($4, $5, $6)"
+                               " on conflict (id) do update set name = excluded.name, age = excluded.age");
+
+        typedef decltype(iod::D(s::_id(var(PRIMARY_KEY)) = int())) OrmKey;
+        std::vector<OrmKey> keys(1);
+        sql::PgsqlOrm<OrmKey> korm("keys", conn);
+        REQUIRE(korm.upsertMany(keys));
+        REQUIRE(srv.queries.size() == 2);
+        CHECK(srv.queries[1] == "insert into keys(id) values ($1) on conflict (id) do nothing");
+    }
+
+    SECTION("objects are fetched by id with a single statement") {
+        std::vector<OrmPerson> people;
+        sql::PgsqlOrm<OrmPerson> orm("people", conn);
+        CHECK_FALSE(orm.findMany({1, 2, 3}, people));
+        REQUIRE(srv.queries.size() == 1);
+        CHECK(srv.queries[0] == "select id, name, age from people where id = ANY($1)");
+        REQUIRE(srv.params.size() == 1);
+        CHECK(srv.params[0] == std::vector<std::string>{"{1,2,3}"});
+        CHECK(people.capacity() >= 3);
+    }
+
+    SECTION("created tables are seeded with a multi-row insert") {
+        std::vector<OrmPerson> seed(3);
+        sql::PgsqlOrm<OrmPerson> orm("people", conn);
+        REQUIRE(orm.cifne(seed));
+        REQUIRE(srv.queries.size() == 3);
+        CHECK(srv.queries[1].find("CREATE TABLE people(") == 0);
+        CHECK(srv.queries[2] == "insert into people(id, name, age) values ($1, $2, $3), ($4, $5, $6), ($7, $8, $9)");
+    }
+}
+
+TEST_CASE("suil::sql::PGSQLStatement benchmark", "[.][benchmark][sql][pgsql]")
+{
+    using Clock = std::chrono::steady_clock;
+    const int nrows = 10000;
+
+    SECTION("wide result set mapping") {
+        sql::PGSQLStatement stmt(nullptr, "SELECT", false);
+        stmt.results.add(makeWideResult(nrows));
+        stmt.results.reset();
+        auto& results = stmt.results;
+
+        // lookup the column of each field on every row
+        auto start = Clock::now();
+        std::vector<WideRow> lookup;
+        lookup.reserve(nrows);
+        do {
+            WideRow o;
+            iod::foreach(o) |
+            [&](auto& m) {
+                int fnumber = PQfnumber(results.result(), m.symbol().name());
+                if (fnumber != -1)
+                    results.read(o[m], fnumber);
+            };
+            lookup.push_back(std::move(o));
+        } while (results.next());
+        auto lookupTime = Clock::now() - start;
+        results.reset();
+
+        // column index cached once per result set
+        start = Clock::now();
+        std::vector<WideRow> cached;
+        cached.reserve(nrows);
+        stmt >> cached;
+        auto cachedTime = Clock::now() - start;
+
+        REQUIRE(cached.size() == lookup.size());
+        WARN("rows: " << nrows << ", fields: 20, per row lookup: "
+             << std::chrono::duration_cast<std::chrono::microseconds>(lookupTime).count()
+             << " us, cached: "
+             << std::chrono::duration_cast<std::chrono::microseconds>(cachedTime).count() << " us");
+    }
+}
+
+#endif // unit_test
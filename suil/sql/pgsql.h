@@ -27,22 +27,39 @@ namespace suil {
         };
 
         enum pg_types_t {
+            BOOLOID  = 16,
             BYTEAOID = 17,
             CHAROID  = 18,
+            NAMEOID  = 19,
             INT8OID  = 20,
             INT2OID  = 21,
             INT4OID  = 23,
             TEXTOID  = 25,
+            OIDOID   = 26,
+            JSONOID  = 114,
             FLOAT4OID = 700,
             FLOAT8OID = 701,
             INT2ARRAYOID   = 1005,
             INT4ARRAYOID   = 1007,
             TEXTARRAYOID   = 1009,
             FLOAT4ARRAYOID = 1021,
+            BPCHAROID      = 1042,
+            VARCHAROID     = 1043,
+            TIMESTAMPOID   = 1114,
+            TIMESTAMPTZOID = 1184,
             JSONBOID = 3802
 
         };
 
+        enum pg_format_t {
+            PGSQL_TEXT_FORMAT   = 0,
+            PGSQL_BINARY_FORMAT = 1
+        };
+
+        /* libpq drops the connection on parameter descriptions larger than 30000 bytes,
+         * statements with more parameters than this are prepared without being described */
+        static constexpr int PGSQL_MAX_DESCRIBED_PARAMS = (30000 - 2) / 4;
+
         namespace __internal {
 
             inline Oid type_to_pgsql_oid_type(const char&)
@@ -175,6 +192,9 @@ namespace suil {
                 unsigned int u32;
             };
 
+            /* seconds between the unix epoch and the postgres epoch (2000-01-01) */
+            static constexpr int64_t PGSQL_EPOCH_OFFSET = 946684800;
+
             template <typename Args>
             static char *vhod_to_vnod(unsigned long long& buf, const Args& v) {
                 order8b_t& to = (order8b_t &)buf;
@@ -186,8 +206,8 @@ namespace suil {
             }
 
             template <typename Args>
-            static inline void vhod_to_vnod_append(OBuffer& b,
-                  const typename  std::enable_if<std::is_arithmetic<Args>::value, Args>::type & d)
+            static inline typename std::enable_if<std::is_arithmetic<Args>::value>::type
+            vhod_to_vnod_append(OBuffer& b, const Args& d)
             { b << d; }
 
             static inline void vhod_to_vnod_append(OBuffer& b, const String &d) {
@@ -282,19 +302,335 @@ namespace suil {
                 to.u32_1 = ntohl(from->u32_2);
                 to.u32_2 = ntohl(from->u32_1);
             }
+
+            /**
+             * checks whether values of the given column type can be transferred
+             * in binary format. libpq requests one format for all the columns of a
+             * result, so each binary value is converted to whatever the field it's
+             * read into expects, the same way its text value would be. Timestamps
+             * are only sent in binary when the session formats them as ISO (and in
+             * UTC for timestamptz), the format used to read them as text
+             * @param oid the type of the column
+             * @param conn the connection the statement is prepared on
+             * @return true if the column type can be transferred in binary format
+             */
+            bool binary_decodable(Oid oid, PGconn *conn);
+
+            /**
+             * converts microseconds since the unix epoch into a number of seconds
+             */
+            template <typename Args>
+            void epoch_to_number(long long us, Args& v) {
+                if constexpr (std::is_floating_point<Args>::value) {
+                    v = (Args) (us / 1000000.0);
+                }
+                else {
+                    long long secs = us / 1000000;
+                    if (us % 1000000 < 0) secs--;
+                    v = (Args) secs;
+                }
+            }
+
+            /**
+             * parses an ISO formatted timestamp, e.g 2020-01-02 03:04:05.06+03
+             * @param text the timestamp as sent by the server
+             * @param us the number of microseconds since the unix epoch
+             * @return true if the timestamp was parsed
+             */
+            bool iso_to_epoch(const char *text, long long& us);
+
+            /**
+             * decodes a binary formatted numeric column value, timestamps are
+             * decoded as seconds since the unix epoch
+             * @param buf the binary value as received from the server
+             * @param len the length of the value
+             * @param oid the type of the column
+             * @param v the number to decode into
+             * @return true if the value was decoded, false if the type is not numeric
+             */
+            template <typename Args>
+            bool vnod_to_number(const char *buf, int len, Oid oid, Args& v) {
+                switch (oid) {
+                    case BOOLOID:
+                        v = (Args) (buf[0] != 0);
+                        return len == 1;
+                    case INT2OID: {
+                        short int tmp;
+                        vnod_to_vhod(buf, tmp);
+                        v = (Args) tmp;
+                        return len == sizeof(tmp);
+                    }
+                    case INT4OID: {
+                        int tmp;
+                        vnod_to_vhod(buf, tmp);
+                        v = (Args) tmp;
+                        return len == sizeof(tmp);
+                    }
+                    case OIDOID: {
+                        unsigned int tmp;
+                        vnod_to_vhod(buf, tmp);
+                        v = (Args) tmp;
+                        return len == sizeof(tmp);
+                    }
+                    case INT8OID: {
+                        long long tmp;
+                        vnod_to_vhod(buf, tmp);
+                        v = (Args) tmp;
+                        return len == sizeof(tmp);
+                    }
+                    case FLOAT4OID: {
+                        float tmp;
+                        vnod_to_vhod(buf, tmp);
+                        v = (Args) tmp;
+                        return len == sizeof(tmp);
+                    }
+                    case FLOAT8OID: {
+                        double tmp;
+                        vnod_to_vhod(buf, tmp);
+                        v = (Args) tmp;
+                        return len == sizeof(tmp);
+                    }
+                    case TIMESTAMPOID:
+                    case TIMESTAMPTZOID: {
+                        long long us;
+                        vnod_to_vhod(buf, us);
+                        epoch_to_number(us + PGSQL_EPOCH_OFFSET * 1000000, v);
+                        return len == sizeof(us);
+                    }
+                    default:
+                        return false;
+                }
+            }
+
+            /**
+             * converts a text formatted column value into a number
+             * @param text the value as sent by the server
+             * @param oid the type of the column
+             * @param v the number to convert into
+             */
+            template <typename Args>
+            void text_to_number(const char *text, Oid oid, Args& v) {
+                switch (oid) {
+                    case BOOLOID:
+                        v = (Args) (text[0] == 't');
+                        break;
+                    case TIMESTAMPOID:
+                    case TIMESTAMPTZOID: {
+                        long long us{0};
+                        iso_to_epoch(text, us);
+                        epoch_to_number(us, v);
+                        break;
+                    }
+                    default:
+                        utils::cast(text, v);
+                }
+            }
+
+            /**
+             * gets the text representation of a binary formatted column value
+             * @param buf the binary value as received from the server
+             * @param len the length of the value
+             * @param oid the type of the column
+             * @param scratch a buffer used to format numbers and timestamps
+             * @return a view of the text, either into \param buf or into \param scratch
+             */
+            strview vnod_to_text(const char *buf, int len, Oid oid, char (&scratch)[64]);
+
+            /**
+             * waits for the socket of the given connection to be ready
+             * @param conn the connection to wait on
+             * @param ev the events to wait for, either FDW_IN or FDW_OUT
+             * @param timeout the wait timeout in milliseconds, -1 to wait forever
+             * @return 0 when ready, ETIMEDOUT on timeout and a negative value on error
+             */
+            inline int pgsql_wait(PGconn *conn, int ev, int64_t timeout) {
+                int sock = PQsocket(conn);
+                if (sock < 0) {
+                    serror("invalid PGSQL socket");
+                    return -EINVAL;
+                }
+
+                int64_t tmp = timeout < 0? -1 : mnow() + timeout;
+                int events = fdwait(sock, ev, tmp);
+                if (events&FDW_ERR) {
+                    return -1;
+                } else if (events&ev) {
+                    return 0;
+                }
+                errno = ETIMEDOUT;
+                return ETIMEDOUT;
+            }
+
+            /**
+             * flushes the data queued on the given connection, consuming the input
+             * received meanwhile. A server stops reading commands while it's blocked
+             * sending results, which commands sent back-to-back (e.g a pipeline)
+             * can cause if the results are not read while sending
+             * @param conn the connection to flush
+             * @param timeout the wait timeout in milliseconds, -1 to wait forever
+             * @return 0 when flushed, ETIMEDOUT on timeout and a negative value on error
+             */
+            inline int pgsql_flush(PGconn *conn, int64_t timeout) {
+                int rc;
+                while ((rc = PQflush(conn)) == 1) {
+                    int64_t tmp = timeout < 0? -1 : mnow() + timeout;
+                    int events = fdwait(PQsocket(conn), FDW_IN|FDW_OUT, tmp);
+                    if (events&FDW_ERR) {
+                        return -1;
+                    }
+                    if ((events&FDW_IN) && !PQconsumeInput(conn)) {
+                        return -1;
+                    }
+                    if (!(events&(FDW_IN|FDW_OUT))) {
+                        errno = ETIMEDOUT;
+                        return ETIMEDOUT;
+                    }
+                }
+                return rc;
+            }
+
+            /* the fields of a type that are copied in/out of a table */
+            template <typename T>
+            using copy_fields_t = remove_ignore_fields_t<remove_auto_increment_t<typename schema_of<T>::type>>;
+
+            /**
+             * appends the given data into the buffer, escaping it for the COPY text format
+             */
+            void copy_escape(OBuffer& b, const char *data, size_t len);
+
+            /**
+             * appends the given data into the buffer, removing COPY text format escapes
+             */
+            void copy_unescape(OBuffer& b, const char *data, size_t len);
+
+            template <typename Args>
+            typename std::enable_if<std::is_arithmetic<Args>::value>::type
+            copy_text(OBuffer& b, const Args& v) {
+                if constexpr (std::is_same<Args, bool>::value)
+                    b << (v? 't' : 'f');
+                else if constexpr (std::is_floating_point<Args>::value) {
+                    /* shortest round trip digits, NaN and infinite values are written
+                     * as NaN, Infinity and -Infinity which postgres accepts */
+                    char tmp[numfmt::MAX_DOUBLE];
+                    if constexpr (std::is_same<Args, float>::value)
+                        b.append(tmp, numfmt::ftoa(v, tmp));
+                    else
+                        b.append(tmp, numfmt::dtoa((double) v, tmp));
+                }
+                else if constexpr (std::is_same<Args, char>::value)
+                    b << (int) v;
+                else
+                    b << v;
+            }
+            inline void copy_text(OBuffer& b, const char *v) { copy_escape(b, v, strlen(v)); }
+            inline void copy_text(OBuffer& b, const String& v) { copy_escape(b, v.data(), v.size()); }
+            inline void copy_text(OBuffer& b, const std::string& v) { copy_escape(b, v.data(), v.size()); }
+            inline void copy_text(OBuffer& b, const strview& v) { copy_escape(b, v.data(), v.size()); }
+            inline void copy_text(OBuffer& b, const iod::json_string& v) { copy_text(b, v.str); }
+            template <size_t N>
+            inline void copy_text(OBuffer& b, const Blob<N>& v) {
+                b << "\\\\x";
+                b.hex(v.cbegin(), v.size());
+            }
+            template <typename Args>
+            inline void copy_text(OBuffer& b, const std::vector<Args>& v) {
+                OBuffer tmp(32);
+                vhod_to_vnod(tmp, v);
+                copy_escape(b, tmp.data(), tmp.size());
+            }
+
+            inline void copy_binary_field(OBuffer& b, const void *data, size_t len) {
+                b.append(htonl((unsigned int) len));
+                b.append(data, len);
+            }
+
+            template <typename Args>
+            typename std::enable_if<std::is_arithmetic<Args>::value>::type
+            copy_binary(OBuffer& b, const Args& v) {
+                if constexpr (std::is_same<Args, bool>::value) {
+                    char c = v? 1 : 0;
+                    copy_binary_field(b, &c, 1);
+                }
+                else {
+                    unsigned long long norder{0};
+                    copy_binary_field(b, vhod_to_vnod(norder, v), sizeof(Args));
+                }
+            }
+            inline void copy_binary(OBuffer& b, const char *v) { copy_binary_field(b, v, strlen(v)); }
+            inline void copy_binary(OBuffer& b, const String& v) { copy_binary_field(b, v.data(), v.size()); }
+            inline void copy_binary(OBuffer& b, const std::string& v) { copy_binary_field(b, v.data(), v.size()); }
+            inline void copy_binary(OBuffer& b, const strview& v) { copy_binary_field(b, v.data(), v.size()); }
+            inline void copy_binary(OBuffer& b, const iod::json_string& v) {
+                /* binary jsonb is prefixed with a version byte */
+                b.append(htonl((unsigned int) v.str.size()+1));
+                b.append((char) 1);
+                b.append(v.str.data(), v.str.size());
+            }
+            template <size_t N>
+            inline void copy_binary(OBuffer& b, const Blob<N>& v) { copy_binary_field(b, v.cbegin(), v.size()); }
+            template <typename Args>
+            inline void copy_binary(OBuffer& b, const std::vector<Args>&) {
+                throw Exception::unsupportedOperation("arrays are not supported by binary COPY");
+            }
+
+            template <typename Args>
+            typename std::enable_if<std::is_arithmetic<Args>::value>::type
+            copy_parse(const String& in, Args& v) {
+                if constexpr (std::is_same<Args, bool>::value)
+                    v = !in.empty() && (in.data()[0] == 't' || in.data()[0] == '1');
+                else
+                    utils::cast(in, v);
+            }
+            inline void copy_parse(const String& in, String& v) { v = in.dup(); }
+            inline void copy_parse(const String& in, std::string& v) { v.assign(in.data(), in.size()); }
+            inline void copy_parse(const String& in, iod::json_string& v) { copy_parse(in, v.str); }
+            template <size_t N>
+            inline void copy_parse(const String& in, Blob<N>& v) {
+                /* bytea hex format, \x0102 */
+                if (in.size() > 2)
+                    utils::bytes(String(&in.data()[2], MIN(in.size()-2, N<<1), false), &v[0], N);
+            }
+            template <typename Args>
+            inline void copy_parse(const String& in, std::vector<Args>& v) {
+                parse_array(v, in.data());
+            }
         };
 
+        struct PgSqlBatch;
+        struct PgSqlCopyIn;
+
         struct PGSQLStatement : LOGGER(PGSQL_CONN) {
 
-            PGSQLStatement(PGconn *conn, String stmt, bool async, int64_t timeout = -1)
+            PGSQLStatement(PGconn *conn, String stmt, bool async, int64_t timeout = -1, String name = nullptr)
                 : conn(conn),
                   stmt(std::move(stmt)),
                   async(async),
                   timeout(timeout)
-            {}
+            {
+                if (!name.empty()) {
+                    /* statement will be prepared on the server on first use */
+                    prepared = std::make_shared<prepared_t>();
+                    prepared->name = std::move(name);
+                }
+            }
 
             template <typename... Args>
             auto& operator()(Args&&... args) {
+                params([&](int nparams, const char **values, const Oid *oids, const int *lens, const int *bins) {
+                    execute(nparams, values, oids, lens, bins);
+                }, std::forward<Args>(args)...);
+
+                return *this;
+            }
+
+            /**
+             * binds the given arguments to statement parameters and invokes \param f with
+             * the parameter arrays, which are only valid during the call
+             * @param f handler invoked as f(nparams, values, oids, lengths, formats)
+             * @param args the arguments to bind
+             */
+            template <typename F, typename... Args>
+            void params(F f, Args&&... args) {
                 const size_t size = sizeof...(Args)+1;
                 const char *values[size] = {nullptr};
                 int  lens[size]    = {0};
@@ -325,57 +661,34 @@ namespace suil {
                     i++;
                 };
 
+                f((int) sizeof...(Args), values, oids, lens, bins);
+            }
+
+            /**
+             * executes the statement with already bound parameters
+             * @param nparams the number of parameters
+             * @param values the parameter values
+             * @param oids the parameter types
+             * @param lens the length of each parameter value
+             * @param bins the format of each parameter value
+             */
+            void execute(int nparams, const char **values, const Oid *oids, const int *lens, const int *bins) {
                 // Clear the results (important for reused statements)
                 results.clear();
+                if (prepared && !prepared->ready && !prepared->failed) {
+                    /* first use of the statement on this connection */
+                    prepare(oids, nparams);
+                }
+                const bool usePrepared = isPrepared(oids, nparams);
+                const int  format = usePrepared? prepared->format : PGSQL_TEXT_FORMAT;
+
                 if (async) {
-                    int status = PQsendQueryParams(
-                            conn,
-                            stmt.data(),
-                            (int) sizeof...(Args),
-                            oids,
-                            values,
-                            lens,
-                            bins,
-                            0);
-                    if (!status) {
+                    if (!send(nparams, values, oids, lens, bins)) {
                         ierror("ASYNC QUERY: %s failed: %s", stmt(), PQerrorMessage(conn));
                         throw std::runtime_error("executing async query failed");
                     }
 
-                    bool wait = true, err = false;
-                    while (!err && PQflush(conn)) {
-                        trace("ASYNC QUERY: %s wait write %ld", stmt(), timeout);
-                        if (wait_write()) {
-                            ierror("ASYNC QUERY: % wait write failed: %s", stmt(), errno_s);
-                            err  = true;
-                            continue;
-                        }
-                    }
-
-                    while (wait && !err) {
-                        if (PQisBusy(conn)) {
-                            trace("ASYNC QUERY: %s wait read %ld", stmt.data(), timeout);
-                            if (wait_read()) {
-                                ierror("ASYNC QUERY: %s wait read failed: %s", stmt.data(), errno_s);
-                                err = true;
-                                continue;
-                            }
-                        }
-
-                        // asynchronously wait for results
-                        if (!PQconsumeInput(conn)) {
-                            ierror("ASYNC QUERY: %s failed: %s", stmt(), PQerrorMessage(conn));
-                            err = true;
-                            continue;
-                        }
-
-                        PGresult *result = PQgetResult(conn);
-                        if (result == nullptr) {
-                            /* async query done */
-                            wait = false;
-                            continue;
-                        }
-
+                    bool ok = waitResults([&](PGresult *result) {
                         switch (PQresultStatus(result)) {
                             case PGRES_COPY_OUT:
                             case PGRES_COPY_IN:
@@ -398,11 +711,12 @@ namespace suil {
                                 ierror("ASYNC QUERY: %s failed: %s",
                                       stmt(), PQerrorMessage(conn));
                                 PQclear(result);
-                                err = true;
+                                return false;
                         }
-                    }
+                        return true;
+                    });
 
-                    if (err) {
+                    if (!ok) {
                         /* error occurred and was reported in logs */
                         throw Exception::create("query failed: ", PQerrorMessage(conn));
                     }
@@ -410,15 +724,24 @@ namespace suil {
                     trace("ASYNC QUERY: received %d results", results.results.size());
                 }
                 else {
-                    PGresult *result = PQexecParams(
+                    PGresult *result = usePrepared?
+                        PQexecPrepared(
+                            conn,
+                            prepared->name.data(),
+                            nparams,
+                            values,
+                            lens,
+                            bins,
+                            format) :
+                        PQexecParams(
                             conn,
                             stmt.data(),
-                            (int) sizeof...(Args),
+                            nparams,
                             oids,
                             values,
                             lens,
                             bins,
-                            0);
+                            format);
                     ExecStatusType status = PQresultStatus(result);
 
                     if ((status != PGRES_TUPLES_OK && status != PGRES_COMMAND_OK)) {
@@ -437,10 +760,134 @@ namespace suil {
                         results.add(result);
                     }
                 }
+            }
+
+            /**
+             * executes the statement binding the given fields of each object in the range
+             * [\param first, \param last) as consecutive parameters, used to execute
+             * statements generated for a number of rows (e.g multi-row VALUES lists)
+             * @param fields the fields to bind from each object
+             * @param first the first object to bind
+             * @param last the end of the range of objects
+             * @return the statement
+             */
+            template <typename Fields, typename It>
+            auto& many(const Fields& fields, It first, It last) {
+                const size_t size = (size_t) std::distance(first, last) * Fields::size();
+                std::vector<const char *> values(size, nullptr);
+                std::vector<Oid> oids(size, InvalidOid);
+                std::vector<int> lens(size, 0), bins(size, 0);
+                std::vector<unsigned long long> norder(size, 0);
+                std::vector<void *> gc;
+
+                size_t i{0};
+                for (auto it = first; it != last; it++) {
+                    auto& o = *it;
+                    iod::foreach(fields) |
+                    [&](auto& m) {
+                        void *tmp = this->bind(values[i], oids[i], lens[i], bins[i], norder[i],
+                                               m.symbol().member_access(o));
+                        if (tmp != nullptr)
+                            gc.push_back(tmp);
+                        i++;
+                    };
+                }
+
+                try {
+                    execute((int) size, values.data(), oids.data(), lens.data(), bins.data());
+                }
+                catch (...) {
+                    for (auto b: gc) free(b);
+                    throw;
+                }
+                for (auto b: gc) free(b);
 
                 return *this;
             }
 
+            /**
+             * executes the statement in single row mode, decoding each row into an
+             * object and passing it to \param f as soon as it is received. Only one
+             * row is held in memory at a time whatever the size of the result set
+             * @param f the row handler f(T& row), may return false to skip the remaining rows
+             * @param args the arguments to bind to the statement
+             * @return the number of rows received
+             *
+             * \example
+             *  conn("SELECT * FROM logs WHERE day = $1").stream([&](Log& log) {
+             *      write(log);
+             *  }, today);
+             */
+            template <typename F, typename... Args>
+            size_t stream(F f, Args&&... args) {
+                typedef iod::callable_arguments_tuple_t<F> __tmp;
+                typedef std::remove_reference_t<std::tuple_element_t<0, __tmp>> Row;
+                size_t nrows{0};
+
+                params([&](int nparams, const char **values, const Oid *oids, const int *lens, const int *bins) {
+                    results.clear();
+                    if (prepared && !prepared->ready && !prepared->failed) {
+                        /* first use of the statement on this connection */
+                        prepare(oids, nparams);
+                    }
+
+                    if (!send(nparams, values, oids, lens, bins)) {
+                        ierror("STREAM QUERY: %s failed: %s", stmt(), PQerrorMessage(conn));
+                        throw Exception::create("executing streaming query failed: ", PQerrorMessage(conn));
+                    }
+                    if (!PQsetSingleRowMode(conn)) {
+                        iwarn("STREAM QUERY: %s single row mode not available", stmt());
+                    }
+
+                    bool more{true}, failed{false};
+                    bool ok = waitResults([&](PGresult *result) {
+                        switch (PQresultStatus(result)) {
+                            case PGRES_SINGLE_TUPLE:
+                            case PGRES_TUPLES_OK:
+                                if (PQntuples(result) == 0) {
+                                    /* end of the result set */
+                                    PQclear(result);
+                                    break;
+                                }
+                                results.add(result);
+                                results.reset();
+                                do {
+                                    Row o;
+                                    if (more && Ego >> o) {
+                                        nrows++;
+                                        if constexpr (std::is_same<decltype(f(o)), bool>::value)
+                                            more = f(o);
+                                        else
+                                            f(o);
+                                    }
+                                } while (results.next());
+                                /* the column mapping is kept for the next row */
+                                results.drop();
+                                break;
+                            case PGRES_COMMAND_OK:
+                            case PGRES_NONFATAL_ERROR:
+                                PQclear(result);
+                                break;
+                            default:
+                                /* keep reading until the end of the query */
+                                ierror("STREAM QUERY: %s failed: %s", stmt(), PQresultErrorMessage(result));
+                                failed = true;
+                                PQclear(result);
+                                break;
+                        }
+                        return true;
+                    });
+
+                    if (!ok || failed) {
+                        results.clear();
+                        results.fail();
+                        throw Exception::create("streaming query failed: ", PQerrorMessage(conn));
+                    }
+                }, std::forward<Args>(args)...);
+
+                return nrows;
+            }
+
             template <typename... O>
             inline bool operator>>(iod::sio<O...>& o) {
                 if (results.empty()) return false;
@@ -504,59 +951,167 @@ namespace suil {
                 return results.empty();
             }
 
-        private:
+        private suil_ut:
+            friend struct PgSqlBatch;
 
-            inline int wait_read() {
-                int sock = PQsocket(conn);
-                if (sock < 0) {
-                    ierror("invalid PGSQL socket");
-                    return -EINVAL;
+            struct prepared_t {
+                String           name;
+                std::vector<Oid> oids;
+                int              format{PGSQL_TEXT_FORMAT};
+                bool             ready{false};
+                bool             failed{false};
+            };
+
+            inline bool isPrepared(const Oid *oids, int nparams) const {
+                return prepared && prepared->ready &&
+                       std::equal(oids, oids+nparams, prepared->oids.begin(), prepared->oids.end());
+            }
+
+            /* sends the statement without waiting for results */
+            bool send(int nparams, const char **values, const Oid *oids, const int *lens, const int *bins) {
+                int status = isPrepared(oids, nparams)?
+                    PQsendQueryPrepared(
+                        conn,
+                        prepared->name.data(),
+                        nparams,
+                        values,
+                        lens,
+                        bins,
+                        prepared->format) :
+                    PQsendQueryParams(
+                        conn,
+                        stmt.data(),
+                        nparams,
+                        oids,
+                        values,
+                        lens,
+                        bins,
+                        PGSQL_TEXT_FORMAT);
+                return status != 0;
+            }
+
+            /* passes each result of the command in progress to handler. Results are always
+             * read up to the terminating null result, those following a failure or an
+             * exception in the handler are discarded to keep the connection usable */
+            template <typename Handler>
+            bool waitResults(Handler handler) {
+                bool ok{true}, failed{false};
+                PGresult *result{nullptr};
+                try {
+                    while ((ok = nextResult(result)) && result != nullptr) {
+                        if (failed) {
+                            /* draining the results of a failed command */
+                            PQclear(result);
+                            continue;
+                        }
+                        failed = !handler(result);
+                    }
+                }
+                catch (...) {
+                    while (nextResult(result) && result != nullptr)
+                        PQclear(result);
+                    throw;
                 }
 
-                int64_t tmp = timeout < 0? -1 : mnow() + timeout;
-                int events = fdwait(sock, FDW_IN, tmp);
-                if (events&FDW_ERR) {
-                    return -1;
-                } else if (events&FDW_IN) {
-                    return 0;
+                return ok && !failed;
+            }
+
+            /* waits for the next result of the command in progress, result is set to
+             * nullptr once all results are received. Returns false if waiting failed */
+            bool nextResult(PGresult*& result) {
+                result = nullptr;
+                if (__internal::pgsql_flush(conn, timeout)) {
+                    ierror("ASYNC QUERY: %s flush failed: %s", stmt(), errno_s);
+                    return false;
                 }
-                errno = ETIMEDOUT;
-                return ETIMEDOUT;
+
+                while (PQisBusy(conn)) {
+                    trace("ASYNC QUERY: %s wait read %ld", stmt.data(), timeout);
+                    if (wait_read()) {
+                        ierror("ASYNC QUERY: %s wait read failed: %s", stmt.data(), errno_s);
+                        return false;
+                    }
+
+                    // asynchronously wait for results
+                    if (!PQconsumeInput(conn)) {
+                        ierror("ASYNC QUERY: %s failed: %s", stmt(), PQerrorMessage(conn));
+                        return false;
+                    }
+                }
+
+                result = PQgetResult(conn);
+                return true;
             }
 
-            inline int wait_write() {
-                int sock = PQsocket(conn);
-                if (sock < 0) {
-                    ierror("invalid PGSQL socket");
-                    return -EINVAL;
+            void prepare(const Oid *oids, int nparams) {
+                PGresult *desc{nullptr};
+                bool ok{false}, describe{nparams <= PGSQL_MAX_DESCRIBED_PARAMS};
+                if (async) {
+                    ok = PQsendPrepare(conn, prepared->name.data(), stmt.data(), nparams, oids) &&
+                         waitResults([&](PGresult *result) {
+                             bool status = PQresultStatus(result) == PGRES_COMMAND_OK;
+                             PQclear(result);
+                             return status;
+                         });
+                    ok = ok && (!describe || (PQsendDescribePrepared(conn, prepared->name.data()) &&
+                         waitResults([&](PGresult *result) {
+                             bool status = PQresultStatus(result) == PGRES_COMMAND_OK;
+                             if (status && desc == nullptr)
+                                 desc = result;
+                             else
+                                 PQclear(result);
+                             return status;
+                         })));
+                }
+                else {
+                    PGresult *result = PQprepare(conn, prepared->name.data(), stmt.data(), nparams, oids);
+                    ok = PQresultStatus(result) == PGRES_COMMAND_OK;
+                    PQclear(result);
+                    if (ok && describe) {
+                        desc = PQdescribePrepared(conn, prepared->name.data());
+                        ok = PQresultStatus(desc) == PGRES_COMMAND_OK;
+                    }
                 }
 
-                int64_t tmp = timeout < 0? -1 : mnow() + timeout;
-                int events = fdwait(sock, FDW_OUT, tmp);
-                if (events&FDW_ERR) {
-                    return -1;
-                } else if (events&FDW_OUT) {
-                    return 0;
+                if (!ok || (describe && desc == nullptr)) {
+                    /* statement cannot be prepared (e.g utility statement), fallback to unnamed statements */
+                    iwarn("PREPARE: %s failed: %s", stmt(), PQerrorMessage(conn));
+                    prepared->failed = true;
+                    if (desc) PQclear(desc);
+                    return;
                 }
 
-                errno = ETIMEDOUT;
-                return ETIMEDOUT;
+                /* results are requested in binary format only if every column can be decoded */
+                int nfields = desc? PQnfields(desc) : 0;
+                bool binary = nfields > 0;
+                for (int i = 0; binary && i < nfields; i++)
+                    binary = __internal::binary_decodable(PQftype(desc, i), conn);
+                if (desc) PQclear(desc);
+
+                prepared->format = binary? PGSQL_BINARY_FORMAT : PGSQL_TEXT_FORMAT;
+                prepared->oids.assign(oids, oids+nparams);
+                prepared->ready  = true;
+                trace("PREPARE: %s prepared as %s format %d", stmt(), prepared->name(), prepared->format);
+            }
+
+            inline int wait_read() {
+                return __internal::pgsql_wait(conn, FDW_IN, timeout);
             }
 
             template <typename... O>
             bool rowToSio(iod::sio<O...> &o) {
                 if (results.empty()) return false;
 
-                int ncols = PQnfields(results.result());
+                using Fields = suil::sql::__internal::remove_ignore_fields_t<iod::sio<O...>>;
+                const int *columns = results.template columns<iod::sio<O...>>(Fields());
                 bool status{true};
-                iod::foreach(suil::sql::__internal::remove_ignore_fields_t<decltype(o)>()) |
+                int i{0};
+                iod::foreach(Fields()) |
                 [&] (auto &m) {
-                    if (status) {
-                        int fnumber = PQfnumber(results.result(), m.symbol().name());
-                        if (fnumber != -1) {
-                            // column found
-                            status = results.read(o[m], fnumber);
-                        }
+                    int fnumber = columns[i++];
+                    if (status && fnumber != -1) {
+                        // column found
+                        status = results.read(o[m], fnumber);
                     }
                 };
 
@@ -567,16 +1122,16 @@ namespace suil {
             bool rowToMeta(T& o) {
                 if (results.empty()) return false;
 
-                int ncols = PQnfields(results.result());
+                using Fields = suil::sql::__internal::remove_ignore_fields_t<typename T::Schema>;
+                const int *columns = results.template columns<T>(Fields());
                 bool status{true};
-                iod::foreach(suil::sql::__internal::remove_ignore_fields_t<typename T::Schema>()) |
+                int i{0};
+                iod::foreach(Fields()) |
                 [&] (auto &m) {
-                    if (status) {
-                        int fnumber = PQfnumber(results.result(), m.symbol().name());
-                        if (fnumber != -1) {
-                            // column found
-                            status = results.read(m.symbol().member_access(o), fnumber);
-                        }
+                    int fnumber = columns[i++];
+                    if (status && fnumber != -1) {
+                        // column found
+                        status = results.read(m.symbol().member_access(o), fnumber);
                     }
                 };
 
@@ -685,9 +1240,38 @@ namespace suil {
                 result_q_t   results;
                 results_q_it it;
                 int row{0};
+                /* field -> column index map of the last mapped type, all results
+                 * of a statement share the same row description */
+                const void      *mapped{nullptr};
+                std::vector<int> mapping;
+                /* the last text formatted bytea value read */
+                std::string      bytes{};
 
                 inline PGresult *result() {
                     if (it != results.end()) return *it;
+                    return nullptr;
+                }
+
+                /**
+                 * gets the column index of each of the given fields, the lookup
+                 * is done once per result set and target type
+                 * @tparam T the type being mapped from the rows
+                 * @param fields the fields to lookup
+                 * @return an array with the column index of each field, -1 if the
+                 * field has no matching column
+                 */
+                template <typename T, typename Fields>
+                const int* columns(const Fields& fields) {
+                    static const char tag{0};
+                    if (mapped != &tag) {
+                        mapping.clear();
+                        iod::foreach(fields) |
+                        [&](auto& m) {
+                            mapping.push_back(PQfnumber(result(), m.symbol().name()));
+                        };
+                        mapped = &tag;
+                    }
+                    return mapping.data();
                 }
 
                 bool next() {
@@ -707,9 +1291,16 @@ namespace suil {
                     if (!empty()) {
                         char *data = PQgetvalue(*it, row, col);
                         if (data != nullptr) {
-                            //__internal::vnod_to_vhod(data, v);
-                            String tmp(data);
-                            utils::cast(data, v);
+                            Oid oid = PQftype(*it, col);
+                            if (PQfformat(*it, col) == PGSQL_BINARY_FORMAT && !PQgetisnull(*it, row, col)) {
+                                /* binary numbers are decoded directly, other types are converted from text */
+                                if (!__internal::vnod_to_number(data, PQgetlength(*it, row, col), oid, v)) {
+                                    char scratch[64];
+                                    __internal::text_to_number(text(col, scratch).data(), oid, v);
+                                }
+                                return true;
+                            }
+                            __internal::text_to_number(data, oid, v);
                             return true;
                         }
                     }
@@ -719,10 +1310,10 @@ namespace suil {
                 template <typename Args>
                 bool read(std::vector<Args>& v, int col) {
                     if (!empty()) {
-                        char *data = PQgetvalue(*it, row, col);
-                        if (data != nullptr) {
-                            int len = PQgetlength(*it, row, col);
-                            __internal::parse_array(v, data);
+                        char scratch[64];
+                        strview data = text(col, scratch);
+                        if (data.data() != nullptr) {
+                            __internal::parse_array(v, data.data());
                             return true;
                         }
                     }
@@ -731,11 +1322,10 @@ namespace suil {
 
                 bool read(std::string& v, int col) {
                     if (!empty()) {
-                        char *data = PQgetvalue(*it, row, col);
-                        if (data != nullptr) {
-                            int len = PQgetlength(*it, row, col);
-                            v.resize((size_t) len);
-                            memcpy(&v[0], data, (size_t) len);
+                        char scratch[64];
+                        strview data = text(col, scratch);
+                        if (data.data() != nullptr) {
+                            v.assign(data.data(), data.size());
                             return true;
                         }
                     }
@@ -749,10 +1339,10 @@ namespace suil {
                 template <size_t N>
                 bool read(Blob<N>& v, int col) {
                     if (!empty()) {
-                        char *data = PQgetvalue(*it, row, col);
-                        if (data != nullptr) {
-                            int len = PQgetlength(*it, row, col);
-                            memcpy(&v[0], data, MIN((size_t)len, N));
+                        char scratch[64];
+                        strview data = text(col, scratch);
+                        if (data.data() != nullptr) {
+                            memcpy(&v[0], data.data(), MIN(data.size(), N));
                             return true;
                         }
                     }
@@ -761,10 +1351,10 @@ namespace suil {
 
                 bool read(String& v, int col) {
                     if (!empty()) {
-                        char *data = PQgetvalue(*it, row, col);
-                        if (data != nullptr) {
-                            int len = PQgetlength(*it, row, col);
-                            v = std::move(String(data, len, false).dup());
+                        char scratch[64];
+                        strview data = text(col, scratch);
+                        if (data.data() != nullptr) {
+                            v = std::move(String(data.data(), data.size(), false).dup());
                             return true;
                         }
                     }
@@ -772,13 +1362,38 @@ namespace suil {
                     return false;
                 }
 
-                void clear() {
-                    results_q_it tmp = results.begin();
-                    while (tmp != results.end()) {
-                        PQclear(*tmp);
-                        results.erase(tmp);
-                        tmp = results.begin();
+                strview text(int col, char (&scratch)[64]) {
+                    char *data = PQgetvalue(*it, row, col);
+                    if (data == nullptr)
+                        return strview{};
+                    int len = PQgetlength(*it, row, col);
+                    if (PQgetisnull(*it, row, col))
+                        return strview{data, (size_t) len};
+                    if (PQfformat(*it, col) == PGSQL_BINARY_FORMAT)
+                        return __internal::vnod_to_text(data, len, PQftype(*it, col), scratch);
+                    if (PQftype(*it, col) == BYTEAOID && len >= 2 && data[0] == '\\' && data[1] == 'x') {
+                        /* bytea is read as the raw bytes, like its binary value */
+                        bytes.resize((size_t) (len-2)/2);
+                        for (int i = 2; i+1 < len; i += 2)
+                            bytes[i/2-1] = (char) (utils::c2i(data[i]) << 4 | utils::c2i(data[i+1]));
+                        return strview{bytes.data(), bytes.size()};
                     }
+                    return strview{data, (size_t) len};
+                }
+
+                void clear() {
+                    drop();
+                    mapped = nullptr;
+                }
+
+                /**
+                 * releases the results but keeps the column mapping, used when
+                 * streaming rows which all share the same row description
+                 */
+                void drop() {
+                    for (auto res: results)
+                        PQclear(res);
+                    results.clear();
                     reset();
                 }
 
@@ -814,19 +1429,27 @@ namespace suil {
             bool         async;
             int64_t      timeout;
             pgsql_result results;
+            std::shared_ptr<prepared_t> prepared{nullptr};
         };
 
         struct PgSqlConnection: LOGGER(PGSQL_CONN) {
             typedef std::vector<PgSqlConnection*>::iterator active_conns_iterator_t;
-            typedef CaseMap <PGSQLStatement> stmt_map_t;
+            /* statements prepared on a connection, the slots point into the map
+             * whose values are not moved when it grows */
+            struct stmt_map_t : CaseMap<PGSQLStatement> {
+                std::vector<PGSQLStatement*> slots{};
+            };
             typedef std::shared_ptr<stmt_map_t>  stmt_map_ptr_t;
             using free_conn_t = std::function<void(PgSqlConnection*)>;
 
-            PgSqlConnection(PGconn *conn, String& dname, bool async, int64_t timeout, free_conn_t free_conn)
+            PgSqlConnection(PGconn *conn, String& dname, bool async, int64_t timeout,
+                            free_conn_t free_conn, stmt_map_ptr_t stmts = nullptr, bool prepare = true)
                 : conn(conn),
+                  stmt_cache(stmts? std::move(stmts) : std::make_shared<stmt_map_t>()),
                   async(async),
                   timeout(timeout),
                   free_conn(free_conn),
+                  prepare(prepare),
                   dbname(dname)
             {}
 
@@ -839,6 +1462,17 @@ namespace suil {
 
             PGSQLStatement operator()(const char *req);
 
+            /**
+             * gets the statement held in the given slot, the statement is looked up
+             * by its text the first time the slot is used on this connection. Used by
+             * callers that generate statements once (see \ref Orm) to reach the prepared
+             * statement without hashing the statement text on every execution
+             * @param slot the slot allocated for the statement (see \ref __internal::statement_slot)
+             * @param req the statement text, always the same for a given slot
+             * @return the statement
+             */
+            PGSQLStatement operator()(size_t slot, const String& req);
+
             inline bool has_table(const char *name) {
                 const char *schema = "public";
                 return has_table(schema, name);
@@ -914,10 +1548,69 @@ namespace suil {
                 destroy(false);
             }
 
+            /**
+             * checks whether the connection can be reused for another command
+             * @return false if the connection is broken, still executing a
+             * command or left in pipeline mode
+             */
+            inline bool idle() const {
+#ifdef LIBPQ_HAS_PIPELINING
+                if (PQpipelineStatus(conn) != PQ_PIPELINE_OFF)
+                    return false;
+#endif
+                return PQstatus(conn) == CONNECTION_OK &&
+                       PQtransactionStatus(conn) != PQTRANS_ACTIVE;
+            }
+
             static inline void params(OBuffer& req, int i) {
                 req << "$" << i;
             }
 
+            /**
+             * creates a batch which queues statement executions and sends
+             * them back-to-back on this connection
+             * @param chunk the maximum number of executions in flight
+             * @return a new batch
+             */
+            PgSqlBatch batch(size_t chunk = 256);
+
+            /**
+             * starts a COPY ... FROM STDIN on this connection
+             * @param stmt the COPY statement
+             * @param binary true if the statement uses the binary COPY format
+             * @return a writer used to stream rows into the table
+             */
+            PgSqlCopyIn copyIn(const char *stmt, bool binary = false);
+
+            /**
+             * starts a COPY into the given table, the columns copied are the fields
+             * of \tparam T excluding ignored and auto increment fields
+             * @param table the table to copy into
+             * @param binary true to use the binary COPY format, field types must then
+             * match the column types
+             * @return a writer used to stream rows into the table
+             */
+            template <typename T>
+            PgSqlCopyIn copyIn(const String& table, bool binary = false);
+
+            /**
+             * runs a COPY ... TO STDOUT statement, streaming each row as received
+             * @param stmt the COPY statement
+             * @param f invoked with each row's data, return false to skip the remaining rows
+             * @return the number of rows received
+             */
+            ssize_t copyOut(const char *stmt, std::function<bool(const char*, size_t)> f);
+
+            /**
+             * copies rows out of the given table into objects of type \tparam T, the
+             * columns copied are the fields of T excluding ignored and auto increment fields
+             * @param table the table to copy from
+             * @param f invoked with each decoded row, may return false to skip the remaining rows
+             * @return the number of rows received
+             */
+            template <typename T, typename F>
+            ssize_t copyOut(const String& table, F f);
+
             inline ~PgSqlConnection() {
                 if (conn) {
                     destroy(true);
@@ -929,18 +1622,279 @@ namespace suil {
             void destroy(bool dctor = false );
 
             friend struct PgSqlDb;
+            friend struct PgSqlBatch;
+            friend struct PgSqlCopyIn;
             PGconn      *conn{nullptr};
-            stmt_map_t  stmt_cache;
+            /* statements prepared on conn, kept alive with conn in the pool */
+            stmt_map_ptr_t stmt_cache{std::make_shared<stmt_map_t>()};
             bool        async{false};
             int64_t     timeout{-1};
             free_conn_t free_conn;
             active_conns_iterator_t handle;
             int         refs{1};
             bool        deleting{false};
+            bool        prepare{true};
             suil::String dbname{"public"};
         };
         typedef std::vector<PgSqlConnection*> active_conns_t;
 
+        /**
+         * A batch of parameterized statement executions. Executions are queued
+         * and sent to the server back-to-back, in pipeline mode when libpq supports
+         * it, and the results are collected in the order they were queued.
+         *
+         * \example
+         *  auto batch = conn.batch();
+         *  for (auto& u: users)
+         *      batch("INSERT INTO users(name, age) VALUES($1, $2)", u.name, u.age);
+         *  batch.exec();
+         */
+        struct PgSqlBatch : LOGGER(PGSQL_CONN) {
+            using handler_t = std::function<void(size_t, PGSQLStatement&)>;
+
+            PgSqlBatch(PgSqlConnection& conn, size_t chunk = 256)
+                : conn(conn),
+                  chunk(MAX(chunk, 1))
+            {}
+
+            PgSqlBatch(const PgSqlBatch&) = delete;
+            PgSqlBatch& operator=(const PgSqlBatch&) = delete;
+            PgSqlBatch(PgSqlBatch&&) = default;
+
+            /**
+             * queue an execution of the given statement
+             * @param req the statement to execute
+             * @param args the statement parameters, copied into the batch
+             * @return the batch
+             */
+            template <typename... Args>
+            PgSqlBatch& operator()(const char *req, Args&&... args) {
+                queue(conn(req), std::forward<Args>(args)...);
+                return Ego;
+            }
+
+            template <typename... Args>
+            PgSqlBatch& operator()(OBuffer& req, Args&&... args) {
+                queue(conn(req), std::forward<Args>(args)...);
+                return Ego;
+            }
+
+            /**
+             * sends all queued executions and waits for their results. A failed
+             * execution aborts the remaining executions of its chunk and no further
+             * chunks are sent
+             * @param handler if provided, invoked in order for each execution with the
+             * statement holding the results of that execution
+             * @return true if all executions succeeded, false otherwise
+             */
+            bool exec(handler_t handler = nullptr);
+
+            inline size_t size() const {
+                return entries.size();
+            }
+
+            inline bool empty() const {
+                return entries.empty();
+            }
+
+            inline void clear() {
+                entries.clear();
+            }
+
+        private:
+            struct entry_t {
+                PGSQLStatement   stmt;
+                std::vector<Oid> oids{};
+                std::vector<int> lens{};
+                std::vector<int> bins{};
+                std::vector<ssize_t> offsets{};
+                std::string      data{};
+            };
+
+            template <typename... Args>
+            void queue(PGSQLStatement stmt, Args&&... args) {
+                entry_t e{std::move(stmt)};
+                e.stmt.params([&](int nparams, const char **values, const Oid *oids, const int *lens, const int *bins) {
+                    e.oids.assign(oids, oids+nparams);
+                    e.lens.assign(lens, lens+nparams);
+                    e.bins.assign(bins, bins+nparams);
+                    for (int i = 0; i < nparams; i++) {
+                        if (values[i] == nullptr) {
+                            e.offsets.push_back(-1);
+                            continue;
+                        }
+                        /* text parameters are read up to the null terminator */
+                        e.offsets.push_back(e.data.size());
+                        e.data.append(values[i], (size_t) lens[i]);
+                        e.data.push_back('\0');
+                    }
+                }, std::forward<Args>(args)...);
+                entries.push_back(std::move(e));
+            }
+
+            void execute(entry_t& e);
+
+            bool send(entry_t& e);
+
+            bool pipeline(handler_t& handler);
+
+            PgSqlConnection&     conn;
+            size_t               chunk{256};
+            std::vector<entry_t> entries{};
+        };
+
+        /**
+         * Streams rows into a table with COPY ... FROM STDIN. Rows are encoded into
+         * a buffer which is handed to libpq once it reaches the flush threshold,
+         * waiting on the connection socket whenever libpq cannot queue more data
+         *
+         * \example
+         *  auto copy = conn.copyIn<User>("users");
+         *  for (auto& u: users)
+         *      copy << u;
+         *  copy.end();
+         */
+        struct PgSqlCopyIn : LOGGER(PGSQL_CONN) {
+            PgSqlCopyIn(PgSqlConnection& conn, const char *stmt, bool binary = false, size_t threshold = 64_Kb);
+
+            PgSqlCopyIn(const PgSqlCopyIn&) = delete;
+            PgSqlCopyIn& operator=(const PgSqlCopyIn&) = delete;
+
+            /**
+             * encode the given row, the fields written are the fields of \tparam T
+             * excluding ignored and auto increment fields
+             * @param row the row to write
+             * @return the writer
+             */
+            template <typename T>
+            PgSqlCopyIn& operator<<(const T& row) {
+                using Fields = __internal::copy_fields_t<T>;
+                if (binary) {
+                    buffer.append((unsigned short) htons((unsigned short) Fields::size()));
+                    iod::foreach(Fields()) |
+                    [&](auto& m) {
+                        __internal::copy_binary(buffer, m.symbol().member_access(row));
+                    };
+                }
+                else {
+                    bool first{true};
+                    iod::foreach(Fields()) |
+                    [&](auto& m) {
+                        if (!first) buffer.append('\t');
+                        first = false;
+                        __internal::copy_text(buffer, m.symbol().member_access(row));
+                    };
+                    buffer.append('\n');
+                }
+
+                nrows++;
+                if (buffer.size() >= threshold)
+                    flush();
+                return Ego;
+            }
+
+            template <typename T>
+            PgSqlCopyIn& operator<<(const std::vector<T>& rows) {
+                for (auto& row: rows)
+                    Ego << row;
+                return Ego;
+            }
+
+            /**
+             * writes data already encoded in the COPY format of the statement
+             * @param data the data to write
+             * @param len the size of the data
+             */
+            void write(const void *data, size_t len);
+
+            /**
+             * ends the COPY, sending any buffered rows
+             * @param error if not null, the COPY is aborted with this error message
+             * @return true if the COPY succeeded
+             */
+            bool end(const char *error = nullptr);
+
+            /**
+             * @return the number of rows written
+             */
+            inline size_t rows() const {
+                return nrows;
+            }
+
+            ~PgSqlCopyIn();
+
+        private:
+            void flush();
+
+            PgSqlConnection& conn;
+            OBuffer          buffer;
+            size_t           threshold{64_Kb};
+            size_t           nrows{0};
+            bool             binary{false};
+            bool             active{false};
+        };
+
+        template <typename T>
+        PgSqlCopyIn PgSqlConnection::copyIn(const String& table, bool binary) {
+            OBuffer qb(64);
+            qb << "COPY " << table << "(";
+            bool first{true};
+            iod::foreach(__internal::copy_fields_t<T>()) |
+            [&](auto& m) {
+                if (!first) qb << ", ";
+                first = false;
+                qb << m.symbol().name();
+            };
+            qb << ") FROM STDIN";
+            if (binary)
+                qb << " (FORMAT binary)";
+
+            return PgSqlCopyIn(Ego, (const char *) qb, binary);
+        }
+
+        template <typename T, typename F>
+        ssize_t PgSqlConnection::copyOut(const String& table, F f) {
+            using Fields = __internal::copy_fields_t<T>;
+            OBuffer qb(64);
+            qb << "COPY " << table << "(";
+            bool first{true};
+            iod::foreach(Fields()) |
+            [&](auto& m) {
+                if (!first) qb << ", ";
+                first = false;
+                qb << m.symbol().name();
+            };
+            qb << ") TO STDOUT";
+
+            OBuffer fb(32);
+            return copyOut((const char *) qb, [&](const char *data, size_t len) {
+                T row{};
+                const char *p = data, *end = data + len;
+                if (end > p && end[-1] == '\n') end--;
+
+                iod::foreach(Fields()) |
+                [&](auto& m) {
+                    auto *sep = (const char *) memchr(p, '\t', end - p);
+                    if (sep == nullptr) sep = end;
+                    if ((sep - p) != 2 || p[0] != '\\' || p[1] != 'N') {
+                        /* column is not null */
+                        fb.reset((size_t)(sep - p), true);
+                        __internal::copy_unescape(fb, p, (size_t)(sep - p));
+                        String tmp((char *) fb, fb.size(), false);
+                        __internal::copy_parse(tmp, m.symbol().member_access(row));
+                    }
+                    p = (sep < end)? sep+1 : end;
+                };
+
+                if constexpr (std::is_same<decltype(f(row)), bool>::value)
+                    return f(row);
+                else {
+                    f(row);
+                    return true;
+                }
+            });
+        }
+
         struct PgSqlTransaction : LOGGER(PGSQL_DB) {
             PgSqlTransaction(PgSqlConnection& conn)
                 : conn(conn)
@@ -1006,6 +1960,7 @@ namespace suil {
                 async      = opts.get(var(ASYNC), false);
                 timeout    = opts.get(var(TIMEOUT), -1);
                 keep_alive = opts.get(var(EXPIRES), -1);
+                prepare    = opts.get(var(PREPARED), true);
                 dbname     = String{opts.get(var(name), "public")}.dup();
 
                 if (keep_alive > 0 && keep_alive < 3000) {
@@ -1032,6 +1987,7 @@ namespace suil {
             struct conn_handle_t {
                 PGconn  *conn;
                 int64_t alive;
+                Connection::stmt_map_ptr_t stmts;
                 inline void cleanup() {
                     if (conn) {
                         PQfinish(conn);
@@ -1041,6 +1997,7 @@ namespace suil {
 
             std::deque<conn_handle_t> conns;
             bool          async{false};
+            bool          prepare{true};
             int64_t       keep_alive{-1};
             int64_t       timeout{-1};
             Channel<bool> notify{false};
@@ -0,0 +1,245 @@
+//
+// SQLite thread pool
+//
+
+#include <sys/eventfd.h>
+
+#include <suil/sql/sqlite.h>
+
+namespace suil::sql {
+
+    std::unique_ptr<SQLiteConnetion> SQLitePool::open(const char *db, int flags) {
+        /* connections are never shared between threads at the same time */
+        auto conn = std::make_unique<SQLiteConnetion>();
+        conn->connect(db, flags|SQLITE_OPEN_NOMUTEX);
+        return conn;
+    }
+
+    void SQLitePool::start(queue_t& q) {
+        struct args_t {
+            queue_t&         q;
+            SQLiteConnetion& conn;
+        };
+
+        for (auto& conn: q.conns) {
+            pthread_t th;
+            auto *args = new args_t{q, *conn};
+            int err = pthread_create(&th, nullptr, [](void *p) -> void* {
+                auto *args = (args_t *) p;
+                loop(args->q, args->conn);
+                delete args;
+                return nullptr;
+            }, args);
+
+            if (err) {
+                delete args;
+                ierror("SQLitePool: starting thread failed: %s", strerror(err));
+                throw Exception::create("SQLitePool: starting thread failed: ", strerror(err));
+            }
+            q.threads.push_back(th);
+        }
+    }
+
+    void SQLitePool::stop(queue_t& q) {
+        {
+            std::lock_guard<std::mutex> lk(q.lock);
+            q.stopping = true;
+        }
+        q.cond.notify_all();
+        for (auto th: q.threads)
+            pthread_join(th, nullptr);
+        q.threads.clear();
+        q.conns.clear();
+    }
+
+    void SQLitePool::loop(queue_t& q, SQLiteConnetion& conn) {
+        while (true) {
+            job_t *job{nullptr};
+            {
+                std::unique_lock<std::mutex> lk(q.lock);
+                q.cond.wait(lk, [&q] { return q.stopping || !q.jobs.empty(); });
+                if (q.jobs.empty())
+                    /* pool is being stopped */
+                    return;
+                job = q.jobs.front();
+                q.jobs.pop_front();
+            }
+
+            try {
+                job->work(conn);
+            }
+            catch (...) {
+                job->error = std::current_exception();
+            }
+
+            /* the job belongs to the waiting coroutine, it must not be
+             * touched once the coroutine is notified */
+            int efd = job->efd;
+            uint64_t done{1};
+            while (::write(efd, &done, sizeof(done)) < 0 && errno == EINTR);
+        }
+    }
+
+    int SQLitePool::acquire() {
+        if (!efds.empty()) {
+            int efd = efds.back();
+            efds.pop_back();
+            return efd;
+        }
+
+        int efd = eventfd(0, EFD_NONBLOCK|EFD_CLOEXEC);
+        if (efd < 0) {
+            ierror("SQLitePool: creating eventfd failed: %s", errno_s);
+            throw Exception::create("SQLitePool: creating eventfd failed: ", errno_s);
+        }
+        return efd;
+    }
+
+    void SQLitePool::run(queue_t& q, work_t work) {
+        if (q.conns.empty()) {
+            throw Exception::create("SQLitePool: pool not initialized");
+        }
+
+        if (q.threads.empty())
+            start(q);
+
+        job_t job{std::move(work), acquire()};
+        {
+            std::lock_guard<std::mutex> lk(q.lock);
+            q.jobs.push_back(&job);
+        }
+        q.cond.notify_one();
+
+        /* the job references the caller's stack, wait until it is done */
+        uint64_t done{0};
+        while (::read(job.efd, &done, sizeof(done)) != sizeof(done)) {
+            fdwait(job.efd, FDW_IN, -1);
+        }
+        efds.push_back(job.efd);
+
+        if (job.error)
+            std::rethrow_exception(job.error);
+    }
+
+    SQLitePool::~SQLitePool() {
+        stop(readers);
+        stop(writer);
+        for (auto efd: efds) {
+            fdclean(efd);
+            ::close(efd);
+        }
+        efds.clear();
+    }
+}
+
+#ifdef unit_test
+#include <catch/catch.hpp>
+#include "tests/test_symbols.h"
+
+using namespace suil;
+
+static void removeDb(const char *path) {
+    ::unlink(path);
+    ::unlink(utils::catstr(path, "-wal")());
+    ::unlink(utils::catstr(path, "-shm")());
+}
+
+typedef decltype(iod::D(
+    s::_id(var(PRIMARY_KEY)) = int(),
+    prop(name, String),
+    prop(age,  int)
+)) OrmPerson;
+
+TEST_CASE("suil::sql::Orm over SQLite", "[sql][sqlite][orm]")
+{
+    const char *path = "/tmp/suil-sqlite-orm.db";
+    removeDb(path);
+    {
+        sql::SQLiteConnetion conn;
+        conn.connect(path);
+        conn.exec("CREATE TABLE people(id INTEGER PRIMARY KEY, name TEXT, age INTEGER)");
+
+        for (int i = 1; i <= 3; i++) {
+            String name = utils::catstr("person", i);
+            conn.exec(utils::catstr("INSERT INTO people(id, name, age) VALUES (", i, ", '", name, "', ", 20+i, ")")());
+        }
+        sql::Orm<sql::SQLiteConnetion, OrmPerson> orm("people", conn);
+
+        SECTION("generated statements are bound to the cached statements") {
+            OrmPerson p;
+            REQUIRE(orm.find(2, p));
+            CHECK(p.name == "person2");
+            CHECK(p.age == 22);
+            REQUIRE(orm.find(3, p));
+            CHECK(p.name == "person3");
+            CHECK(orm.has("name", "person1"));
+            CHECK_FALSE(orm.has("name", "person4"));
+            /* one statement for finding and one for checking */
+            CHECK(conn.cached() == 2);
+        }
+
+        SECTION("slots of evicted statements are refilled") {
+            conn.cacheSize(1);
+            OrmPerson p;
+            REQUIRE(orm.find(1, p));
+            CHECK(orm.has("name", "person1"));
+            CHECK(conn.cached() == 1);
+            /* the find statement was evicted */
+            REQUIRE(orm.find(2, p));
+            CHECK(p.name == "person2");
+            CHECK(conn.cached() == 1);
+            CHECK(orm.has("name", "person2"));
+        }
+    }
+    removeDb(path);
+}
+
+TEST_CASE("suil::sql::SQLitePool", "[sql][sqlite]")
+{
+    const char *path = "/tmp/suil-sqlite-pool.db";
+    removeDb(path);
+    {
+        sql::SQLitePool pool;
+        pool.init(path, opt(READERS, 2), opt(SYNCHRONOUS, 1));
+
+        pool.write([](sql::SQLiteConnetion& conn) {
+            conn.exec("CREATE TABLE items(id INTEGER, name TEXT)");
+        });
+
+        SECTION("writes are visible to readers") {
+            pool.write([](sql::SQLiteConnetion& conn) {
+                conn.exec("BEGIN");
+                for (int i = 0; i < 100; i++) {
+                    String name = utils::catstr("item", i);
+                    conn("INSERT INTO items(id, name) VALUES (?, ?)")(i, name);
+                }
+                conn.exec("COMMIT");
+            });
+
+            auto count = pool.read([](sql::SQLiteConnetion& conn) {
+                int n{0};
+                conn("SELECT COUNT(*) FROM items")() >> n;
+                return n;
+            });
+            CHECK(count == 100);
+
+            auto name = pool.read([](sql::SQLiteConnetion& conn) {
+                String name;
+                conn("SELECT name FROM items WHERE id = ?")(42) >> name;
+                return name;
+            });
+            CHECK(name == "item42");
+        }
+
+        SECTION("errors are reported to the caller") {
+            CHECK_THROWS(pool.read([](sql::SQLiteConnetion& conn) {
+                conn.exec("INSERT INTO items(id, name) VALUES (1, 'x')");
+            }));
+            CHECK_THROWS(pool.write([](sql::SQLiteConnetion& conn) {
+                conn("SELECT * FROM unknown")();
+            }));
+        }
+    }
+    removeDb(path);
+}
+#endif
@@ -5,7 +5,13 @@
 #ifndef SUIL_SQLITE_HPP
 #define SUIL_SQLITE_HPP
 
+#include <condition_variable>
+#include <deque>
+#include <list>
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <pthread.h>
 #include <sqlite3.h>
 
 #include <iod/sio.hh>
@@ -197,15 +203,20 @@ namespace suil {
                 sqlite3_close_v2((sqlite3*) p);
             }
 
-            typedef std::shared_ptr<sqlite3>     m_dbptrt;
-            typedef Map <SQLiteStmt>     stmt_map_t;
-            typedef std::shared_ptr<stmt_map_t>  stmt_map_ptr_t;
+            typedef std::shared_ptr<sqlite3>          m_dbptrt;
+            typedef std::pair<String, SQLiteStmt>     stmt_entry_t;
+            typedef std::list<stmt_entry_t>           stmt_lru_t;
+            typedef Map<stmt_lru_t::iterator>         stmt_map_t;
 
-            SQLiteConnetion()
+            SQLiteConnetion(size_t cacheSize = 64)
                 :m_db(nullptr),
-                 m_stmtCache(new stmt_map_t())
+                 m_stmtCapacity(cacheSize)
             {}
 
+            /* the statement cache is keyed by views into the LRU list entries */
+            SQLiteConnetion(const SQLiteConnetion&) = delete;
+            SQLiteConnetion& operator=(const SQLiteConnetion&) = delete;
+
             void connect(const char *filename, int flags = SQLITE_OPEN_READWRITE|SQLITE_OPEN_CREATE) {
                 int r = sqlite3_open_v2(filename, &m_db, flags, nullptr);
                 if (r != SQLITE_OK) {
@@ -232,13 +243,18 @@ namespace suil {
                 String tmp(req, false);
                 trace("%s", (char *)req);
 
-                auto it = m_stmtCache->find(tmp);
-                if (it != m_stmtCache->end()) {
-                    return it->second;
+                auto it = m_stmtCache.find(tmp);
+                if (it != m_stmtCache.end()) {
+                    return cached(it->second);
                 }
 
                 sqlite3_stmt *stmt;
+#if SQLITE_VERSION_NUMBER >= 3020000
+                /* statement is kept in the cache, hint sqlite to allocate it accordingly */
+                int err = sqlite3_prepare_v3(m_db, req.data(), req.size(), SQLITE_PREPARE_PERSISTENT, &stmt, nullptr);
+#else
                 int err = sqlite3_prepare_v2(m_db, req.data(), req.size(), &stmt, nullptr);
+#endif
                 if (err != SQLITE_OK) {
                     throw std::runtime_error(
                             std::string("sqlite3_prepare_v2 : ") +
@@ -246,12 +262,48 @@ namespace suil {
                     );
                 }
 
-                // take buffer
-                String key(req);
-                auto ret = m_stmtCache->insert(it,
-                                               std::make_pair(std::move(key), SQLiteStmt(m_db, stmt)));
+                if (m_stmtCapacity == 0) {
+                    /* statement caching disabled */
+                    return SQLiteStmt(m_db, stmt);
+                }
+
+                if (m_stmtLru.size() >= m_stmtCapacity) {
+                    /* evict the least recently used statement, the handle is finalized
+                     * once every copy of the statement is released */
+                    evict();
+                }
+
+                // take buffer, the cache is keyed by a view of the entry's key
+                m_stmtLru.emplace_front(String(req), SQLiteStmt(m_db, stmt));
+                m_stmtCache.emplace(m_stmtLru.front().first.peek(), m_stmtLru.begin());
+
+                return m_stmtLru.front().second;
+            }
+
+            /**
+             * gets the statement held in the given slot, the statement is looked up
+             * by its text when the slot is empty. Used by callers that generate
+             * statements once (see \ref Orm) to reach the cached statement without
+             * hashing the statement text on every execution
+             * @param slot the slot allocated for the statement (see \ref __internal::statement_slot)
+             * @param req the statement text, always the same for a given slot
+             * @return the statement
+             */
+            SQLiteStmt operator()(size_t slot, const String& req) {
+                if (slot < m_stmtSlots.size() && m_stmtSlots[slot] != m_stmtLru.end()) {
+                    return cached(m_stmtSlots[slot]);
+                }
 
-                return ret->second;
+                OBuffer b(req.size()+1);
+                b << req;
+                auto stmt = (*this)(b);
+                if (m_stmtCapacity != 0) {
+                    /* the statement is now the most recently used */
+                    if (slot >= m_stmtSlots.size())
+                        m_stmtSlots.resize(slot+1, m_stmtLru.end());
+                    m_stmtSlots[slot] = m_stmtLru.begin();
+                }
+                return stmt;
             }
 
             SQLiteStmt operator()(const char *req) {
@@ -260,9 +312,9 @@ namespace suil {
                 String tmp(req);
                 trace("%s", req);
 
-                auto it = m_stmtCache->find(tmp);
-                if (it != m_stmtCache->end()) {
-                    return it->second;
+                auto it = m_stmtCache.find(tmp);
+                if (it != m_stmtCache.end()) {
+                    return cached(it->second);
                 }
 
                 // forced to create string
@@ -271,6 +323,69 @@ namespace suil {
                 return (*this)(b);
             }
 
+            /**
+             * executes the given statements without caching them, used for
+             * statements that are executed once (e.g PRAGMA's)
+             * @param sql the statements to execute
+             */
+            void exec(const char *sql) {
+                trace("%s", sql);
+                char *msg{nullptr};
+                int err = sqlite3_exec(m_db, sql, nullptr, nullptr, &msg);
+                if (err != SQLITE_OK) {
+                    std::string what = std::string("sqlite3_exec: ") +
+                                       (msg? msg : sqlite3_errstr(err)) + ", statement: " + sql;
+                    sqlite3_free(msg);
+                    throw std::runtime_error(what);
+                }
+            }
+
+            /**
+             * changes the maximum number of prepared statements cached by the
+             * connection, least recently used statements are evicted first
+             * @param size the new capacity, 0 disables statement caching
+             */
+            void cacheSize(size_t size) {
+                m_stmtCapacity = size;
+                while (m_stmtLru.size() > m_stmtCapacity)
+                    evict();
+            }
+
+            inline size_t cached() const {
+                return m_stmtLru.size();
+            }
+
+            /**
+             * applies the connection options (WAL, SYNCHRONOUS, MMAP_SIZE, CACHE_SIZE
+             * and STMT_CACHE) to the connection
+             * @param opts the options to apply
+             * @param readOnly true if the connection is read-only, in which case
+             * journal and synchronous options are skipped
+             */
+            template <typename O>
+            void configure(O& opts, bool readOnly = false) {
+                cacheSize(opts.get(sym(STMT_CACHE), 64));
+                if (!readOnly && opts.get(sym(WAL), false)) {
+                    exec("PRAGMA journal_mode = WAL");
+                }
+                if (!readOnly && opts.has(sym(SYNCHRONOUS))) {
+                    OBuffer qb(32);
+                    qb << "PRAGMA synchronous = " << opts.get(sym(SYNCHRONOUS), 2);
+                    exec(qb);
+                }
+                if (opts.has(sym(MMAP_SIZE))) {
+                    OBuffer qb(32);
+                    qb << "PRAGMA mmap_size = " << (int64_t) opts.get(sym(MMAP_SIZE), 0);
+                    exec(qb);
+                }
+                if (opts.has(sym(CACHE_SIZE))) {
+                    /* negative values are in KiB, positive values are in pages */
+                    OBuffer qb(32);
+                    qb << "PRAGMA cache_size = " << (int64_t) opts.get(sym(CACHE_SIZE), -2000);
+                    exec(qb);
+                }
+            }
+
             bool has_table(String& name) {
                 int has = 0;
                 auto stmt = (*this)("SELECT COUNT(*) FROM sqlite_master WHERE type'table' AND name='?'");
@@ -303,7 +418,27 @@ namespace suil {
             }
 
         private:
+            inline SQLiteStmt& cached(stmt_lru_t::iterator it) {
+                /* move to the front of the LRU list */
+                if (it != m_stmtLru.begin())
+                    m_stmtLru.splice(m_stmtLru.begin(), m_stmtLru, it);
+                return it->second;
+            }
+
+            /* drops the least recently used statement and the slots pointing to it */
+            void evict() {
+                auto lru = std::prev(m_stmtLru.end());
+                for (auto& it: m_stmtSlots) {
+                    if (it == lru) it = m_stmtLru.end();
+                }
+                m_stmtCache.erase(lru->first);
+                m_stmtLru.erase(lru);
+            }
+
             inline void close() {
+                m_stmtSlots.clear();
+                m_stmtCache.clear();
+                m_stmtLru.clear();
                 if (m_db) {
                     sqlite3_close_v2(m_db);
                     m_db = nullptr;
@@ -312,7 +447,10 @@ namespace suil {
 
             sqlite3*          m_db;
             m_dbptrt          m_dbptr;
-            stmt_map_ptr_t    m_stmtCache;
+            stmt_lru_t        m_stmtLru;
+            stmt_map_t        m_stmtCache;
+            std::vector<stmt_lru_t::iterator> m_stmtSlots;
+            size_t            m_stmtCapacity{64};
         };
 
         struct SQLiteDb : LOGGER(SQLITE_DB) {
@@ -342,11 +480,7 @@ namespace suil {
                 if (path != nullptr) {
                     /* database not already initialized */
                     conn.connect(path, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE);
-                    if (opts.has(sym(SYNCHRONOUS))) {
-                        OBuffer qb(32);
-                        qb << "PRAGMA synchronous = " << opts.get(sym(SYNCHRONOUS), 2);
-                        conn(qb);
-                    }
+                    conn.configure(opts);
                     trace("SQLite: `%s` Connection initialized", path);
                 }
                 else {
@@ -365,6 +499,134 @@ namespace suil {
             char       *path{nullptr};
         };
 
+        /**
+         * Runs SQLite work on a small pool of threads so that slow queries and
+         * commits do not stall the coroutines of the worker. Reads are spread across
+         * a set of read-only connections while writes are serialized on a single
+         * writer connection. The calling coroutine waits on an eventfd for the work
+         * to complete, letting other coroutines run meanwhile.
+         *
+         * The pool threads are started on first use, after the worker was forked.
+         * Work submitted to the pool must not use libmill. It can log, as long as
+         * custom log sinks and formatters are thread safe (see log::setup).
+         *
+         * \example
+         *  sql::SQLitePool pool;
+         *  pool.init("app.db", opt(READERS, 4));
+         *  auto users = pool.read([&](sql::SQLiteConnetion& conn) {
+         *      std::vector<User> users;
+         *      conn("SELECT * FROM users")() | [&](User& u) {
+         *          users.push_back(u);
+         *      };
+         *      return users;
+         *  });
+         */
+        struct SQLitePool : LOGGER(SQLITE_DB) {
+            typedef std::function<void(SQLiteConnetion&)> work_t;
+
+            SQLitePool()
+            {}
+
+            SQLitePool(const SQLitePool&) = delete;
+            SQLitePool& operator=(const SQLitePool&) = delete;
+
+            template <typename...O>
+            inline void init(const char *db, O... opts) {
+                auto options = iod::D(opts...);
+                configure(options, db);
+            }
+
+            /**
+             * opens the connections of the pool, the database is always switched
+             * to WAL journaling so that readers do not block on the writer
+             * @param opts connection options (see \ref SQLiteConnetion::configure) and
+             * READERS, the number of read-only connections (default 2)
+             * @param db the path to the database
+             */
+            template <typename O>
+            void configure(O& opts, const char *db) {
+                if (!writer.conns.empty()) {
+                    iwarn("SQLitePool: %s already initialized", db);
+                    return;
+                }
+
+                auto conn = open(db, SQLITE_OPEN_READWRITE|SQLITE_OPEN_CREATE);
+                conn->exec("PRAGMA journal_mode = WAL");
+                conn->configure(opts);
+                writer.conns.push_back(std::move(conn));
+
+                int nreaders = MAX(1, (int) opts.get(sym(READERS), 2));
+                for (int i = 0; i < nreaders; i++) {
+                    auto reader = open(db, SQLITE_OPEN_READONLY);
+                    reader->configure(opts, true);
+                    readers.conns.push_back(std::move(reader));
+                }
+                trace("SQLitePool: `%s` initialized with %d readers", db, nreaders);
+            }
+
+            /**
+             * runs \param f on one of the read-only connections
+             * @param f the work to run, f(SQLiteConnetion&)
+             * @return the value returned by \param f
+             */
+            template <typename F>
+            auto read(F f) {
+                return submit(readers, f);
+            }
+
+            /**
+             * runs \param f on the writer connection, writes are run one at a time
+             * @param f the work to run, f(SQLiteConnetion&)
+             * @return the value returned by \param f
+             */
+            template <typename F>
+            auto write(F f) {
+                return submit(writer, f);
+            }
+
+            ~SQLitePool();
+
+        private suil_ut:
+            struct job_t {
+                work_t             work;
+                int                efd{-1};
+                std::exception_ptr error{nullptr};
+            };
+
+            struct queue_t {
+                std::mutex               lock;
+                std::condition_variable  cond;
+                std::deque<job_t*>       jobs;
+                bool                     stopping{false};
+                std::vector<std::unique_ptr<SQLiteConnetion>> conns;
+                std::vector<pthread_t>   threads;
+            };
+
+            template <typename F>
+            auto submit(queue_t& q, F& f) {
+                using R = decltype(f(std::declval<SQLiteConnetion&>()));
+                if constexpr (std::is_void<R>::value) {
+                    run(q, [&](SQLiteConnetion& conn) { f(conn); });
+                }
+                else {
+                    std::optional<R> result;
+                    run(q, [&](SQLiteConnetion& conn) { result.emplace(f(conn)); });
+                    return std::move(*result);
+                }
+            }
+
+            static std::unique_ptr<SQLiteConnetion> open(const char *db, int flags);
+            static void loop(queue_t& q, SQLiteConnetion& conn);
+            void run(queue_t& q, work_t work);
+            void start(queue_t& q);
+            void stop(queue_t& q);
+            int  acquire();
+
+            queue_t          readers;
+            queue_t          writer;
+            std::vector<int> efds;
+        };
+
         namespace  mw {
             using SQLite = sql::Middleware<SQLiteDb>;
         }
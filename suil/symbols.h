@@ -0,0 +1,762 @@
+// Generated by iod_generate_symbols.
+#include <iod/symbol.hh>
+#ifndef IOD_SYMBOL_ASYNC
+#define IOD_SYMBOL_ASYNC
+    iod_define_symbol(ASYNC)
+#endif
+
+#ifndef IOD_SYMBOL_AUTHORIZE
+#define IOD_SYMBOL_AUTHORIZE
+    iod_define_symbol(AUTHORIZE)
+#endif
+
+#ifndef IOD_SYMBOL_AUTO_INCREMENT
+#define IOD_SYMBOL_AUTO_INCREMENT
+    iod_define_symbol(AUTO_INCREMENT)
+#endif
+
+#ifndef IOD_SYMBOL_CACHE_SIZE
+#define IOD_SYMBOL_CACHE_SIZE
+    iod_define_symbol(CACHE_SIZE)
+#endif
+
+#ifndef IOD_SYMBOL_D
+#define IOD_SYMBOL_D
+    iod_define_symbol(D)
+#endif
+
+#ifndef IOD_SYMBOL_E
+#define IOD_SYMBOL_E
+    iod_define_symbol(E)
+#endif
+
+#ifndef IOD_SYMBOL_EXPIRES
+#define IOD_SYMBOL_EXPIRES
+    iod_define_symbol(EXPIRES)
+#endif
+
+#ifndef IOD_SYMBOL_MMAP_SIZE
+#define IOD_SYMBOL_MMAP_SIZE
+    iod_define_symbol(MMAP_SIZE)
+#endif
+
+#ifndef IOD_SYMBOL_PARSE_COOKIES
+#define IOD_SYMBOL_PARSE_COOKIES
+    iod_define_symbol(PARSE_COOKIES)
+#endif
+
+#ifndef IOD_SYMBOL_PARSE_FORM
+#define IOD_SYMBOL_PARSE_FORM
+    iod_define_symbol(PARSE_FORM)
+#endif
+
+#ifndef IOD_SYMBOL_PREPARED
+#define IOD_SYMBOL_PREPARED
+    iod_define_symbol(PREPARED)
+#endif
+
+#ifndef IOD_SYMBOL_PRIMARY_KEY
+#define IOD_SYMBOL_PRIMARY_KEY
+    iod_define_symbol(PRIMARY_KEY)
+#endif
+
+#ifndef IOD_SYMBOL_PROPERTIES
+#define IOD_SYMBOL_PROPERTIES
+    iod_define_symbol(PROPERTIES)
+#endif
+
+#ifndef IOD_SYMBOL_READERS
+#define IOD_SYMBOL_READERS
+    iod_define_symbol(READERS)
+#endif
+
+#ifndef IOD_SYMBOL_READ_ONLY
+#define IOD_SYMBOL_READ_ONLY
+    iod_define_symbol(READ_ONLY)
+#endif
+
+#ifndef IOD_SYMBOL_REPLY_TYPE
+#define IOD_SYMBOL_REPLY_TYPE
+    iod_define_symbol(REPLY_TYPE)
+#endif
+
+#ifndef IOD_SYMBOL_STATIC
+#define IOD_SYMBOL_STATIC
+    iod_define_symbol(STATIC)
+#endif
+
+#ifndef IOD_SYMBOL_STMT_CACHE
+#define IOD_SYMBOL_STMT_CACHE
+    iod_define_symbol(STMT_CACHE)
+#endif
+
+#ifndef IOD_SYMBOL_SYNCHRONOUS
+#define IOD_SYMBOL_SYNCHRONOUS
+    iod_define_symbol(SYNCHRONOUS)
+#endif
+
+#ifndef IOD_SYMBOL_TIMEOUT
+#define IOD_SYMBOL_TIMEOUT
+    iod_define_symbol(TIMEOUT)
+#endif
+
+#ifndef IOD_SYMBOL_UNIQUE
+#define IOD_SYMBOL_UNIQUE
+    iod_define_symbol(UNIQUE)
+#endif
+
+#ifndef IOD_SYMBOL_V
+#define IOD_SYMBOL_V
+    iod_define_symbol(V)
+#endif
+
+#ifndef IOD_SYMBOL_W
+#define IOD_SYMBOL_W
+    iod_define_symbol(W)
+#endif
+
+#ifndef IOD_SYMBOL_WAL
+#define IOD_SYMBOL_WAL
+    iod_define_symbol(WAL)
+#endif
+
+#ifndef IOD_SYMBOL_accept_backlog
+#define IOD_SYMBOL_accept_backlog
+    iod_define_symbol(accept_backlog)
+#endif
+
+#ifndef IOD_SYMBOL_accept_timeout
+#define IOD_SYMBOL_accept_timeout
+    iod_define_symbol(accept_timeout)
+#endif
+
+#ifndef IOD_SYMBOL_age
+#define IOD_SYMBOL_age
+    iod_define_symbol(age)
+#endif
+
+#ifndef IOD_SYMBOL_alg
+#define IOD_SYMBOL_alg
+    iod_define_symbol(alg)
+#endif
+
+#ifndef IOD_SYMBOL_alloc_miss
+#define IOD_SYMBOL_alloc_miss
+    iod_define_symbol(alloc_miss)
+#endif
+
+#ifndef IOD_SYMBOL_allocs
+#define IOD_SYMBOL_allocs
+    iod_define_symbol(allocs)
+#endif
+
+#ifndef IOD_SYMBOL_allow_caching
+#define IOD_SYMBOL_allow_caching
+    iod_define_symbol(allow_caching)
+#endif
+
+#ifndef IOD_SYMBOL_allow_compress
+#define IOD_SYMBOL_allow_compress
+    iod_define_symbol(allow_compress)
+#endif
+
+#ifndef IOD_SYMBOL_allow_headers
+#define IOD_SYMBOL_allow_headers
+    iod_define_symbol(allow_headers)
+#endif
+
+#ifndef IOD_SYMBOL_allow_origin
+#define IOD_SYMBOL_allow_origin
+    iod_define_symbol(allow_origin)
+#endif
+
+#ifndef IOD_SYMBOL_app_id
+#define IOD_SYMBOL_app_id
+    iod_define_symbol(app_id)
+#endif
+
+#ifndef IOD_SYMBOL_appsdb
+#define IOD_SYMBOL_appsdb
+    iod_define_symbol(appsdb)
+#endif
+
+#ifndef IOD_SYMBOL_aud
+#define IOD_SYMBOL_aud
+    iod_define_symbol(aud)
+#endif
+
+#ifndef IOD_SYMBOL_authdb
+#define IOD_SYMBOL_authdb
+    iod_define_symbol(authdb)
+#endif
+
+#ifndef IOD_SYMBOL_authenticate
+#define IOD_SYMBOL_authenticate
+    iod_define_symbol(authenticate)
+#endif
+
+#ifndef IOD_SYMBOL_b
+#define IOD_SYMBOL_b
+    iod_define_symbol(b)
+#endif
+
+#ifndef IOD_SYMBOL_background
+#define IOD_SYMBOL_background
+    iod_define_symbol(background)
+#endif
+
+#ifndef IOD_SYMBOL_base
+#define IOD_SYMBOL_base
+    iod_define_symbol(base)
+#endif
+
+#ifndef IOD_SYMBOL_check
+#define IOD_SYMBOL_check
+    iod_define_symbol(check)
+#endif
+
+#ifndef IOD_SYMBOL_chroot
+#define IOD_SYMBOL_chroot
+    iod_define_symbol(chroot)
+#endif
+
+#ifndef IOD_SYMBOL_claims
+#define IOD_SYMBOL_claims
+    iod_define_symbol(claims)
+#endif
+
+#ifndef IOD_SYMBOL_cmdargs
+#define IOD_SYMBOL_cmdargs
+    iod_define_symbol(cmdargs)
+#endif
+
+#ifndef IOD_SYMBOL_code
+#define IOD_SYMBOL_code
+    iod_define_symbol(code)
+#endif
+
+#ifndef IOD_SYMBOL_commit
+#define IOD_SYMBOL_commit
+    iod_define_symbol(commit)
+#endif
+
+#ifndef IOD_SYMBOL_cookies
+#define IOD_SYMBOL_cookies
+    iod_define_symbol(cookies)
+#endif
+
+#ifndef IOD_SYMBOL_data
+#define IOD_SYMBOL_data
+    iod_define_symbol(data)
+#endif
+
+#ifndef IOD_SYMBOL_db
+#define IOD_SYMBOL_db
+    iod_define_symbol(db)
+#endif
+
+#ifndef IOD_SYMBOL_deliver
+#define IOD_SYMBOL_deliver
+    iod_define_symbol(deliver)
+#endif
+
+#ifndef IOD_SYMBOL_description
+#define IOD_SYMBOL_description
+    iod_define_symbol(description)
+#endif
+
+#ifndef IOD_SYMBOL_domain
+#define IOD_SYMBOL_domain
+    iod_define_symbol(domain)
+#endif
+
+#ifndef IOD_SYMBOL_email
+#define IOD_SYMBOL_email
+    iod_define_symbol(email)
+#endif
+
+#ifndef IOD_SYMBOL_enable_send_file
+#define IOD_SYMBOL_enable_send_file
+    iod_define_symbol(enable_send_file)
+#endif
+
+#ifndef IOD_SYMBOL_entries
+#define IOD_SYMBOL_entries
+    iod_define_symbol(entries)
+#endif
+
+#ifndef IOD_SYMBOL_entry
+#define IOD_SYMBOL_entry
+    iod_define_symbol(entry)
+#endif
+
+#ifndef IOD_SYMBOL_error
+#define IOD_SYMBOL_error
+    iod_define_symbol(error)
+#endif
+
+#ifndef IOD_SYMBOL_exp
+#define IOD_SYMBOL_exp
+    iod_define_symbol(exp)
+#endif
+
+#ifndef IOD_SYMBOL_expires
+#define IOD_SYMBOL_expires
+    iod_define_symbol(expires)
+#endif
+
+#ifndef IOD_SYMBOL_extensions
+#define IOD_SYMBOL_extensions
+    iod_define_symbol(extensions)
+#endif
+
+#ifndef IOD_SYMBOL_format
+#define IOD_SYMBOL_format
+    iod_define_symbol(format)
+#endif
+
+#ifndef IOD_SYMBOL_frees
+#define IOD_SYMBOL_frees
+    iod_define_symbol(frees)
+#endif
+
+#ifndef IOD_SYMBOL_fullname
+#define IOD_SYMBOL_fullname
+    iod_define_symbol(fullname)
+#endif
+
+#ifndef IOD_SYMBOL_host
+#define IOD_SYMBOL_host
+    iod_define_symbol(host)
+#endif
+
+#ifndef IOD_SYMBOL_http_endpoint
+#define IOD_SYMBOL_http_endpoint
+    iod_define_symbol(http_endpoint)
+#endif
+
+#ifndef IOD_SYMBOL_iat
+#define IOD_SYMBOL_iat
+    iod_define_symbol(iat)
+#endif
+
+#ifndef IOD_SYMBOL_id
+#define IOD_SYMBOL_id
+    iod_define_symbol(id)
+#endif
+
+#ifndef IOD_SYMBOL_iss
+#define IOD_SYMBOL_iss
+    iod_define_symbol(iss)
+#endif
+
+#ifndef IOD_SYMBOL_jsonrpc
+#define IOD_SYMBOL_jsonrpc
+    iod_define_symbol(jsonrpc)
+#endif
+
+#ifndef IOD_SYMBOL_jti
+#define IOD_SYMBOL_jti
+    iod_define_symbol(jti)
+#endif
+
+#ifndef IOD_SYMBOL_jwt_cache
+#define IOD_SYMBOL_jwt_cache
+    iod_define_symbol(jwt_cache)
+#endif
+
+#ifndef IOD_SYMBOL_jwt_token_use
+#define IOD_SYMBOL_jwt_token_use
+    iod_define_symbol(jwt_token_use)
+#endif
+
+#ifndef IOD_SYMBOL_keep_alive
+#define IOD_SYMBOL_keep_alive
+    iod_define_symbol(keep_alive)
+#endif
+
+#ifndef IOD_SYMBOL_key
+#define IOD_SYMBOL_key
+    iod_define_symbol(key)
+#endif
+
+#ifndef IOD_SYMBOL_locked
+#define IOD_SYMBOL_locked
+    iod_define_symbol(locked)
+#endif
+
+#ifndef IOD_SYMBOL_lower
+#define IOD_SYMBOL_lower
+    iod_define_symbol(lower)
+#endif
+
+#ifndef IOD_SYMBOL_maxChars
+#define IOD_SYMBOL_maxChars
+    iod_define_symbol(maxChars)
+#endif
+
+#ifndef IOD_SYMBOL_message
+#define IOD_SYMBOL_message
+    iod_define_symbol(message)
+#endif
+
+#ifndef IOD_SYMBOL_method
+#define IOD_SYMBOL_method
+    iod_define_symbol(method)
+#endif
+
+#ifndef IOD_SYMBOL_methods
+#define IOD_SYMBOL_methods
+    iod_define_symbol(methods)
+#endif
+
+#ifndef IOD_SYMBOL_minChars
+#define IOD_SYMBOL_minChars
+    iod_define_symbol(minChars)
+#endif
+
+#ifndef IOD_SYMBOL_module
+#define IOD_SYMBOL_module
+    iod_define_symbol(module)
+#endif
+
+#ifndef IOD_SYMBOL_n
+#define IOD_SYMBOL_n
+    iod_define_symbol(n)
+#endif
+
+#ifndef IOD_SYMBOL_name
+#define IOD_SYMBOL_name
+    iod_define_symbol(name)
+#endif
+
+#ifndef IOD_SYMBOL_nbf
+#define IOD_SYMBOL_nbf
+    iod_define_symbol(nbf)
+#endif
+
+#ifndef IOD_SYMBOL_numbers
+#define IOD_SYMBOL_numbers
+    iod_define_symbol(numbers)
+#endif
+
+#ifndef IOD_SYMBOL_nworkers
+#define IOD_SYMBOL_nworkers
+    iod_define_symbol(nworkers)
+#endif
+
+#ifndef IOD_SYMBOL_onClose
+#define IOD_SYMBOL_onClose
+    iod_define_symbol(onClose)
+#endif
+
+#ifndef IOD_SYMBOL_onConnect
+#define IOD_SYMBOL_onConnect
+    iod_define_symbol(onConnect)
+#endif
+
+#ifndef IOD_SYMBOL_onDisconnect
+#define IOD_SYMBOL_onDisconnect
+    iod_define_symbol(onDisconnect)
+#endif
+
+#ifndef IOD_SYMBOL_onMessage
+#define IOD_SYMBOL_onMessage
+    iod_define_symbol(onMessage)
+#endif
+
+#ifndef IOD_SYMBOL_onStdError
+#define IOD_SYMBOL_onStdError
+    iod_define_symbol(onStdError)
+#endif
+
+#ifndef IOD_SYMBOL_onStdOutput
+#define IOD_SYMBOL_onStdOutput
+    iod_define_symbol(onStdOutput)
+#endif
+
+#ifndef IOD_SYMBOL_open_requests
+#define IOD_SYMBOL_open_requests
+    iod_define_symbol(open_requests)
+#endif
+
+#ifndef IOD_SYMBOL_option
+#define IOD_SYMBOL_option
+    iod_define_symbol(option)
+#endif
+
+#ifndef IOD_SYMBOL_owner
+#define IOD_SYMBOL_owner
+    iod_define_symbol(owner)
+#endif
+
+#ifndef IOD_SYMBOL_params
+#define IOD_SYMBOL_params
+    iod_define_symbol(params)
+#endif
+
+#ifndef IOD_SYMBOL_passwd
+#define IOD_SYMBOL_passwd
+    iod_define_symbol(passwd)
+#endif
+
+#ifndef IOD_SYMBOL_path
+#define IOD_SYMBOL_path
+    iod_define_symbol(path)
+#endif
+
+#ifndef IOD_SYMBOL_pid
+#define IOD_SYMBOL_pid
+    iod_define_symbol(pid)
+#endif
+
+#ifndef IOD_SYMBOL_pools
+#define IOD_SYMBOL_pools
+    iod_define_symbol(pools)
+#endif
+
+#ifndef IOD_SYMBOL_port
+#define IOD_SYMBOL_port
+    iod_define_symbol(port)
+#endif
+
+#ifndef IOD_SYMBOL_printinfo
+#define IOD_SYMBOL_printinfo
+    iod_define_symbol(printinfo)
+#endif
+
+#ifndef IOD_SYMBOL_privkey
+#define IOD_SYMBOL_privkey
+    iod_define_symbol(privkey)
+#endif
+
+#ifndef IOD_SYMBOL_pubkey
+#define IOD_SYMBOL_pubkey
+    iod_define_symbol(pubkey)
+#endif
+
+#ifndef IOD_SYMBOL_query
+#define IOD_SYMBOL_query
+    iod_define_symbol(query)
+#endif
+
+#ifndef IOD_SYMBOL_r
+#define IOD_SYMBOL_r
+    iod_define_symbol(r)
+#endif
+
+#ifndef IOD_SYMBOL_realm
+#define IOD_SYMBOL_realm
+    iod_define_symbol(realm)
+#endif
+
+#ifndef IOD_SYMBOL_result
+#define IOD_SYMBOL_result
+    iod_define_symbol(result)
+#endif
+
+#ifndef IOD_SYMBOL_roles
+#define IOD_SYMBOL_roles
+    iod_define_symbol(roles)
+#endif
+
+#ifndef IOD_SYMBOL_root
+#define IOD_SYMBOL_root
+    iod_define_symbol(root)
+#endif
+
+#ifndef IOD_SYMBOL_route
+#define IOD_SYMBOL_route
+    iod_define_symbol(route)
+#endif
+
+#ifndef IOD_SYMBOL_runas
+#define IOD_SYMBOL_runas
+    iod_define_symbol(runas)
+#endif
+
+#ifndef IOD_SYMBOL_rx_bytes
+#define IOD_SYMBOL_rx_bytes
+    iod_define_symbol(rx_bytes)
+#endif
+
+#ifndef IOD_SYMBOL_salt
+#define IOD_SYMBOL_salt
+    iod_define_symbol(salt)
+#endif
+
+#ifndef IOD_SYMBOL_sequence
+#define IOD_SYMBOL_sequence
+    iod_define_symbol(sequence)
+#endif
+
+#ifndef IOD_SYMBOL_shm
+#define IOD_SYMBOL_shm
+    iod_define_symbol(shm)
+#endif
+
+#ifndef IOD_SYMBOL_sink
+#define IOD_SYMBOL_sink
+    iod_define_symbol(sink)
+#endif
+
+#ifndef IOD_SYMBOL_special
+#define IOD_SYMBOL_special
+    iod_define_symbol(special)
+#endif
+
+#ifndef IOD_SYMBOL_status
+#define IOD_SYMBOL_status
+    iod_define_symbol(status)
+#endif
+
+#ifndef IOD_SYMBOL_sub
+#define IOD_SYMBOL_sub
+    iod_define_symbol(sub)
+#endif
+
+#ifndef IOD_SYMBOL_suil
+#define IOD_SYMBOL_suil
+    iod_define_symbol(suil)
+#endif
+
+#ifndef IOD_SYMBOL_t
+#define IOD_SYMBOL_t
+    iod_define_symbol(t)
+#endif
+
+#ifndef IOD_SYMBOL_tag
+#define IOD_SYMBOL_tag
+    iod_define_symbol(tag)
+#endif
+
+#ifndef IOD_SYMBOL_text
+#define IOD_SYMBOL_text
+    iod_define_symbol(text)
+#endif
+
+#ifndef IOD_SYMBOL_timeout
+#define IOD_SYMBOL_timeout
+    iod_define_symbol(timeout)
+#endif
+
+#ifndef IOD_SYMBOL_total_requests
+#define IOD_SYMBOL_total_requests
+    iod_define_symbol(total_requests)
+#endif
+
+#ifndef IOD_SYMBOL_tx_bytes
+#define IOD_SYMBOL_tx_bytes
+    iod_define_symbol(tx_bytes)
+#endif
+
+#ifndef IOD_SYMBOL_typ
+#define IOD_SYMBOL_typ
+    iod_define_symbol(typ)
+#endif
+
+#ifndef IOD_SYMBOL_type
+#define IOD_SYMBOL_type
+    iod_define_symbol(type)
+#endif
+
+#ifndef IOD_SYMBOL_uid
+#define IOD_SYMBOL_uid
+    iod_define_symbol(uid)
+#endif
+
+#ifndef IOD_SYMBOL_unwire
+#define IOD_SYMBOL_unwire
+    iod_define_symbol(unwire)
+#endif
+
+#ifndef IOD_SYMBOL_upper
+#define IOD_SYMBOL_upper
+    iod_define_symbol(upper)
+#endif
+
+#ifndef IOD_SYMBOL_use_pool
+#define IOD_SYMBOL_use_pool
+    iod_define_symbol(use_pool)
+#endif
+
+#ifndef IOD_SYMBOL_username
+#define IOD_SYMBOL_username
+    iod_define_symbol(username)
+#endif
+
+#ifndef IOD_SYMBOL_v
+#define IOD_SYMBOL_v
+    iod_define_symbol(v)
+#endif
+
+#ifndef IOD_SYMBOL_val
+#define IOD_SYMBOL_val
+    iod_define_symbol(val)
+#endif
+
+#ifndef IOD_SYMBOL_vbuild
+#define IOD_SYMBOL_vbuild
+    iod_define_symbol(vbuild)
+#endif
+
+#ifndef IOD_SYMBOL_vdate
+#define IOD_SYMBOL_vdate
+    iod_define_symbol(vdate)
+#endif
+
+#ifndef IOD_SYMBOL_verbose
+#define IOD_SYMBOL_verbose
+    iod_define_symbol(verbose)
+#endif
+
+#ifndef IOD_SYMBOL_verified
+#define IOD_SYMBOL_verified
+    iod_define_symbol(verified)
+#endif
+
+#ifndef IOD_SYMBOL_version
+#define IOD_SYMBOL_version
+    iod_define_symbol(version)
+#endif
+
+#ifndef IOD_SYMBOL_vmajor
+#define IOD_SYMBOL_vmajor
+    iod_define_symbol(vmajor)
+#endif
+
+#ifndef IOD_SYMBOL_vminor
+#define IOD_SYMBOL_vminor
+    iod_define_symbol(vminor)
+#endif
+
+#ifndef IOD_SYMBOL_vpatch
+#define IOD_SYMBOL_vpatch
+    iod_define_symbol(vpatch)
+#endif
+
+#ifndef IOD_SYMBOL_vsoftware
+#define IOD_SYMBOL_vsoftware
+    iod_define_symbol(vsoftware)
+#endif
+
+#ifndef IOD_SYMBOL_vtag
+#define IOD_SYMBOL_vtag
+    iod_define_symbol(vtag)
+#endif
+
+#ifndef IOD_SYMBOL_vtime
+#define IOD_SYMBOL_vtime
+    iod_define_symbol(vtime)
+#endif
+
+#ifndef IOD_SYMBOL_wdir
+#define IOD_SYMBOL_wdir
+    iod_define_symbol(wdir)
+#endif
+
+#ifndef IOD_SYMBOL_worker
+#define IOD_SYMBOL_worker
+    iod_define_symbol(worker)
+#endif
+
@@ -359,12 +359,21 @@ namespace suil {
          * convert given number to string
          * @tparam T the type of number to convert
          * @param v the number to convert
-         * @return converts the number to string using std::to_string
+         * @return converts the number to string, floating point numbers are
+         * converted using std::to_string
          */
         template<typename T>
         inline auto tostr(T v) -> typename std::enable_if<std::is_arithmetic<T>::value, String>::type {
-            auto tmp = std::to_string(v);
-            return String(tmp.c_str(), tmp.size(), false).dup();
+            if constexpr (std::is_integral<T>::value) {
+                char tmp[numfmt::MAX_INTEGER];
+                size_t n = std::is_signed<T>::value?
+                           numfmt::itoa((int64_t) v, tmp) : numfmt::utoa((uint64_t) v, tmp);
+                return String(tmp, n, false).dup();
+            }
+            else {
+                auto tmp = std::to_string(v);
+                return String(tmp.c_str(), tmp.size(), false).dup();
+            }
         }
 
         /**
@@ -40,6 +40,62 @@ namespace test {
 #define TEST_IOD_SYMBOL_f
     iod_define_symbol(f)
 #endif
+#ifndef TEST_IOD_SYMBOL_g
+#define TEST_IOD_SYMBOL_g
+    iod_define_symbol(g)
+#endif
+#ifndef TEST_IOD_SYMBOL_h
+#define TEST_IOD_SYMBOL_h
+    iod_define_symbol(h)
+#endif
+#ifndef TEST_IOD_SYMBOL_i
+#define TEST_IOD_SYMBOL_i
+    iod_define_symbol(i)
+#endif
+#ifndef TEST_IOD_SYMBOL_j
+#define TEST_IOD_SYMBOL_j
+    iod_define_symbol(j)
+#endif
+#ifndef TEST_IOD_SYMBOL_k
+#define TEST_IOD_SYMBOL_k
+    iod_define_symbol(k)
+#endif
+#ifndef TEST_IOD_SYMBOL_l
+#define TEST_IOD_SYMBOL_l
+    iod_define_symbol(l)
+#endif
+#ifndef TEST_IOD_SYMBOL_m
+#define TEST_IOD_SYMBOL_m
+    iod_define_symbol(m)
+#endif
+#ifndef TEST_IOD_SYMBOL_n
+#define TEST_IOD_SYMBOL_n
+    iod_define_symbol(n)
+#endif
+#ifndef TEST_IOD_SYMBOL_o
+#define TEST_IOD_SYMBOL_o
+    iod_define_symbol(o)
+#endif
+#ifndef TEST_IOD_SYMBOL_p
+#define TEST_IOD_SYMBOL_p
+    iod_define_symbol(p)
+#endif
+#ifndef TEST_IOD_SYMBOL_q
+#define TEST_IOD_SYMBOL_q
+    iod_define_symbol(q)
+#endif
+#ifndef TEST_IOD_SYMBOL_r
+#define TEST_IOD_SYMBOL_r
+    iod_define_symbol(r)
+#endif
+#ifndef TEST_IOD_SYMBOL_s
+#define TEST_IOD_SYMBOL_s
+    iod_define_symbol(s)
+#endif
+#ifndef TEST_IOD_SYMBOL_t
+#define TEST_IOD_SYMBOL_t
+    iod_define_symbol(t)
+#endif
 
 }
 #endif //SUIL_TEST_SYMBOLS_H